@@ -49,6 +49,8 @@ typedef struct ldb_handler_s ldb_handler_t;
 typedef struct ldb_iter_s ldb_iter_t;
 typedef struct ldb_logger_s ldb_logger_t;
 typedef struct ldb_lru_s ldb_lru_t;
+typedef struct ldb_pinned_s ldb_pinned_t;
+typedef struct ldb_prefix_s ldb_prefix_t;
 typedef struct ldb_readopt_s ldb_readopt_t;
 typedef struct ldb_snapshot_s ldb_snapshot_t;
 typedef struct ldb_writeopt_s ldb_writeopt_t;
@@ -136,6 +138,12 @@ ldb_batch_append(ldb_batch_t *dst, const ldb_batch_t *src);
 ldb_bloom_t *
 ldb_bloom_create(int bits_per_key);
 
+ldb_bloom_t *
+ldb_bloom_create_blocked(int bits_per_key);
+
+ldb_bloom_t *
+ldb_bloom_create_ribbon(int bits_per_key, int bloom_before_level);
+
 void
 ldb_bloom_destroy(ldb_bloom_t *bloom);
 
@@ -148,6 +156,9 @@ extern const ldb_bloom_t *ldb_bloom_default;
 ldb_lru_t *
 ldb_lru_create(size_t capacity);
 
+ldb_lru_t *
+ldb_lru_create_clock(size_t capacity);
+
 void
 ldb_lru_destroy(ldb_lru_t *lru);
 
@@ -174,6 +185,16 @@ extern const ldb_comparator_t *ldb_bytewise_comparator;
  * Database
  */
 
+struct ldb_pinned_s {
+  ldb_slice_t value;
+  struct {
+    void (*func)(void *, void *);
+    void *arg1;
+    void *arg2;
+    void *next;
+  } _cleanup;
+};
+
 int
 ldb_open(const char *dbname, const ldb_dbopt_t *options, ldb_t **dbptr);
 
@@ -185,6 +206,21 @@ ldb_get(ldb_t *db, const ldb_slice_t *key,
                    ldb_slice_t *value,
                    const ldb_readopt_t *options);
 
+int
+ldb_get_pinned(ldb_t *db, const ldb_slice_t *key,
+                          ldb_pinned_t *value,
+                          const ldb_readopt_t *options);
+
+void
+ldb_release_pinned(ldb_pinned_t *value);
+
+int
+ldb_multi_get(ldb_t *db, const ldb_slice_t *keys,
+                         size_t count,
+                         ldb_slice_t *values,
+                         int *statuses,
+                         const ldb_readopt_t *options);
+
 int
 ldb_has(ldb_t *db, const ldb_slice_t *key, const ldb_readopt_t *options);
 
@@ -314,12 +350,25 @@ struct ldb_dbopt_s {
   int reuse_logs;
   const ldb_bloom_t *filter_policy;
   int use_mmap;
+  int max_background_compactions;
+  int max_subcompactions;
+  int full_filter;
+  ldb_lru_t *row_cache;
+  const ldb_prefix_t *prefix_extractor;
+  int concurrent_memtable_writes;
+  int pipelined_write;
+  int group_commit;
+  int group_commit_delay;
 };
 
 struct ldb_readopt_s {
   int verify_checksums;
   int fill_cache;
   const ldb_snapshot_t *snapshot;
+  const ldb_slice_t *iterate_lower_bound;
+  const ldb_slice_t *iterate_upper_bound;
+  int prefix_same_as_start;
+  int prefetch_blocks;
 };
 
 struct ldb_writeopt_s {
@@ -331,6 +380,24 @@ extern const ldb_readopt_t *ldb_readopt_default;
 extern const ldb_writeopt_t *ldb_writeopt_default;
 extern const ldb_readopt_t *ldb_iteropt_default;
 
+/*
+ * Prefix
+ */
+
+struct ldb_prefix_s {
+  const char *name;
+  ldb_slice_t (*transform)(const ldb_prefix_t *, const ldb_slice_t *);
+  int (*in_domain)(const ldb_prefix_t *, const ldb_slice_t *);
+  size_t length;
+  void *state;
+};
+
+ldb_prefix_t *
+ldb_prefix_create_fixed(size_t length);
+
+void
+ldb_prefix_destroy(ldb_prefix_t *prefix);
+
 /*
  * Slice
  */
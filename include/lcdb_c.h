@@ -73,6 +73,7 @@ enum {
 #define leveldb_delete ldb__leveldb_delete
 #define leveldb_write ldb__leveldb_write
 #define leveldb_get ldb__leveldb_get
+#define leveldb_multi_get ldb__leveldb_multi_get
 #define leveldb_create_iterator ldb__leveldb_create_iterator
 #define leveldb_create_snapshot ldb__leveldb_create_snapshot
 #define leveldb_release_snapshot ldb__leveldb_release_snapshot
@@ -168,6 +169,18 @@ leveldb_get(leveldb_t *db, const leveldb_readoptions_t *options,
                            const char *key, size_t keylen,
                            size_t *vallen, char **errptr);
 
+/* Values and errors are returned per key. A missing key yields a
+   NULL value and a NULL error. Values must be freed with
+   leveldb_free(). */
+LDB_EXTERN void
+leveldb_multi_get(leveldb_t *db, const leveldb_readoptions_t *options,
+                                 size_t num_keys,
+                                 const char *const *keys_list,
+                                 const size_t *keys_list_sizes,
+                                 char **values_list,
+                                 size_t *values_list_sizes,
+                                 char **errs);
+
 LDB_EXTERN leveldb_iterator_t *
 leveldb_create_iterator(leveldb_t *db, const leveldb_readoptions_t *options);
 
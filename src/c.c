@@ -172,6 +172,50 @@ leveldb_get(leveldb_t *db, const leveldb_readoptions_t *options,
   return result;
 }
 
+void
+leveldb_multi_get(leveldb_t *db, const leveldb_readoptions_t *options,
+                                 size_t num_keys,
+                                 const char *const *keys_list,
+                                 const size_t *keys_list_sizes,
+                                 char **values_list,
+                                 size_t *values_list_sizes,
+                                 char **errs) {
+  ldb_slice_t *keys, *values;
+  int *statuses;
+  size_t i;
+
+  if (num_keys == 0)
+    return;
+
+  keys = ldb_malloc(num_keys * sizeof(ldb_slice_t));
+  values = ldb_malloc(num_keys * sizeof(ldb_slice_t));
+  statuses = ldb_malloc(num_keys * sizeof(int));
+
+  for (i = 0; i < num_keys; i++)
+    keys[i] = ldb_slice((const uint8_t *)keys_list[i], keys_list_sizes[i]);
+
+  ldb_multi_get(db, keys, num_keys, values, statuses, options);
+
+  for (i = 0; i < num_keys; i++) {
+    errs[i] = NULL;
+
+    if (statuses[i] == LDB_OK) {
+      values_list[i] = (char *)values[i].data;
+      values_list_sizes[i] = values[i].size;
+    } else {
+      values_list[i] = NULL;
+      values_list_sizes[i] = 0;
+
+      if (statuses[i] != LDB_NOTFOUND)
+        save_error(&errs[i], statuses[i]);
+    }
+  }
+
+  ldb_free(statuses);
+  ldb_free(values);
+  ldb_free(keys);
+}
+
 leveldb_iterator_t *
 leveldb_create_iterator(leveldb_t *db, const leveldb_readoptions_t *options) {
   return ldb_iterator(db, options);
@@ -283,6 +283,29 @@ int ldb_test_c(void) {
     leveldb_writebatch_destroy(wb);
   }
 
+  StartPhase("multiget");
+  {
+    const char* keys[3] = { "foo", "bar", "box" };
+    size_t keys_sizes[3] = { 3, 3, 3 };
+    char* vals[3];
+    size_t vals_sizes[3];
+    char* errs[3];
+    int i;
+
+    leveldb_multi_get(db, roptions, 3, keys, keys_sizes,
+                      vals, vals_sizes, errs);
+
+    for (i = 0; i < 3; i++)
+      CheckNoError(errs[i]);
+
+    CheckEqual("hello", vals[0], vals_sizes[0]);
+    CheckEqual(NULL, vals[1], vals_sizes[1]);
+    CheckEqual("c", vals[2], vals_sizes[2]);
+
+    for (i = 0; i < 3; i++)
+      Free(&vals[i]);
+  }
+
   StartPhase("iter");
   {
     leveldb_iterator_t* iter = leveldb_create_iterator(db, roptions);
@@ -14,6 +14,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "table/iterator.h"
 #include "table/merger.h"
@@ -31,6 +32,7 @@
 #include "util/internal.h"
 #include "util/options.h"
 #include "util/port.h"
+#include "util/prefix.h"
 #include "util/rbt.h"
 #include "util/slice.h"
 #include "util/status.h"
@@ -111,14 +113,33 @@ ldb_cstats_add(ldb_cstats_t *z, const ldb_cstats_t *x) {
  * DBImpl::Writer
  */
 
+/* Writer states. A writer starts out waiting and is moved along by
+   whoever owns the group it belongs to; only the writer itself may
+   move into LDB_WRITER_BLOCKED, which means it has stopped spinning
+   and is sleeping on its condition variable. */
+#define LDB_WRITER_WAITING 1
+#define LDB_WRITER_LEADER 2    /* Now at the front of the queue. */
+#define LDB_WRITER_INSERT 4    /* Must insert its own batch. */
+#define LDB_WRITER_INSERTED 8  /* All followers have inserted (leader). */
+#define LDB_WRITER_COMPLETED 16
+#define LDB_WRITER_BLOCKED 32
+
+/* Number of polls before a waiting writer goes to sleep. */
+#define LDB_WRITER_SPINS 200
+
 /* Information kept for every waiting writer. */
 typedef struct ldb_writer_s {
   int status;
   ldb_batch_t *batch;
   int sync;
-  int done;
+  ldb_atomic(int) state;
+  ldb_atomic(int) pending; /* Group members still inserting (leader only). */
+  struct ldb_writer_s *leader;
+  ldb_memtable_t *mem; /* Memtable to insert into (followers only). */
+  struct ldb_writer_s *link_older; /* Set when joining the queue. */
+  struct ldb_writer_s *link_newer; /* Filled in lazily by the leader. */
+  ldb_mutex_t mutex;
   ldb_cond_t cv;
-  struct ldb_writer_s *next;
 } ldb_writer_t;
 
 static void
@@ -126,63 +147,180 @@ ldb_writer_init(ldb_writer_t *w) {
   w->status = LDB_OK;
   w->batch = NULL;
   w->sync = 0;
-  w->done = 0;
-  w->next = NULL;
-
+  w->state = LDB_WRITER_WAITING;
+  w->pending = 0;
+  w->leader = NULL;
+  w->mem = NULL;
+  w->link_older = NULL;
+  w->link_newer = NULL;
+
+  ldb_mutex_init(&w->mutex);
   ldb_cond_init(&w->cv);
 }
 
 static void
 ldb_writer_clear(ldb_writer_t *w) {
   ldb_cond_destroy(&w->cv);
+  ldb_mutex_destroy(&w->mutex);
+}
+
+/* Move "w" into a new state, waking it if it is asleep. The writer
+   may return as soon as this is done; "w" must not be touched after. */
+static void
+ldb_writer_set_state(ldb_writer_t *w, int state) {
+  int old = ldb_atomic_load(&w->state, ldb_order_acquire);
+
+  if (old != LDB_WRITER_BLOCKED) {
+    if (ldb_atomic_compare_exchange(&w->state, old, state,
+                                    ldb_order_acq_rel)) {
+      return;
+    }
+
+    /* The writer went to sleep in the meantime. */
+  }
+
+  ldb_mutex_lock(&w->mutex);
+
+  assert(ldb_atomic_load(&w->state, ldb_order_relaxed) == LDB_WRITER_BLOCKED);
+
+  ldb_atomic_store(&w->state, state, ldb_order_release);
+
+  ldb_cond_signal(&w->cv);
+  ldb_mutex_unlock(&w->mutex);
 }
 
 /*
  * Writer Queue
  */
 
+/* The queue is a lock-free stack of writers linked from the newest
+   one back to the current leader. Joining is a single CAS. The
+   leader fills in the forward links when it needs to walk its group
+   and hands off to the writer behind the group once it is done, so
+   no lock is taken to enqueue or to be woken. */
 typedef struct ldb_queue_s {
-  ldb_writer_t *head;
-  ldb_writer_t *tail;
-  int length;
+  ldb_atomic_ptr(ldb_writer_t) newest;
+  /* Adjusts how eagerly waiters spin, based on whether
+     spinning has paid off recently. Updated racily. */
+  ldb_atomic(int) spin_credit;
 } ldb_queue_t;
 
 static void
 ldb_queue_init(ldb_queue_t *queue) {
-  queue->head = NULL;
-  queue->tail = NULL;
-  queue->length = 0;
+  queue->newest = NULL;
+  queue->spin_credit = 0;
 }
 
-static void
+static int
+ldb_queue_empty(ldb_queue_t *queue) {
+  return ldb_atomic_load_ptr(&queue->newest, ldb_order_acquire) == NULL;
+}
+
+/* Add "writer" to the queue. Returns true if the
+   queue was empty and the writer is now its leader. */
+static int
 ldb_queue_push(ldb_queue_t *queue, ldb_writer_t *writer) {
-  if (queue->head == NULL)
-    queue->head = writer;
+  ldb_writer_t *newest;
 
-  if (queue->tail != NULL)
-    queue->tail->next = writer;
+  do {
+    newest = ldb_atomic_load_ptr(&queue->newest, ldb_order_relaxed);
+    writer->link_older = newest;
+  } while (!ldb_atomic_compare_exchange_ptr(&queue->newest, newest, writer,
+                                            ldb_order_release));
 
-  queue->tail = writer;
-  queue->length++;
+  return newest == NULL;
 }
 
+/* Link every writer between the leader and the newest
+   writer to its successor. Returns the newest writer. */
+/* REQUIRES: called by the leader. */
 static ldb_writer_t *
-ldb_queue_shift(ldb_queue_t *queue) {
-  ldb_writer_t *writer = queue->head;
+ldb_queue_link(ldb_queue_t *queue) {
+  ldb_writer_t *newest = ldb_atomic_load_ptr(&queue->newest,
+                                             ldb_order_acquire);
+  ldb_writer_t *writer = newest;
+
+  /* The leader has no older link, and everything
+     before the first unlinked writer is linked. */
+  while (writer->link_older != NULL && writer->link_older->link_newer == NULL) {
+    writer->link_older->link_newer = writer;
+    writer = writer->link_older;
+  }
+
+  return newest;
+}
+
+/* Make the writer after "last" the leader, if there is one. */
+/* REQUIRES: called by the leader; "last" ends its group. */
+static void
+ldb_queue_advance(ldb_queue_t *queue, ldb_writer_t *last) {
+  ldb_writer_t *next;
+
+  if (ldb_atomic_load_ptr(&queue->newest, ldb_order_acquire) == last) {
+    if (ldb_atomic_compare_exchange_ptr(&queue->newest, last, NULL,
+                                        ldb_order_acq_rel)) {
+      return;
+    }
+  }
+
+  /* Someone has joined behind "last". */
+  ldb_queue_link(queue);
+
+  next = last->link_newer;
 
-  if (writer == NULL)
-    abort(); /* LCOV_EXCL_LINE */
+  assert(next != NULL);
 
-  queue->head = writer->next;
+  next->link_older = NULL;
 
-  if (queue->head == NULL)
-    queue->tail = NULL;
+  ldb_writer_set_state(next, LDB_WRITER_LEADER);
+}
+
+/* Wait until the state of "w" is one of those in "mask". Spin
+   briefly first, since the wait is usually only as long as one
+   WAL append, and fall back to sleeping if that does not pay off. */
+static int
+ldb_queue_await(ldb_queue_t *queue, ldb_writer_t *w, int mask) {
+  int credit = ldb_atomic_load(&queue->spin_credit, ldb_order_relaxed);
+  int state, i;
+
+  if (credit >= 0) {
+    for (i = 0; i < LDB_WRITER_SPINS; i++) {
+      state = ldb_atomic_load(&w->state, ldb_order_acquire);
+
+      if (state & mask) {
+        if (credit < 64)
+          ldb_atomic_fetch_add(&queue->spin_credit, 1, ldb_order_relaxed);
+
+        return state;
+      }
+    }
+
+    ldb_atomic_fetch_sub(&queue->spin_credit, 8, ldb_order_relaxed);
+  } else {
+    /* Recover slowly so that spinning is retried now and then. */
+    ldb_atomic_fetch_add(&queue->spin_credit, 1, ldb_order_relaxed);
+  }
+
+  ldb_mutex_lock(&w->mutex);
+
+  for (;;) {
+    state = ldb_atomic_load(&w->state, ldb_order_acquire);
+
+    if (state & mask)
+      break;
 
-  queue->length--;
+    if (state == LDB_WRITER_BLOCKED) {
+      ldb_cond_wait(&w->cv, &w->mutex);
+      continue;
+    }
+
+    ldb_atomic_compare_exchange(&w->state, state, LDB_WRITER_BLOCKED,
+                                ldb_order_acq_rel);
+  }
 
-  writer->next = NULL;
+  ldb_mutex_unlock(&w->mutex);
 
-  return writer;
+  return state;
 }
 
 /*
@@ -339,6 +477,24 @@ ldb_sanitize_options(const char *dbname,
   clip_to_range(result.write_buffer_size, 64 << 10, 1 << 30);
   clip_to_range(result.max_file_size, 1 << 20, 1 << 30);
   clip_to_range(result.block_size, 1 << 10, 4 << 20);
+  clip_to_range(result.max_background_compactions, 1, 64);
+  clip_to_range(result.max_subcompactions, 1, 64);
+  clip_to_range(result.group_commit_delay, 0, 1000000);
+
+#if !defined(_WIN32) && !defined(LDB_PTHREAD)
+  /* Background work runs inline without threads. */
+  result.max_background_compactions = 1;
+  result.max_subcompactions = 1;
+  result.concurrent_memtable_writes = 0;
+  result.pipelined_write = 0;
+  result.group_commit = 0;
+#endif
+
+  /* Group commit relies on the pipeline to overlap syncs with logging. */
+  if (result.group_commit)
+    result.pipelined_write = 1;
+  else
+    result.group_commit_delay = 0;
 
   if (result.info_log == NULL) {
     char info[LDB_PATH_MAX];
@@ -376,6 +532,29 @@ table_cache_size(const ldb_dbopt_t *sanitized_options) {
   return sanitized_options->max_open_files - non_table_cache_files;
 }
 
+/*
+ * SuperVersion
+ */
+
+/* An immutable view of the memtables and the current version which
+   point reads acquire without taking the mutex. A new one is installed
+   whenever mem, imm or the current version changes. */
+typedef struct ldb_super_s {
+  ldb_memtable_t *mem;
+  ldb_memtable_t *imm;
+  ldb_version_t *current;
+  ldb_atomic(int) refs;
+} ldb_super_t;
+
+/* The last sequence number is mirrored for lock-free reads wherever
+   64-bit atomic loads are available. Elsewhere it is read under the
+   mutex (which is still a single short critical section). */
+#if defined(LDB_CLANG_ATOMICS) && defined(__SIZEOF_POINTER__)
+#  if __SIZEOF_POINTER__ >= 8
+#    define LDB_ATOMIC_SEQUENCE
+#  endif
+#endif
+
 /*
  * DBImpl
  */
@@ -386,6 +565,7 @@ struct ldb_s {
   ldb_bloom_t user_filter_policy;
   ldb_comparator_t internal_comparator;
   ldb_bloom_t internal_filter_policy;
+  ldb_bloom_t level_filter_policy[LDB_NUM_LEVELS]; /* For building tables. */
   ldb_dbopt_t options; /* options.comparator == &internal_comparator */
   int owns_info_log;
   int owns_cache;
@@ -403,7 +583,6 @@ struct ldb_s {
   ldb_cond_t background_work_finished_signal;
   ldb_memtable_t *mem;
   ldb_memtable_t *imm; /* Memtable being compacted. */
-  ldb_atomic(int) has_imm; /* So bg thread can detect non-null imm. */
   ldb_wfile_t *logfile;
   uint64_t logfile_number;
   ldb_logwriter_t *log;
@@ -411,7 +590,32 @@ struct ldb_s {
 
   /* Queue of writers. */
   ldb_queue_t writers;
-  ldb_batch_t *tmp_batch;
+
+  /* Pieces of the log record for the group being written: a batch
+     header followed by the body of each batch in the group. Only
+     touched by the writer at the front of the queue. */
+  ldb_slice_t *group_iov;
+  size_t group_alloc;
+
+  /* Groups that have been logged but not yet applied to the
+     memtable (pipelined writes). Each group takes a ticket when it
+     is logged and applies its batches once pipeline_head reaches
+     it. The memtable is never switched while a group is in flight. */
+  uint64_t pipeline_head;
+  uint64_t pipeline_tail;
+  ldb_seqnum_t pipeline_sequence; /* Last sequence handed out. */
+  ldb_cond_t pipeline_signal;
+
+  /* Log syncs for group commit. A sync group bumps log_sync_requested
+     once its record is written and waits for log_synced to catch up.
+     The sync job covers every group logged before it started, so
+     groups logged during one sync share the next. */
+  ldb_pool_t *sync_pool;
+  int log_sync_scheduled;
+  uint64_t log_sync_requested;
+  uint64_t log_synced;
+  int log_sync_error;
+  ldb_cond_t log_synced_signal;
 
   ldb_snaplist_t snapshots;
 
@@ -419,11 +623,19 @@ struct ldb_s {
      part of ongoing compactions. */
   rb_set64_t pending_outputs;
 
-  /* Thread pool. */
+  /* Thread pools. Memtable flushes get their own thread so
+     that they never have to wait behind a long compaction. */
+  ldb_pool_t *flush_pool;
   ldb_pool_t *pool;
 
-  /* Has a background compaction been scheduled or is running? */
-  int background_compaction_scheduled;
+  /* Has a memtable flush been scheduled or is running? */
+  int background_flush_scheduled;
+
+  /* Number of background compactions scheduled or running. */
+  int background_compactions_scheduled;
+
+  /* Number of compactions which have picked their inputs. */
+  int compactions_in_progress;
 
   ldb_manual_t *manual_compaction;
 
@@ -433,8 +645,196 @@ struct ldb_s {
   int bg_error;
 
   ldb_cstats_t stats[LDB_NUM_LEVELS];
+
+  /* Number of times writers were delayed or blocked by
+     ldb_make_room_for_write() (once per call, however many
+     waits it took), and the total micros spent waiting. */
+  uint64_t stall_count;
+  int64_t stall_micros;
+
+  /* Super version published to readers. Superseded versions are
+     retired and destroyed (with the mutex held) once no reader can
+     still be acquiring them. Whoever drops the last reference to a
+     retired version, or is the last reader to leave while a reclaim
+     is pending, destroys it. */
+  ldb_atomic_ptr(ldb_super_t) super;
+  ldb_atomic(int) super_readers;
+  ldb_atomic(int) reclaim_pending;
+  ldb_vector_t retired; /* ldb_super_t */
+
+#ifdef LDB_ATOMIC_SEQUENCE
+  ldb_atomic(uint64_t) last_sequence;
+#endif
 };
 
+/*
+ * SuperVersion
+ */
+
+static ldb_super_t *
+ldb_super_create(ldb_memtable_t *mem,
+                 ldb_memtable_t *imm,
+                 ldb_version_t *current) {
+  ldb_super_t *sv = ldb_malloc(sizeof(ldb_super_t));
+
+  /* ldb_mutex_assert_held(&db->mutex); */
+
+  sv->mem = mem;
+  sv->imm = imm;
+  sv->current = current;
+  sv->refs = 1;
+
+  ldb_memtable_ref(mem);
+
+  if (imm != NULL)
+    ldb_memtable_ref(imm);
+
+  ldb_version_ref(current);
+
+  return sv;
+}
+
+static void
+ldb_super_destroy(ldb_super_t *sv) {
+  /* ldb_mutex_assert_held(&db->mutex); */
+
+  ldb_memtable_unref(sv->mem);
+
+  if (sv->imm != NULL)
+    ldb_memtable_unref(sv->imm);
+
+  ldb_version_unref(sv->current);
+
+  ldb_free(sv);
+}
+
+/* Destroy retired super versions which are no longer referenced. */
+static void
+ldb_reclaim_supers(ldb_t *db) {
+  size_t i, j;
+
+  /* ldb_mutex_assert_held(&db->mutex); */
+
+  /* A reader is counted in super_readers from before it loads the
+     pointer until after it has taken its reference. Once the count
+     is seen at zero, nothing can acquire a retired version anymore,
+     so one with no references is garbage. Otherwise leave the sweep
+     to the last reader out (see ldb_acquire_super). */
+  ldb_atomic_store(&db->reclaim_pending, 1, ldb_order_seq_cst);
+
+  if (ldb_atomic_load(&db->super_readers, ldb_order_seq_cst) != 0)
+    return;
+
+  ldb_atomic_store(&db->reclaim_pending, 0, ldb_order_seq_cst);
+
+  for (i = 0, j = 0; i < db->retired.length; i++) {
+    ldb_super_t *sv = db->retired.items[i];
+
+    if (ldb_atomic_load(&sv->refs, ldb_order_acquire) == 0)
+      ldb_super_destroy(sv);
+    else
+      db->retired.items[j++] = sv;
+  }
+
+  db->retired.length = j;
+}
+
+/* Publish the current mem, imm and version to readers. */
+static void
+ldb_install_super(ldb_t *db) {
+  ldb_super_t *old = ldb_atomic_load_ptr(&db->super, ldb_order_relaxed);
+  ldb_version_t *current = ldb_vset_current(db->versions);
+  ldb_super_t *sv;
+
+  /* ldb_mutex_assert_held(&db->mutex); */
+
+  if (old != NULL && old->mem == db->mem
+                  && old->imm == db->imm
+                  && old->current == current) {
+    return;
+  }
+
+  sv = ldb_super_create(db->mem, db->imm, current);
+
+  ldb_atomic_store_ptr(&db->super, sv, ldb_order_seq_cst);
+
+  if (old != NULL) {
+    ldb_atomic_fetch_sub(&old->refs, 1, ldb_order_acq_rel);
+    ldb_vector_push(&db->retired, old);
+  }
+
+  ldb_reclaim_supers(db);
+}
+
+static void
+ldb_reclaim_supers_locked(ldb_t *db) {
+  ldb_mutex_lock(&db->mutex);
+  ldb_reclaim_supers(db);
+  ldb_mutex_unlock(&db->mutex);
+}
+
+static ldb_super_t *
+ldb_acquire_super(ldb_t *db) {
+  ldb_super_t *sv;
+
+  ldb_atomic_fetch_add(&db->super_readers, 1, ldb_order_seq_cst);
+
+  sv = ldb_atomic_load_ptr(&db->super, ldb_order_seq_cst);
+
+  ldb_atomic_fetch_add(&sv->refs, 1, ldb_order_seq_cst);
+
+  /* A reclaim which saw us in flight was deferred to the last reader. */
+  if (ldb_atomic_fetch_sub(&db->super_readers, 1, ldb_order_seq_cst) == 1) {
+    if (ldb_atomic_load(&db->reclaim_pending, ldb_order_seq_cst))
+      ldb_reclaim_supers_locked(db);
+  }
+
+  return sv;
+}
+
+static void
+ldb_release_super(ldb_t *db, ldb_super_t *sv) {
+  /* The published version holds a reference of its own, so only
+     a retired one can drop to zero here. Free it right away rather
+     than leaving its memtables and files pinned until the next
+     install. */
+  if (ldb_atomic_fetch_sub(&sv->refs, 1, ldb_order_acq_rel) == 1)
+    ldb_reclaim_supers_locked(db);
+}
+
+/* Publish the last sequence number to lock-free readers. */
+static void
+ldb_publish_sequence(ldb_t *db) {
+#ifdef LDB_ATOMIC_SEQUENCE
+  ldb_atomic_store(&db->last_sequence,
+                   ldb_vset_last_sequence(db->versions),
+                   ldb_order_release);
+#else
+  (void)db;
+#endif
+}
+
+static ldb_seqnum_t
+ldb_visible_sequence(ldb_t *db) {
+#ifdef LDB_ATOMIC_SEQUENCE
+  return ldb_atomic_load(&db->last_sequence, ldb_order_acquire);
+#else
+  ldb_seqnum_t seq;
+
+  ldb_mutex_lock(&db->mutex);
+
+  seq = ldb_vset_last_sequence(db->versions);
+
+  ldb_mutex_unlock(&db->mutex);
+
+  return seq;
+#endif
+}
+
+/*
+ * DBImpl
+ */
+
 static ldb_t *
 ldb_create(const char *dbname, const ldb_dbopt_t *options) {
   ldb_t *db = ldb_malloc(sizeof(ldb_t));
@@ -452,6 +852,13 @@ ldb_create(const char *dbname, const ldb_dbopt_t *options) {
     }
   }
 
+  if (options->prefix_extractor != NULL) {
+    if (strlen(options->prefix_extractor->name) > 64) {
+      ldb_free(db);
+      return NULL;
+    }
+  }
+
   if (options->comparator != NULL) {
     db->user_comparator = *options->comparator;
     ldb_ikc_init(&db->internal_comparator, &db->user_comparator);
@@ -466,6 +873,12 @@ ldb_create(const char *dbname, const ldb_dbopt_t *options) {
     ldb_ifp_init(&db->internal_filter_policy, ldb_bloom_default);
   }
 
+  for (i = 0; i < LDB_NUM_LEVELS; i++) {
+    const ldb_bloom_t *policy = db->internal_filter_policy.user_policy;
+
+    ldb_ifp_init(&db->level_filter_policy[i], ldb_bloom_for_level(policy, i));
+  }
+
   db->options = ldb_sanitize_options(db->dbname,
                                      &db->internal_comparator,
                                      &db->internal_filter_policy,
@@ -490,7 +903,6 @@ ldb_create(const char *dbname, const ldb_dbopt_t *options) {
 
   db->mem = NULL;
   db->imm = NULL;
-  db->has_imm = 0;
   db->logfile = NULL;
   db->logfile_number = 0;
   db->log = NULL;
@@ -498,13 +910,30 @@ ldb_create(const char *dbname, const ldb_dbopt_t *options) {
 
   ldb_queue_init(&db->writers);
 
-  db->tmp_batch = ldb_batch_create();
+  db->group_iov = NULL;
+  db->group_alloc = 0;
+  db->pipeline_head = 0;
+  db->pipeline_tail = 0;
+  db->pipeline_sequence = 0;
+
+  ldb_cond_init(&db->pipeline_signal);
+
+  db->sync_pool = db->options.group_commit ? ldb_pool_create(1) : NULL;
+  db->log_sync_scheduled = 0;
+  db->log_sync_requested = 0;
+  db->log_synced = 0;
+  db->log_sync_error = LDB_OK;
+
+  ldb_cond_init(&db->log_synced_signal);
 
   ldb_snaplist_init(&db->snapshots);
   rb_set64_init(&db->pending_outputs);
 
-  db->pool = ldb_pool_create(1);
-  db->background_compaction_scheduled = 0;
+  db->flush_pool = ldb_pool_create(1);
+  db->pool = ldb_pool_create(db->options.max_background_compactions);
+  db->background_flush_scheduled = 0;
+  db->background_compactions_scheduled = 0;
+  db->compactions_in_progress = 0;
   db->manual_compaction = NULL;
 
   db->versions = ldb_vset_create(db->dbname,
@@ -517,6 +946,19 @@ ldb_create(const char *dbname, const ldb_dbopt_t *options) {
   for (i = 0; i < LDB_NUM_LEVELS; i++)
     ldb_cstats_init(&db->stats[i]);
 
+  db->stall_count = 0;
+  db->stall_micros = 0;
+
+  db->super = NULL;
+  db->super_readers = 0;
+  db->reclaim_pending = 0;
+
+  ldb_vector_init(&db->retired);
+
+#ifdef LDB_ATOMIC_SEQUENCE
+  db->last_sequence = 0;
+#endif
+
   return db;
 }
 
@@ -527,16 +969,38 @@ ldb_destroy(ldb_t *db) {
 
   ldb_atomic_store(&db->shutting_down, 1, ldb_order_release);
 
-  while (db->background_compaction_scheduled)
+  while (db->background_flush_scheduled ||
+         db->background_compactions_scheduled > 0) {
     ldb_cond_wait(&db->background_work_finished_signal, &db->mutex);
+  }
+
+  while (db->log_sync_scheduled)
+    ldb_cond_wait(&db->log_synced_signal, &db->mutex);
 
   ldb_mutex_unlock(&db->mutex);
 
+  ldb_pool_destroy(db->flush_pool);
   ldb_pool_destroy(db->pool);
 
+  if (db->sync_pool != NULL)
+    ldb_pool_destroy(db->sync_pool);
+
   if (db->db_lock != NULL)
     ldb_unlock_file(db->db_lock);
 
+  {
+    ldb_super_t *sv = ldb_atomic_load_ptr(&db->super, ldb_order_acquire);
+    size_t i;
+
+    if (sv != NULL)
+      ldb_super_destroy(sv);
+
+    for (i = 0; i < db->retired.length; i++)
+      ldb_super_destroy(db->retired.items[i]);
+
+    ldb_vector_clear(&db->retired);
+  }
+
   ldb_vset_destroy(db->versions);
 
   if (db->mem != NULL)
@@ -545,7 +1009,8 @@ ldb_destroy(ldb_t *db) {
   if (db->imm != NULL)
     ldb_memtable_unref(db->imm);
 
-  ldb_batch_destroy(db->tmp_batch);
+  if (db->group_iov != NULL)
+    ldb_free(db->group_iov);
 
   if (db->log != NULL)
     ldb_logwriter_destroy(db->log);
@@ -562,13 +1027,15 @@ ldb_destroy(ldb_t *db) {
     ldb_lru_destroy(db->options.block_cache);
 
   /* Extra */
-  assert(db->writers.length == 0);
+  assert(ldb_queue_empty(&db->writers));
   assert(ldb_snaplist_empty(&db->snapshots));
 
   rb_set64_clear(&db->pending_outputs);
 
   ldb_mutex_destroy(&db->mutex);
   ldb_cond_destroy(&db->background_work_finished_signal);
+  ldb_cond_destroy(&db->pipeline_signal);
+  ldb_cond_destroy(&db->log_synced_signal);
 
   ldb_free(db);
 }
@@ -578,6 +1045,17 @@ ldb_user_comparator(const ldb_t *db) {
   return db->internal_comparator.user_comparator;
 }
 
+/* Options for building a table destined for "level". */
+static ldb_dbopt_t
+ldb_level_options(const ldb_t *db, int level) {
+  ldb_dbopt_t options = db->options;
+
+  if (options.filter_policy != NULL)
+    options.filter_policy = &db->level_filter_policy[level];
+
+  return options;
+}
+
 static int
 ldb_new_db(ldb_t *db) {
   char manifest[LDB_PATH_MAX];
@@ -656,6 +1134,9 @@ ldb_remove_obsolete_files(ldb_t *db) {
 
   /* ldb_mutex_assert_held(&db->mutex); */
 
+  /* Drop unused super versions so that they do not pin old files. */
+  ldb_reclaim_supers(db);
+
   if (db->bg_error != LDB_OK) {
     /* After a background error, we don't know whether a new version may
        or may not have been committed, so we cannot safely garbage collect. */
@@ -767,10 +1248,14 @@ ldb_write_level0_table(ldb_t *db, ldb_memtable_t *mem,
                                 (unsigned long)meta.number);
 
   {
+    /* Memtable output is built as a level-0 table, even if it
+       ends up being pushed to a deeper level below. */
+    ldb_dbopt_t options = ldb_level_options(db, 0);
+
     ldb_mutex_unlock(&db->mutex);
 
     rc = ldb_build_table(db->dbname,
-                         &db->options,
+                         &options,
                          db->table_cache,
                          iter,
                          &meta);
@@ -785,15 +1270,18 @@ ldb_write_level0_table(ldb_t *db, ldb_memtable_t *mem,
 
   ldb_iter_destroy(iter);
 
-  rb_set64_del(&db->pending_outputs, meta.number);
-
   /* Note that if file_size is zero, the file has been deleted and
-     should not be added to the manifest. */
+     should not be added to the manifest. Otherwise, the table remains
+     in pending_outputs until the caller has applied the edit. */
   if (rc == LDB_OK && meta.file_size > 0) {
     ldb_slice_t min_user_key = ldb_ikey_user_key(&meta.smallest);
     ldb_slice_t max_user_key = ldb_ikey_user_key(&meta.largest);
 
-    if (base != NULL) {
+    /* The lock was released while building the table. If a compaction
+       is running or has finished meanwhile, "base" may no longer show
+       every file the table could overlap, so leave it in level 0. */
+    if (base != NULL && db->compactions_in_progress == 0
+                     && base == ldb_vset_current(db->versions)) {
       level = ldb_version_pick_level_for_memtable_output(base,
                                                          &min_user_key,
                                                          &max_user_key);
@@ -804,6 +1292,8 @@ ldb_write_level0_table(ldb_t *db, ldb_memtable_t *mem,
                        meta.file_size,
                        &meta.smallest,
                        &meta.largest);
+  } else {
+    rb_set64_del(&db->pending_outputs, meta.number);
   }
 
   stats.micros = ldb_now_usec() - start_micros;
@@ -816,6 +1306,19 @@ ldb_write_level0_table(ldb_t *db, ldb_memtable_t *mem,
   return rc;
 }
 
+static void
+ldb_release_outputs(ldb_t *db, const ldb_vedit_t *edit) {
+  size_t i;
+
+  /* ldb_mutex_assert_held(&db->mutex); */
+
+  for (i = 0; i < edit->new_files.length; i++) {
+    const meta_entry_t *entry = edit->new_files.items[i];
+
+    rb_set64_del(&db->pending_outputs, entry->meta.number);
+  }
+}
+
 static void
 report_corruption(ldb_reporter_t *report, size_t bytes, int status) {
   ldb_log(report->info_log, "%s%s: dropping %d bytes; %s",
@@ -1119,7 +1622,14 @@ ldb_compact_memtable(ldb_t *db) {
 
   ldb_version_ref(base);
 
-  rc = ldb_write_level0_table(db, db->imm, &edit, base);
+  /* Flushes run alongside compactions, whose outputs may land anywhere
+     in the range they cover. Do not push the table to a deeper level
+     while one is in progress, as it could overlap. */
+  if (db->compactions_in_progress > 0) {
+    rc = ldb_write_level0_table(db, db->imm, &edit, NULL);
+  } else {
+    rc = ldb_write_level0_table(db, db->imm, &edit, base);
+  }
 
   ldb_version_unref(base);
 
@@ -1133,11 +1643,14 @@ ldb_compact_memtable(ldb_t *db) {
     rc = ldb_vset_log_and_apply(db->versions, &edit, &db->mutex);
   }
 
+  /* The new table is either live or garbage by now. */
+  ldb_release_outputs(db, &edit);
+
   if (rc == LDB_OK) {
     /* Commit to the new state. */
     ldb_memtable_unref(db->imm);
     db->imm = NULL;
-    ldb_atomic_store(&db->has_imm, 0, ldb_order_release);
+    ldb_install_super(db);
     ldb_remove_obsolete_files(db);
   } else {
     ldb_record_background_error(db, rc);
@@ -1172,8 +1685,10 @@ ldb_open_compaction_output_file(ldb_t *db, ldb_cstate_t *compact) {
     rc = ldb_truncfile_create(fname, &compact->outfile);
 
     if (rc == LDB_OK) {
-      compact->builder = ldb_tablebuilder_create(&db->options,
-                                                 compact->outfile);
+      int level = ldb_compaction_level(compact->compaction) + 1;
+      ldb_dbopt_t options = ldb_level_options(db, level);
+
+      compact->builder = ldb_tablebuilder_create(&options, compact->outfile);
     }
   } else {
     rc = LDB_INVALID;
@@ -1253,7 +1768,7 @@ ldb_finish_compaction_output_file(ldb_t *db, ldb_cstate_t *compact,
 static int
 ldb_install_compaction_results(ldb_t *db, ldb_cstate_t *compact) {
   ldb_vedit_t *edit = ldb_compaction_edit(compact->compaction);
-  int level;
+  int level, rc;
   size_t i;
 
   /* ldb_mutex_assert_held(&db->mutex); */
@@ -1280,80 +1795,42 @@ ldb_install_compaction_results(ldb_t *db, ldb_cstate_t *compact) {
                        &out->largest);
   }
 
-  return ldb_vset_log_and_apply(db->versions, edit, &db->mutex);
+  rc = ldb_vset_log_and_apply(db->versions, edit, &db->mutex);
+
+  ldb_install_super(db);
+
+  return rc;
 }
 
 static int
-ldb_do_compaction_work(ldb_t *db, ldb_cstate_t *compact) {
+ldb_compact_key_range(ldb_t *db, ldb_cstate_t *compact,
+                                 ldb_iter_t *input,
+                                 const ldb_ikey_t *start,
+                                 const ldb_ikey_t *end) {
   const ldb_comparator_t *ucmp = ldb_user_comparator(db);
   ldb_seqnum_t last_sequence_for_key = LDB_MAX_SEQUENCE;
-  int64_t start_micros = ldb_now_usec();
-  int64_t imm_micros = 0; /* Micros spent doing db->imm compactions. */
   ldb_buffer_t user_key;
   int has_user_key = 0;
-  ldb_cstats_t stats;
-  ldb_iter_t *input;
   int rc = LDB_OK;
-  int which, level;
   ldb_pkey_t ikey;
-  char tmp[100];
-  size_t i;
-
-  ldb_log(db->options.info_log, "Compacting %d@%d + %d@%d files",
-          ldb_compaction_num_input_files(compact->compaction, 0),
-          ldb_compaction_level(compact->compaction) + 0,
-          ldb_compaction_num_input_files(compact->compaction, 1),
-          ldb_compaction_level(compact->compaction) + 1);
 
   ldb_buffer_init(&user_key);
-  ldb_cstats_init(&stats);
-
-  assert(ldb_vset_num_level_files(db->versions,
-                                  ldb_compaction_level(compact->compaction))
-                                  > 0);
-
-  assert(compact->builder == NULL);
-  assert(compact->outfile == NULL);
-
-  if (ldb_snaplist_empty(&db->snapshots)) {
-    compact->smallest_snapshot = ldb_vset_last_sequence(db->versions);
-  } else {
-    compact->smallest_snapshot =
-      ldb_snaplist_oldest(&db->snapshots)->sequence;
-  }
-
-  input = ldb_inputiter_create(db->versions, compact->compaction);
-
-  /* Release mutex while we're actually doing the compaction work. */
-  ldb_mutex_unlock(&db->mutex);
 
-  ldb_iter_seek_first(input);
+  if (start->size > 0)
+    ldb_iter_seek(input, start);
+  else
+    ldb_iter_seek_first(input);
 
   while (ldb_iter_valid(input) &&
         !ldb_atomic_load(&db->shutting_down, ldb_order_acquire)) {
     ldb_slice_t key, value;
     int drop = 0;
 
-    /* Prioritize immutable compaction work. */
-    if (ldb_atomic_load(&db->has_imm, ldb_order_relaxed)) {
-      int64_t imm_start = ldb_now_usec();
-
-      ldb_mutex_lock(&db->mutex);
-
-      if (db->imm != NULL) {
-        ldb_compact_memtable(db);
-
-        /* Wake up make_room_for_write() if necessary. */
-        ldb_cond_broadcast(&db->background_work_finished_signal);
-      }
-
-      ldb_mutex_unlock(&db->mutex);
-
-      imm_micros += (ldb_now_usec() - imm_start);
-    }
-
     key = ldb_iter_key(input);
 
+    if (end->size > 0 && ldb_compare(&db->internal_comparator, &key, end) >= 0)
+      break;
+
     if (ldb_compaction_should_stop_before(compact->compaction, &key) &&
         compact->builder != NULL) {
       rc = ldb_finish_compaction_output_file(db, compact, input);
@@ -1439,19 +1916,272 @@ ldb_do_compaction_work(ldb_t *db, ldb_cstate_t *compact) {
   if (rc == LDB_OK)
     rc = ldb_iter_status(input);
 
-  ldb_iter_destroy(input);
-  input = NULL;
+  ldb_buffer_clear(&user_key);
 
-  stats.micros = ldb_now_usec() - start_micros - imm_micros;
+  return rc;
+}
 
-  for (which = 0; which < 2; which++) {
-    size_t len = ldb_compaction_num_input_files(compact->compaction, which);
+/*
+ * Subcompaction
+ */
 
-    for (i = 0; i < len; i++) {
-      ldb_filemeta_t *f = ldb_compaction_input(compact->compaction, which, i);
+/* A slice of a compaction's key range, processed on its own thread.
+   The first shard runs on the calling thread using the compaction
+   state itself; the others work on forked copies whose outputs are
+   appended to the parent's once they complete. */
+typedef struct ldb_subcompact_s {
+  ldb_t *db;
+  ldb_cstate_t *state;
+  ldb_iter_t *input;
+  ldb_ikey_t start; /* Inclusive (empty if unbounded). */
+  ldb_ikey_t end; /* Exclusive (empty if unbounded). */
+  ldb_thread_t thread;
+  int status;
+} ldb_subcompact_t;
 
-      stats.bytes_read += f->file_size;
-    }
+/* Pick the keys at which to split a compaction: the distinct
+   smallest user keys of its input files, evenly spaced. Fills
+   "result" with the files whose smallest keys begin each shard
+   after the first and returns the number of shards. */
+static int
+ldb_subcompact_boundaries(ldb_t *db, ldb_compaction_t *c,
+                                     ldb_vector_t *result) {
+  const ldb_comparator_t *ucmp = ldb_user_comparator(db);
+  ldb_vector_t files; /* ldb_filemeta_t */
+  int which, n;
+  size_t i, j;
+
+  ldb_vector_init(&files);
+
+  for (which = 0; which < 2; which++) {
+    size_t len = ldb_compaction_num_input_files(c, which);
+
+    for (i = 0; i < len; i++) {
+      ldb_filemeta_t *f = ldb_compaction_input(c, which, i);
+      ldb_slice_t key = ldb_ikey_user_key(&f->smallest);
+      int cmp = 1;
+
+      /* Insertion sort; input counts are small. */
+      for (j = files.length; j > 0; j--) {
+        ldb_filemeta_t *g = files.items[j - 1];
+        ldb_slice_t other = ldb_ikey_user_key(&g->smallest);
+
+        cmp = ldb_compare(ucmp, &other, &key);
+
+        if (cmp <= 0)
+          break;
+      }
+
+      if (j > 0 && cmp == 0)
+        continue;
+
+      ldb_vector_push(&files, NULL);
+
+      memmove(files.items + j + 1, files.items + j,
+              (files.length - j - 1) * sizeof(void *));
+
+      files.items[j] = f;
+    }
+  }
+
+  n = db->options.max_subcompactions;
+
+  if ((size_t)n > files.length)
+    n = files.length;
+
+  /* The first key begins the whole range and is never a boundary. */
+  for (i = 1; i < (size_t)n; i++)
+    ldb_vector_push(result, files.items[i * files.length / n]);
+
+  ldb_vector_clear(&files);
+
+  return n < 1 ? 1 : n;
+}
+
+static void
+ldb_subcompact_run(void *arg) {
+  ldb_subcompact_t *sub = arg;
+
+  sub->status = ldb_compact_key_range(sub->db, sub->state, sub->input,
+                                      &sub->start, &sub->end);
+}
+
+static ldb_subcompact_t *
+ldb_subcompact_create(ldb_t *db, ldb_cstate_t *compact, int *count) {
+  ldb_subcompact_t *subs;
+  ldb_vector_t bounds;
+  int i, n;
+
+  /* ldb_mutex_assert_held(&db->mutex); */
+
+  ldb_vector_init(&bounds);
+
+  n = 1;
+
+  if (db->options.max_subcompactions > 1)
+    n = ldb_subcompact_boundaries(db, compact->compaction, &bounds);
+
+  subs = ldb_malloc(n * sizeof(ldb_subcompact_t));
+
+  for (i = 0; i < n; i++) {
+    ldb_subcompact_t *sub = &subs[i];
+
+    sub->db = db;
+
+    if (i == 0) {
+      sub->state = compact;
+    } else {
+      sub->state = ldb_cstate_create(ldb_compaction_fork(compact->compaction));
+      sub->state->smallest_snapshot = compact->smallest_snapshot;
+    }
+
+    sub->input = ldb_inputiter_create(db->versions, sub->state->compaction);
+
+    ldb_ikey_init(&sub->start);
+    ldb_ikey_init(&sub->end);
+
+    if (i > 0) {
+      ldb_filemeta_t *f = bounds.items[i - 1];
+      ldb_slice_t key = ldb_ikey_user_key(&f->smallest);
+
+      ldb_ikey_set(&sub->start, &key, LDB_MAX_SEQUENCE, LDB_VALTYPE_SEEK);
+      ldb_ikey_copy(&subs[i - 1].end, &sub->start);
+    }
+
+    sub->status = LDB_OK;
+  }
+
+  ldb_vector_clear(&bounds);
+
+  *count = n;
+
+  return subs;
+}
+
+static int
+ldb_subcompact_execute(ldb_subcompact_t *subs, int count) {
+  int rc = LDB_OK;
+  int i;
+
+  for (i = 1; i < count; i++)
+    ldb_thread_create(&subs[i].thread, ldb_subcompact_run, &subs[i]);
+
+  ldb_subcompact_run(&subs[0]);
+
+  for (i = 1; i < count; i++)
+    ldb_thread_join(&subs[i].thread);
+
+  for (i = 0; i < count; i++) {
+    if (rc == LDB_OK)
+      rc = subs[i].status;
+  }
+
+  return rc;
+}
+
+static void
+ldb_subcompact_destroy(ldb_subcompact_t *subs, int count) {
+  ldb_cstate_t *compact = subs[0].state;
+  int i;
+
+  /* ldb_mutex_assert_held(&db->mutex); */
+
+  for (i = 0; i < count; i++) {
+    ldb_subcompact_t *sub = &subs[i];
+    ldb_cstate_t *state = sub->state;
+    size_t j;
+
+    ldb_iter_destroy(sub->input);
+    ldb_ikey_clear(&sub->start);
+    ldb_ikey_clear(&sub->end);
+
+    if (i == 0)
+      continue;
+
+    /* Shards cover increasing key ranges, so appending keeps the
+       outputs sorted. The parent installs them (or, on failure,
+       removes them from the pending outputs). */
+    for (j = 0; j < state->outputs.length; j++)
+      ldb_vector_push(&compact->outputs, state->outputs.items[j]);
+
+    compact->total_bytes += state->total_bytes;
+
+    ldb_vector_reset(&state->outputs);
+
+    if (state->builder != NULL) {
+      ldb_tablebuilder_abandon(state->builder);
+      ldb_tablebuilder_destroy(state->builder);
+    }
+
+    if (state->outfile != NULL)
+      ldb_wfile_destroy(state->outfile);
+
+    ldb_compaction_destroy(state->compaction);
+    ldb_cstate_destroy(state);
+  }
+
+  ldb_free(subs);
+}
+
+static int
+ldb_do_compaction_work(ldb_t *db, ldb_cstate_t *compact) {
+  int64_t start_micros = ldb_now_usec();
+  ldb_subcompact_t *subs;
+  ldb_cstats_t stats;
+  int which, level;
+  int rc = LDB_OK;
+  char tmp[100];
+  int count;
+  size_t i;
+
+  ldb_log(db->options.info_log, "Compacting %d@%d + %d@%d files",
+          ldb_compaction_num_input_files(compact->compaction, 0),
+          ldb_compaction_level(compact->compaction) + 0,
+          ldb_compaction_num_input_files(compact->compaction, 1),
+          ldb_compaction_level(compact->compaction) + 1);
+
+  ldb_cstats_init(&stats);
+
+  assert(ldb_vset_num_level_files(db->versions,
+                                  ldb_compaction_level(compact->compaction))
+                                  > 0);
+
+  assert(compact->builder == NULL);
+  assert(compact->outfile == NULL);
+
+  if (ldb_snaplist_empty(&db->snapshots)) {
+    compact->smallest_snapshot = ldb_vset_last_sequence(db->versions);
+  } else {
+    compact->smallest_snapshot =
+      ldb_snaplist_oldest(&db->snapshots)->sequence;
+  }
+
+  subs = ldb_subcompact_create(db, compact, &count);
+
+  if (count > 1) {
+    ldb_log(db->options.info_log, "Compacting with %d subcompactions",
+            count);
+  }
+
+  /* Release mutex while we're actually doing the compaction work. */
+  ldb_mutex_unlock(&db->mutex);
+
+  rc = ldb_subcompact_execute(subs, count);
+
+  ldb_mutex_lock(&db->mutex);
+
+  ldb_subcompact_destroy(subs, count);
+
+  stats.micros = ldb_now_usec() - start_micros;
+
+  for (which = 0; which < 2; which++) {
+    size_t len = ldb_compaction_num_input_files(compact->compaction, which);
+
+    for (i = 0; i < len; i++) {
+      ldb_filemeta_t *f = ldb_compaction_input(compact->compaction, which, i);
+
+      stats.bytes_read += f->file_size;
+    }
   }
 
   for (i = 0; i < compact->outputs.length; i++) {
@@ -1460,8 +2190,6 @@ ldb_do_compaction_work(ldb_t *db, ldb_cstate_t *compact) {
     stats.bytes_written += out->file_size;
   }
 
-  ldb_mutex_lock(&db->mutex);
-
   level = ldb_compaction_level(compact->compaction);
 
   ldb_cstats_add(&db->stats[level + 1], &stats);
@@ -1472,8 +2200,6 @@ ldb_do_compaction_work(ldb_t *db, ldb_cstate_t *compact) {
   if (rc != LDB_OK)
     ldb_record_background_error(db, rc);
 
-  ldb_buffer_clear(&user_key);
-
   ldb_log(db->options.info_log, "compacted to: %s",
           ldb_vset_level_summary(db->versions, tmp));
 
@@ -1507,21 +2233,26 @@ ldb_cleanup_compaction(ldb_t *db, ldb_cstate_t *compact) {
 }
 
 static void
+ldb_maybe_schedule_compaction(ldb_t *db);
+
+static int
 ldb_background_compaction(ldb_t *db) {
   int is_manual = (db->manual_compaction != NULL);
   ldb_compaction_t *c;
   int rc = LDB_OK;
+  int found = 0;
 
   /* ldb_mutex_assert_held(&db->mutex); */
 
-  if (db->imm != NULL) {
-    ldb_compact_memtable(db);
-    return;
-  }
-
   if (is_manual) {
     ldb_manual_t *m = db->manual_compaction;
 
+    /* A manual compaction waits for all other compactions to finish
+       (the last one to do so will schedule us again). Automatic
+       compactions are held back until it is done. */
+    if (db->compactions_in_progress > 0)
+      return 0;
+
     c = ldb_vset_compact_range(db->versions, m->level, m->begin, m->end);
 
     m->done = (c == NULL);
@@ -1539,6 +2270,16 @@ ldb_background_compaction(ldb_t *db) {
     c = ldb_vset_pick_compaction(db->versions);
   }
 
+  if (c != NULL) {
+    found = 1;
+
+    db->compactions_in_progress++;
+
+    /* Our inputs are now reserved. Let another thread
+       look for non-overlapping work in the meantime. */
+    ldb_maybe_schedule_compaction(db);
+  }
+
   if (c == NULL) {
     /* Nothing to do. */
   } else if (!is_manual && ldb_compaction_is_trivial_move(c)) {
@@ -1561,6 +2302,8 @@ ldb_background_compaction(ldb_t *db) {
 
     rc = ldb_vset_log_and_apply(db->versions, edit, &db->mutex);
 
+    ldb_install_super(db);
+
     if (rc != LDB_OK)
       ldb_record_background_error(db, rc);
 
@@ -1585,9 +2328,12 @@ ldb_background_compaction(ldb_t *db) {
     ldb_remove_obsolete_files(db);
   }
 
-  if (c != NULL)
+  if (c != NULL) {
     ldb_compaction_destroy(c);
 
+    db->compactions_in_progress--;
+  }
+
   if (rc == LDB_OK) {
     /* Done. */
   } else if (ldb_atomic_load(&db->shutting_down, ldb_order_acquire)) {
@@ -1610,51 +2356,107 @@ ldb_background_compaction(ldb_t *db) {
 
     db->manual_compaction = NULL;
   }
+
+  return found || is_manual;
 }
 
+static void
+ldb_flush_call(void *db);
+
 static void
 ldb_background_call(void *db);
 
+static void
+ldb_maybe_schedule_flush(ldb_t *db) {
+  /* ldb_mutex_assert_held(&db->mutex); */
+
+  if (db->background_flush_scheduled) {
+    /* Already scheduled. */
+  } else if (ldb_atomic_load(&db->shutting_down, ldb_order_acquire)) {
+    /* DB is being deleted; no more background work. */
+  } else if (db->bg_error != LDB_OK) {
+    /* Already got an error; no more changes. */
+  } else if (db->imm == NULL) {
+    /* No work to be done. */
+  } else {
+    db->background_flush_scheduled = 1;
+    ldb_pool_schedule(db->flush_pool, &ldb_flush_call, db);
+  }
+}
+
 static void
 ldb_maybe_schedule_compaction(ldb_t *db) {
   /* ldb_mutex_assert_held(&db->mutex); */
 
-  if (db->background_compaction_scheduled) {
+  ldb_maybe_schedule_flush(db);
+
+  if (db->background_compactions_scheduled >=
+      db->options.max_background_compactions) {
     /* Already scheduled. */
   } else if (ldb_atomic_load(&db->shutting_down, ldb_order_acquire)) {
     /* DB is being deleted; no more background compactions. */
   } else if (db->bg_error != LDB_OK) {
     /* Already got an error; no more changes. */
-  } else if (db->imm == NULL && db->manual_compaction == NULL &&
+  } else if (db->manual_compaction == NULL &&
              !ldb_vset_needs_compaction(db->versions)) {
     /* No work to be done. */
   } else {
-    db->background_compaction_scheduled = 1;
+    db->background_compactions_scheduled++;
     ldb_pool_schedule(db->pool, &ldb_background_call, db);
   }
 }
 
+static void
+ldb_flush_call(void *ptr) {
+  ldb_t *db = ptr;
+
+  ldb_mutex_lock(&db->mutex);
+
+  assert(db->background_flush_scheduled);
+
+  if (ldb_atomic_load(&db->shutting_down, ldb_order_acquire)) {
+    /* No more background work when shutting down. */
+  } else if (db->bg_error != LDB_OK) {
+    /* No more background work after a background error. */
+  } else if (db->imm != NULL) {
+    ldb_compact_memtable(db);
+  }
+
+  db->background_flush_scheduled = 0;
+
+  /* The new level-0 file may need to be compacted. */
+  ldb_maybe_schedule_compaction(db);
+
+  /* Wake up make_room_for_write() if necessary. */
+  ldb_cond_broadcast(&db->background_work_finished_signal);
+
+  ldb_mutex_unlock(&db->mutex);
+}
+
 static void
 ldb_background_call(void *ptr) {
   ldb_t *db = ptr;
+  int did_work = 0;
 
   ldb_mutex_lock(&db->mutex);
 
-  assert(db->background_compaction_scheduled);
+  assert(db->background_compactions_scheduled > 0);
 
   if (ldb_atomic_load(&db->shutting_down, ldb_order_acquire)) {
     /* No more background work when shutting down. */
   } else if (db->bg_error != LDB_OK) {
     /* No more background work after a background error. */
   } else {
-    ldb_background_compaction(db);
+    did_work = ldb_background_compaction(db);
   }
 
-  db->background_compaction_scheduled = 0;
+  db->background_compactions_scheduled--;
 
   /* Previous compaction may have produced too many files in a level,
-     so reschedule another compaction if needed. */
-  ldb_maybe_schedule_compaction(db);
+     so reschedule another compaction if needed. If we found nothing
+     to do, leave that to the compactions which are still running. */
+  if (did_work || db->background_compactions_scheduled == 0)
+    ldb_maybe_schedule_compaction(db);
 
   ldb_cond_broadcast(&db->background_work_finished_signal);
 
@@ -1670,7 +2472,8 @@ cleanup_iter_state(void *arg1, void *arg2) {
 static ldb_iter_t *
 ldb_internal_iterator(ldb_t *db, const ldb_readopt_t *options,
                                  ldb_seqnum_t *latest_snapshot,
-                                 uint32_t *seed) {
+                                 uint32_t *seed,
+                                 iter_state_t **state) {
   ldb_iter_t *internal_iter;
   ldb_version_t *current;
   iter_state_t *cleanup;
@@ -1694,7 +2497,7 @@ ldb_internal_iterator(ldb_t *db, const ldb_readopt_t *options,
 
   current = ldb_vset_current(db->versions);
 
-  ldb_version_add_iterators(current, options, &list);
+  ldb_version_add_iterators(current, options, NULL, &list);
 
   internal_iter = ldb_mergeiter_create(&db->internal_comparator,
                                        (ldb_iter_t **)list.items,
@@ -1713,25 +2516,75 @@ ldb_internal_iterator(ldb_t *db, const ldb_readopt_t *options,
 
   ldb_vector_clear(&list);
 
+  if (state != NULL)
+    *state = cleanup;
+
   return internal_iter;
 }
 
-/* REQUIRES: Writer list must be non-empty. */
+ldb_iter_t *
+ldb_prefix_iterator(ldb_t *db,
+                    void *arg,
+                    const ldb_readopt_t *options,
+                    const ldb_slice_t *prefix) {
+  iter_state_t *state = arg;
+  ldb_iter_t *iter;
+  ldb_vector_t list;
+
+  ldb_vector_init(&list);
+
+  /* The state is kept alive by the full iterator, so
+     none of this needs to be done under the mutex. */
+  ldb_vector_push(&list, ldb_memiter_create(state->mem));
+
+  if (state->imm != NULL)
+    ldb_vector_push(&list, ldb_memiter_create(state->imm));
+
+  ldb_version_add_iterators(state->version, options, prefix, &list);
+
+  iter = ldb_mergeiter_create(&db->internal_comparator,
+                              (ldb_iter_t **)list.items,
+                              list.length);
+
+  ldb_vector_clear(&list);
+
+  return iter;
+}
+
+static void
+ldb_push_group_iov(ldb_t *db, size_t *length, ldb_slice_t piece) {
+  if (*length == db->group_alloc) {
+    db->group_alloc = db->group_alloc == 0 ? 8 : db->group_alloc * 2;
+    db->group_iov = ldb_realloc(db->group_iov,
+                                db->group_alloc * sizeof(ldb_slice_t));
+  }
+
+  db->group_iov[(*length)++] = piece;
+}
+
+/* Gather the log record for "first" and the writers queued behind it
+   into db->group_iov. The first slot is reserved for the header of
+   the combined batch, which the caller fills in once the sequence is
+   known; the rest point directly into each writer's batch, so the
+   batches are never copied into one. Returns the number of slots and
+   stores the total number of entries in "count". */
+/* REQUIRES: "first" must be the leader of the writer queue. */
 /* REQUIRES: First writer must have a non-null batch. */
-static ldb_batch_t *
-ldb_build_batch_group(ldb_t *db, ldb_writer_t **last_writer) {
-  ldb_writer_t *first = db->writers.head;
-  ldb_batch_t *result = first->batch;
+static size_t
+ldb_build_batch_group(ldb_t *db,
+                      ldb_writer_t *first,
+                      ldb_writer_t **last_writer,
+                      int *count) {
+  ldb_writer_t *newest = ldb_queue_link(&db->writers);
   size_t size, max_size;
+  size_t length = 0;
+  ldb_slice_t header;
   ldb_writer_t *w;
 
   /* ldb_mutex_assert_held(&db->mutex); */
 
   assert(first != NULL);
-
-  result = first->batch;
-
-  assert(result != NULL);
+  assert(first->batch != NULL);
 
   size = ldb_batch_size(first->batch);
 
@@ -1743,41 +2596,238 @@ ldb_build_batch_group(ldb_t *db, ldb_writer_t **last_writer) {
   if (size <= (128 << 10))
     max_size = size + (128 << 10);
 
-  *last_writer = first;
+  ldb_slice_init(&header);
+
+  ldb_push_group_iov(db, &length, header);
+  ldb_push_group_iov(db, &length, ldb_batch_body(first->batch));
+
+  *count = ldb_batch_count(first->batch);
+  *last_writer = first;
+
+  /* Advance past "first". */
+  w = first;
+
+  while (w != newest) {
+    w = w->link_newer;
+
+    if (w->sync && !first->sync) {
+      if (!db->options.group_commit) {
+        /* Do not include a sync write into a
+           batch handled by a non-sync write. */
+        break;
+      }
+
+      /* The log sync is cheap to share under group
+         commit, so sync the whole group instead. */
+      first->sync = 1;
+    }
+
+    if (w->batch != NULL) {
+      size += ldb_batch_size(w->batch);
+
+      if (size > max_size) {
+        /* Do not make batch too big. */
+        break;
+      }
+
+      ldb_push_group_iov(db, &length, ldb_batch_body(w->batch));
+
+      *count += ldb_batch_count(w->batch);
+    }
+
+    *last_writer = w;
+  }
+
+  return length;
+}
+
+/* Insert the batches of the group from "leader" to "last_writer" into
+   "mem", numbering them consecutively from "sequence". With concurrent
+   memtable writes, each writer inserts its own batch in parallel. */
+/* REQUIRES: db->mutex is not held. */
+/* REQUIRES: no other thread is writing to "mem". */
+static int
+ldb_insert_group(ldb_t *db,
+                 ldb_memtable_t *mem,
+                 ldb_writer_t *leader,
+                 ldb_writer_t *last_writer,
+                 ldb_seqnum_t sequence) {
+  ldb_writer_t *w;
+  int rc = LDB_OK;
+
+  if (!db->options.concurrent_memtable_writes || leader == last_writer) {
+    for (w = leader; rc == LDB_OK; w = w->link_newer) {
+      if (w->batch != NULL) {
+        ldb_batch_set_sequence(w->batch, sequence);
+
+        sequence += ldb_batch_count(w->batch);
+
+        rc = ldb_batch_insert_into(w->batch, mem);
+      }
+
+      if (w == last_writer)
+        break;
+    }
+
+    return rc;
+  }
+
+  /* Number the batches and count the writers which take part. The
+     count must be in place before any follower is woken. */
+  leader->pending = 0;
+
+  for (w = leader; w != NULL; w = w->link_newer) {
+    if (w->batch != NULL) {
+      ldb_batch_set_sequence(w->batch, sequence);
+
+      sequence += ldb_batch_count(w->batch);
+
+      leader->pending++;
+    }
+
+    if (w == last_writer)
+      break;
+  }
+
+  for (w = leader->link_newer; w != NULL; w = w->link_newer) {
+    if (w->batch != NULL) {
+      w->leader = leader;
+      w->mem = mem;
+
+      ldb_writer_set_state(w, LDB_WRITER_INSERT);
+    }
+
+    if (w == last_writer)
+      break;
+  }
+
+  rc = ldb_batch_insert_concurrently(leader->batch, mem);
+
+  /* The last writer to finish inserting wakes the leader. */
+  if (ldb_atomic_fetch_sub(&leader->pending, 1, ldb_order_acq_rel) != 1)
+    ldb_queue_await(&db->writers, leader, LDB_WRITER_INSERTED);
+
+  for (w = leader->link_newer; rc == LDB_OK; w = w->link_newer) {
+    rc = w->status;
+
+    if (w == last_writer)
+      break;
+  }
+
+  return rc;
+}
+
+/* Wake the followers of "leader" up to and including "last_writer". */
+/* REQUIRES: leadership has already been passed on. */
+static void
+ldb_complete_group(ldb_writer_t *leader, ldb_writer_t *last_writer, int rc) {
+  ldb_writer_t *w, *next;
+
+  if (leader == last_writer)
+    return;
+
+  for (w = leader->link_newer; w != last_writer; w = next) {
+    /* The writer may be gone as soon as it is woken. */
+    next = w->link_newer;
+
+    w->status = rc;
+
+    ldb_writer_set_state(w, LDB_WRITER_COMPLETED);
+  }
+
+  last_writer->status = rc;
+
+  ldb_writer_set_state(last_writer, LDB_WRITER_COMPLETED);
+}
+
+/* Give more writers a chance to queue up behind "leader" so that they
+   can share its log sync. Does not wait if nobody else is writing, and
+   stops early once the group is as large as it is allowed to grow. */
+/* REQUIRES: "leader" must be the leader of the writer queue. */
+static void
+ldb_gather_group(ldb_t *db, ldb_writer_t *leader) {
+  int64_t deadline = ldb_now_usec() + db->options.group_commit_delay;
+  size_t size = ldb_batch_size(leader->batch);
+  ldb_writer_t *w = leader;
+
+  for (;;) {
+    ldb_writer_t *newest = ldb_queue_link(&db->writers);
+    int64_t now;
+
+    while (w != newest) {
+      w = w->link_newer;
+
+      if (w->batch != NULL)
+        size += ldb_batch_size(w->batch);
+    }
+
+    if (w == leader || size >= (1 << 20))
+      break;
+
+    now = ldb_now_usec();
+
+    if (now >= deadline)
+      break;
+
+    ldb_sleep_usec(LDB_MIN(deadline - now, 10));
+  }
+}
+
+static void
+ldb_log_sync_call(void *ptr) {
+  ldb_t *db = ptr;
 
-  /* Advance past "first". */
-  for (w = first->next; w != NULL; w = w->next) {
-    if (w->sync && !first->sync) {
-      /* Do not include a sync write into a
-         batch handled by a non-sync write. */
-      break;
-    }
+  ldb_mutex_lock(&db->mutex);
 
-    if (w->batch != NULL) {
-      size += ldb_batch_size(w->batch);
+  assert(db->log_sync_scheduled);
 
-      if (size > max_size) {
-        /* Do not make batch too big. */
-        break;
-      }
+  while (db->log_synced < db->log_sync_requested &&
+         db->log_sync_error == LDB_OK) {
+    uint64_t target = db->log_sync_requested;
+    ldb_wfile_t *file = db->logfile;
+    int rc;
 
-      /* Append to *result. */
-      if (result == first->batch) {
-        /* Switch to temporary batch instead of disturbing caller's batch. */
-        result = db->tmp_batch;
+    ldb_mutex_unlock(&db->mutex);
 
-        assert(ldb_batch_count(result) == 0);
+    /* Other groups may be appending to the log meanwhile. */
+    rc = ldb_wfile_sync_data(file);
 
-        ldb_batch_append(result, first->batch);
-      }
+    ldb_mutex_lock(&db->mutex);
 
-      ldb_batch_append(result, w->batch);
+    if (rc == LDB_OK) {
+      db->log_synced = target;
+    } else {
+      /* As in ldb_write, the state of the log file is
+         indeterminate, so all future writes must fail. */
+      db->log_sync_error = rc;
+      ldb_record_background_error(db, rc);
     }
 
-    *last_writer = w;
+    ldb_cond_broadcast(&db->log_synced_signal);
   }
 
-  return result;
+  db->log_sync_scheduled = 0;
+
+  ldb_cond_broadcast(&db->log_synced_signal);
+  ldb_mutex_unlock(&db->mutex);
+}
+
+/* Wait until the log has been synced past request "target". */
+/* REQUIRES: db->mutex is held. */
+static int
+ldb_await_log_sync(ldb_t *db, uint64_t target) {
+  if (!db->log_sync_scheduled) {
+    db->log_sync_scheduled = 1;
+    ldb_pool_schedule(db->sync_pool, &ldb_log_sync_call, db);
+  }
+
+  while (db->log_synced < target && db->log_sync_error == LDB_OK)
+    ldb_cond_wait(&db->log_synced_signal, &db->mutex);
+
+  if (db->log_synced < target)
+    return db->log_sync_error;
+
+  return LDB_OK;
 }
 
 /* REQUIRES: db->mutex is held. */
@@ -1787,11 +2837,12 @@ ldb_make_room_for_write(ldb_t *db, int force) {
   size_t write_buffer_size = db->options.write_buffer_size;
   char fname[LDB_PATH_MAX];
   int allow_delay = !force;
+  int stalled = 0;
   int rc = LDB_OK;
 
   /* ldb_mutex_assert_held(&db->mutex); */
 
-  assert(db->writers.length > 0);
+  assert(!ldb_queue_empty(&db->writers));
 
   for (;;) {
 #define L0_FILES ldb_vset_num_level_files(db->versions, 0)
@@ -1806,22 +2857,53 @@ ldb_make_room_for_write(ldb_t *db, int force) {
          individual write by 1ms to reduce latency variance.  Also,
          this delay hands over some CPU to the compaction thread in
          case it is sharing the same core as the writer. */
+      int64_t start = ldb_now_usec();
+
       ldb_mutex_unlock(&db->mutex);
       ldb_sleep_usec(1000);
       allow_delay = 0;  /* Do not delay a single write more than once. */
       ldb_mutex_lock(&db->mutex);
+
+      stalled = 1;
+      db->stall_count++;
+      db->stall_micros += ldb_now_usec() - start;
     } else if (!force && ldb_memtable_usage(db->mem) <= write_buffer_size) {
       /* There is room in current memtable. */
       break;
     } else if (db->imm != NULL) {
       /* We have filled up the current memtable, but the previous
          one is still being compacted, so we wait. */
+      int64_t start = ldb_now_usec();
+
       ldb_log(db->options.info_log, "Current memtable full; waiting...");
       ldb_cond_wait(&db->background_work_finished_signal, &db->mutex);
+
+      /* A wait may wake several times; count the stall once. */
+      if (!stalled) {
+        stalled = 1;
+        db->stall_count++;
+      }
+
+      db->stall_micros += ldb_now_usec() - start;
     } else if (L0_FILES >= LDB_L0_STOP_WRITES_TRIGGER) {
       /* There are too many level-0 files. */
+      int64_t start = ldb_now_usec();
+
       ldb_log(db->options.info_log, "Too many L0 files; waiting...");
       ldb_cond_wait(&db->background_work_finished_signal, &db->mutex);
+
+      if (!stalled) {
+        stalled = 1;
+        db->stall_count++;
+      }
+
+      db->stall_micros += ldb_now_usec() - start;
+    } else if (db->pipeline_head != db->pipeline_tail) {
+      /* Earlier groups are still being applied to the memtable. */
+      ldb_cond_wait(&db->pipeline_signal, &db->mutex);
+    } else if (db->log_sync_scheduled) {
+      /* The current log is still being synced. */
+      ldb_cond_wait(&db->log_synced_signal, &db->mutex);
     } else {
       ldb_wfile_t *lfile = NULL;
       uint64_t new_log_number;
@@ -1852,13 +2934,12 @@ ldb_make_room_for_write(ldb_t *db, int force) {
       db->logfile_number = new_log_number;
       db->log = ldb_logwriter_create(lfile, 0);
       db->imm = db->mem;
-
-      ldb_atomic_store(&db->has_imm, 1, ldb_order_release);
-
       db->mem = ldb_memtable_create(&db->internal_comparator);
 
       ldb_memtable_ref(db->mem);
 
+      ldb_install_super(db);
+
       force = 0; /* Do not force another compaction if have room. */
       ldb_maybe_schedule_compaction(db);
     }
@@ -1924,7 +3005,11 @@ ldb_open(const char *dbname, const ldb_dbopt_t *options, ldb_t **dbptr) {
     rc = ldb_vset_log_and_apply(db->versions, &edit, &db->mutex);
   }
 
+  ldb_release_outputs(db, &edit);
+
   if (rc == LDB_OK) {
+    ldb_install_super(db);
+    ldb_publish_sequence(db);
     ldb_remove_obsolete_files(db);
     ldb_maybe_schedule_compaction(db);
   }
@@ -1948,16 +3033,91 @@ ldb_close(ldb_t *db) {
   ldb_destroy(db);
 }
 
+static void
+release_pinned_super(void *arg1, void *arg2) {
+  ldb_release_super((ldb_t *)arg2, (ldb_super_t *)arg1);
+}
+
+static int
+ldb_memtable_lookup(ldb_memtable_t *mem,
+                    const ldb_lkey_t *lkey,
+                    ldb_buffer_t *value,
+                    ldb_pinned_t *pinned,
+                    int *status) {
+  if (pinned != NULL)
+    return ldb_memtable_get_pinned(mem, lkey, &pinned->value, status);
+
+  return ldb_memtable_get(mem, lkey, value, status);
+}
+
+static int
+ldb_get_value(ldb_t *db, const ldb_slice_t *key,
+                         ldb_buffer_t *value,
+                         ldb_pinned_t *pinned,
+                         const ldb_readopt_t *options) {
+  int have_stat_update = 0;
+  ldb_seqnum_t snapshot;
+  ldb_getstats_t stats;
+  ldb_super_t *sv;
+  ldb_lkey_t lkey;
+  int rc = LDB_OK;
+
+  /* The sequence must be read before the memtables are: a write
+     is only visible once it has been applied to a memtable which
+     every later super version still references. */
+  if (options->snapshot != NULL)
+    snapshot = options->snapshot->sequence;
+  else
+    snapshot = ldb_visible_sequence(db);
+
+  sv = ldb_acquire_super(db);
+
+  /* First look in the memtable, then in the immutable memtable (if any). */
+  ldb_lkey_init(&lkey, key, snapshot);
+
+  if (ldb_memtable_lookup(sv->mem, &lkey, value, pinned, &rc)) {
+    /* Done. */
+  } else if (sv->imm != NULL &&
+             ldb_memtable_lookup(sv->imm, &lkey, value, pinned, &rc)) {
+    /* Done. */
+  } else if (pinned != NULL) {
+    rc = ldb_version_get_pinned(sv->current, options, &lkey,
+                                &pinned->value, &pinned->cleanup, &stats);
+    have_stat_update = 1;
+  } else {
+    rc = ldb_version_get(sv->current, options, &lkey, value, &stats);
+    have_stat_update = 1;
+  }
+
+  /* A value found in a memtable lives in its arena. */
+  if (pinned != NULL && rc == LDB_OK && !have_stat_update) {
+    ldb_atomic_fetch_add(&sv->refs, 1, ldb_order_relaxed);
+    ldb_cleanup_push(&pinned->cleanup, release_pinned_super, sv, db);
+  }
+
+  ldb_lkey_clear(&lkey);
+
+  /* Seeks are charged atomically; the mutex is only needed once
+     a file runs out of them. */
+  if (have_stat_update && ldb_version_charge_seek(sv->current, &stats)) {
+    ldb_mutex_lock(&db->mutex);
+
+    if (ldb_version_mark_seek_file(sv->current, &stats))
+      ldb_maybe_schedule_compaction(db);
+
+    ldb_mutex_unlock(&db->mutex);
+  }
+
+  ldb_release_super(db, sv);
+
+  return rc;
+}
+
 int
 ldb_get(ldb_t *db, const ldb_slice_t *key,
                    ldb_slice_t *value,
                    const ldb_readopt_t *options) {
-  ldb_memtable_t *mem, *imm;
-  ldb_version_t *current;
-  ldb_seqnum_t snapshot;
-  int have_stat_update = 0;
-  ldb_getstats_t stats;
-  int rc = LDB_OK;
+  int rc;
 
   if (value != NULL)
     ldb_buffer_init(value);
@@ -1965,69 +3125,174 @@ ldb_get(ldb_t *db, const ldb_slice_t *key,
   if (options == NULL)
     options = ldb_readopt_default;
 
-  ldb_mutex_lock(&db->mutex);
+  rc = ldb_get_value(db, key, value, NULL, options);
+
+  if (value != NULL) {
+    if (rc == LDB_OK) {
+      if (value->alloc == 0)
+        ldb_buffer_grow(value, 1);
+    } else {
+      ldb_buffer_clear(value);
+    }
+  }
+
+  return rc;
+}
+
+int
+ldb_get_pinned(ldb_t *db, const ldb_slice_t *key,
+                          ldb_pinned_t *value,
+                          const ldb_readopt_t *options) {
+  int rc;
+
+  ldb_buffer_init(&value->value);
+  ldb_cleanup_init(&value->cleanup);
+
+  if (options == NULL)
+    options = ldb_readopt_default;
+
+  rc = ldb_get_value(db, key, NULL, value, options);
+
+  if (rc != LDB_OK)
+    ldb_release_pinned(value);
+
+  return rc;
+}
+
+void
+ldb_release_pinned(ldb_pinned_t *value) {
+  ldb_cleanup_clear(&value->cleanup);
+  ldb_buffer_init(&value->value);
+}
+
+static void
+ldb_sort_keys(size_t *order,
+              size_t *scratch,
+              size_t count,
+              const ldb_slice_t *keys,
+              const ldb_comparator_t *ucmp) {
+  size_t half = count / 2;
+  size_t i = 0, j = half, k = 0;
+
+  if (count < 2)
+    return;
+
+  ldb_sort_keys(order, scratch, half, keys, ucmp);
+  ldb_sort_keys(order + half, scratch, count - half, keys, ucmp);
+
+  while (i < half && j < count) {
+    if (ldb_compare(ucmp, &keys[order[j]], &keys[order[i]]) < 0)
+      scratch[k++] = order[j++];
+    else
+      scratch[k++] = order[i++];
+  }
+
+  while (i < half)
+    scratch[k++] = order[i++];
+
+  while (j < count)
+    scratch[k++] = order[j++];
+
+  memcpy(order, scratch, count * sizeof(size_t));
+}
 
+int
+ldb_multi_get(ldb_t *db, const ldb_slice_t *keys,
+                         size_t count,
+                         ldb_slice_t *values,
+                         int *statuses,
+                         const ldb_readopt_t *options) {
+  const ldb_comparator_t *ucmp = ldb_user_comparator(db);
+  int need_compaction = 0;
+  ldb_seqnum_t snapshot;
+  ldb_getstats_t stats;
+  ldb_vbatch_t batch;
+  size_t *order;
+  ldb_super_t *sv;
+  int result = LDB_OK;
+  size_t i;
+
+  if (count == 0)
+    return LDB_OK;
+
+  if (options == NULL)
+    options = ldb_readopt_default;
+
+  /* Visit the keys in comparator order so that neighbouring
+     lookups can share tables and data blocks. */
+  order = ldb_malloc(2 * count * sizeof(size_t));
+
+  for (i = 0; i < count; i++)
+    order[i] = i;
+
+  ldb_sort_keys(order, order + count, count, keys, ucmp);
+
+  /* The whole batch reads from a single sequence and super version. */
   if (options->snapshot != NULL)
     snapshot = options->snapshot->sequence;
   else
-    snapshot = ldb_vset_last_sequence(db->versions);
-
-  mem = db->mem;
-  imm = db->imm;
-  current = ldb_vset_current(db->versions);
+    snapshot = ldb_visible_sequence(db);
 
-  ldb_memtable_ref(mem);
-
-  if (imm != NULL)
-    ldb_memtable_ref(imm);
+  sv = ldb_acquire_super(db);
 
-  ldb_version_ref(current);
+  ldb_vbatch_init(&batch, sv->current);
 
-  /* Unlock while reading from files and memtables. */
-  {
+  for (i = 0; i < count; i++) {
+    size_t n = order[i];
+    ldb_slice_t *value = values != NULL ? &values[n] : NULL;
     ldb_lkey_t lkey;
+    int rc = LDB_OK;
 
-    ldb_mutex_unlock(&db->mutex);
+    if (value != NULL)
+      ldb_buffer_init(value);
 
-    /* First look in the memtable, then in the immutable memtable (if any). */
-    ldb_lkey_init(&lkey, key, snapshot);
+    ldb_lkey_init(&lkey, &keys[n], snapshot);
 
-    if (ldb_memtable_get(mem, &lkey, value, &rc)) {
+    if (ldb_memtable_get(sv->mem, &lkey, value, &rc)) {
       /* Done. */
-    } else if (imm != NULL && ldb_memtable_get(imm, &lkey, value, &rc)) {
+    } else if (sv->imm != NULL && ldb_memtable_get(sv->imm, &lkey, value, &rc)) {
       /* Done. */
     } else {
-      rc = ldb_version_get(current, options, &lkey, value, &stats);
-      have_stat_update = 1;
+      rc = ldb_vbatch_get(&batch, options, &lkey, value, &stats);
+
+      if (ldb_version_charge_seek(sv->current, &stats)) {
+        ldb_mutex_lock(&db->mutex);
+        need_compaction |= ldb_version_mark_seek_file(sv->current, &stats);
+        ldb_mutex_unlock(&db->mutex);
+      }
     }
 
     ldb_lkey_clear(&lkey);
 
-    ldb_mutex_lock(&db->mutex);
-  }
+    if (value != NULL) {
+      if (rc == LDB_OK) {
+        if (value->alloc == 0)
+          ldb_buffer_grow(value, 1);
+      } else {
+        ldb_buffer_clear(value);
+      }
+    }
 
-  if (have_stat_update && ldb_version_update_stats(current, &stats))
-    ldb_maybe_schedule_compaction(db);
+    if (statuses != NULL)
+      statuses[n] = rc;
 
-  ldb_memtable_unref(mem);
+    if (rc != LDB_OK && rc != LDB_NOTFOUND && result == LDB_OK)
+      result = rc;
+  }
 
-  if (imm != NULL)
-    ldb_memtable_unref(imm);
+  ldb_vbatch_clear(&batch);
 
-  ldb_version_unref(current);
+  if (need_compaction) {
+    ldb_mutex_lock(&db->mutex);
+    ldb_maybe_schedule_compaction(db);
+    ldb_mutex_unlock(&db->mutex);
+  }
 
-  ldb_mutex_unlock(&db->mutex);
+  ldb_release_super(db, sv);
 
-  if (value != NULL) {
-    if (rc == LDB_OK) {
-      if (value->alloc == 0)
-        ldb_buffer_grow(value, 1);
-    } else {
-      ldb_buffer_clear(value);
-    }
-  }
+  ldb_free(order);
 
-  return rc;
+  return result;
 }
 
 int
@@ -2081,55 +3346,90 @@ ldb_write(ldb_t *db, ldb_batch_t *updates, const ldb_writeopt_t *options) {
 
   w.batch = updates;
   w.sync = options->sync;
-  w.done = 0;
 
-  ldb_mutex_lock(&db->mutex);
+  if (!ldb_queue_push(&db->writers, &w)) {
+    int state = ldb_queue_await(&db->writers, &w, LDB_WRITER_LEADER
+                                                | LDB_WRITER_INSERT
+                                                | LDB_WRITER_COMPLETED);
 
-  ldb_queue_push(&db->writers, &w);
+    if (state == LDB_WRITER_INSERT) {
+      /* Our leader has logged the group and
+         asked us to apply our own batch. */
+      ldb_writer_t *leader = w.leader;
 
-  while (!w.done && &w != db->writers.head)
-    ldb_cond_wait(&w.cv, &db->mutex);
+      w.status = ldb_batch_insert_concurrently(updates, w.mem);
 
-  if (w.done) {
-    ldb_mutex_unlock(&db->mutex);
-    ldb_writer_clear(&w);
-    return w.status;
+      if (ldb_atomic_fetch_sub(&leader->pending, 1, ldb_order_acq_rel) == 1)
+        ldb_writer_set_state(leader, LDB_WRITER_INSERTED);
+
+      state = ldb_queue_await(&db->writers, &w, LDB_WRITER_COMPLETED);
+    }
+
+    if (state == LDB_WRITER_COMPLETED) {
+      /* Our write was done by the leader. */
+      ldb_writer_clear(&w);
+      return w.status;
+    }
   }
 
+  if (updates != NULL && w.sync && db->options.group_commit_delay > 0)
+    ldb_gather_group(db, &w);
+
+  ldb_mutex_lock(&db->mutex);
+
   /* May temporarily unlock and wait. */
   rc = ldb_make_room_for_write(db, updates == NULL);
   last_sequence = ldb_vset_last_sequence(db->versions);
   last_writer = &w;
 
   if (rc == LDB_OK && updates != NULL) {  /* NULL batch is for compactions. */
-    ldb_batch_t *write_batch = ldb_build_batch_group(db, &last_writer);
+    int pipelined = db->options.pipelined_write;
+    uint8_t header[LDB_BATCH_HEADER];
+    ldb_seqnum_t first_sequence;
+    uint64_t sync_target = 0;
+    uint64_t ticket = 0;
+    size_t length;
+    int count;
+
+    length = ldb_build_batch_group(db, &w, &last_writer, &count);
+
+    /* Sequences handed to groups still in the pipeline
+       are not yet visible in the version set. */
+    if (db->pipeline_head != db->pipeline_tail)
+      last_sequence = db->pipeline_sequence;
+
+    first_sequence = last_sequence + 1;
 
-    ldb_batch_set_sequence(write_batch, last_sequence + 1);
+    ldb_batch_header(header, first_sequence, count);
+    ldb_slice_set(&db->group_iov[0], header, sizeof(header));
 
-    last_sequence += ldb_batch_count(write_batch);
+    last_sequence += count;
+
+    if (pipelined) {
+      ticket = db->pipeline_tail++;
+      db->pipeline_sequence = last_sequence;
+    }
 
     /* Add to log and apply to memtable.  We can release the lock
        during this phase since &w is currently responsible for logging
        and protects against concurrent loggers and concurrent writes
        into db->mem. */
     {
-      ldb_slice_t contents;
       int sync_error = 0;
 
       ldb_mutex_unlock(&db->mutex);
 
-      contents = ldb_batch_contents(write_batch);
-      rc = ldb_logwriter_add_record(db->log, &contents);
+      rc = ldb_logwriter_add_recordv(db->log, db->group_iov, length);
 
-      if (rc == LDB_OK && options->sync) {
+      if (rc == LDB_OK && w.sync && !db->options.group_commit) {
         rc = ldb_wfile_sync(db->logfile);
 
         if (rc != LDB_OK)
           sync_error = 1;
       }
 
-      if (rc == LDB_OK)
-        rc = ldb_batch_insert_into(write_batch, db->mem);
+      if (rc == LDB_OK && !pipelined)
+        rc = ldb_insert_group(db, db->mem, &w, last_writer, first_sequence);
 
       ldb_mutex_lock(&db->mutex);
 
@@ -2139,32 +3439,60 @@ ldb_write(ldb_t *db, ldb_batch_t *updates, const ldb_writeopt_t *options) {
            So we force the DB into a mode where all future writes fail. */
         ldb_record_background_error(db, rc);
       }
+
+      /* The group may have been made sync by one of its followers. */
+      if (rc == LDB_OK && w.sync && db->options.group_commit)
+        sync_target = ++db->log_sync_requested;
     }
 
-    if (write_batch == db->tmp_batch)
-      ldb_batch_reset(db->tmp_batch);
+    if (pipelined) {
+      ldb_memtable_t *mem = db->mem;
 
-    ldb_vset_set_last_sequence(db->versions, last_sequence);
-  }
+      /* Hand the writer queue to the next group so that it can log
+         while we apply our batches. Groups reach the memtable in the
+         order they were logged, so sequences are published in order. */
+      ldb_queue_advance(&db->writers, last_writer);
 
-  for (;;) {
-    ldb_writer_t *ready = ldb_queue_shift(&db->writers);
+      /* Under group commit, the log is synced on our behalf
+         while the next group appends to it. */
+      if (sync_target != 0)
+        rc = ldb_await_log_sync(db, sync_target);
+
+      while (db->pipeline_head != ticket)
+        ldb_cond_wait(&db->pipeline_signal, &db->mutex);
+
+      if (rc == LDB_OK) {
+        ldb_mutex_unlock(&db->mutex);
+
+        rc = ldb_insert_group(db, mem, &w, last_writer, first_sequence);
+
+        ldb_mutex_lock(&db->mutex);
+      }
+
+      ldb_vset_set_last_sequence(db->versions, last_sequence);
+      ldb_publish_sequence(db);
 
-    if (ready != &w) {
-      ready->status = rc;
-      ready->done = 1;
-      ldb_cond_signal(&ready->cv);
+      db->pipeline_head++;
+
+      ldb_cond_broadcast(&db->pipeline_signal);
+
+      ldb_mutex_unlock(&db->mutex);
+
+      ldb_complete_group(&w, last_writer, rc);
+      ldb_writer_clear(&w);
+
+      return rc;
     }
 
-    if (ready == last_writer)
-      break;
+    ldb_vset_set_last_sequence(db->versions, last_sequence);
+    ldb_publish_sequence(db);
   }
 
-  /* Notify new head of write queue. */
-  if (db->writers.length > 0)
-    ldb_cond_signal(&db->writers.head->cv);
-
   ldb_mutex_unlock(&db->mutex);
+
+  /* Notify new head of write queue, then the rest of the group. */
+  ldb_queue_advance(&db->writers, last_writer);
+  ldb_complete_group(&w, last_writer, rc);
   ldb_writer_clear(&w);
 
   return rc;
@@ -2197,16 +3525,26 @@ ldb_release_snapshot(ldb_t *db, const ldb_snapshot_t *snapshot) {
 ldb_iter_t *
 ldb_iterator(ldb_t *db, const ldb_readopt_t *options) {
   const ldb_comparator_t *ucmp = ldb_user_comparator(db);
+  const ldb_prefix_t *prefix = NULL;
   ldb_seqnum_t latest_snapshot;
+  iter_state_t *state;
   ldb_iter_t *iter;
   uint32_t seed;
 
   if (options == NULL)
     options = ldb_iteropt_default;
 
-  iter = ldb_internal_iterator(db, options, &latest_snapshot, &seed);
+  if (options->prefix_same_as_start)
+    prefix = db->options.prefix_extractor;
+
+  iter = ldb_internal_iterator(db, options, &latest_snapshot, &seed, &state);
 
-  return ldb_dbiter_create(db, ucmp, iter,
+  /* Without filters there is nothing to skip; prefix seeks
+     simply stop at the end of the prefix. */
+  if (db->options.filter_policy == NULL)
+    state = NULL;
+
+  return ldb_dbiter_create(db, ucmp, iter, state, prefix, options,
                            (options->snapshot != NULL
                               ? options->snapshot->sequence
                               : latest_snapshot),
@@ -2319,6 +3657,73 @@ ldb_get_property(ldb_t *db, const char *property, char **value) {
     return 1;
   }
 
+  if (strcmp(in, "num-write-stalls") == 0) {
+    *value = ldb_malloc(21);
+
+    ldb_encode_int(*value, db->stall_count, 0);
+
+    ldb_mutex_unlock(&db->mutex);
+
+    return 1;
+  }
+
+  if (strcmp(in, "write-stall-micros") == 0) {
+    *value = ldb_malloc(21);
+
+    ldb_encode_int(*value, db->stall_micros, 0);
+
+    ldb_mutex_unlock(&db->mutex);
+
+    return 1;
+  }
+
+  if (ldb_starts_with(in, "compaction-bytes-")) {
+    int64_t total = 0;
+    int level, is_read;
+
+    in += 17;
+
+    if (strcmp(in, "read") == 0) {
+      is_read = 1;
+    } else if (strcmp(in, "written") == 0) {
+      is_read = 0;
+    } else {
+      ldb_mutex_unlock(&db->mutex);
+      return 0;
+    }
+
+    for (level = 0; level < LDB_NUM_LEVELS; level++) {
+      if (is_read)
+        total += db->stats[level].bytes_read;
+      else
+        total += db->stats[level].bytes_written;
+    }
+
+    *value = ldb_malloc(21);
+
+    ldb_encode_int(*value, total, 0);
+
+    ldb_mutex_unlock(&db->mutex);
+
+    return 1;
+  }
+
+  if (strcmp(in, "total-bytes") == 0) {
+    int64_t total = 0;
+    int level;
+
+    for (level = 0; level < LDB_NUM_LEVELS; level++)
+      total += ldb_vset_num_level_bytes(db->versions, level);
+
+    *value = ldb_malloc(21);
+
+    ldb_encode_int(*value, total, 0);
+
+    ldb_mutex_unlock(&db->mutex);
+
+    return 1;
+  }
+
   ldb_mutex_unlock(&db->mutex);
 
   return 0;
@@ -2538,7 +3943,8 @@ ldb_test_internal_iterator(ldb_t *db) {
 
   return ldb_internal_iterator(db, ldb_readopt_default,
                                    &ignored,
-                                   &ignored_seed);
+                                   &ignored_seed,
+                                   NULL);
 }
 
 int64_t
@@ -16,6 +16,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "table/iterator.h"
 #include "util/extern.h"
 #include "util/options.h"
 #include "util/types.h"
@@ -32,6 +33,13 @@ struct ldb_snapshot_s;
 
 typedef struct ldb_s ldb_t;
 
+/* A value returned by ldb_get_pinned(). The value points
+   into memory which is kept alive until it is released. */
+typedef struct ldb_pinned_s {
+  ldb_slice_t value;
+  ldb_cleanup_t cleanup;
+} ldb_pinned_t;
+
 /*
  * Helpers
  */
@@ -57,6 +65,21 @@ ldb_get(ldb_t *db, const ldb_slice_t *key,
                    ldb_slice_t *value,
                    const ldb_readopt_t *options);
 
+LDB_EXTERN int
+ldb_get_pinned(ldb_t *db, const ldb_slice_t *key,
+                          ldb_pinned_t *value,
+                          const ldb_readopt_t *options);
+
+LDB_EXTERN void
+ldb_release_pinned(ldb_pinned_t *value);
+
+LDB_EXTERN int
+ldb_multi_get(ldb_t *db, const ldb_slice_t *keys,
+                         size_t count,
+                         ldb_slice_t *values,
+                         int *statuses,
+                         const ldb_readopt_t *options);
+
 LDB_EXTERN int
 ldb_has(ldb_t *db, const ldb_slice_t *key, const ldb_readopt_t *options);
 
@@ -126,4 +149,14 @@ ldb_test_max_next_level_overlapping_bytes(ldb_t *db);
 void
 ldb_record_read_sample(ldb_t *db, const ldb_slice_t *key);
 
+/* Return an internal iterator over the memtables and version pinned
+   by "state" (as handed to ldb_dbiter_create()) which leaves out the
+   tables whose prefix filters rule out "prefix". The result must be
+   destroyed before the iterator owning "state". */
+ldb_iter_t *
+ldb_prefix_iterator(ldb_t *db,
+                    void *state,
+                    const ldb_readopt_t *options,
+                    const ldb_slice_t *prefix);
+
 #endif /* LDB_DB_IMPL_H */
@@ -19,6 +19,8 @@
 #include "util/buffer.h"
 #include "util/comparator.h"
 #include "util/internal.h"
+#include "util/options.h"
+#include "util/prefix.h"
 #include "util/random.h"
 #include "util/slice.h"
 #include "util/status.h"
@@ -53,8 +55,17 @@ enum ldb_direction { LDB_FORWARD, LDB_REVERSE };
 typedef struct ldb_dbiter_s {
   ldb_t *db;
   const ldb_comparator_t *ucmp;
-  ldb_iter_t *iter;
+  ldb_iter_t *iter;         /* Either full or piter. */
+  ldb_iter_t *full;
+  ldb_iter_t *piter;        /* Restricted to the tables holding prefix. */
+  void *state;              /* May be NULL. */
+  ldb_readopt_t options;
   ldb_seqnum_t sequence;
+  const ldb_slice_t *lower; /* May be NULL. */
+  const ldb_slice_t *upper; /* May be NULL. */
+  const ldb_prefix_t *extractor; /* May be NULL. */
+  ldb_buffer_t prefix;      /* Prefix of the last seek in prefix mode. */
+  int prefix_seek;
   int status;
   ldb_buffer_t saved_key;   /* == current key when direction==LDB_REVERSE */
   ldb_buffer_t saved_value; /* == current value when direction==LDB_REVERSE */
@@ -98,6 +109,35 @@ parse_key(ldb_dbiter_t *iter, ldb_pkey_t *ikey) {
   return 1;
 }
 
+static LDB_INLINE int
+below_lower(const ldb_dbiter_t *iter, const ldb_slice_t *user_key) {
+  return iter->lower != NULL
+      && ldb_compare(iter->ucmp, user_key, iter->lower) < 0;
+}
+
+static LDB_INLINE int
+above_upper(const ldb_dbiter_t *iter, const ldb_slice_t *user_key) {
+  return iter->upper != NULL
+      && ldb_compare(iter->ucmp, user_key, iter->upper) >= 0;
+}
+
+/* Whether a prefix seek is in progress and "user_key" does not share
+   its prefix. Keys outside of the extractor's domain share nothing. */
+static LDB_INLINE int
+past_prefix(const ldb_dbiter_t *iter, const ldb_slice_t *user_key) {
+  ldb_slice_t prefix;
+
+  if (!iter->prefix_seek)
+    return 0;
+
+  if (!ldb_prefix_in_domain(iter->extractor, user_key))
+    return 1;
+
+  prefix = ldb_prefix_transform(iter->extractor, user_key);
+
+  return !ldb_slice_equal(&prefix, &iter->prefix);
+}
+
 static LDB_INLINE void
 clear_saved_value(ldb_dbiter_t *iter) {
   if (iter->saved_value.alloc > 1048576) {
@@ -117,23 +157,33 @@ find_next_user_entry(ldb_dbiter_t *iter, int skipping, ldb_buffer_t *skip) {
   do {
     ldb_pkey_t ikey;
 
-    if (parse_key(iter, &ikey) && ikey.sequence <= iter->sequence) {
-      switch (ikey.type) {
-        case LDB_TYPE_DELETION:
-          /* Arrange to skip all upcoming entries for this key since
-             they are hidden by this deletion. */
-          ldb_buffer_copy(skip, &ikey.user_key);
-          skipping = 1;
-          break;
-        case LDB_TYPE_VALUE:
-          if (skipping && ldb_compare(iter->ucmp, &ikey.user_key, skip) <= 0) {
-            /* Entry hidden. */
-          } else {
-            iter->valid = 1;
-            ldb_buffer_reset(&iter->saved_key);
-            return;
-          }
-          break;
+    if (parse_key(iter, &ikey)) {
+      /* Everything from here on is out of range. */
+      if (above_upper(iter, &ikey.user_key))
+        break;
+
+      if (past_prefix(iter, &ikey.user_key))
+        break;
+
+      if (ikey.sequence <= iter->sequence) {
+        switch (ikey.type) {
+          case LDB_TYPE_DELETION:
+            /* Arrange to skip all upcoming entries for this key since
+               they are hidden by this deletion. */
+            ldb_buffer_copy(skip, &ikey.user_key);
+            skipping = 1;
+            break;
+          case LDB_TYPE_VALUE:
+            if (skipping &&
+                ldb_compare(iter->ucmp, &ikey.user_key, skip) <= 0) {
+              /* Entry hidden. */
+            } else {
+              iter->valid = 1;
+              ldb_buffer_reset(&iter->saved_key);
+              return;
+            }
+            break;
+        }
       }
     }
 
@@ -155,30 +205,40 @@ find_prev_user_entry(ldb_dbiter_t *iter) {
     do {
       ldb_pkey_t ikey;
 
-      if (parse_key(iter, &ikey) && ikey.sequence <= iter->sequence) {
-        if ((value_type != LDB_TYPE_DELETION) &&
-            ldb_compare(iter->ucmp, &ikey.user_key, &iter->saved_key) < 0) {
-          /* We encountered a non-deleted value in entries for previous keys. */
+      if (parse_key(iter, &ikey)) {
+        /* Everything from here on is out of range. */
+        if (below_lower(iter, &ikey.user_key))
           break;
-        }
-
-        value_type = ikey.type;
 
-        if (value_type == LDB_TYPE_DELETION) {
-          ldb_buffer_reset(&iter->saved_key);
-          clear_saved_value(iter);
-        } else {
-          ldb_slice_t key = ldb_iter_key(iter->iter);
-          ldb_slice_t ukey = ldb_extract_user_key(&key);
-          ldb_slice_t value = ldb_iter_value(iter->iter);
+        if (past_prefix(iter, &ikey.user_key))
+          break;
 
-          if (iter->saved_value.alloc > value.size + 1048576) {
-            ldb_buffer_clear(&iter->saved_value);
-            ldb_buffer_init(&iter->saved_value);
+        if (ikey.sequence <= iter->sequence) {
+          if ((value_type != LDB_TYPE_DELETION) &&
+              ldb_compare(iter->ucmp, &ikey.user_key, &iter->saved_key) < 0) {
+            /* We encountered a non-deleted value
+               in entries for previous keys. */
+            break;
           }
 
-          ldb_buffer_copy(&iter->saved_key, &ukey);
-          ldb_buffer_copy(&iter->saved_value, &value);
+          value_type = ikey.type;
+
+          if (value_type == LDB_TYPE_DELETION) {
+            ldb_buffer_reset(&iter->saved_key);
+            clear_saved_value(iter);
+          } else {
+            ldb_slice_t key = ldb_iter_key(iter->iter);
+            ldb_slice_t ukey = ldb_extract_user_key(&key);
+            ldb_slice_t value = ldb_iter_value(iter->iter);
+
+            if (iter->saved_value.alloc > value.size + 1048576) {
+              ldb_buffer_clear(&iter->saved_value);
+              ldb_buffer_init(&iter->saved_value);
+            }
+
+            ldb_buffer_copy(&iter->saved_key, &ukey);
+            ldb_buffer_copy(&iter->saved_value, &value);
+          }
         }
       }
 
@@ -197,6 +257,63 @@ find_prev_user_entry(ldb_dbiter_t *iter) {
   }
 }
 
+static void
+full_mode(ldb_dbiter_t *iter) {
+  iter->iter = iter->full;
+  iter->prefix_seek = 0;
+}
+
+/* Enter prefix mode for a seek to "target". Returns the restricted
+   iterator being replaced, which the caller must destroy once "target"
+   (possibly pointing into it) is no longer needed. */
+static ldb_iter_t *
+prefix_mode(ldb_dbiter_t *iter, const ldb_slice_t *target) {
+  ldb_iter_t *last = iter->piter;
+  ldb_slice_t prefix;
+
+  if (!ldb_prefix_in_domain(iter->extractor, target)) {
+    full_mode(iter);
+    return NULL;
+  }
+
+  prefix = ldb_prefix_transform(iter->extractor, target);
+
+  iter->prefix_seek = 1;
+
+  /* Reuse the restricted iterator if the prefix is unchanged. */
+  if (last != NULL && ldb_slice_equal(&prefix, &iter->prefix)) {
+    iter->iter = last;
+    return NULL;
+  }
+
+  ldb_buffer_copy(&iter->prefix, &prefix);
+
+  if (iter->state == NULL)
+    return NULL;
+
+  iter->piter = ldb_prefix_iterator(iter->db,
+                                    iter->state,
+                                    &iter->options,
+                                    &iter->prefix);
+
+  iter->iter = iter->piter;
+
+  return last;
+}
+
+/* Position the internal iterator at the first entry of the prefix. */
+static void
+seek_prefix(ldb_dbiter_t *iter) {
+  ldb_ikey_t key;
+
+  ldb_ikey_init(&key);
+  ldb_ikey_set(&key, &iter->prefix, LDB_MAX_SEQUENCE, LDB_VALTYPE_SEEK);
+
+  ldb_iter_seek(iter->iter, &key);
+
+  ldb_ikey_clear(&key);
+}
+
 /*
  * DBIter
  */
@@ -206,14 +323,27 @@ ldb_dbiter_init(ldb_dbiter_t *iter,
                 ldb_t *db,
                 const ldb_comparator_t *ucmp,
                 ldb_iter_t *internal_iter,
+                void *state,
+                const ldb_prefix_t *extractor,
+                const ldb_readopt_t *options,
                 ldb_seqnum_t sequence,
                 uint32_t seed) {
   iter->db = db;
   iter->ucmp = ucmp;
   iter->iter = internal_iter;
+  iter->full = internal_iter;
+  iter->piter = NULL;
+  iter->state = state;
+  iter->options = *options;
   iter->sequence = sequence;
+  iter->lower = options->iterate_lower_bound;
+  iter->upper = options->iterate_upper_bound;
+  iter->extractor = extractor;
+  iter->prefix_seek = 0;
   iter->status = LDB_OK;
 
+  ldb_buffer_init(&iter->prefix);
+
   ldb_buffer_init(&iter->saved_key);
   ldb_buffer_init(&iter->saved_value);
 
@@ -227,7 +357,11 @@ ldb_dbiter_init(ldb_dbiter_t *iter,
 
 static void
 ldb_dbiter_clear(ldb_dbiter_t *iter) {
-  ldb_iter_destroy(iter->iter);
+  if (iter->piter != NULL)
+    ldb_iter_destroy(iter->piter);
+
+  ldb_iter_destroy(iter->full);
+  ldb_buffer_clear(&iter->prefix);
   ldb_buffer_clear(&iter->saved_key);
   ldb_buffer_clear(&iter->saved_value);
 }
@@ -276,10 +410,12 @@ ldb_dbiter_next(ldb_dbiter_t *iter) {
     /* iter->iter is pointing just before the entries for key(),
        so advance into the range of entries for key() and then
        use the normal skipping code below. */
-    if (!ldb_iter_valid(iter->iter))
-      ldb_iter_seek_first(iter->iter);
-    else
+    if (ldb_iter_valid(iter->iter))
       ldb_iter_next(iter->iter);
+    else if (iter->prefix_seek)
+      seek_prefix(iter);
+    else
+      ldb_iter_seek_first(iter->iter);
 
     if (!ldb_iter_valid(iter->iter)) {
       iter->valid = 0;
@@ -348,7 +484,7 @@ ldb_dbiter_prev(ldb_dbiter_t *iter) {
 }
 
 static void
-ldb_dbiter_seek(ldb_dbiter_t *iter, const ldb_slice_t *target) {
+seek_to(ldb_dbiter_t *iter, const ldb_slice_t *target) {
   ldb_pkey_t pkey;
 
   iter->direction = LDB_FORWARD;
@@ -357,6 +493,11 @@ ldb_dbiter_seek(ldb_dbiter_t *iter, const ldb_slice_t *target) {
 
   ldb_buffer_reset(&iter->saved_key);
 
+  if (above_upper(iter, target)) {
+    iter->valid = 0;
+    return;
+  }
+
   ldb_pkey_init(&pkey, target, iter->sequence, LDB_VALTYPE_SEEK);
   ldb_pkey_export(&iter->saved_key, &pkey);
 
@@ -368,8 +509,31 @@ ldb_dbiter_seek(ldb_dbiter_t *iter, const ldb_slice_t *target) {
     iter->valid = 0;
 }
 
+static void
+ldb_dbiter_seek(ldb_dbiter_t *iter, const ldb_slice_t *target) {
+  ldb_iter_t *last = NULL;
+
+  if (below_lower(iter, target))
+    target = iter->lower;
+
+  if (iter->extractor != NULL)
+    last = prefix_mode(iter, target);
+
+  seek_to(iter, target);
+
+  if (last != NULL)
+    ldb_iter_destroy(last);
+}
+
 static void
 ldb_dbiter_seek_first(ldb_dbiter_t *iter) {
+  full_mode(iter);
+
+  if (iter->lower != NULL) {
+    seek_to(iter, iter->lower);
+    return;
+  }
+
   iter->direction = LDB_FORWARD;
 
   clear_saved_value(iter);
@@ -384,11 +548,33 @@ ldb_dbiter_seek_first(ldb_dbiter_t *iter) {
 
 static void
 ldb_dbiter_seek_last(ldb_dbiter_t *iter) {
+  full_mode(iter);
+
   iter->direction = LDB_REVERSE;
 
   clear_saved_value(iter);
 
-  ldb_iter_seek_last(iter->iter);
+  if (iter->upper != NULL) {
+    /* Position the internal iterator at the last
+       entry whose user key is below the bound. */
+    ldb_pkey_t pkey;
+
+    ldb_buffer_reset(&iter->saved_key);
+
+    ldb_pkey_init(&pkey, iter->upper, LDB_MAX_SEQUENCE, LDB_VALTYPE_SEEK);
+    ldb_pkey_export(&iter->saved_key, &pkey);
+
+    ldb_iter_seek(iter->iter, &iter->saved_key);
+
+    ldb_buffer_reset(&iter->saved_key);
+
+    if (ldb_iter_valid(iter->iter))
+      ldb_iter_prev(iter->iter);
+    else
+      ldb_iter_seek_last(iter->iter);
+  } else {
+    ldb_iter_seek_last(iter->iter);
+  }
 
   find_prev_user_entry(iter);
 }
@@ -399,9 +585,15 @@ ldb_iter_t *
 ldb_dbiter_create(ldb_t *db,
                   const ldb_comparator_t *user_comparator,
                   ldb_iter_t *internal_iter,
+                  void *state,
+                  const ldb_prefix_t *prefix_extractor,
+                  const ldb_readopt_t *options,
                   ldb_seqnum_t sequence,
                   uint32_t seed) {
   ldb_dbiter_t *iter = ldb_malloc(sizeof(ldb_dbiter_t));
-  ldb_dbiter_init(iter, db, user_comparator, internal_iter, sequence, seed);
+
+  ldb_dbiter_init(iter, db, user_comparator, internal_iter, state,
+                  prefix_extractor, options, sequence, seed);
+
   return ldb_iter_create(iter, &ldb_dbiter_table);
 }
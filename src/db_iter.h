@@ -18,11 +18,16 @@
 struct ldb_s;
 struct ldb_comparator_s;
 struct ldb_iter_s;
+struct ldb_prefix_s;
+struct ldb_readopt_s;
 
 struct ldb_iter_s *
 ldb_dbiter_create(struct ldb_s *db,
                   const struct ldb_comparator_s *user_comparator,
                   struct ldb_iter_s *internal_iter,
+                  void *state,
+                  const struct ldb_prefix_s *prefix_extractor,
+                  const struct ldb_readopt_s *options,
                   uint64_t sequence,
                   uint32_t seed);
 
@@ -28,6 +28,7 @@
 #include "util/internal.h"
 #include "util/options.h"
 #include "util/port.h"
+#include "util/prefix.h"
 #include "util/random.h"
 #include "util/rbt.h"
 #include "util/slice.h"
@@ -61,7 +62,11 @@ enum option_config {
   CONFIG_DEFAULT,
   CONFIG_REUSE,
   CONFIG_FILTER,
+  CONFIG_FULL_FILTER,
   CONFIG_UNCOMPRESSED,
+  CONFIG_CONCURRENT,
+  CONFIG_PIPELINED,
+  CONFIG_GROUP_COMMIT,
   CONFIG_END
 };
 
@@ -240,9 +245,23 @@ test_current_options(test_t *t) {
     case CONFIG_FILTER:
       options.filter_policy = t->policy;
       break;
+    case CONFIG_FULL_FILTER:
+      options.filter_policy = t->policy;
+      options.full_filter = 1;
+      break;
     case CONFIG_UNCOMPRESSED:
       options.compression = LDB_NO_COMPRESSION;
       break;
+    case CONFIG_CONCURRENT:
+      options.concurrent_memtable_writes = 1;
+      break;
+    case CONFIG_PIPELINED:
+      options.pipelined_write = 1;
+      break;
+    case CONFIG_GROUP_COMMIT:
+      options.group_commit = 1;
+      options.group_commit_delay = 100;
+      break;
     default:
       break;
   }
@@ -828,6 +847,40 @@ test_db_get_memusage(test_t *t) {
   } while (test_change_options(t));
 }
 
+static void
+test_db_get_compaction_properties(test_t *t) {
+  uint64_t read, written, total, stalls;
+  char *val;
+
+  ASSERT(test_put(t, "foo", "v1") == LDB_OK);
+  ASSERT(test_put(t, "bar", "v2") == LDB_OK);
+  ASSERT(ldb_test_compact_memtable(t->db) == LDB_OK);
+
+  ASSERT(ldb_get_property(t->db, "leveldb.compaction-bytes-read", &val));
+  read = atoi(val);
+  ldb_free(val);
+
+  ASSERT(ldb_get_property(t->db, "leveldb.compaction-bytes-written", &val));
+  written = atoi(val);
+  ldb_free(val);
+
+  ASSERT(ldb_get_property(t->db, "leveldb.total-bytes", &val));
+  total = atoi(val);
+  ldb_free(val);
+
+  ASSERT(ldb_get_property(t->db, "leveldb.num-write-stalls", &val));
+  stalls = atoi(val);
+  ldb_free(val);
+
+  ASSERT(!ldb_get_property(t->db, "leveldb.compaction-bytes-foo", &val));
+
+  /* A memtable flush writes a table but reads nothing. */
+  ASSERT(read == 0);
+  ASSERT(written > 0);
+  ASSERT(total == written);
+  ASSERT(stalls == 0);
+}
+
 static void
 test_db_get_snapshot(test_t *t) {
   do {
@@ -856,6 +909,81 @@ test_db_get_snapshot(test_t *t) {
   } while (test_change_options(t));
 }
 
+static void
+test_db_multi_get(test_t *t) {
+  do {
+    static const char *keys[] = { "k9", "k1", "k5", "k0", "k3",
+                                  "k7", "k2", "k1", "k8", "k4" };
+    ldb_slice_t key[10], val[10];
+    const ldb_snapshot_t *snap;
+    ldb_readopt_t opt;
+    int rc[10];
+    int i;
+
+    for (i = 0; i < 10; i++)
+      key[i] = ldb_string(keys[i]);
+
+    ASSERT(test_put(t, "k1", "v1") == LDB_OK);
+    ASSERT(test_put(t, "k2", "v2") == LDB_OK);
+    ASSERT(test_put(t, "k3", "v3") == LDB_OK);
+
+    ldb_test_compact_memtable(t->db);
+
+    ASSERT(test_put(t, "k4", "v4") == LDB_OK);
+    ASSERT(test_put(t, "k8", "v8") == LDB_OK);
+    ASSERT(test_del(t, "k2") == LDB_OK);
+
+    ldb_test_compact_memtable(t->db);
+
+    snap = ldb_get_snapshot(t->db);
+
+    ASSERT(test_put(t, "k1", "v1b") == LDB_OK);
+    ASSERT(test_put(t, "k5", "v5") == LDB_OK);
+    ASSERT(test_del(t, "k8") == LDB_OK);
+
+    ASSERT(ldb_multi_get(t->db, key, 10, val, rc, 0) == LDB_OK);
+
+    for (i = 0; i < 10; i++) {
+      const char *expect = test_get(t, keys[i]);
+
+      if (strcmp(expect, "NOT_FOUND") == 0) {
+        ASSERT(rc[i] == LDB_NOTFOUND);
+      } else {
+        ASSERT(rc[i] == LDB_OK);
+        ASSERT(val[i].size == strlen(expect));
+        ASSERT(memcmp(val[i].data, expect, val[i].size) == 0);
+        ldb_free(val[i].data);
+      }
+    }
+
+    ASSERT(rc[1] == LDB_OK && rc[7] == LDB_OK);
+    ASSERT(rc[6] == LDB_NOTFOUND);
+
+    opt = *ldb_readopt_default;
+    opt.snapshot = snap;
+
+    ASSERT(ldb_multi_get(t->db, key, 10, val, rc, &opt) == LDB_OK);
+
+    for (i = 0; i < 10; i++) {
+      const char *expect = test_get2(t, keys[i], snap);
+
+      if (strcmp(expect, "NOT_FOUND") == 0) {
+        ASSERT(rc[i] == LDB_NOTFOUND);
+      } else {
+        ASSERT(rc[i] == LDB_OK);
+        ASSERT(val[i].size == strlen(expect));
+        ASSERT(memcmp(val[i].data, expect, val[i].size) == 0);
+        ldb_free(val[i].data);
+      }
+    }
+
+    ASSERT(rc[8] == LDB_OK);
+    ASSERT(rc[2] == LDB_NOTFOUND);
+
+    ldb_release_snapshot(t->db, snap);
+  } while (test_change_options(t));
+}
+
 static void
 test_db_get_identical_snapshots(test_t *t) {
   do {
@@ -1185,7 +1313,432 @@ test_db_iter_multi(test_t *t) {
   ldb_iter_prev(iter);
   ASSERT_EQ(iter_status(t, iter), "(invalid)");
 
-  ldb_iter_destroy(iter);
+  ldb_iter_destroy(iter);
+}
+
+static void
+test_db_iter_bounds(test_t *t) {
+  ldb_dbopt_t options = test_current_options(t);
+  ldb_readopt_t opt = *ldb_readopt_default;
+  ldb_slice_t lower = ldb_string("b");
+  ldb_slice_t upper = ldb_string("f");
+  char key[32], val[32];
+  ldb_iter_t *iter;
+  int i, count;
+
+  ASSERT(test_put(t, "a", "va") == LDB_OK);
+  ASSERT(test_put(t, "b", "vb") == LDB_OK);
+  ASSERT(test_put(t, "c", "vc") == LDB_OK);
+
+  ldb_test_compact_memtable(t->db);
+
+  ASSERT(test_put(t, "d", "vd") == LDB_OK);
+  ASSERT(test_put(t, "e", "ve") == LDB_OK);
+  ASSERT(test_put(t, "f", "vf") == LDB_OK);
+
+  ldb_test_compact_memtable(t->db);
+
+  ASSERT(test_put(t, "g", "vg") == LDB_OK);
+  ASSERT(test_del(t, "c") == LDB_OK);
+
+  opt.iterate_lower_bound = &lower;
+  opt.iterate_upper_bound = &upper;
+
+  iter = ldb_iterator(t->db, &opt);
+
+  ldb_iter_seek_first(iter);
+  ASSERT_EQ(iter_status(t, iter), "b->vb");
+  ldb_iter_next(iter);
+  ASSERT_EQ(iter_status(t, iter), "d->vd");
+  ldb_iter_next(iter);
+  ASSERT_EQ(iter_status(t, iter), "e->ve");
+  ldb_iter_next(iter);
+  ASSERT_EQ(iter_status(t, iter), "(invalid)");
+
+  ldb_iter_seek_last(iter);
+  ASSERT_EQ(iter_status(t, iter), "e->ve");
+  ldb_iter_prev(iter);
+  ASSERT_EQ(iter_status(t, iter), "d->vd");
+  ldb_iter_prev(iter);
+  ASSERT_EQ(iter_status(t, iter), "b->vb");
+  ldb_iter_prev(iter);
+  ASSERT_EQ(iter_status(t, iter), "(invalid)");
+
+  iter_seek(iter, "");
+  ASSERT_EQ(iter_status(t, iter), "b->vb");
+  iter_seek(iter, "c");
+  ASSERT_EQ(iter_status(t, iter), "d->vd");
+  iter_seek(iter, "f");
+  ASSERT_EQ(iter_status(t, iter), "(invalid)");
+  iter_seek(iter, "z");
+  ASSERT_EQ(iter_status(t, iter), "(invalid)");
+
+  /* Switch directions at the edges. */
+  ldb_iter_seek_last(iter);
+  ldb_iter_prev(iter);
+  ldb_iter_next(iter);
+  ASSERT_EQ(iter_status(t, iter), "e->ve");
+
+  ldb_iter_seek_first(iter);
+  ldb_iter_next(iter);
+  ldb_iter_prev(iter);
+  ASSERT_EQ(iter_status(t, iter), "b->vb");
+
+  ldb_iter_destroy(iter);
+
+  /* One-sided bounds. */
+  opt.iterate_upper_bound = NULL;
+
+  iter = ldb_iterator(t->db, &opt);
+
+  ldb_iter_seek_first(iter);
+  ASSERT_EQ(iter_status(t, iter), "b->vb");
+  ldb_iter_seek_last(iter);
+  ASSERT_EQ(iter_status(t, iter), "g->vg");
+
+  ldb_iter_destroy(iter);
+
+  opt.iterate_lower_bound = NULL;
+  opt.iterate_upper_bound = &upper;
+
+  iter = ldb_iterator(t->db, &opt);
+
+  ldb_iter_seek_first(iter);
+  ASSERT_EQ(iter_status(t, iter), "a->va");
+  ldb_iter_seek_last(iter);
+  ASSERT_EQ(iter_status(t, iter), "e->ve");
+
+  ldb_iter_destroy(iter);
+
+  /* Many small blocks spread over several levels. */
+  options.create_if_missing = 1;
+  options.block_size = 256;
+
+  test_destroy_and_reopen(t, &options);
+
+  for (i = 0; i < 300; i++) {
+    sprintf(key, "key%03d", i);
+    sprintf(val, "val%03d", i);
+
+    ASSERT(test_put(t, key, val) == LDB_OK);
+
+    if (i % 100 == 99)
+      ldb_test_compact_memtable(t->db);
+  }
+
+  lower = ldb_string("key050");
+  upper = ldb_string("key250");
+
+  opt.iterate_lower_bound = &lower;
+  opt.iterate_upper_bound = &upper;
+
+  iter = ldb_iterator(t->db, &opt);
+
+  count = 0;
+
+  for (ldb_iter_seek_first(iter); ldb_iter_valid(iter); ldb_iter_next(iter)) {
+    sprintf(key, "key%03d->val%03d", 50 + count, 50 + count);
+    ASSERT_EQ(iter_status(t, iter), key);
+    count++;
+  }
+
+  ASSERT(count == 200);
+
+  count = 0;
+
+  for (ldb_iter_seek_last(iter); ldb_iter_valid(iter); ldb_iter_prev(iter))
+    count++;
+
+  ASSERT(count == 200);
+  ASSERT(ldb_iter_status(iter) == LDB_OK);
+
+  ldb_iter_destroy(iter);
+}
+
+static void
+test_db_iter_readahead(test_t *t) {
+  ldb_dbopt_t options = test_current_options(t);
+  char key[128], val[128];
+  ldb_iter_t *iter;
+  int i, pass, count;
+
+  options.create_if_missing = 1;
+  options.use_mmap = 0;
+  options.block_size = 1024;
+
+  for (pass = 0; pass < 2; pass++) {
+    options.compression = pass ? LDB_SNAPPY_COMPRESSION
+                               : LDB_NO_COMPRESSION;
+
+    test_destroy_and_reopen(t, &options);
+
+    for (i = 0; i < 3000; i++) {
+      sprintf(key, "key%06d", i);
+      sprintf(val, "%0100d", i);
+
+      ASSERT(test_put(t, key, val) == LDB_OK);
+    }
+
+    test_compact(t, "a", "z");
+
+    iter = ldb_iterator(t->db, 0);
+
+    /* A full scan is served by reads of growing size. */
+    ldb_iter_seek_first(iter);
+
+    for (count = 0; ldb_iter_valid(iter); count++) {
+      sprintf(key, "key%06d->%0100d", count, count);
+      ASSERT_EQ(iter_status(t, iter), key);
+      ldb_iter_next(iter);
+    }
+
+    ASSERT(count == 3000);
+
+    /* Reverse and random access never read ahead. */
+    for (ldb_iter_seek_last(iter); ldb_iter_valid(iter); ldb_iter_prev(iter))
+      count--;
+
+    ASSERT(count == 0);
+
+    for (i = 2999; i >= 0; i -= 97) {
+      sprintf(key, "key%06d", i);
+      iter_seek(iter, key);
+      sprintf(key, "key%06d->%0100d", i, i);
+      ASSERT_EQ(iter_status(t, iter), key);
+    }
+
+    ASSERT(ldb_iter_status(iter) == LDB_OK);
+
+    ldb_iter_destroy(iter);
+  }
+}
+
+static void
+test_db_iter_prefetch(test_t *t) {
+  ldb_dbopt_t options = test_current_options(t);
+  ldb_readopt_t opt = *ldb_iteropt_default;
+  char key[128], val[128];
+  ldb_iter_t *iter;
+  int i, pass, count;
+
+  options.create_if_missing = 1;
+  options.block_size = 1024;
+
+  test_destroy_and_reopen(t, &options);
+
+  for (i = 0; i < 3000; i++) {
+    sprintf(key, "key%06d", i);
+    sprintf(val, "%0100d", i);
+
+    ASSERT(test_put(t, key, val) == LDB_OK);
+  }
+
+  test_compact(t, "a", "z");
+
+  opt.prefetch_blocks = 4;
+
+  for (pass = 0; pass < 2; pass++) {
+    opt.fill_cache = pass;
+
+    iter = ldb_iterator(t->db, &opt);
+
+    ldb_iter_seek_first(iter);
+
+    for (count = 0; ldb_iter_valid(iter); count++) {
+      sprintf(key, "key%06d->%0100d", count, count);
+      ASSERT_EQ(iter_status(t, iter), key);
+      ldb_iter_next(iter);
+    }
+
+    ASSERT(count == 3000);
+
+    /* Jumping around discards blocks read for the old position. */
+    for (i = 0; i < 3000; i += 311) {
+      sprintf(key, "key%06d", i);
+      iter_seek(iter, key);
+      ldb_iter_next(iter);
+      sprintf(key, "key%06d->%0100d", i + 1, i + 1);
+      ASSERT_EQ(iter_status(t, iter), key);
+      ldb_iter_prev(iter);
+      ldb_iter_prev(iter);
+
+      if (i > 0) {
+        sprintf(key, "key%06d->%0100d", i - 1, i - 1);
+        ASSERT_EQ(iter_status(t, iter), key);
+      }
+    }
+
+    ASSERT(ldb_iter_status(iter) == LDB_OK);
+
+    /* Destroy with reads still in flight. */
+    iter_seek(iter, "key001500");
+    ldb_iter_destroy(iter);
+  }
+}
+
+static void
+check_prefix_seek(test_t *t) {
+  ldb_readopt_t opt = *ldb_readopt_default;
+  char key[32];
+  ldb_iter_t *iter;
+  int i;
+
+  opt.prefix_same_as_start = 1;
+
+  iter = ldb_iterator(t->db, &opt);
+
+  /* Forward scans stop at the end of the prefix. */
+  iter_seek(iter, "bbb");
+
+  for (i = 0; i < 20; i++) {
+    if (i == 10)
+      continue;
+
+    sprintf(key, "bbb%03d->v%03d", i, i);
+    ASSERT_EQ(iter_status(t, iter), key);
+    ldb_iter_next(iter);
+  }
+
+  ASSERT_EQ(iter_status(t, iter), "(invalid)");
+
+  /* So do reverse scans. */
+  iter_seek(iter, "ccc005");
+  ASSERT_EQ(iter_status(t, iter), "ccc005->v005");
+
+  for (i = 4; i >= 0; i--) {
+    ldb_iter_prev(iter);
+    sprintf(key, "ccc%03d->v%03d", i, i);
+    ASSERT_EQ(iter_status(t, iter), key);
+  }
+
+  ldb_iter_prev(iter);
+  ASSERT_EQ(iter_status(t, iter), "(invalid)");
+
+  /* Switch directions at the start of the prefix. */
+  iter_seek(iter, "aaa001");
+  ldb_iter_prev(iter);
+  ASSERT_EQ(iter_status(t, iter), "aaa000->v000");
+  ldb_iter_next(iter);
+  ASSERT_EQ(iter_status(t, iter), "aaa001->v001");
+
+  /* Absent prefixes yield nothing. */
+  iter_seek(iter, "abc");
+  ASSERT_EQ(iter_status(t, iter), "(invalid)");
+  iter_seek(iter, "eee");
+  ASSERT_EQ(iter_status(t, iter), "(invalid)");
+
+  /* Seeks to the same prefix again. */
+  iter_seek(iter, "ddd019");
+  ASSERT_EQ(iter_status(t, iter), "ddd019->v019");
+  ldb_iter_next(iter);
+  ASSERT_EQ(iter_status(t, iter), "(invalid)");
+  iter_seek(iter, "ddd000");
+  ASSERT_EQ(iter_status(t, iter), "ddd000->v000");
+
+  /* Targets outside of the domain are not restricted. */
+  iter_seek(iter, "b");
+  ASSERT_EQ(iter_status(t, iter), "bbb000->v000");
+
+  for (i = 0; i < 19; i++)
+    ldb_iter_next(iter);
+
+  ASSERT_EQ(iter_status(t, iter), "ccc000->v000");
+
+  /* Nor are seek_first() and seek_last(). */
+  ldb_iter_seek_first(iter);
+  ASSERT_EQ(iter_status(t, iter), "aaa000->v000");
+
+  for (i = 0; i < 20; i++)
+    ldb_iter_next(iter);
+
+  ASSERT_EQ(iter_status(t, iter), "bbb000->v000");
+
+  ldb_iter_seek_last(iter);
+  ASSERT_EQ(iter_status(t, iter), "ddd019->v019");
+
+  for (i = 0; i < 20; i++)
+    ldb_iter_prev(iter);
+
+  ASSERT_EQ(iter_status(t, iter), "ccc019->v019");
+  ASSERT(ldb_iter_status(iter) == LDB_OK);
+
+  ldb_iter_destroy(iter);
+}
+
+static void
+test_db_prefix_seek(test_t *t) {
+  static const char *prefixes[] = { "aaa", "ccc", "bbb", "ddd" };
+  ldb_dbopt_t options = test_current_options(t);
+  char key[32], val[32];
+  int i, j;
+
+  options.create_if_missing = 1;
+  options.prefix_extractor = ldb_prefix_create_fixed(3);
+
+  /* Without a filter policy, seeks are restricted but skip nothing. */
+  test_destroy_and_reopen(t, &options);
+
+  for (i = 0; i < 4; i++) {
+    for (j = 0; j < 20; j++) {
+      sprintf(key, "%s%03d", prefixes[i], j);
+      sprintf(val, "v%03d", j);
+
+      ASSERT(test_put(t, key, val) == LDB_OK);
+    }
+
+    if (i != 0)
+      ldb_test_compact_memtable(t->db);
+  }
+
+  ASSERT(test_del(t, "bbb010") == LDB_OK);
+
+  check_prefix_seek(t);
+
+  /* With one, tables are skipped. */
+  options.filter_policy = ldb_bloom_create(10);
+
+  test_destroy_and_reopen(t, &options);
+
+  for (i = 0; i < 4; i++) {
+    for (j = 0; j < 20; j++) {
+      sprintf(key, "%s%03d", prefixes[i], j);
+      sprintf(val, "v%03d", j);
+
+      ASSERT(test_put(t, key, val) == LDB_OK);
+    }
+
+    /* Level-0 tables holding {aaa,ccc} and {bbb}; ddd stays in memory. */
+    if (i == 1 || i == 2)
+      ldb_test_compact_memtable(t->db);
+  }
+
+  ASSERT(test_del(t, "bbb010") == LDB_OK);
+
+  check_prefix_seek(t);
+
+  /* Again, with everything pushed into the deeper levels. */
+  test_compact(t, "a", "z");
+
+  check_prefix_seek(t);
+
+  test_close(t);
+
+  /* Names which cannot be recorded in a table are rejected. */
+  {
+    ldb_prefix_t prefix = *options.prefix_extractor;
+    ldb_dbopt_t opts = options;
+
+    prefix.name = "lcdb.LongPrefixExtractorName.0123456789abcdef0123456789abcdef0123";
+
+    ASSERT(strlen(prefix.name) == 65);
+
+    opts.prefix_extractor = &prefix;
+
+    ASSERT(test_try_reopen(t, &opts) == LDB_INVALID);
+  }
+
+  ldb_bloom_destroy((ldb_bloom_t *)options.filter_policy);
+  ldb_prefix_destroy((ldb_prefix_t *)options.prefix_extractor);
 }
 
 static void
@@ -1490,6 +2043,187 @@ test_db_repeated_writes_to_same_key(test_t *t) {
   }
 }
 
+static void
+test_db_concurrent_compactions(test_t *t) {
+  ldb_dbopt_t options = test_current_options(t);
+  int num_keys = 20000;
+  char key[100], value[600];
+  int *versions;
+  ldb_rand_t rnd;
+  int i;
+
+  ldb_rand_init(&rnd, 301);
+
+  options.write_buffer_size = 100000; /* Small write buffer */
+  options.max_background_compactions = 4;
+
+  test_reopen(t, &options);
+
+  versions = ldb_malloc(num_keys * sizeof(int));
+
+  for (i = 0; i < num_keys; i++)
+    versions[i] = 0;
+
+  /* Overwrite random keys so that several levels
+     need compacting at the same time. */
+  for (i = 0; i < 2 * num_keys; i++) {
+    int k = ldb_rand_uniform(&rnd, num_keys);
+
+    sprintf(key, "key%06d", k);
+    sprintf(value, "%d:%0500d", ++versions[k], k);
+
+    ASSERT(test_put(t, key, value) == LDB_OK);
+  }
+
+  ASSERT(ldb_test_compact_memtable(t->db) == LDB_OK);
+
+  for (i = 0; i < num_keys; i++) {
+    sprintf(key, "key%06d", i);
+
+    if (versions[i] == 0) {
+      ASSERT_EQ("NOT_FOUND", test_get(t, key));
+    } else {
+      sprintf(value, "%d:%0500d", versions[i], i);
+      ASSERT_EQ(value, test_get(t, key));
+    }
+  }
+
+  ldb_free(versions);
+}
+
+#if defined(_WIN32) || defined(LDB_PTHREAD)
+static ldb_atomic(int) test_slow_compares = 0;
+
+static int
+slow_compare(const ldb_comparator_t *comparator,
+             const ldb_slice_t *x,
+             const ldb_slice_t *y) {
+  (void)comparator;
+
+  if (ldb_atomic_load(&test_slow_compares, ldb_order_relaxed))
+    ldb_sleep_usec(1000);
+
+  return ldb_compare(ldb_bytewise_comparator, x, y);
+}
+
+static void
+test_db_flush_during_compaction(test_t *t) {
+  ldb_comparator_t comparator = *ldb_bytewise_comparator;
+  ldb_dbopt_t options = test_current_options(t);
+  char key[100];
+  int i;
+
+  comparator.compare = slow_compare;
+
+  options.create_if_missing = 1;
+  options.comparator = &comparator;
+
+  test_destroy_and_reopen(t, &options);
+
+  ASSERT(options.max_background_compactions == 1);
+
+  /* Stack overlapping tables in level 0. The last one reaches the
+     compaction trigger, and slow comparisons keep that compaction
+     running while we flush again. */
+  for (;;) {
+    for (i = 0; i < 100; i++) {
+      sprintf(key, "b%04d", i);
+      ASSERT(test_put(t, key, "v") == LDB_OK);
+    }
+
+    if (test_files_at_level(t, 0) == LDB_L0_COMPACTION_TRIGGER - 1)
+      ldb_atomic_store(&test_slow_compares, 1, ldb_order_relaxed);
+
+    ASSERT(ldb_test_compact_memtable(t->db) == LDB_OK);
+
+    if (test_files_at_level(t, 0) == LDB_L0_COMPACTION_TRIGGER)
+      break;
+  }
+
+  ldb_sleep_msec(100); /* Let the compaction start. */
+
+  /* Nothing overlaps "a", so the table would normally be pushed
+     down to the last level the compaction might also write to. */
+  ASSERT(test_put(t, "a", "v") == LDB_OK);
+  ASSERT(ldb_test_compact_memtable(t->db) == LDB_OK);
+
+  ASSERT(test_files_at_level(t, LDB_MAX_MEM_COMPACT_LEVEL) == 1);
+
+  ldb_atomic_store(&test_slow_compares, 0, ldb_order_relaxed);
+
+  test_compact(t, "a", "c");
+
+  ASSERT_EQ("v", test_get(t, "a"));
+  ASSERT_EQ("v", test_get(t, "b0000"));
+  ASSERT_EQ("v", test_get(t, "b0099"));
+}
+#endif /* _WIN32 || LDB_PTHREAD */
+
+static void
+test_db_subcompactions(test_t *t) {
+  ldb_dbopt_t options = test_current_options(t);
+  int num_keys = 6000;
+  char key[100], value[1100];
+  int i;
+
+  options.max_subcompactions = 4;
+  options.max_file_size = 1 << 20;
+
+  test_reopen(t, &options);
+
+  /* Build a level with several files. */
+  for (i = 0; i < num_keys; i++) {
+    sprintf(key, "key%06d", i);
+    sprintf(value, "0:%01000d", i);
+
+    ASSERT(test_put(t, key, value) == LDB_OK);
+  }
+
+  ldb_compact_range(t->db, NULL, NULL);
+
+  ASSERT(test_total_files(t) > 1);
+
+  /* Without sharding, the next compaction could now only write a
+     single file. */
+  options.max_file_size = 1 << 30;
+
+  test_reopen(t, &options);
+
+  /* Overwrite and delete across the whole range, then compact
+     everything again (this time split into shards). */
+  for (i = 0; i < num_keys; i++) {
+    sprintf(key, "key%06d", i);
+
+    if (i % 7 == 0) {
+      ASSERT(test_del(t, key) == LDB_OK);
+    } else if (i % 3 == 0) {
+      sprintf(value, "1:%01000d", i);
+      ASSERT(test_put(t, key, value) == LDB_OK);
+    }
+  }
+
+  ldb_compact_range(t->db, NULL, NULL);
+
+#if defined(_WIN32) || defined(LDB_PTHREAD)
+  /* Each shard wrote its own output. */
+  ASSERT(test_total_files(t) > 1);
+  ASSERT(test_total_files(t) <= options.max_subcompactions);
+#endif
+
+  test_reopen(t, &options);
+
+  for (i = 0; i < num_keys; i++) {
+    sprintf(key, "key%06d", i);
+
+    if (i % 7 == 0) {
+      ASSERT_EQ("NOT_FOUND", test_get(t, key));
+    } else {
+      sprintf(value, "%d:%01000d", i % 3 == 0, i);
+      ASSERT_EQ(value, test_get(t, key));
+    }
+  }
+}
+
 static void
 test_db_sparse_merge(test_t *t) {
   ldb_dbopt_t options = test_current_options(t);
@@ -2552,6 +3286,265 @@ test_db_bloom_filter(test_t *t) {
   ldb_bloom_destroy((ldb_bloom_t *)options.filter_policy);
 }
 
+static void
+test_db_full_filter_compat(test_t *t) {
+  ldb_dbopt_t options = test_current_options(t);
+  const int N = 1000;
+  int i, pass;
+
+  options.filter_policy = t->policy;
+
+  /* Alternate the table format between passes so that the second
+     pass reads tables written with the other kind of filter. */
+  for (pass = 0; pass < 2; pass++) {
+    options.full_filter = pass;
+
+    test_reopen(t, &options);
+
+    for (i = pass; i < N; i += 2)
+      ASSERT(test_put(t, test_key(t, i), test_key(t, i)) == LDB_OK);
+
+    ldb_test_compact_memtable(t->db);
+
+    options.full_filter = !pass;
+
+    test_reopen(t, &options);
+
+    for (i = 0; i < N; i++) {
+      if ((i & 1) <= pass)
+        ASSERT_EQ(test_key(t, i), test_get(t, test_key(t, i)));
+      else
+        ASSERT_EQ("NOT_FOUND", test_get(t, test_key(t, i)));
+
+      ASSERT_EQ("NOT_FOUND", test_get(t, test_key2(t, i, ".missing")));
+    }
+  }
+
+  /* Merge both kinds of tables into a full-filter table. */
+  options.full_filter = 1;
+
+  test_reopen(t, &options);
+  test_compact(t, "a", "z");
+
+  for (i = 0; i < N; i++) {
+    ASSERT_EQ(test_key(t, i), test_get(t, test_key(t, i)));
+    ASSERT_EQ("NOT_FOUND", test_get(t, test_key2(t, i, ".missing")));
+  }
+}
+
+static void
+test_db_long_filter_name(test_t *t) {
+  ldb_dbopt_t options = test_current_options(t);
+  ldb_bloom_t policy = *ldb_bloom_default;
+  const int N = 100;
+  int i, pass;
+
+  /* The longest name ldb_open() accepts (64 bytes). */
+  policy.name = "lcdb.LongFilterPolicyName.0123456789abcdef0123456789abcdef012345";
+
+  ASSERT(strlen(policy.name) == 64);
+
+  options.filter_policy = &policy;
+
+  for (pass = 0; pass < 2; pass++) {
+    options.full_filter = pass;
+
+    test_reopen(t, &options);
+
+    for (i = pass; i < N; i += 2)
+      ASSERT(test_put(t, test_key(t, i), test_key(t, i)) == LDB_OK);
+
+    ASSERT(ldb_test_compact_memtable(t->db) == LDB_OK);
+  }
+
+  test_compact(t, "a", "z");
+
+  for (i = 0; i < N; i++) {
+    ASSERT_EQ(test_key(t, i), test_get(t, test_key(t, i)));
+    ASSERT_EQ("NOT_FOUND", test_get(t, test_key2(t, i, ".missing")));
+  }
+
+  test_close(t);
+}
+
+static void
+test_db_ribbon_filter(test_t *t) {
+  ldb_dbopt_t options = test_current_options(t);
+  const int N = 10000;
+  int i;
+
+  /* Bloom filters for level 0, Ribbon filters below. */
+  options.filter_policy = ldb_bloom_create_ribbon(10, 1);
+  options.full_filter = 1;
+
+  test_reopen(t, &options);
+
+  for (i = 0; i < N; i++)
+    ASSERT(test_put(t, test_key(t, i), test_key(t, i)) == LDB_OK);
+
+  test_compact(t, "a", "z");
+
+  for (i = 0; i < N; i += 100)
+    ASSERT(test_put(t, test_key2(t, i, ".new"), test_key(t, i)) == LDB_OK);
+
+  ldb_test_compact_memtable(t->db);
+
+  ASSERT(test_files_at_level(t, 0) > 0 || test_files_at_level(t, 1) > 0);
+
+  for (i = 0; i < N; i++) {
+    ASSERT_EQ(test_key(t, i), test_get(t, test_key(t, i)));
+    ASSERT_EQ("NOT_FOUND", test_get(t, test_key2(t, i, ".missing")));
+
+    if ((i % 100) == 0)
+      ASSERT_EQ(test_key(t, i), test_get(t, test_key2(t, i, ".new")));
+  }
+
+  test_close(t);
+
+  ldb_bloom_destroy((ldb_bloom_t *)options.filter_policy);
+}
+
+static void
+test_db_row_cache(test_t *t) {
+  ldb_dbopt_t options = test_current_options(t);
+  const ldb_snapshot_t *snap;
+  int i;
+
+  options.row_cache = ldb_lru_create(1 << 20);
+
+  test_reopen(t, &options);
+
+  ASSERT(test_put(t, "foo", "v1") == LDB_OK);
+
+  snap = ldb_get_snapshot(t->db);
+
+  ASSERT(test_put(t, "foo", "v2") == LDB_OK);
+  ASSERT(test_put(t, "bar", "b1") == LDB_OK);
+  ASSERT(test_put(t, "baz", "z1") == LDB_OK);
+  ASSERT(test_del(t, "baz") == LDB_OK);
+
+  /* Both versions of "foo" end up in the same table. */
+  ldb_test_compact_memtable(t->db);
+
+  /* The first pass fills the cache, the second one hits it. Reads
+     from the older snapshot must never see the newer versions. */
+  for (i = 0; i < 2; i++) {
+    ASSERT_EQ("v1", test_get2(t, "foo", snap));
+    ASSERT_EQ("v2", test_get(t, "foo"));
+    ASSERT_EQ("NOT_FOUND", test_get2(t, "bar", snap));
+    ASSERT_EQ("b1", test_get(t, "bar"));
+    ASSERT_EQ("NOT_FOUND", test_get(t, "baz"));
+    ASSERT_EQ("NOT_FOUND", test_get(t, "missing"));
+  }
+
+  ASSERT(ldb_lru_total_charge(options.row_cache) > 0);
+
+  /* Newer tables shadow cached rows of older ones. */
+  ASSERT(test_put(t, "foo", "v3") == LDB_OK);
+  ASSERT(test_put(t, "baz", "z2") == LDB_OK);
+
+  ldb_test_compact_memtable(t->db);
+
+  ASSERT_EQ("v3", test_get(t, "foo"));
+  ASSERT_EQ("z2", test_get(t, "baz"));
+  ASSERT_EQ("v1", test_get2(t, "foo", snap));
+
+  ldb_release_snapshot(t->db, snap);
+
+  test_compact(t, "a", "z");
+
+  ASSERT_EQ("v3", test_get(t, "foo"));
+  ASSERT_EQ("b1", test_get(t, "bar"));
+  ASSERT_EQ("z2", test_get(t, "baz"));
+
+  test_close(t);
+
+  ldb_lru_destroy(options.row_cache);
+}
+
+static int
+test_pinned_equal(const ldb_pinned_t *x, const char *y) {
+  size_t len = strlen(y);
+
+  if (x->value.size != len)
+    return 0;
+
+  return len == 0 || memcmp(x->value.data, y, len) == 0;
+}
+
+static int
+test_get_pinned(test_t *t,
+                const char *k,
+                ldb_pinned_t *value,
+                const ldb_readopt_t *options) {
+  ldb_slice_t key = ldb_string(k);
+  return ldb_get_pinned(t->db, &key, value, options);
+}
+
+static void
+test_db_get_pinned(test_t *t) {
+  ldb_dbopt_t dbopt = test_current_options(t);
+  ldb_readopt_t options = *ldb_readopt_default;
+  ldb_pinned_t v1, v2, v3, v4;
+  int i;
+
+  options.fill_cache = 0;
+
+  ASSERT(test_put(t, "foo", "v1") == LDB_OK);
+  ASSERT(test_put(t, "bar", "b1") == LDB_OK);
+
+  /* From the memtable. */
+  ASSERT(test_get_pinned(t, "foo", &v1, NULL) == LDB_OK);
+  ASSERT(test_pinned_equal(&v1, "v1"));
+
+  ldb_test_compact_memtable(t->db);
+
+  ASSERT(test_put(t, "foo", "v2") == LDB_OK);
+
+  /* From a cached and an uncached block. */
+  ASSERT(test_get_pinned(t, "bar", &v2, NULL) == LDB_OK);
+  ASSERT(test_get_pinned(t, "bar", &v3, &options) == LDB_OK);
+  ASSERT(test_pinned_equal(&v2, "b1"));
+  ASSERT(test_pinned_equal(&v3, "b1"));
+
+  ASSERT(test_get_pinned(t, "missing", &v4, NULL) == LDB_NOTFOUND);
+  ASSERT(v4.value.size == 0);
+
+  /* Pinned values outlive the memtables and tables they came from. */
+  ASSERT(test_put(t, "bar", "b2") == LDB_OK);
+
+  ldb_test_compact_memtable(t->db);
+
+  test_compact(t, "a", "z");
+
+  ASSERT(test_pinned_equal(&v1, "v1"));
+  ASSERT(test_pinned_equal(&v2, "b1"));
+  ASSERT(test_pinned_equal(&v3, "b1"));
+
+  ldb_release_pinned(&v1);
+  ldb_release_pinned(&v2);
+  ldb_release_pinned(&v3);
+  ldb_release_pinned(&v4);
+
+  ASSERT_EQ("v2", test_get(t, "foo"));
+  ASSERT_EQ("b2", test_get(t, "bar"));
+
+  /* From the row cache (on the second pass). */
+  dbopt.row_cache = ldb_lru_create(1 << 20);
+
+  test_reopen(t, &dbopt);
+
+  for (i = 0; i < 2; i++) {
+    ASSERT(test_get_pinned(t, "bar", &v1, NULL) == LDB_OK);
+    ASSERT(test_pinned_equal(&v1, "b2"));
+    ldb_release_pinned(&v1);
+  }
+
+  test_close(t);
+
+  ldb_lru_destroy(dbopt.row_cache);
+}
+
 /*
  * Multi-threaded Testing
  */
@@ -2975,7 +3968,9 @@ ldb_test_db(void) {
     test_db_get_from_immutable_layer,
     test_db_get_from_versions,
     test_db_get_memusage,
+    test_db_get_compaction_properties,
     test_db_get_snapshot,
+    test_db_multi_get,
     test_db_get_identical_snapshots,
     test_db_iterate_over_empty_snapshot,
     test_db_get_level0_ordering,
@@ -2985,6 +3980,10 @@ ldb_test_db(void) {
     test_db_iter_empty,
     test_db_iter_single,
     test_db_iter_multi,
+    test_db_iter_bounds,
+    test_db_prefix_seek,
+    test_db_iter_readahead,
+    test_db_iter_prefetch,
     test_db_iter_small_and_large_mix,
     test_db_iter_multi_with_delete,
     test_db_iter_multi_with_delete_and_compaction,
@@ -2995,6 +3994,11 @@ ldb_test_db(void) {
     test_db_recover_with_large_log,
     test_db_compactions_generate_multiple_files,
     test_db_repeated_writes_to_same_key,
+    test_db_concurrent_compactions,
+#if defined(_WIN32) || defined(LDB_PTHREAD)
+    test_db_flush_during_compaction,
+#endif
+    test_db_subcompactions,
     test_db_sparse_merge,
     test_db_approximate_sizes,
     test_db_approximate_sizes_mix_of_small_and_large,
@@ -3024,6 +4028,11 @@ ldb_test_db(void) {
     test_db_still_read_sst,
     test_db_files_deleted_after_compaction,
     test_db_bloom_filter,
+    test_db_full_filter_compat,
+    test_db_long_filter_name,
+    test_db_ribbon_filter,
+    test_db_row_cache,
+    test_db_get_pinned,
 #if defined(_WIN32) || defined(LDB_PTHREAD)
     test_db_multi_threaded,
 #endif
@@ -0,0 +1,1792 @@
+/*!
+ * dbbench.c - database benchmark for lcdb
+ * Copyright (c) 2022, Christopher Jeffrey (MIT License).
+ * https://github.com/chjj/lcdb
+ *
+ * Parts of this software are based on google/leveldb:
+ *   Copyright (c) 2011, The LevelDB Authors. All rights reserved.
+ *   https://github.com/google/leveldb
+ *
+ * See LICENSE for more information.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "table/iterator.h"
+
+#include "util/array.h"
+#include "util/bloom.h"
+#include "util/buffer.h"
+#include "util/cache.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
+#include "util/env.h"
+#include "util/histogram.h"
+#include "util/internal.h"
+#include "util/options.h"
+#include "util/port.h"
+#include "util/random.h"
+#include "util/slice.h"
+#include "util/snappy.h"
+#include "util/status.h"
+#include "util/strutil.h"
+
+#include "db_impl.h"
+#include "write_batch.h"
+
+/* Comma-separated list of operations to run in the specified order
+ *   Actual benchmarks:
+ *      fillseq       -- write N values in sequential key order in async mode
+ *      fillrandom    -- write N values in random key order in async mode
+ *      overwrite     -- overwrite N values in random key order in async mode
+ *      fillsync      -- write N/1000 values in random key order in sync mode
+ *      fill100K      -- write N/1000 100K values in random order in async mode
+ *      fillbatch     -- write N values in sequential key order in batches
+ *      deleteseq     -- delete N keys in sequential order
+ *      deleterandom  -- delete N keys in random order
+ *      readseq       -- read N times sequentially
+ *      readreverse   -- read N times in reverse order
+ *      readrandom    -- read N times in random order
+ *      readmissing   -- read N missing keys in random order
+ *      readhot       -- read N times in random order from 1% section of DB
+ *      seekrandom    -- N random seeks
+ *      seekordered   -- N ordered seeks
+ *      readwhilewriting -- 1 writer, N threads doing random reads
+ *      utxo          -- replay a synthetic chain of blocks against a UTXO set
+ *      crc32c        -- repeated crc32c of 4K of data
+ *      snappycomp    -- repeated snappy compression of 4K of data
+ *      snappyuncomp  -- repeated snappy decompression of 4K of data
+ *   Meta operations:
+ *      compact     -- Compact the entire DB
+ *      stats       -- Print DB stats
+ *      sstables    -- Print sstable info
+ */
+static const char *flags_benchmarks =
+  "fillseq,"
+  "fillsync,"
+  "fillrandom,"
+  "overwrite,"
+  "readrandom,"
+  "readrandom," /* Extra run to allow previous compactions to quiesce. */
+  "readseq,"
+  "readreverse,"
+  "compact,"
+  "readrandom,"
+  "readseq,"
+  "readreverse,"
+  "seekrandom,"
+  "fill100K,"
+  "crc32c,"
+  "snappycomp,"
+  "snappyuncomp";
+
+/* Number of key/values to place in database. */
+static int flags_num = 1000000;
+
+/* Number of read operations to do. If negative, do flags_num reads. */
+static int flags_reads = -1;
+
+/* Number of concurrent threads to run. */
+static int flags_threads = 1;
+
+/* Size of each key (keys are zero-padded decimal numbers). */
+static int flags_key_size = 16;
+
+/* Size of each value. */
+static int flags_value_size = 100;
+
+/* Arrange to generate values that shrink to this fraction of
+   their original size after compression. */
+static double flags_compression_ratio = 0.5;
+
+/* Print the full latency histogram for every benchmark. */
+static int flags_histogram = 0;
+
+/* Number of bytes to buffer in memtable before compacting
+   (initialized to default value by "main"). */
+static int flags_write_buffer_size = 0;
+
+/* Number of bytes written to each file
+   (initialized to default value by "main"). */
+static int flags_max_file_size = 0;
+
+/* Approximate size of user data packed per block (before compression)
+   (initialized to default value by "main"). */
+static int flags_block_size = 0;
+
+/* Number of bytes to use as a cache of uncompressed data.
+   Negative means use the default (8MB internal cache). */
+static int flags_cache_size = -1;
+
+/* If true, use the CLOCK cache instead of the LRU cache. */
+static int flags_clock_cache = 0;
+
+/* Number of bytes to use as a cache of rows.
+   Negative means no row cache. */
+static int flags_row_cache_size = -1;
+
+/* Maximum number of files to keep open at the same time
+   (initialized to default value by "main"). */
+static int flags_open_files = 0;
+
+/* Maximum number of concurrent background compactions
+   (initialized to default value by "main"). */
+static int flags_max_background_compactions = 0;
+
+/* Maximum number of threads per compaction
+   (initialized to default value by "main"). */
+static int flags_max_subcompactions = 0;
+
+/* Bloom filter bits per key.
+   Negative means use default settings. */
+static int flags_bloom_bits = -1;
+
+/* If true, use the cache-local (blocked) bloom filter. */
+static int flags_blocked_bloom = 0;
+
+/* If non-negative, use Ribbon filters for tables written
+   to this level and deeper (and bloom filters above it). */
+static int flags_ribbon_level = -1;
+
+/* If true, write one bloom filter per table. */
+static int flags_full_filter = 0;
+
+/* If true, writers in a group insert into the memtable in parallel. */
+static int flags_concurrent_memtable_writes = 0;
+
+/* If true, overlap logging with memtable insertion across groups. */
+static int flags_pipelined_write = 0;
+
+/* If true, sync writes share log syncs done by a dedicated thread. */
+static int flags_group_commit = 0;
+
+/* Microseconds a sync write leader waits for more writers. */
+static int flags_group_commit_delay = 0;
+
+/* If true, compress blocks with snappy. */
+static int flags_compression = 1;
+
+/* If true, do not destroy the existing database. If you set this
+   flag and also specify a benchmark that wants a fresh database,
+   that benchmark will fail. */
+static int flags_use_existing_db = 0;
+
+/* If true, reuse existing log/MANIFEST files when re-opening a database. */
+static int flags_reuse_logs = 0;
+
+/* If true, use mmap for random access files. */
+static int flags_use_mmap = 1;
+
+/* Use the db with the following name. */
+static const char *flags_db = NULL;
+
+/* Number of blocks to replay in the "utxo" benchmark. */
+static int flags_blocks = 10000;
+
+/* Average number of transactions per block ("utxo" benchmark). */
+static int flags_block_txs = 500;
+
+/* Average number of inputs (spent coins) per transaction. The actual
+   count is drawn uniformly from [1, 2 * avg - 1] ("utxo" benchmark). */
+static int flags_tx_inputs = 2;
+
+/* Average number of outputs (created coins) per transaction. The actual
+   count is drawn uniformly from [1, 2 * avg - 1] ("utxo" benchmark). */
+static int flags_tx_outputs = 3;
+
+/* Number of extra random lookups of unspent coins per block. */
+static int flags_block_lookups = 0;
+
+/*
+ * Helpers
+ */
+
+static void
+bench_key(char *zp, uint64_t k) {
+  sprintf(zp, "%0*lu", flags_key_size, (unsigned long)k);
+}
+
+static ldb_slice_t
+bench_string(const char *xp) {
+  return ldb_slice((const uint8_t *)xp, strlen(xp));
+}
+
+/*
+ * RandomGenerator
+ */
+
+/* Helper for quickly generating random data. */
+typedef struct rgen_s {
+  ldb_buffer_t data;
+  size_t pos;
+} rgen_t;
+
+static void
+rgen_compressible(ldb_buffer_t *z, ldb_rand_t *rnd, double ratio, size_t len) {
+  size_t chunklen = (size_t)(len * ratio);
+  size_t i;
+
+  if (chunklen < 1)
+    chunklen = 1;
+
+  ldb_buffer_grow(z, z->size + len);
+
+  /* Generate a random chunk and duplicate it until we have "len" bytes. */
+  for (i = 0; i < chunklen && i < len; i++)
+    z->data[z->size + i] = ' ' + ldb_rand_uniform(rnd, 95);
+
+  for (; i < len; i++)
+    z->data[z->size + i] = z->data[z->size + (i % chunklen)];
+
+  z->size += len;
+}
+
+static void
+rgen_init(rgen_t *gen) {
+  ldb_rand_t rnd;
+
+  ldb_rand_init(&rnd, 301);
+  ldb_buffer_init(&gen->data);
+
+  /* We use a limited amount of data over and over again and ensure
+     that it is larger than the compression window (32KB), and also
+     large enough to serve all typical value sizes we want to write. */
+  while (gen->data.size < 1048576)
+    rgen_compressible(&gen->data, &rnd, flags_compression_ratio, 100);
+
+  gen->pos = 0;
+}
+
+static void
+rgen_clear(rgen_t *gen) {
+  ldb_buffer_clear(&gen->data);
+}
+
+static ldb_slice_t
+rgen_generate(rgen_t *gen, size_t len) {
+  if (gen->pos + len > gen->data.size) {
+    gen->pos = 0;
+    assert(len < gen->data.size);
+  }
+
+  gen->pos += len;
+
+  return ldb_slice(gen->data.data + gen->pos - len, len);
+}
+
+/*
+ * Stats
+ */
+
+typedef struct stats_s {
+  double start;
+  double finish;
+  double seconds;
+  int done;
+  int next_report;
+  int64_t bytes;
+  double last_op_finish;
+  histogram_t hist;
+  char message[256];
+} stats_t;
+
+static double
+bench_now(void) {
+  return (double)ldb_now_usec();
+}
+
+static void
+stats_start(stats_t *st) {
+  st->next_report = 100;
+  histogram_init(&st->hist);
+  st->done = 0;
+  st->bytes = 0;
+  st->seconds = 0;
+  st->message[0] = '\0';
+  st->start = bench_now();
+  st->last_op_finish = st->start;
+  st->finish = st->start;
+}
+
+static void
+stats_merge(stats_t *z, const stats_t *x) {
+  histogram_merge(&z->hist, &x->hist);
+
+  z->done += x->done;
+  z->bytes += x->bytes;
+  z->seconds += x->seconds;
+
+  if (x->start < z->start)
+    z->start = x->start;
+
+  if (x->finish > z->finish)
+    z->finish = x->finish;
+
+  /* Just keep the messages from one thread. */
+  if (z->message[0] == '\0')
+    strcpy(z->message, x->message);
+}
+
+static void
+stats_stop(stats_t *st) {
+  st->finish = bench_now();
+  st->seconds = (st->finish - st->start) * 1e-6;
+}
+
+static void
+stats_add_message(stats_t *st, const char *msg) {
+  size_t len = strlen(st->message);
+
+  if (len + 1 + strlen(msg) + 1 > sizeof(st->message))
+    return;
+
+  if (len > 0)
+    st->message[len++] = ' ';
+
+  strcpy(st->message + len, msg);
+}
+
+/* Record the completion of "n" operations which all started at the
+   same time (i.e. a batch). Latency is recorded once per call. */
+static void
+stats_finished_ops(stats_t *st, int n) {
+  double now = bench_now();
+  double micros = now - st->last_op_finish;
+
+  histogram_add(&st->hist, micros);
+
+  if (micros > 20000 && n == 1) {
+    fprintf(stderr, "long op: %.1f micros%30s\r", micros, "");
+    fflush(stderr);
+  }
+
+  st->last_op_finish = now;
+  st->done += n;
+
+  if (st->done >= st->next_report) {
+    if (st->next_report < 1000)
+      st->next_report += 100;
+    else if (st->next_report < 5000)
+      st->next_report += 500;
+    else if (st->next_report < 10000)
+      st->next_report += 1000;
+    else if (st->next_report < 50000)
+      st->next_report += 5000;
+    else if (st->next_report < 100000)
+      st->next_report += 10000;
+    else if (st->next_report < 500000)
+      st->next_report += 50000;
+    else
+      st->next_report += 100000;
+
+    fprintf(stderr, "... finished %d ops%30s\r", st->done, "");
+    fflush(stderr);
+  }
+}
+
+static void
+stats_finished_single_op(stats_t *st) {
+  stats_finished_ops(st, 1);
+}
+
+static void
+stats_add_bytes(stats_t *st, int64_t n) {
+  st->bytes += n;
+}
+
+static void
+stats_report(stats_t *st, const char *name) {
+  char rate[100];
+  double elapsed;
+
+  /* Pretend at least one op was done in case we are running a benchmark
+     that does not call finished_single_op(). */
+  if (st->done < 1)
+    st->done = 1;
+
+  rate[0] = '\0';
+
+  if (st->bytes > 0) {
+    /* Rate is computed on actual elapsed time, not the sum of per-thread
+       elapsed times. */
+    elapsed = (st->finish - st->start) * 1e-6;
+
+    sprintf(rate, "%6.1f MB/s", (st->bytes / 1048576.0) / elapsed);
+  }
+
+  fprintf(stdout, "%-12s : %11.3f micros/op;%s%s%s%s\n",
+                  name,
+                  st->seconds * 1e6 / st->done,
+                  rate[0] ? " " : "", rate,
+                  st->message[0] ? " " : "", st->message);
+
+  if (st->hist.num > 0) {
+    fprintf(stdout, "%-12s   P50: %.2f  P75: %.2f  P99: %.2f"
+                    "  P99.9: %.2f  P99.99: %.2f (micros/op)\n",
+                    "",
+                    histogram_percentile(&st->hist, 50.0),
+                    histogram_percentile(&st->hist, 75.0),
+                    histogram_percentile(&st->hist, 99.0),
+                    histogram_percentile(&st->hist, 99.9),
+                    histogram_percentile(&st->hist, 99.99));
+  }
+
+  if (flags_histogram) {
+    char *buf = ldb_malloc(MAX_HISTOGRAM);
+
+    fprintf(stdout, "Microseconds per op:\n%s\n",
+                    histogram_string(&st->hist, buf));
+
+    ldb_free(buf);
+  }
+
+  fflush(stdout);
+}
+
+/*
+ * SharedState
+ */
+
+/* State shared by all concurrent executions of the same benchmark. */
+typedef struct shared_s {
+  ldb_mutex_t mu;
+  ldb_cond_t cv;
+  int total;
+
+  /* Each thread goes through the following states:
+   *    (1) initializing
+   *    (2) waiting for others to be initialized
+   *    (3) running
+   *    (4) done
+   */
+  int num_initialized;
+  int num_done;
+  int start;
+} shared_t;
+
+/*
+ * ThreadState
+ */
+
+struct bench_s;
+
+/* Per-thread state for concurrent executions of the same benchmark. */
+typedef struct thread_s {
+  int tid;         /* 0..n-1 when running in n threads. */
+  ldb_rand_t rand; /* Has different seeds for different threads. */
+  stats_t stats;
+  shared_t *shared;
+  struct bench_s *bench;
+  void (*method)(struct bench_s *, struct thread_s *);
+  ldb_thread_t handle;
+} thread_t;
+
+/*
+ * Benchmark
+ */
+
+typedef struct bench_s {
+  ldb_lru_t *cache;
+  ldb_lru_t *row_cache;
+  ldb_bloom_t *filter_policy;
+  ldb_t *db;
+  char dbname[LDB_PATH_MAX];
+  int num;
+  int value_size;
+  int entries_per_batch;
+  ldb_writeopt_t write_options;
+  int reads;
+} bench_t;
+
+typedef void bench_method_f(bench_t *, thread_t *);
+
+static void
+print_header(void) {
+  const int key_size = flags_key_size;
+  double raw, comp;
+
+  raw = (double)(key_size + flags_value_size) * flags_num;
+  comp = (key_size + flags_value_size * flags_compression_ratio) * flags_num;
+
+  fprintf(stdout, "Keys:       %d bytes each\n", key_size);
+
+  fprintf(stdout, "Values:     %d bytes each (%d bytes after compression)\n",
+                  flags_value_size,
+                  (int)(flags_value_size * flags_compression_ratio + 0.5));
+
+  fprintf(stdout, "Entries:    %d\n", flags_num);
+  fprintf(stdout, "RawSize:    %.1f MB (estimated)\n", raw / 1048576.0);
+  fprintf(stdout, "FileSize:   %.1f MB (estimated)\n", comp / 1048576.0);
+  fprintf(stdout, "Threads:    %d\n", flags_threads);
+  fprintf(stdout, "Cache:      %d bytes\n", flags_cache_size);
+  fprintf(stdout, "Bloom bits: %d\n", flags_bloom_bits);
+  fprintf(stdout, "Compressed: %s\n", flags_compression ? "snappy" : "none");
+
+#if !defined(NDEBUG) && !defined(__OPTIMIZE__)
+  fprintf(stdout,
+    "WARNING: Optimization is disabled: benchmarks unnecessarily slow\n");
+#endif
+
+#if !defined(NDEBUG)
+  fprintf(stdout,
+    "WARNING: Assertions are enabled; benchmarks unnecessarily slow\n");
+#endif
+
+#if defined(__linux__)
+  {
+    FILE *cpuinfo = fopen("/proc/cpuinfo", "r");
+
+    if (cpuinfo != NULL) {
+      char line[1000];
+      char cpu_type[256];
+      char cache_size[256];
+      int num_cpus = 0;
+
+      cpu_type[0] = '\0';
+      cache_size[0] = '\0';
+
+      while (fgets(line, sizeof(line), cpuinfo) != NULL) {
+        char *sep = strchr(line, ':');
+        char *val;
+        size_t len;
+
+        if (sep == NULL)
+          continue;
+
+        val = sep + 1;
+
+        while (*val == ' ' || *val == '\t')
+          val++;
+
+        len = strlen(val);
+
+        while (len > 0 && (val[len - 1] == '\n' || val[len - 1] == ' '))
+          val[--len] = '\0';
+
+        if (len >= 256)
+          continue;
+
+        if (ldb_starts_with(line, "model name")) {
+          num_cpus++;
+          strcpy(cpu_type, val);
+        } else if (ldb_starts_with(line, "cache size")) {
+          strcpy(cache_size, val);
+        }
+      }
+
+      fclose(cpuinfo);
+
+      fprintf(stdout, "CPU:        %d * %s\n", num_cpus, cpu_type);
+      fprintf(stdout, "CPUCache:   %s\n", cache_size);
+    }
+  }
+#endif
+
+  fprintf(stdout, "------------------------------------------------\n");
+}
+
+static void
+bench_init(bench_t *bench) {
+  bench->cache = NULL;
+  bench->row_cache = NULL;
+  bench->filter_policy = NULL;
+  bench->db = NULL;
+  bench->num = flags_num;
+  bench->value_size = flags_value_size;
+  bench->entries_per_batch = 1;
+  bench->write_options = *ldb_writeopt_default;
+  bench->reads = flags_reads < 0 ? flags_num : flags_reads;
+
+  if (flags_cache_size >= 0) {
+    if (flags_clock_cache)
+      bench->cache = ldb_lru_create_clock(flags_cache_size);
+    else
+      bench->cache = ldb_lru_create(flags_cache_size);
+  }
+
+  if (flags_row_cache_size >= 0) {
+    if (flags_clock_cache)
+      bench->row_cache = ldb_lru_create_clock(flags_row_cache_size);
+    else
+      bench->row_cache = ldb_lru_create(flags_row_cache_size);
+  }
+
+  if (flags_bloom_bits >= 0) {
+    if (flags_ribbon_level >= 0)
+      bench->filter_policy = ldb_bloom_create_ribbon(flags_bloom_bits,
+                                                     flags_ribbon_level);
+    else if (flags_blocked_bloom)
+      bench->filter_policy = ldb_bloom_create_blocked(flags_bloom_bits);
+    else
+      bench->filter_policy = ldb_bloom_create(flags_bloom_bits);
+  }
+
+  if (flags_db != NULL) {
+    if (strlen(flags_db) + 1 > sizeof(bench->dbname)) {
+      fprintf(stderr, "database name too long\n");
+      exit(EXIT_FAILURE);
+    }
+
+    strcpy(bench->dbname, flags_db);
+  } else {
+    if (!ldb_test_filename(bench->dbname, sizeof(bench->dbname), "dbbench")) {
+      fprintf(stderr, "could not determine database path\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (!flags_use_existing_db)
+    ldb_destroy_db(bench->dbname, NULL);
+}
+
+static void
+bench_clear(bench_t *bench) {
+  if (bench->db != NULL)
+    ldb_close(bench->db);
+
+  if (bench->cache != NULL)
+    ldb_lru_destroy(bench->cache);
+
+  if (bench->row_cache != NULL)
+    ldb_lru_destroy(bench->row_cache);
+
+  if (bench->filter_policy != NULL)
+    ldb_bloom_destroy(bench->filter_policy);
+}
+
+static void
+bench_open(bench_t *bench) {
+  ldb_dbopt_t options = *ldb_dbopt_default;
+  int rc;
+
+  assert(bench->db == NULL);
+
+  options.create_if_missing = !flags_use_existing_db;
+  options.block_cache = bench->cache;
+  options.row_cache = bench->row_cache;
+  options.write_buffer_size = flags_write_buffer_size;
+  options.max_file_size = flags_max_file_size;
+  options.block_size = flags_block_size;
+  options.max_open_files = flags_open_files;
+  options.max_background_compactions = flags_max_background_compactions;
+  options.max_subcompactions = flags_max_subcompactions;
+  options.filter_policy = bench->filter_policy;
+  options.full_filter = flags_full_filter;
+  options.concurrent_memtable_writes = flags_concurrent_memtable_writes;
+  options.pipelined_write = flags_pipelined_write;
+  options.group_commit = flags_group_commit;
+  options.group_commit_delay = flags_group_commit_delay;
+  options.reuse_logs = flags_reuse_logs;
+  options.use_mmap = flags_use_mmap;
+  options.compression = flags_compression ? LDB_SNAPPY_COMPRESSION
+                                          : LDB_NO_COMPRESSION;
+
+  rc = ldb_open(bench->dbname, &options, &bench->db);
+
+  if (rc != LDB_OK) {
+    fprintf(stderr, "open error: %s\n", ldb_strerror(rc));
+    exit(EXIT_FAILURE);
+  }
+}
+
+static void
+thread_body(void *arg) {
+  thread_t *thread = arg;
+  shared_t *shared = thread->shared;
+
+  ldb_mutex_lock(&shared->mu);
+
+  shared->num_initialized++;
+
+  if (shared->num_initialized >= shared->total)
+    ldb_cond_broadcast(&shared->cv);
+
+  while (!shared->start)
+    ldb_cond_wait(&shared->cv, &shared->mu);
+
+  ldb_mutex_unlock(&shared->mu);
+
+  stats_start(&thread->stats);
+
+  thread->method(thread->bench, thread);
+
+  stats_stop(&thread->stats);
+
+  ldb_mutex_lock(&shared->mu);
+
+  shared->num_done++;
+
+  if (shared->num_done >= shared->total)
+    ldb_cond_broadcast(&shared->cv);
+
+  ldb_mutex_unlock(&shared->mu);
+}
+
+static void
+run_benchmark(bench_t *bench, int n, const char *name,
+                                     bench_method_f *method) {
+  thread_t *threads = ldb_malloc(n * sizeof(thread_t));
+  shared_t shared;
+  int i;
+
+  ldb_mutex_init(&shared.mu);
+  ldb_cond_init(&shared.cv);
+
+  shared.total = n;
+  shared.num_initialized = 0;
+  shared.num_done = 0;
+  shared.start = 0;
+
+  for (i = 0; i < n; i++) {
+    threads[i].tid = i;
+    threads[i].shared = &shared;
+    threads[i].bench = bench;
+    threads[i].method = method;
+
+    ldb_rand_init(&threads[i].rand, 1000 + i);
+  }
+
+  if (n == 1) {
+    /* Run inline; this also works on platforms without threads. */
+    shared.start = 1;
+    thread_body(&threads[0]);
+  } else {
+    for (i = 0; i < n; i++)
+      ldb_thread_create(&threads[i].handle, thread_body, &threads[i]);
+
+    ldb_mutex_lock(&shared.mu);
+
+    while (shared.num_initialized < n)
+      ldb_cond_wait(&shared.cv, &shared.mu);
+
+    shared.start = 1;
+
+    ldb_cond_broadcast(&shared.cv);
+
+    while (shared.num_done < n)
+      ldb_cond_wait(&shared.cv, &shared.mu);
+
+    ldb_mutex_unlock(&shared.mu);
+
+    for (i = 0; i < n; i++)
+      ldb_thread_join(&threads[i].handle);
+  }
+
+  for (i = 1; i < n; i++)
+    stats_merge(&threads[0].stats, &threads[i].stats);
+
+  stats_report(&threads[0].stats, name);
+
+  ldb_cond_destroy(&shared.cv);
+  ldb_mutex_destroy(&shared.mu);
+  ldb_free(threads);
+}
+
+/*
+ * Benchmarks
+ */
+
+static void
+bench_crc32c(bench_t *bench, thread_t *thread) {
+  /* Checksum about 500MB of data total. */
+  const int size = 4096;
+  const char *label = "(4K per op)";
+  uint8_t *data = ldb_malloc(size);
+  int64_t bytes = 0;
+  uint32_t crc = 0;
+  char msg[100];
+
+  (void)bench;
+
+  memset(data, 'x', size);
+
+  while (bytes < 500 * 1048576) {
+    crc = ldb_crc32c_value(data, size);
+    stats_finished_single_op(&thread->stats);
+    bytes += size;
+  }
+
+  /* Print so result is not dead. */
+  sprintf(msg, "(0x%x)", (unsigned int)crc);
+
+  stats_add_bytes(&thread->stats, bytes);
+  stats_add_message(&thread->stats, label);
+  stats_add_message(&thread->stats, msg);
+
+  ldb_free(data);
+}
+
+static void
+bench_snappy_compress(bench_t *bench, thread_t *thread) {
+  int64_t bytes = 0, produced = 0;
+  ldb_slice_t input;
+  uint8_t *output;
+  size_t max_size;
+  char msg[100];
+  rgen_t gen;
+
+  (void)bench;
+
+  rgen_init(&gen);
+
+  input = rgen_generate(&gen, 4096);
+
+  if (!snappy_encode_size(&max_size, input.size))
+    abort(); /* LCOV_EXCL_LINE */
+
+  output = ldb_malloc(max_size);
+
+  while (bytes < 1024 * 1048576) { /* Compress 1G. */
+    produced += snappy_encode(output, input.data, input.size);
+    bytes += input.size;
+    stats_finished_single_op(&thread->stats);
+  }
+
+  sprintf(msg, "(output: %.1f%%)", (produced * 100.0) / bytes);
+
+  stats_add_message(&thread->stats, msg);
+  stats_add_bytes(&thread->stats, bytes);
+
+  ldb_free(output);
+  rgen_clear(&gen);
+}
+
+static void
+bench_snappy_uncompress(bench_t *bench, thread_t *thread) {
+  int64_t bytes = 0;
+  ldb_slice_t input;
+  uint8_t *compressed;
+  uint8_t *output;
+  size_t max_size;
+  size_t comp_size;
+  size_t out_size;
+  rgen_t gen;
+
+  (void)bench;
+
+  rgen_init(&gen);
+
+  input = rgen_generate(&gen, 4096);
+
+  if (!snappy_encode_size(&max_size, input.size))
+    abort(); /* LCOV_EXCL_LINE */
+
+  compressed = ldb_malloc(max_size);
+  comp_size = snappy_encode(compressed, input.data, input.size);
+
+  if (!snappy_decode_size(&out_size, compressed, comp_size))
+    abort(); /* LCOV_EXCL_LINE */
+
+  output = ldb_malloc(out_size);
+
+  while (bytes < 1024 * 1048576) {
+    if (!snappy_decode(output, compressed, comp_size))
+      break;
+
+    bytes += input.size;
+
+    stats_finished_single_op(&thread->stats);
+  }
+
+  stats_add_bytes(&thread->stats, bytes);
+
+  ldb_free(output);
+  ldb_free(compressed);
+  rgen_clear(&gen);
+}
+
+static void
+bench_do_write(bench_t *bench, thread_t *thread, int seq) {
+  char key[1024 + 32];
+  int64_t bytes = 0;
+  ldb_batch_t batch;
+  rgen_t gen;
+  int rc = LDB_OK;
+  int i, j;
+
+  if (bench->num != flags_num) {
+    char msg[100];
+    sprintf(msg, "(%d ops)", bench->num);
+    stats_add_message(&thread->stats, msg);
+  }
+
+  rgen_init(&gen);
+  ldb_batch_init(&batch);
+
+  for (i = 0; i < bench->num; i += bench->entries_per_batch) {
+    ldb_batch_reset(&batch);
+
+    for (j = 0; j < bench->entries_per_batch; j++) {
+      uint64_t k = seq ? (uint64_t)(i + j)
+                         : ldb_rand_uniform(&thread->rand, flags_num);
+      ldb_slice_t kslice, vslice;
+
+      bench_key(key, k);
+
+      kslice = bench_string(key);
+      vslice = rgen_generate(&gen, bench->value_size);
+
+      ldb_batch_put(&batch, &kslice, &vslice);
+
+      bytes += vslice.size + kslice.size;
+    }
+
+    rc = ldb_write(bench->db, &batch, &bench->write_options);
+
+    if (rc != LDB_OK) {
+      fprintf(stderr, "put error: %s\n", ldb_strerror(rc));
+      exit(EXIT_FAILURE);
+    }
+
+    stats_finished_ops(&thread->stats, bench->entries_per_batch);
+  }
+
+  stats_add_bytes(&thread->stats, bytes);
+
+  ldb_batch_clear(&batch);
+  rgen_clear(&gen);
+}
+
+static void
+bench_write_seq(bench_t *bench, thread_t *thread) {
+  bench_do_write(bench, thread, 1);
+}
+
+static void
+bench_write_random(bench_t *bench, thread_t *thread) {
+  bench_do_write(bench, thread, 0);
+}
+
+static void
+bench_read_sequential(bench_t *bench, thread_t *thread) {
+  ldb_iter_t *iter = ldb_iterator(bench->db, ldb_readopt_default);
+  int64_t bytes = 0;
+  int i = 0;
+
+  for (ldb_iter_seek_first(iter);
+       i < bench->reads && ldb_iter_valid(iter);
+       ldb_iter_next(iter)) {
+    ldb_slice_t key = ldb_iter_key(iter);
+    ldb_slice_t val = ldb_iter_value(iter);
+
+    bytes += key.size + val.size;
+
+    stats_finished_single_op(&thread->stats);
+
+    i++;
+  }
+
+  ldb_iter_destroy(iter);
+
+  stats_add_bytes(&thread->stats, bytes);
+}
+
+static void
+bench_read_reverse(bench_t *bench, thread_t *thread) {
+  ldb_iter_t *iter = ldb_iterator(bench->db, ldb_readopt_default);
+  int64_t bytes = 0;
+  int i = 0;
+
+  for (ldb_iter_seek_last(iter);
+       i < bench->reads && ldb_iter_valid(iter);
+       ldb_iter_prev(iter)) {
+    ldb_slice_t key = ldb_iter_key(iter);
+    ldb_slice_t val = ldb_iter_value(iter);
+
+    bytes += key.size + val.size;
+
+    stats_finished_single_op(&thread->stats);
+
+    i++;
+  }
+
+  ldb_iter_destroy(iter);
+
+  stats_add_bytes(&thread->stats, bytes);
+}
+
+static void
+bench_read_random(bench_t *bench, thread_t *thread) {
+  char key[1024 + 32];
+  char msg[100];
+  int found = 0;
+  int i;
+
+  for (i = 0; i < bench->reads; i++) {
+    uint64_t k = ldb_rand_uniform(&thread->rand, flags_num);
+    ldb_slice_t kslice, value;
+
+    bench_key(key, k);
+
+    kslice = bench_string(key);
+
+    if (ldb_get(bench->db, &kslice, &value, ldb_readopt_default) == LDB_OK) {
+      ldb_free(value.data);
+      found++;
+    }
+
+    stats_finished_single_op(&thread->stats);
+  }
+
+  sprintf(msg, "(%d of %d found)", found, bench->num);
+
+  stats_add_message(&thread->stats, msg);
+}
+
+static void
+bench_read_missing(bench_t *bench, thread_t *thread) {
+  char key[1024 + 32];
+  int i;
+
+  for (i = 0; i < bench->reads; i++) {
+    uint64_t k = ldb_rand_uniform(&thread->rand, flags_num);
+    ldb_slice_t kslice, value;
+
+    bench_key(key, k);
+    strcat(key, ".");
+
+    kslice = bench_string(key);
+
+    if (ldb_get(bench->db, &kslice, &value, ldb_readopt_default) == LDB_OK)
+      ldb_free(value.data);
+
+    stats_finished_single_op(&thread->stats);
+  }
+}
+
+static void
+bench_read_hot(bench_t *bench, thread_t *thread) {
+  const int range = (flags_num + 99) / 100;
+  char key[1024 + 32];
+  int i;
+
+  for (i = 0; i < bench->reads; i++) {
+    uint64_t k = ldb_rand_uniform(&thread->rand, range);
+    ldb_slice_t kslice, value;
+
+    bench_key(key, k);
+
+    kslice = bench_string(key);
+
+    if (ldb_get(bench->db, &kslice, &value, ldb_readopt_default) == LDB_OK)
+      ldb_free(value.data);
+
+    stats_finished_single_op(&thread->stats);
+  }
+}
+
+static void
+bench_seek_random(bench_t *bench, thread_t *thread) {
+  char key[1024 + 32];
+  char msg[100];
+  int found = 0;
+  int i;
+
+  for (i = 0; i < bench->reads; i++) {
+    ldb_iter_t *iter = ldb_iterator(bench->db, ldb_iteropt_default);
+    uint64_t k = ldb_rand_uniform(&thread->rand, flags_num);
+    ldb_slice_t kslice;
+
+    bench_key(key, k);
+
+    kslice = bench_string(key);
+
+    ldb_iter_seek(iter, &kslice);
+
+    if (ldb_iter_valid(iter)) {
+      ldb_slice_t ikey = ldb_iter_key(iter);
+
+      if (ldb_slice_equal(&ikey, &kslice))
+        found++;
+    }
+
+    ldb_iter_destroy(iter);
+
+    stats_finished_single_op(&thread->stats);
+  }
+
+  sprintf(msg, "(%d of %d found)", found, bench->num);
+
+  stats_add_message(&thread->stats, msg);
+}
+
+static void
+bench_seek_ordered(bench_t *bench, thread_t *thread) {
+  ldb_iter_t *iter = ldb_iterator(bench->db, ldb_iteropt_default);
+  char key[1024 + 32];
+  char msg[100];
+  int found = 0;
+  uint64_t k = 0;
+  int i;
+
+  for (i = 0; i < bench->reads; i++) {
+    ldb_slice_t kslice;
+
+    k = (k + (ldb_rand_uniform(&thread->rand, 100))) % flags_num;
+
+    bench_key(key, k);
+
+    kslice = bench_string(key);
+
+    ldb_iter_seek(iter, &kslice);
+
+    if (ldb_iter_valid(iter)) {
+      ldb_slice_t ikey = ldb_iter_key(iter);
+
+      if (ldb_slice_equal(&ikey, &kslice))
+        found++;
+    }
+
+    stats_finished_single_op(&thread->stats);
+  }
+
+  ldb_iter_destroy(iter);
+
+  sprintf(msg, "(%d of %d found)", found, bench->num);
+
+  stats_add_message(&thread->stats, msg);
+}
+
+static void
+bench_do_delete(bench_t *bench, thread_t *thread, int seq) {
+  char key[1024 + 32];
+  ldb_batch_t batch;
+  int rc = LDB_OK;
+  int i, j;
+
+  ldb_batch_init(&batch);
+
+  for (i = 0; i < bench->num; i += bench->entries_per_batch) {
+    ldb_batch_reset(&batch);
+
+    for (j = 0; j < bench->entries_per_batch; j++) {
+      uint64_t k = seq ? (uint64_t)(i + j)
+                         : ldb_rand_uniform(&thread->rand, flags_num);
+      ldb_slice_t kslice;
+
+      bench_key(key, k);
+
+      kslice = bench_string(key);
+
+      ldb_batch_del(&batch, &kslice);
+    }
+
+    rc = ldb_write(bench->db, &batch, &bench->write_options);
+
+    if (rc != LDB_OK) {
+      fprintf(stderr, "del error: %s\n", ldb_strerror(rc));
+      exit(EXIT_FAILURE);
+    }
+
+    stats_finished_ops(&thread->stats, bench->entries_per_batch);
+  }
+
+  ldb_batch_clear(&batch);
+}
+
+static void
+bench_delete_seq(bench_t *bench, thread_t *thread) {
+  bench_do_delete(bench, thread, 1);
+}
+
+static void
+bench_delete_random(bench_t *bench, thread_t *thread) {
+  bench_do_delete(bench, thread, 0);
+}
+
+static void
+bench_read_while_writing(bench_t *bench, thread_t *thread) {
+  if (thread->tid > 0) {
+    bench_read_random(bench, thread);
+  } else {
+    /* Special thread that keeps writing until other threads are done. */
+    char key[1024 + 32];
+    rgen_t gen;
+
+    rgen_init(&gen);
+
+    for (;;) {
+      ldb_slice_t kslice, vslice;
+      uint64_t k;
+      int rc;
+
+      ldb_mutex_lock(&thread->shared->mu);
+
+      if (thread->shared->num_done + 1 >= thread->shared->num_initialized) {
+        /* Other threads have finished. */
+        ldb_mutex_unlock(&thread->shared->mu);
+        break;
+      }
+
+      ldb_mutex_unlock(&thread->shared->mu);
+
+      k = ldb_rand_uniform(&thread->rand, flags_num);
+
+      bench_key(key, k);
+
+      kslice = bench_string(key);
+      vslice = rgen_generate(&gen, bench->value_size);
+
+      rc = ldb_put(bench->db, &kslice, &vslice, &bench->write_options);
+
+      if (rc != LDB_OK) {
+        fprintf(stderr, "put error: %s\n", ldb_strerror(rc));
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    rgen_clear(&gen);
+
+    /* Do not count any of the preceding work/delay in stats. */
+    stats_start(&thread->stats);
+  }
+}
+
+/*
+ * UTXO Replay
+ */
+
+/* Models the coin database of a bitcoin full node (mako's UTXO set):
+ * 36 byte outpoint keys (32 byte txid + 4 byte output index) which are
+ * written once when the creating transaction is connected, read when
+ * a later transaction spends them, and deleted once. Each block is
+ * committed as a single batch of puts and deletes.
+ */
+
+#define UTXO_KEY_SIZE 36
+
+static void
+utxo_key(uint8_t *zp, uint64_t txnum, uint32_t index) {
+  uint64_t x = txnum;
+  int i;
+
+  /* Derive a well distributed txid from the transaction number
+     (splitmix64) so that outpoints land randomly in the key space. */
+  for (i = 0; i < 4; i++) {
+    uint64_t z = (x += UINT64_C(0x9e3779b97f4a7c15));
+
+    z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+    z = z ^ (z >> 31);
+
+    ldb_fixed64_write(zp + i * 8, z);
+  }
+
+  ldb_fixed32_write(zp + 32, index);
+}
+
+static uint32_t
+utxo_draw(ldb_rand_t *rnd, int avg) {
+  if (avg <= 0)
+    return 0;
+
+  return 1 + ldb_rand_uniform(rnd, 2 * avg - 1);
+}
+
+static int64_t
+utxo_property(bench_t *bench, const char *name) {
+  char *value = NULL;
+  int64_t result = 0;
+
+  if (ldb_get_property(bench->db, name, &value)) {
+    result = (int64_t)strtod(value, NULL);
+    ldb_free(value);
+  }
+
+  return result;
+}
+
+static void
+bench_utxo(bench_t *bench, thread_t *thread) {
+  int64_t stalls = utxo_property(bench, "leveldb.num-write-stalls");
+  int64_t stall_us = utxo_property(bench, "leveldb.write-stall-micros");
+  int64_t comp_read = utxo_property(bench, "leveldb.compaction-bytes-read");
+  int64_t comp_write = utxo_property(bench, "leveldb.compaction-bytes-written");
+  int64_t live_bytes = 0;
+  int64_t bytes = 0;
+  int64_t missed = 0;
+  int64_t spent = 0;
+  int64_t created = 0;
+  uint64_t txnum = 0;
+  uint8_t key[UTXO_KEY_SIZE];
+  ldb_array_t live; /* Unspent outpoints: (txnum << 16) | index. */
+  ldb_array_t fresh; /* Outpoints created by the current block. */
+  ldb_batch_t batch;
+  double elapsed, space_amp;
+  int64_t total_bytes;
+  char msg[256];
+  rgen_t gen;
+  int i, t;
+  size_t j;
+
+  ldb_array_init(&live);
+  ldb_array_init(&fresh);
+  ldb_batch_init(&batch);
+  rgen_init(&gen);
+
+  for (i = 0; i < flags_blocks; i++) {
+    uint32_t txs = utxo_draw(&thread->rand, flags_block_txs);
+    int rc;
+
+    ldb_batch_reset(&batch);
+    ldb_array_reset(&fresh);
+
+    for (t = 0; t < (int)txs + 1; t++) {
+      /* The first transaction is the coinbase; it spends nothing. */
+      uint32_t inputs = t > 0 ? utxo_draw(&thread->rand, flags_tx_inputs) : 0;
+      uint32_t outputs = utxo_draw(&thread->rand, flags_tx_outputs);
+      uint32_t k;
+
+      for (k = 0; k < inputs && live.length > 0; k++) {
+        /* Most coins are spent soon after they are created,
+           while a long tail stays unspent for a very long time. */
+        int max_log = 0;
+        size_t idx, n;
+        ldb_slice_t kslice, value;
+        int64_t op;
+
+        for (n = live.length; n > 1; n >>= 1)
+          max_log++;
+
+        idx = ldb_rand_skewed(&thread->rand, max_log);
+
+        if (idx >= live.length)
+          idx = live.length - 1;
+
+        idx = live.length - 1 - idx;
+        op = live.items[idx];
+
+        live.items[idx] = live.items[live.length - 1];
+        live.length--;
+
+        utxo_key(key, (uint64_t)op >> 16, (uint32_t)(op & 0xffff));
+
+        kslice = ldb_slice(key, sizeof(key));
+
+        /* Fetch the coin being spent (validation), then remove it. */
+        if (ldb_get(bench->db, &kslice, &value, ldb_readopt_default) == LDB_OK) {
+          live_bytes -= UTXO_KEY_SIZE + value.size;
+          ldb_free(value.data);
+        } else {
+          missed++;
+        }
+
+        ldb_batch_del(&batch, &kslice);
+
+        bytes += kslice.size;
+        spent++;
+      }
+
+      if (outputs > 0xffff)
+        outputs = 0xffff;
+
+      for (k = 0; k < outputs; k++) {
+        ldb_slice_t kslice, vslice;
+
+        utxo_key(key, txnum, k);
+
+        kslice = ldb_slice(key, sizeof(key));
+        vslice = rgen_generate(&gen, bench->value_size);
+
+        ldb_batch_put(&batch, &kslice, &vslice);
+        ldb_array_push(&fresh, (int64_t)((txnum << 16) | k));
+
+        live_bytes += kslice.size + vslice.size;
+        bytes += kslice.size + vslice.size;
+        created++;
+      }
+
+      txnum++;
+    }
+
+    for (t = 0; t < flags_block_lookups && live.length > 0; t++) {
+      int64_t op = live.items[ldb_rand_uniform(&thread->rand, live.length)];
+      ldb_slice_t kslice, value;
+
+      utxo_key(key, (uint64_t)op >> 16, (uint32_t)(op & 0xffff));
+
+      kslice = ldb_slice(key, sizeof(key));
+
+      if (ldb_get(bench->db, &kslice, &value, ldb_readopt_default) == LDB_OK)
+        ldb_free(value.data);
+    }
+
+    rc = ldb_write(bench->db, &batch, &bench->write_options);
+
+    if (rc != LDB_OK) {
+      fprintf(stderr, "write error: %s\n", ldb_strerror(rc));
+      exit(EXIT_FAILURE);
+    }
+
+    /* Coins created by this block become spendable by the next. */
+    for (j = 0; j < fresh.length; j++)
+      ldb_array_push(&live, fresh.items[j]);
+
+    stats_finished_single_op(&thread->stats);
+  }
+
+  stats_add_bytes(&thread->stats, bytes);
+
+  stalls = utxo_property(bench, "leveldb.num-write-stalls") - stalls;
+  stall_us = utxo_property(bench, "leveldb.write-stall-micros") - stall_us;
+  comp_read = utxo_property(bench, "leveldb.compaction-bytes-read")
+            - comp_read;
+  comp_write = utxo_property(bench, "leveldb.compaction-bytes-written")
+             - comp_write;
+  total_bytes = utxo_property(bench, "leveldb.total-bytes");
+
+  elapsed = (bench_now() - thread->stats.start) * 1e-6;
+  space_amp = live_bytes > 0 ? (double)total_bytes / live_bytes : 0.0;
+
+  sprintf(msg, "(%d blocks, %.1f blocks/s, %.0f created, %.0f spent,"
+               " %.0f missed)",
+          flags_blocks, flags_blocks / elapsed,
+          (double)created, (double)spent, (double)missed);
+
+  stats_add_message(&thread->stats, msg);
+
+  fprintf(stdout, "%-12s   utxos: %lu (%.1f MB), "
+                  "sst: %.1f MB, space amp: %.2f\n",
+                  "", (unsigned long)live.length,
+                  live_bytes / 1048576.0,
+                  total_bytes / 1048576.0,
+                  space_amp);
+
+  fprintf(stdout, "%-12s   write stalls: %.0f (%.1f ms), "
+                  "compaction: %.1f MB read, %.1f MB written\n",
+                  "", (double)stalls, stall_us / 1000.0,
+                  comp_read / 1048576.0,
+                  comp_write / 1048576.0);
+
+  rgen_clear(&gen);
+  ldb_batch_clear(&batch);
+  ldb_array_clear(&fresh);
+  ldb_array_clear(&live);
+}
+
+static void
+bench_compact(bench_t *bench, thread_t *thread) {
+  (void)thread;
+  ldb_compact_range(bench->db, NULL, NULL);
+}
+
+static void
+bench_print_stats(bench_t *bench, const char *key) {
+  char *stats = NULL;
+
+  if (!ldb_get_property(bench->db, key, &stats)) {
+    fprintf(stdout, "\n(failed)\n");
+    return;
+  }
+
+  fprintf(stdout, "\n%s\n", stats);
+
+  ldb_free(stats);
+}
+
+static void
+bench_run(bench_t *bench) {
+  const char *benchmarks = flags_benchmarks;
+
+  print_header();
+  bench_open(bench);
+
+  while (benchmarks != NULL) {
+    const char *sep = strchr(benchmarks, ',');
+    bench_method_f *method = NULL;
+    int num_threads = flags_threads;
+    int fresh_db = 0;
+    char name[64];
+    size_t len;
+
+    if (sep == NULL) {
+      len = strlen(benchmarks);
+    } else {
+      len = sep - benchmarks;
+      sep++;
+    }
+
+    if (len >= sizeof(name))
+      len = sizeof(name) - 1;
+
+    memcpy(name, benchmarks, len);
+
+    name[len] = '\0';
+    benchmarks = sep;
+
+    /* Reset parameters that may be overridden below. */
+    bench->num = flags_num;
+    bench->reads = (flags_reads < 0 ? flags_num : flags_reads);
+    bench->value_size = flags_value_size;
+    bench->entries_per_batch = 1;
+    bench->write_options = *ldb_writeopt_default;
+
+    if (strcmp(name, "open") == 0) {
+      fprintf(stdout, "%-12s : skipped (opened at startup)\n", name);
+      continue;
+    } else if (strcmp(name, "fillseq") == 0) {
+      fresh_db = 1;
+      method = bench_write_seq;
+    } else if (strcmp(name, "fillbatch") == 0) {
+      fresh_db = 1;
+      bench->entries_per_batch = 1000;
+      method = bench_write_seq;
+    } else if (strcmp(name, "fillrandom") == 0) {
+      fresh_db = 1;
+      method = bench_write_random;
+    } else if (strcmp(name, "overwrite") == 0) {
+      fresh_db = 0;
+      method = bench_write_random;
+    } else if (strcmp(name, "fillsync") == 0) {
+      fresh_db = 1;
+      bench->num /= 1000;
+      bench->write_options.sync = 1;
+      method = bench_write_random;
+    } else if (strcmp(name, "fill100K") == 0) {
+      fresh_db = 1;
+      bench->num /= 1000;
+      bench->value_size = 100 * 1000;
+      method = bench_write_random;
+    } else if (strcmp(name, "readseq") == 0) {
+      method = bench_read_sequential;
+    } else if (strcmp(name, "readreverse") == 0) {
+      method = bench_read_reverse;
+    } else if (strcmp(name, "readrandom") == 0) {
+      method = bench_read_random;
+    } else if (strcmp(name, "readmissing") == 0) {
+      method = bench_read_missing;
+    } else if (strcmp(name, "seekrandom") == 0) {
+      method = bench_seek_random;
+    } else if (strcmp(name, "seekordered") == 0) {
+      method = bench_seek_ordered;
+    } else if (strcmp(name, "readhot") == 0) {
+      method = bench_read_hot;
+    } else if (strcmp(name, "readrandomsmall") == 0) {
+      bench->reads /= 1000;
+      method = bench_read_random;
+    } else if (strcmp(name, "deleteseq") == 0) {
+      method = bench_delete_seq;
+    } else if (strcmp(name, "deleterandom") == 0) {
+      method = bench_delete_random;
+    } else if (strcmp(name, "readwhilewriting") == 0) {
+#if defined(_WIN32) || defined(LDB_PTHREAD)
+      num_threads++; /* Add extra thread for writing. */
+      method = bench_read_while_writing;
+#else
+      fprintf(stderr, "%-12s : skipped (requires threads)\n", name);
+      continue;
+#endif
+    } else if (strcmp(name, "utxo") == 0) {
+      fresh_db = 1;
+      num_threads = 1; /* Blocks are connected serially. */
+      method = bench_utxo;
+    } else if (strcmp(name, "compact") == 0) {
+      method = bench_compact;
+    } else if (strcmp(name, "crc32c") == 0) {
+      method = bench_crc32c;
+    } else if (strcmp(name, "snappycomp") == 0) {
+      method = bench_snappy_compress;
+    } else if (strcmp(name, "snappyuncomp") == 0) {
+      method = bench_snappy_uncompress;
+    } else if (strcmp(name, "stats") == 0) {
+      bench_print_stats(bench, "leveldb.stats");
+    } else if (strcmp(name, "sstables") == 0) {
+      bench_print_stats(bench, "leveldb.sstables");
+    } else {
+      if (name[0] != '\0') /* No error message for empty name. */
+        fprintf(stderr, "unknown benchmark '%s'\n", name);
+    }
+
+    if (fresh_db) {
+      if (flags_use_existing_db) {
+        fprintf(stdout, "%-12s : skipped (--use_existing_db is true)\n", name);
+        method = NULL;
+      } else {
+        ldb_close(bench->db);
+        bench->db = NULL;
+        ldb_destroy_db(bench->dbname, NULL);
+        bench_open(bench);
+      }
+    }
+
+    if (method != NULL)
+      run_benchmark(bench, num_threads, name, method);
+  }
+}
+
+/*
+ * Main
+ */
+
+static int
+parse_flag(const char *arg, const char *name, const char **value) {
+  size_t len = strlen(name);
+
+  if (strncmp(arg, name, len) != 0 || arg[len] != '=')
+    return 0;
+
+  *value = arg + len + 1;
+
+  return 1;
+}
+
+static int
+parse_int(const char *arg, const char *name, int *value) {
+  const char *str;
+  char *end;
+  long num;
+
+  if (!parse_flag(arg, name, &str))
+    return 0;
+
+  num = strtol(str, &end, 10);
+
+  if (*str == '\0' || *end != '\0' || num < INT_MIN || num > INT_MAX)
+    return 0;
+
+  *value = (int)num;
+
+  return 1;
+}
+
+static int
+parse_double(const char *arg, const char *name, double *value) {
+  const char *str;
+  char *end;
+  double num;
+
+  if (!parse_flag(arg, name, &str))
+    return 0;
+
+  num = strtod(str, &end);
+
+  if (*str == '\0' || *end != '\0')
+    return 0;
+
+  *value = num;
+
+  return 1;
+}
+
+int
+main(int argc, char **argv) {
+  bench_t bench;
+  int i;
+
+  flags_write_buffer_size = ldb_dbopt_default->write_buffer_size;
+  flags_max_file_size = ldb_dbopt_default->max_file_size;
+  flags_block_size = ldb_dbopt_default->block_size;
+  flags_open_files = ldb_dbopt_default->max_open_files;
+  flags_max_background_compactions =
+    ldb_dbopt_default->max_background_compactions;
+  flags_max_subcompactions = ldb_dbopt_default->max_subcompactions;
+
+  for (i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+
+    if (parse_flag(arg, "--benchmarks", &flags_benchmarks)) {
+      ;
+    } else if (parse_double(arg, "--compression_ratio",
+                            &flags_compression_ratio)) {
+      ;
+    } else if (parse_int(arg, "--histogram", &flags_histogram)) {
+      ;
+    } else if (parse_int(arg, "--compression", &flags_compression)) {
+      ;
+    } else if (parse_int(arg, "--use_existing_db", &flags_use_existing_db)) {
+      ;
+    } else if (parse_int(arg, "--reuse_logs", &flags_reuse_logs)) {
+      ;
+    } else if (parse_int(arg, "--mmap", &flags_use_mmap)) {
+      ;
+    } else if (parse_int(arg, "--num", &flags_num)) {
+      ;
+    } else if (parse_int(arg, "--reads", &flags_reads)) {
+      ;
+    } else if (parse_int(arg, "--threads", &flags_threads)) {
+      ;
+    } else if (parse_int(arg, "--key_size", &flags_key_size)) {
+      ;
+    } else if (parse_int(arg, "--value_size", &flags_value_size)) {
+      ;
+    } else if (parse_int(arg, "--write_buffer_size",
+                         &flags_write_buffer_size)) {
+      ;
+    } else if (parse_int(arg, "--max_file_size", &flags_max_file_size)) {
+      ;
+    } else if (parse_int(arg, "--block_size", &flags_block_size)) {
+      ;
+    } else if (parse_int(arg, "--cache_size", &flags_cache_size)) {
+      ;
+    } else if (parse_int(arg, "--clock_cache", &flags_clock_cache)) {
+      ;
+    } else if (parse_int(arg, "--row_cache_size", &flags_row_cache_size)) {
+      ;
+    } else if (parse_int(arg, "--bloom_bits", &flags_bloom_bits)) {
+      ;
+    } else if (parse_int(arg, "--ribbon_level", &flags_ribbon_level)) {
+      ;
+    } else if (parse_int(arg, "--blocked_bloom", &flags_blocked_bloom)) {
+      ;
+    } else if (parse_int(arg, "--full_filter", &flags_full_filter)) {
+      ;
+    } else if (parse_int(arg, "--concurrent_memtable_writes",
+                         &flags_concurrent_memtable_writes)) {
+      ;
+    } else if (parse_int(arg, "--pipelined_write", &flags_pipelined_write)) {
+      ;
+    } else if (parse_int(arg, "--group_commit", &flags_group_commit)) {
+      ;
+    } else if (parse_int(arg, "--group_commit_delay",
+                         &flags_group_commit_delay)) {
+      ;
+    } else if (parse_int(arg, "--open_files", &flags_open_files)) {
+      ;
+    } else if (parse_int(arg, "--max_background_compactions",
+                         &flags_max_background_compactions)) {
+      ;
+    } else if (parse_int(arg, "--max_subcompactions",
+                         &flags_max_subcompactions)) {
+      ;
+    } else if (parse_flag(arg, "--db", &flags_db)) {
+      ;
+    } else if (parse_int(arg, "--blocks", &flags_blocks)) {
+      ;
+    } else if (parse_int(arg, "--block_txs", &flags_block_txs)) {
+      ;
+    } else if (parse_int(arg, "--tx_inputs", &flags_tx_inputs)) {
+      ;
+    } else if (parse_int(arg, "--tx_outputs", &flags_tx_outputs)) {
+      ;
+    } else if (parse_int(arg, "--block_lookups", &flags_block_lookups)) {
+      ;
+    } else {
+      fprintf(stderr, "Invalid flag '%s'\n", arg);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (flags_num < 1 || flags_threads < 1 || flags_value_size < 0 ||
+      flags_key_size < 1 || flags_key_size > 1024) {
+    fprintf(stderr, "Invalid flag value\n");
+    return EXIT_FAILURE;
+  }
+
+#if !defined(_WIN32) && !defined(LDB_PTHREAD)
+  if (flags_threads > 1) {
+    fprintf(stderr, "Threads unavailable; using --threads=1\n");
+    flags_threads = 1;
+  }
+#endif
+
+  bench_init(&bench);
+  bench_run(&bench);
+  bench_clear(&bench);
+
+  return EXIT_SUCCESS;
+}
@@ -467,6 +467,54 @@ test_log_random_read(ltest_t *t) {
   ASSERT_EQ("EOF", ltest_read(t));
 }
 
+static void
+test_log_gather_write(ltest_t *t) {
+  const int N = 500;
+  ldb_logwriter_t writer;
+  ldb_buffer_t expect;
+  ldb_rand_t rnd, cut;
+  int i;
+
+  ldb_buffer_init(&expect);
+  ldb_logwriter_init(&writer, NULL, 0);
+
+  writer.dst = &expect;
+
+  ldb_rand_init(&rnd, 301);
+  ldb_rand_init(&cut, 302);
+
+  /* Splitting a record into pieces must not change what is written. */
+  for (i = 0; i < N; i++) {
+    ldb_slice_t rec = ldb_string(ltest_rand_string(t, i, &rnd));
+    size_t a = ldb_rand_uniform(&cut, rec.size + 1);
+    size_t b = a + ldb_rand_uniform(&cut, rec.size - a + 1);
+    ldb_slice_t iov[4];
+
+    ldb_slice_set(&iov[0], rec.data, a);
+    ldb_slice_set(&iov[1], rec.data + a, 0);
+    ldb_slice_set(&iov[2], rec.data + a, b - a);
+    ldb_slice_set(&iov[3], rec.data + b, rec.size - b);
+
+    ASSERT(ldb_logwriter_add_recordv(&t->writer, iov, 4) == LDB_OK);
+    ASSERT(ldb_logwriter_add_record(&writer, &rec) == LDB_OK);
+
+    ltest_reset(t);
+  }
+
+  ASSERT(ldb_buffer_equal(&t->dst, &expect));
+
+  ldb_rand_init(&rnd, 301);
+
+  for (i = 0; i < N; i++) {
+    ASSERT_EQ(ltest_rand_string(t, i, &rnd), ltest_read(t));
+    ltest_reset(t);
+  }
+
+  ASSERT_EQ("EOF", ltest_read(t));
+
+  ldb_buffer_clear(&expect);
+}
+
 /* Tests of all the error paths in log_reader.cc follow: */
 
 static void
@@ -754,6 +802,7 @@ ldb_test_log(void) {
     test_log_aligned_eof,
     test_log_open_for_append,
     test_log_random_read,
+    test_log_gather_write,
     test_log_read_error,
     test_log_bad_record_type,
     test_log_truncated_trailing_record_is_ignored,
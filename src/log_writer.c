@@ -60,10 +60,13 @@ ldb_logwriter_init(ldb_logwriter_t *lw, ldb_wfile_t *file, uint64_t length) {
 static int
 emit_physical_record(ldb_logwriter_t *lw,
                      ldb_rectype_t type,
-                     const uint8_t *ptr,
+                     const ldb_slice_t *iov,
+                     size_t offset,
                      size_t length) {
   uint8_t buf[LDB_HEADER_SIZE];
+  const ldb_slice_t *it;
   ldb_slice_t data;
+  size_t pos, left;
   int rc = LDB_OK;
   uint32_t crc;
 
@@ -75,31 +78,58 @@ emit_physical_record(ldb_logwriter_t *lw,
   buf[5] = (uint8_t)(length >> 8);
   buf[6] = (uint8_t)(type);
 
-  /* Compute the crc of the record type and the payload. */
-  crc = ldb_crc32c_extend(lw->type_crc[type], ptr, length);
+  /* Compute the crc of the record type and the payload. The payload
+     may be spread across several slices, starting at `offset` bytes
+     into the first one. */
+  crc = lw->type_crc[type];
+
+  for (it = iov, pos = offset, left = length; left > 0; it++, pos = 0) {
+    size_t n = it->size - pos;
+
+    if (n > left)
+      n = left;
+
+    crc = ldb_crc32c_extend(crc, it->data + pos, n);
+
+    left -= n;
+  }
+
   crc = ldb_crc32c_mask(crc); /* Adjust for storage. */
 
   ldb_fixed32_write(buf, crc);
 
+  /* Write the header and the payload. */
   if (lw->dst != NULL) {
     ldb_buffer_append(lw->dst, buf, LDB_HEADER_SIZE);
-    ldb_buffer_append(lw->dst, ptr, length);
   } else {
-    /* Write the header and the payload. */
     ldb_slice_set(&data, buf, LDB_HEADER_SIZE);
 
     rc = ldb_wfile_append(lw->file, &data);
+  }
 
-    if (rc == LDB_OK) {
-      ldb_slice_set(&data, ptr, length);
+  for (it = iov, pos = offset, left = length; left > 0; it++, pos = 0) {
+    size_t n = it->size - pos;
 
-      rc = ldb_wfile_append(lw->file, &data);
+    if (rc != LDB_OK)
+      break;
+
+    if (n > left)
+      n = left;
+
+    if (lw->dst != NULL) {
+      ldb_buffer_append(lw->dst, it->data + pos, n);
+    } else {
+      ldb_slice_set(&data, it->data + pos, n);
 
-      if (rc == LDB_OK)
-        rc = ldb_wfile_flush(lw->file);
+      rc = ldb_wfile_append(lw->file, &data);
     }
+
+    left -= n;
   }
 
+  if (rc == LDB_OK && lw->dst == NULL)
+    rc = ldb_wfile_flush(lw->file);
+
   lw->block_offset += LDB_HEADER_SIZE + length;
 
   return rc;
@@ -107,18 +137,30 @@ emit_physical_record(ldb_logwriter_t *lw,
 
 int
 ldb_logwriter_add_record(ldb_logwriter_t *lw, const ldb_slice_t *slice) {
+  return ldb_logwriter_add_recordv(lw, slice, 1);
+}
+
+int
+ldb_logwriter_add_recordv(ldb_logwriter_t *lw,
+                          const ldb_slice_t *iov,
+                          size_t count) {
   static const uint8_t zeroes[LDB_HEADER_SIZE] = {0};
-  const uint8_t *ptr = slice->data;
-  size_t left = slice->size;
+  size_t index = 0;
+  size_t offset = 0;
+  size_t left = 0;
   int rc = LDB_OK;
   int begin = 1;
+  size_t i;
+
+  for (i = 0; i < count; i++)
+    left += iov[i].size;
 
-  /* Fragment the record if necessary and emit it.  Note that if slice
-     is empty, we still want to iterate once to emit a single
+  /* Fragment the record if necessary and emit it.  Note that if the
+     record is empty, we still want to iterate once to emit a single
      zero-length record. */
   do {
     int leftover = LDB_BLOCK_SIZE - lw->block_offset;
-    size_t avail, fragment_length;
+    size_t avail, fragment_length, skip;
     ldb_rectype_t type;
     int end;
 
@@ -158,8 +200,30 @@ ldb_logwriter_add_record(ldb_logwriter_t *lw, const ldb_slice_t *slice) {
       type = LDB_TYPE_MIDDLE;
     }
 
-    rc = emit_physical_record(lw, type, ptr, fragment_length);
-    ptr += fragment_length;
+    /* Skip over exhausted (or empty) slices. */
+    while (index < count && offset == iov[index].size) {
+      index++;
+      offset = 0;
+    }
+
+    rc = emit_physical_record(lw, type, iov + index, offset, fragment_length);
+
+    /* Advance the cursor past the fragment. */
+    skip = fragment_length;
+
+    while (skip > 0) {
+      size_t n = iov[index].size - offset;
+
+      if (n > skip) {
+        offset += skip;
+        break;
+      }
+
+      skip -= n;
+      index++;
+      offset = 0;
+    }
+
     left -= fragment_length;
     begin = 0;
   } while (rc == LDB_OK && left > 0);
@@ -57,4 +57,12 @@ ldb_logwriter_init(ldb_logwriter_t *lw,
 int
 ldb_logwriter_add_record(ldb_logwriter_t *lw, const ldb_slice_t *slice);
 
+/* Like add_record, but the record is the concatenation of `count`
+   slices. The pieces are checksummed and written in place, which
+   saves the caller from assembling a contiguous copy first. */
+int
+ldb_logwriter_add_recordv(ldb_logwriter_t *lw,
+                          const ldb_slice_t *iov,
+                          size_t count);
+
 #endif /* LDB_LOG_WRITER_H */
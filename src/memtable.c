@@ -21,6 +21,7 @@
 #include "util/coding.h"
 #include "util/comparator.h"
 #include "util/internal.h"
+#include "util/port.h"
 #include "util/slice.h"
 #include "util/status.h"
 
@@ -37,6 +38,7 @@ struct ldb_memtable_s {
   int refs;
   ldb_arena_t arena;
   ldb_skiplist_t table;
+  ldb_mutex_t mutex; /* Guards allocation during concurrent adds. */
 };
 
 static void
@@ -49,12 +51,15 @@ ldb_memtable_init(ldb_memtable_t *mt, const ldb_comparator_t *comparator) {
   ldb_arena_init(&mt->arena);
 
   ldb_skiplist_init(&mt->table, &mt->comparator, &mt->arena);
+
+  ldb_mutex_init(&mt->mutex);
 }
 
 static void
 ldb_memtable_clear(ldb_memtable_t *mt) {
   assert(mt->refs == 0);
 
+  ldb_mutex_destroy(&mt->mutex);
   ldb_arena_clear(&mt->arena);
 }
 
@@ -91,12 +96,13 @@ ldb_memtable_usage(const ldb_memtable_t *mt) {
   return ldb_arena_usage(&mt->arena);
 }
 
-void
-ldb_memtable_add(ldb_memtable_t *mt,
-                 ldb_seqnum_t sequence,
-                 ldb_valtype_t type,
-                 const ldb_slice_t *key,
-                 const ldb_slice_t *value) {
+static void
+memtable_add(ldb_memtable_t *mt,
+             ldb_seqnum_t sequence,
+             ldb_valtype_t type,
+             const ldb_slice_t *key,
+             const ldb_slice_t *value,
+             int concurrent) {
   /* Format of an entry is concatenation of:
    *
    *  key_size     : varint32 of internal_key.size()
@@ -107,13 +113,26 @@ ldb_memtable_add(ldb_memtable_t *mt,
    */
   size_t val_size = value->size;
   size_t ikey_size = key->size + 8;
+  ldb_skipnode_t *node = NULL;
   uint8_t *tp, *zp;
   size_t zn = 0;
 
   zn += ldb_varint32_size(ikey_size) + ikey_size;
   zn += ldb_varint32_size(val_size) + val_size;
 
-  tp = ldb_arena_alloc(&mt->arena, zn);
+  if (concurrent) {
+    /* Only allocation is serialized. The entry is
+       encoded and linked in outside of the lock. */
+    ldb_mutex_lock(&mt->mutex);
+
+    tp = ldb_arena_alloc(&mt->arena, zn);
+    node = ldb_skiplist_prepare(&mt->table, tp);
+
+    ldb_mutex_unlock(&mt->mutex);
+  } else {
+    tp = ldb_arena_alloc(&mt->arena, zn);
+  }
+
   zp = tp;
 
   zp = ldb_varint32_write(zp, ikey_size);
@@ -125,14 +144,35 @@ ldb_memtable_add(ldb_memtable_t *mt,
 
   assert(zp == tp + zn);
 
-  ldb_skiplist_insert(&mt->table, tp);
+  if (concurrent)
+    ldb_skiplist_link(&mt->table, node);
+  else
+    ldb_skiplist_insert(&mt->table, tp);
 }
 
-int
-ldb_memtable_get(ldb_memtable_t *mt,
-                 const ldb_lkey_t *key,
-                 ldb_buffer_t *value,
-                 int *status) {
+void
+ldb_memtable_add(ldb_memtable_t *mt,
+                 ldb_seqnum_t sequence,
+                 ldb_valtype_t type,
+                 const ldb_slice_t *key,
+                 const ldb_slice_t *value) {
+  memtable_add(mt, sequence, type, key, value, 0);
+}
+
+void
+ldb_memtable_add_concurrently(ldb_memtable_t *mt,
+                              ldb_seqnum_t sequence,
+                              ldb_valtype_t type,
+                              const ldb_slice_t *key,
+                              const ldb_slice_t *value) {
+  memtable_add(mt, sequence, type, key, value, 1);
+}
+
+static int
+memtable_get(ldb_memtable_t *mt,
+             const ldb_lkey_t *key,
+             ldb_slice_t *value,
+             int *status) {
   ldb_slice_t mkey = ldb_lkey_memtable_key(key);
   ldb_skipiter_t iter;
 
@@ -166,10 +206,7 @@ ldb_memtable_get(ldb_memtable_t *mt,
 
       switch ((ldb_valtype_t)(tag & 0xff)) {
         case LDB_TYPE_VALUE: {
-          if (value != NULL) {
-            ldb_slice_t val = ldb_slice_decode(okey.data + okey.size + 8);
-            ldb_buffer_copy(value, &val);
-          }
+          *value = ldb_slice_decode(okey.data + okey.size + 8);
           return 1;
         }
 
@@ -184,6 +221,33 @@ ldb_memtable_get(ldb_memtable_t *mt,
   return 0;
 }
 
+int
+ldb_memtable_get(ldb_memtable_t *mt,
+                 const ldb_lkey_t *key,
+                 ldb_buffer_t *value,
+                 int *status) {
+  int rc = *status;
+  ldb_slice_t val;
+
+  if (!memtable_get(mt, key, &val, &rc))
+    return 0;
+
+  if (rc == LDB_OK && value != NULL)
+    ldb_buffer_copy(value, &val);
+
+  *status = rc;
+
+  return 1;
+}
+
+int
+ldb_memtable_get_pinned(ldb_memtable_t *mt,
+                        const ldb_lkey_t *key,
+                        ldb_slice_t *value,
+                        int *status) {
+  return memtable_get(mt, key, value, status);
+}
+
 /*
  * MemTable Iterator
  */
@@ -60,6 +60,15 @@ ldb_memtable_add(ldb_memtable_t *mt,
                  const ldb_slice_t *key,
                  const ldb_slice_t *value);
 
+/* Same as ldb_memtable_add(), but may be called from several threads
+   at once. Must not be called at the same time as ldb_memtable_add(). */
+void
+ldb_memtable_add_concurrently(ldb_memtable_t *mt,
+                              ldb_seqnum_t sequence,
+                              ldb_valtype_t type,
+                              const ldb_slice_t *key,
+                              const ldb_slice_t *value);
+
 /* If memtable contains a value for key, store it in *value and return true.
    If memtable contains a deletion for key, store a NOTFOUND error
    in *status and return true.
@@ -70,6 +79,14 @@ ldb_memtable_get(ldb_memtable_t *mt,
                  ldb_buffer_t *value,
                  int *status);
 
+/* Same as ldb_memtable_get(), but points *value into the memtable's
+   arena. The value is valid for as long as the memtable is. */
+int
+ldb_memtable_get_pinned(ldb_memtable_t *mt,
+                        const struct ldb_lkey_s *key,
+                        ldb_slice_t *value,
+                        int *status);
+
 /*
  * MemTable Iterator
  */
@@ -29,6 +29,8 @@
  * -------------
  *
  * Writes require external synchronization, most likely a mutex.
+ * The exception is link(), which uses compare-and-swap to splice
+ * nodes in and may race with other calls to link().
  * Reads require a guarantee that the SkipList will not be destroyed
  * while the read is in progress. Apart from that, reads progress
  * without any internal locking or synchronization.
@@ -78,6 +80,16 @@ ldb_skipnode_next(ldb_skipnode_t *node, int n) {
   return ldb_atomic_load_ptr(&node->next[n], ldb_order_acquire);
 }
 
+static int
+ldb_skipnode_casnext(ldb_skipnode_t *node,
+                     int n,
+                     ldb_skipnode_t *expected,
+                     ldb_skipnode_t *x) {
+  assert(n >= 0);
+  return ldb_atomic_compare_exchange_ptr(&node->next[n], expected, x,
+                                         ldb_order_release);
+}
+
 static void
 ldb_skipnode_setnext(ldb_skipnode_t *node, int n, ldb_skipnode_t *x) {
   assert(n >= 0);
@@ -295,6 +307,91 @@ ldb_skiplist_insert(ldb_skiplist_t *list, const uint8_t *key) {
   }
 }
 
+ldb_skipnode_t *
+ldb_skiplist_prepare(ldb_skiplist_t *list, const uint8_t *key) {
+  int height = ldb_skiplist_randheight(list);
+  ldb_skipnode_t *x = ldb_skipnode_create(list, key, height);
+
+  /* Stash the height in the first link until the node is linked. */
+  ldb_skipnode_setnext_nb(x, 0, (ldb_skipnode_t *)(uintptr_t)height);
+
+  return x;
+}
+
+/* Find the nodes between which key belongs at "level", starting
+   the search from "before" (which must sort before key). */
+static void
+ldb_skiplist_find_splice(const ldb_skiplist_t *list,
+                         const uint8_t *key,
+                         ldb_skipnode_t *before,
+                         int level,
+                         ldb_skipnode_t **prev,
+                         ldb_skipnode_t **next) {
+  ldb_skipnode_t *x = before;
+  ldb_skipnode_t *y;
+
+  for (;;) {
+    y = ldb_skipnode_next(x, level);
+
+    if (!ldb_skiplist_key_after_node(list, key, y))
+      break;
+
+    x = y;
+  }
+
+  *prev = x;
+  *next = y;
+}
+
+void
+ldb_skiplist_link(ldb_skiplist_t *list, ldb_skipnode_t *node) {
+  ldb_skipnode_t *prev[LDB_MAX_HEIGHT];
+  ldb_skipnode_t *next[LDB_MAX_HEIGHT];
+  ldb_skipnode_t *before = list->head;
+  int height, max_height, i;
+
+  height = (int)(uintptr_t)ldb_skipnode_next_nb(node, 0);
+
+  assert(height > 0 && height <= LDB_MAX_HEIGHT);
+
+  max_height = ldb_skiplist_maxheight(list);
+
+  while (height > max_height) {
+    /* See insert() for why a relaxed update is fine here. */
+    if (ldb_atomic_compare_exchange(&list->max_height, max_height, height,
+                                    ldb_order_relaxed)) {
+      max_height = height;
+      break;
+    }
+
+    max_height = ldb_skiplist_maxheight(list);
+  }
+
+  for (i = max_height - 1; i >= 0; i--) {
+    ldb_skiplist_find_splice(list, node->key, before, i, &prev[i], &next[i]);
+    before = prev[i];
+  }
+
+  /* Link from the bottom up so that a node is reachable at level 0
+     before it is reachable from anywhere above. A failed swap means
+     another node went in next to ours; search again from where we
+     were, since prev[i] still sorts before key. */
+  for (i = 0; i < height; i++) {
+    for (;;) {
+      assert(next[i] == NULL
+             || ldb_skiplist_compare(list, node->key, next[i]->key) < 0);
+
+      ldb_skipnode_setnext_nb(node, i, next[i]);
+
+      if (ldb_skipnode_casnext(prev[i], i, next[i], node))
+        break;
+
+      ldb_skiplist_find_splice(list, node->key, prev[i], i,
+                               &prev[i], &next[i]);
+    }
+  }
+}
+
 int
 ldb_skiplist_contains(const ldb_skiplist_t *list, const uint8_t *key) {
   ldb_skipnode_t *x = ldb_skiplist_find_gte(list, key, NULL);
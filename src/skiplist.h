@@ -33,11 +33,11 @@ typedef struct ldb_skiplist_s {
   struct ldb_arena_s *arena;
   ldb_skipnode_t *head;
 
-  /* Modified only by insert(). Read racily by readers, but stale
-     values are ok. */
+  /* Modified only by insert() and link(). Read racily by readers,
+     but stale values are ok. */
   ldb_atomic(int) max_height; /* Height of the entire list. */
 
-  /* Read/written only by insert(). */
+  /* Read/written only by insert() and prepare(). */
   ldb_rand_t rnd;
 } ldb_skiplist_t;
 
@@ -64,6 +64,19 @@ ldb_skiplist_init(ldb_skiplist_t *list,
 void
 ldb_skiplist_insert(ldb_skiplist_t *list, const uint8_t *key);
 
+/* Allocate a node for key without inserting it. The key need not be
+   filled in until the node is passed to link(). Requires the same
+   external synchronization as insert(). */
+ldb_skipnode_t *
+ldb_skiplist_prepare(ldb_skiplist_t *list, const uint8_t *key);
+
+/* Insert a node returned by prepare() into the list. Unlike insert(),
+   this may be called by several threads at once, but never at the
+   same time as insert(). */
+/* REQUIRES: nothing that compares equal to key is currently in the list. */
+void
+ldb_skiplist_link(ldb_skiplist_t *list, ldb_skipnode_t *node);
+
 /* Returns true iff an entry that compares equal to key is in the list. */
 int
 ldb_skiplist_contains(const ldb_skiplist_t *list, const uint8_t *key);
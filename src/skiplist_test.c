@@ -606,6 +606,90 @@ test_skip_concurrent(ldb_pool_t *pool, int run) {
   }
 }
 
+/* Several threads link disjoint keys into the same list. */
+typedef struct lstate_s {
+  skiplist_t *list;
+  ldb_mutex_t *mutex;
+  int id;
+  int threads;
+  int count;
+} lstate_t;
+
+static void
+concurrent_linker(void *arg) {
+  lstate_t *state = arg;
+  ldb_skipnode_t *node;
+  uint8_t *buf;
+  uint64_t key;
+  int i;
+
+  for (i = 0; i < state->count; i++) {
+    key = (uint64_t)i * state->threads + state->id;
+
+    /* Allocation is not thread-safe. */
+    ldb_mutex_lock(state->mutex);
+
+    buf = ldb_arena_alloc(state->list->arena, 9);
+    node = ldb_skiplist_prepare(state->list, buf);
+
+    ldb_mutex_unlock(state->mutex);
+
+    encode_key(key, buf);
+
+    ldb_skiplist_link(state->list, node);
+  }
+}
+
+static void
+test_skip_concurrent_link(void) {
+  enum { THREADS = 4, COUNT = 5000 };
+  ldb_pool_t *pool = ldb_pool_create(THREADS);
+  lstate_t states[THREADS];
+  ldb_mutex_t mutex;
+  ldb_arena_t arena;
+  skipiter_t iter;
+  skiplist_t list;
+  uint64_t key;
+  int i;
+
+  ldb_mutex_init(&mutex);
+  ldb_arena_init(&arena);
+
+  skiplist_init(&list, &integer_comparator, &arena);
+
+  for (i = 0; i < THREADS; i++) {
+    states[i].list = &list;
+    states[i].mutex = &mutex;
+    states[i].id = i;
+    states[i].threads = THREADS;
+    states[i].count = COUNT;
+
+    ldb_pool_schedule(pool, &concurrent_linker, &states[i]);
+  }
+
+  ldb_pool_wait(pool);
+
+  for (key = 0; key < THREADS * COUNT; key++)
+    ASSERT(skiplist_contains(&list, key));
+
+  ASSERT(!skiplist_contains(&list, THREADS * COUNT));
+
+  skipiter_init(&iter, &list);
+  skipiter_seek_first(&iter);
+
+  for (key = 0; key < THREADS * COUNT; key++) {
+    ASSERT(skipiter_valid(&iter));
+    ASSERT(skipiter_key(&iter) == key);
+    skipiter_next(&iter);
+  }
+
+  ASSERT(!skipiter_valid(&iter));
+
+  ldb_pool_destroy(pool);
+  ldb_arena_clear(&arena);
+  ldb_mutex_destroy(&mutex);
+}
+
 #endif /* _WIN32 || LDB_PTHREAD */
 
 /*
@@ -633,6 +717,8 @@ ldb_test_skiplist(void) {
 
     ldb_pool_destroy(pool);
   }
+
+  test_skip_concurrent_link();
 #endif /* _WIN32 || LDB_PTHREAD */
 
   return 0;
@@ -18,6 +18,7 @@
 #include "../util/bloom.h"
 #include "../util/buffer.h"
 #include "../util/coding.h"
+#include "../util/prefix.h"
 #include "../util/slice.h"
 #include "../util/vector.h"
 
@@ -31,6 +32,23 @@
 #define LDB_FILTER_BASE_LG 11
 #define LDB_FILTER_BASE (1 << LDB_FILTER_BASE_LG)
 
+/*
+ * Helpers
+ */
+
+/* Prefixes are added to filters as keys of their own. Internal filter
+   policies strip an 8 byte trailer from every key, so one is appended
+   to prefixes when the keys are internal keys. */
+static void
+filter_prefix_key(ldb_buffer_t *z,
+                  const ldb_bloom_t *policy,
+                  const ldb_slice_t *prefix) {
+  ldb_buffer_concat(z, prefix);
+
+  if (policy->user_policy != NULL)
+    ldb_buffer_pad(z, 8);
+}
+
 /*
  * Filter Builder
  */
@@ -38,11 +56,23 @@
 void
 ldb_filterbuilder_init(ldb_filterbuilder_t *fb, const ldb_bloom_t *policy) {
   fb->policy = policy;
+  fb->prefix = NULL;
+  fb->full = 0;
+  fb->has_prefix = 0;
 
   ldb_buffer_init(&fb->keys);
   ldb_array_init(&fb->start);
   ldb_buffer_init(&fb->result);
   ldb_array_init(&fb->filter_offsets);
+  ldb_buffer_init(&fb->last_prefix);
+}
+
+void
+ldb_filterbuilder_init_full(ldb_filterbuilder_t *fb,
+                            const ldb_bloom_t *policy) {
+  ldb_filterbuilder_init(fb, policy);
+
+  fb->full = 1;
 }
 
 void
@@ -51,6 +81,14 @@ ldb_filterbuilder_clear(ldb_filterbuilder_t *fb) {
   ldb_array_clear(&fb->start);
   ldb_buffer_clear(&fb->result);
   ldb_array_clear(&fb->filter_offsets);
+  ldb_buffer_clear(&fb->last_prefix);
+}
+
+void
+ldb_filterbuilder_set_prefix(ldb_filterbuilder_t *fb,
+                             const ldb_prefix_t *prefix) {
+  assert(fb->start.length == 0 && fb->result.size == 0);
+  fb->prefix = prefix;
 }
 
 static void
@@ -60,18 +98,55 @@ void
 ldb_filterbuilder_start_block(ldb_filterbuilder_t *fb, uint64_t block_offset) {
   uint64_t filter_index = (block_offset / LDB_FILTER_BASE);
 
+  if (fb->full)
+    return;
+
   assert(filter_index >= fb->filter_offsets.length);
 
   while (filter_index > fb->filter_offsets.length)
     ldb_filterbuilder_generate_filter(fb);
 }
 
+static void
+ldb_filterbuilder_add_prefix(ldb_filterbuilder_t *fb, const ldb_slice_t *key) {
+  ldb_slice_t ukey = *key;
+  ldb_slice_t prefix;
+
+  if (fb->policy->user_policy != NULL) {
+    if (ukey.size < 8)
+      return;
+
+    ukey.size -= 8;
+  }
+
+  if (!ldb_prefix_in_domain(fb->prefix, &ukey))
+    return;
+
+  prefix = ldb_prefix_transform(fb->prefix, &ukey);
+
+  /* Keys sharing a prefix arrive together, so each
+     prefix only needs to be added once per filter. */
+  if (fb->has_prefix && ldb_slice_equal(&prefix, &fb->last_prefix))
+    return;
+
+  ldb_buffer_copy(&fb->last_prefix, &prefix);
+
+  fb->has_prefix = 1;
+
+  ldb_array_push(&fb->start, fb->keys.size);
+
+  filter_prefix_key(&fb->keys, fb->policy, &prefix);
+}
+
 void
 ldb_filterbuilder_add_key(ldb_filterbuilder_t *fb, const ldb_slice_t *key) {
   ldb_slice_t k = *key;
 
   ldb_array_push(&fb->start, fb->keys.size);
   ldb_buffer_append(&fb->keys, k.data, k.size);
+
+  if (fb->prefix != NULL)
+    ldb_filterbuilder_add_prefix(fb, key);
 }
 
 ldb_slice_t
@@ -79,6 +154,14 @@ ldb_filterbuilder_finish(ldb_filterbuilder_t *fb) {
   uint32_t array_offset;
   size_t i;
 
+  if (fb->full) {
+    /* The whole block is one filter; no offset array is needed. */
+    if (fb->start.length > 0)
+      ldb_filterbuilder_generate_filter(fb);
+
+    return fb->result;
+  }
+
   if (fb->start.length > 0)
     ldb_filterbuilder_generate_filter(fb);
 
@@ -127,6 +210,8 @@ ldb_filterbuilder_generate_filter(ldb_filterbuilder_t *fb) {
   ldb_free(tmp_keys);
   ldb_buffer_reset(&fb->keys);
   ldb_array_reset(&fb->start);
+
+  fb->has_prefix = 0;
 }
 
 /*
@@ -144,6 +229,7 @@ ldb_filterreader_init(ldb_filterreader_t *fr,
   fr->offset = NULL;
   fr->num = 0;
   fr->base_lg = 0;
+  fr->full = 0;
 
   n = contents->size;
 
@@ -162,12 +248,40 @@ ldb_filterreader_init(ldb_filterreader_t *fr,
   fr->num = (n - 5 - last_word) / 4;
 }
 
+void
+ldb_filterreader_init_full(ldb_filterreader_t *fr,
+                           const ldb_bloom_t *policy,
+                           const ldb_slice_t *contents) {
+  fr->policy = policy;
+  fr->data = contents->data;
+  fr->offset = contents->data + contents->size;
+  fr->num = 0;
+  fr->base_lg = 0;
+  fr->full = 1;
+}
+
 int
-ldb_filterreader_matches(const ldb_filterreader_t *fr,
-                         uint64_t block_offset,
-                         const ldb_slice_t *key) {
-  uint64_t index = block_offset >> fr->base_lg;
+ldb_filterreader_may_match(const ldb_filterreader_t *fr,
+                           const ldb_slice_t *key) {
+  ldb_slice_t filter;
+
+  if (!fr->full)
+    return 1;
+
+  if (fr->offset == fr->data) {
+    /* Empty filters do not match any keys. */
+    return 0;
+  }
 
+  ldb_slice_set(&filter, fr->data, fr->offset - fr->data);
+
+  return ldb_bloom_match(fr->policy, &filter, key);
+}
+
+static int
+ldb_filterreader_match_index(const ldb_filterreader_t *fr,
+                             uint64_t index,
+                             const ldb_slice_t *key) {
   if (index < fr->num) {
     uint32_t start = ldb_fixed32_decode(fr->offset + index * 4);
     uint32_t limit = ldb_fixed32_decode(fr->offset + index * 4 + 4);
@@ -188,3 +302,40 @@ ldb_filterreader_matches(const ldb_filterreader_t *fr,
 
   return 1; /* Errors are treated as potential matches. */
 }
+
+int
+ldb_filterreader_matches(const ldb_filterreader_t *fr,
+                         uint64_t block_offset,
+                         const ldb_slice_t *key) {
+  if (fr->full)
+    return ldb_filterreader_may_match(fr, key);
+
+  return ldb_filterreader_match_index(fr, block_offset >> fr->base_lg, key);
+}
+
+int
+ldb_filterreader_prefix_may_match(const ldb_filterreader_t *fr,
+                                  const ldb_slice_t *prefix) {
+  ldb_buffer_t key;
+  int ret = 0;
+  size_t i;
+
+  if (fr->data == NULL)
+    return 1; /* Errors are treated as potential matches. */
+
+  ldb_buffer_init(&key);
+
+  filter_prefix_key(&key, fr->policy, prefix);
+
+  if (fr->full) {
+    ret = ldb_filterreader_may_match(fr, &key);
+  } else {
+    /* The prefix may be in any of the per-block filters. */
+    for (i = 0; i < fr->num && !ret; i++)
+      ret = ldb_filterreader_match_index(fr, i, &key);
+  }
+
+  ldb_buffer_clear(&key);
+
+  return ret;
+}
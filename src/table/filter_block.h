@@ -23,6 +23,7 @@
  */
 
 struct ldb_bloom_s;
+struct ldb_prefix_s;
 
 /* A filter block builder is used to construct all of the filters for a
  * particular Table. It generates a single string which is stored as
@@ -30,13 +31,24 @@ struct ldb_bloom_s;
  *
  * The sequence of calls to filter block builder must match the regexp:
  *     (start_block add_key*)* finish
+ *
+ * A full filter builder ignores block boundaries and emits a single
+ * filter covering every key in the table.
+ *
+ * With a prefix extractor, each filter also covers the distinct
+ * prefixes of its keys. If the policy is an internal filter policy,
+ * keys are internal keys and prefixes are taken from their user keys.
  */
 typedef struct ldb_filterbuilder_s {
   const ldb_bloom_t *policy;
+  const struct ldb_prefix_s *prefix; /* May be NULL. */
+  int full;                   /* Whether to build one filter for the table. */
   ldb_buffer_t keys;          /* Flattened key contents. */
   ldb_array_t start;          /* Starting index in keys of each key (size_t). */
   ldb_buffer_t result;        /* Filter data computed so far. */
   ldb_array_t filter_offsets; /* Filter offsets (uint32_t). */
+  ldb_buffer_t last_prefix;   /* Last prefix added to the current filter. */
+  int has_prefix;             /* Whether last_prefix is set. */
 } ldb_filterbuilder_t;
 
 typedef struct ldb_filterreader_s {
@@ -45,6 +57,7 @@ typedef struct ldb_filterreader_s {
   const uint8_t *offset;  /* Pointer to beginning of offset array (at block-end). */
   size_t num;             /* Number of entries in offset array. */
   size_t base_lg;         /* Encoding parameter (see LDB_FILTER_BASE_LG in .c file). */
+  int full;               /* Whether the data is a single full filter. */
 } ldb_filterreader_t;
 
 /*
@@ -55,9 +68,18 @@ void
 ldb_filterbuilder_init(ldb_filterbuilder_t *fb,
                        const struct ldb_bloom_s *policy);
 
+void
+ldb_filterbuilder_init_full(ldb_filterbuilder_t *fb,
+                            const struct ldb_bloom_s *policy);
+
 void
 ldb_filterbuilder_clear(ldb_filterbuilder_t *fb);
 
+/* Also add the prefixes of keys. Must precede the first add_key. */
+void
+ldb_filterbuilder_set_prefix(ldb_filterbuilder_t *fb,
+                             const struct ldb_prefix_s *prefix);
+
 void
 ldb_filterbuilder_start_block(ldb_filterbuilder_t *fb, uint64_t block_offset);
 
@@ -77,9 +99,27 @@ ldb_filterreader_init(ldb_filterreader_t *fr,
                       const struct ldb_bloom_s *policy,
                       const ldb_slice_t *contents);
 
+/* Same as above, but for a block written by a full filter builder. */
+void
+ldb_filterreader_init_full(ldb_filterreader_t *fr,
+                           const struct ldb_bloom_s *policy,
+                           const ldb_slice_t *contents);
+
+/* Check the key against a full filter. Always true for
+   partitioned filters, which must be checked per block. */
+int
+ldb_filterreader_may_match(const ldb_filterreader_t *fr,
+                           const ldb_slice_t *key);
+
 int
 ldb_filterreader_matches(const ldb_filterreader_t *fr,
                          uint64_t block_offset,
                          const ldb_slice_t *key);
 
+/* Check whether any key with the given prefix may be present. Only
+   meaningful for filters built with a matching prefix extractor. */
+int
+ldb_filterreader_prefix_may_match(const ldb_filterreader_t *fr,
+                                  const ldb_slice_t *prefix);
+
 #endif /* LDB_FILTER_BLOCK_H */
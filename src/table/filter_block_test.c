@@ -19,6 +19,7 @@
 #include "../util/coding.h"
 #include "../util/extern.h"
 #include "../util/hash.h"
+#include "../util/prefix.h"
 #include "../util/slice.h"
 #include "../util/testutil.h"
 
@@ -228,6 +229,119 @@ test_multi_chunk(const ldb_bloom_t *policy) {
   ldb_filterbuilder_clear(&fb);
 }
 
+static void
+test_full_filter(const ldb_bloom_t *policy) {
+  ldb_filterbuilder_t fb;
+  ldb_filterreader_t fr;
+  ldb_slice_t block;
+  ldb_slice_t key;
+
+  /* Empty full filter. */
+  ldb_filterbuilder_init_full(&fb, policy);
+
+  block = ldb_filterbuilder_finish(&fb);
+
+  ASSERT(block.size == 0);
+
+  ldb_filterreader_init_full(&fr, policy, &block);
+
+  key = ldb_string("foo");
+  ASSERT(!ldb_filterreader_may_match(&fr, &key));
+  ASSERT(!ldb_filterreader_matches(&fr, 0, &key));
+
+  ldb_filterbuilder_clear(&fb);
+
+  /* Keys from every block land in the same filter. */
+  ldb_filterbuilder_init_full(&fb, policy);
+
+  ldb_filterbuilder_start_block(&fb, 0);
+  key = ldb_string("foo");
+  ldb_filterbuilder_add_key(&fb, &key);
+  ldb_filterbuilder_start_block(&fb, 3100);
+  key = ldb_string("bar");
+  ldb_filterbuilder_add_key(&fb, &key);
+  ldb_filterbuilder_start_block(&fb, 9000);
+  key = ldb_string("box");
+  ldb_filterbuilder_add_key(&fb, &key);
+
+  block = ldb_filterbuilder_finish(&fb);
+
+  ldb_filterreader_init_full(&fr, policy, &block);
+
+  key = ldb_string("foo");
+  ASSERT(ldb_filterreader_may_match(&fr, &key));
+  ASSERT(ldb_filterreader_matches(&fr, 9000, &key));
+  key = ldb_string("bar");
+  ASSERT(ldb_filterreader_may_match(&fr, &key));
+  key = ldb_string("box");
+  ASSERT(ldb_filterreader_may_match(&fr, &key));
+  ASSERT(ldb_filterreader_matches(&fr, 0, &key));
+  key = ldb_string("missing");
+  ASSERT(!ldb_filterreader_may_match(&fr, &key));
+  key = ldb_string("other");
+  ASSERT(!ldb_filterreader_matches(&fr, 0, &key));
+
+  /* Partitioned filters defer to the per-block check. */
+  ldb_filterreader_init(&fr, policy, &block);
+
+  key = ldb_string("missing");
+  ASSERT(ldb_filterreader_may_match(&fr, &key));
+
+  ldb_filterbuilder_clear(&fb);
+}
+
+static void
+test_prefix_filter(const ldb_bloom_t *policy, int full) {
+  ldb_prefix_t *prefix = ldb_prefix_create_fixed(3);
+  ldb_filterbuilder_t fb;
+  ldb_filterreader_t fr;
+  ldb_slice_t block;
+  ldb_slice_t key;
+
+  if (full)
+    ldb_filterbuilder_init_full(&fb, policy);
+  else
+    ldb_filterbuilder_init(&fb, policy);
+
+  ldb_filterbuilder_set_prefix(&fb, prefix);
+
+  ldb_filterbuilder_start_block(&fb, 0);
+  key = ldb_string("foo1");
+  ldb_filterbuilder_add_key(&fb, &key);
+  key = ldb_string("foo2");
+  ldb_filterbuilder_add_key(&fb, &key);
+  ldb_filterbuilder_start_block(&fb, 3100);
+  key = ldb_string("box1");
+  ldb_filterbuilder_add_key(&fb, &key);
+  key = ldb_string("x");
+  ldb_filterbuilder_add_key(&fb, &key);
+
+  block = ldb_filterbuilder_finish(&fb);
+
+  if (full)
+    ldb_filterreader_init_full(&fr, policy, &block);
+  else
+    ldb_filterreader_init(&fr, policy, &block);
+
+  key = ldb_string("foo");
+  ASSERT(ldb_filterreader_prefix_may_match(&fr, &key));
+  key = ldb_string("box");
+  ASSERT(ldb_filterreader_prefix_may_match(&fr, &key));
+  key = ldb_string("bar");
+  ASSERT(!ldb_filterreader_prefix_may_match(&fr, &key));
+  key = ldb_string("hel");
+  ASSERT(!ldb_filterreader_prefix_may_match(&fr, &key));
+
+  /* Whole keys are still present. */
+  key = ldb_string("foo2");
+  ASSERT(ldb_filterreader_matches(&fr, 0, &key));
+  key = ldb_string("x");
+  ASSERT(ldb_filterreader_matches(&fr, 3100, &key));
+
+  ldb_filterbuilder_clear(&fb);
+  ldb_prefix_destroy(prefix);
+}
+
 LDB_EXTERN int
 ldb_test_filter_block(void);
 
@@ -236,8 +350,14 @@ ldb_test_filter_block(void) {
   test_empty_builder(&bloom_test);
   test_single_chunk(&bloom_test);
   test_multi_chunk(&bloom_test);
+  test_full_filter(&bloom_test);
+  test_prefix_filter(&bloom_test, 0);
+  test_prefix_filter(&bloom_test, 1);
   test_empty_builder(ldb_bloom_default);
   test_single_chunk(ldb_bloom_default);
   test_multi_chunk(ldb_bloom_default);
+  test_full_filter(ldb_bloom_default);
+  test_prefix_filter(ldb_bloom_default, 0);
+  test_prefix_filter(ldb_bloom_default, 1);
   return 0;
 }
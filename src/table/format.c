@@ -13,6 +13,7 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "../util/buffer.h"
 #include "../util/coding.h"
@@ -163,42 +164,18 @@ ldb_safe_free(void *ptr) {
     ldb_free(ptr);
 }
 
-int
-ldb_read_block(ldb_blockcontents_t *result,
-               ldb_rfile_t *file,
-               const ldb_readopt_t *options,
-               const ldb_blockhandle_t *handle) {
-  ldb_slice_t contents;
-  const uint8_t *data;
-  uint8_t *buf = NULL;
-  size_t n, len;
-  int rc;
-
-  ldb_blockcontents_init(result);
-
-  /* Read the block contents as well as the type/crc footer. */
-  /* See table_builder.c for the code that built this structure. */
-  n = handle->size;
-  len = n + LDB_BLOCK_TRAILER_SIZE;
-
-  if (!ldb_rfile_mapped(file))
-    buf = ldb_malloc(len);
-
-  rc = ldb_rfile_pread(file, &contents, buf, len, handle->offset);
-
-  if (rc != LDB_OK) {
-    ldb_safe_free(buf);
-    return rc;
-  }
-
-  if (contents.size != len) {
-    ldb_safe_free(buf);
-    return LDB_IOERR; /* "truncated block read" */
-  }
-
+/* Check and decompress the "n" bytes of block contents (plus trailer)
+   at "data". If "data" is "buf", the heap buffer is handed over to
+   the result. Otherwise "data" lives while the file is open, unless
+   "transient" is set, in which case it must be copied. */
+static int
+decode_block(ldb_blockcontents_t *result,
+             const ldb_readopt_t *options,
+             const uint8_t *data,
+             size_t n,
+             uint8_t *buf,
+             int transient) {
   /* Check the crc of the type and the block contents. */
-  data = contents.data; /* Pointer to where Read put the data. */
-
   if (options->verify_checksums) {
     uint32_t crc = ldb_crc32c_unmask(ldb_fixed32_decode(data + n + 1));
     uint32_t actual = ldb_crc32c_value(data, n + 1);
@@ -211,7 +188,16 @@ ldb_read_block(ldb_blockcontents_t *result,
 
   switch (data[n]) {
     case LDB_NO_COMPRESSION: {
-      if (data != buf) {
+      if (data != buf && transient) {
+        /* Our caller is about to reuse the memory. */
+        uint8_t *copy = ldb_malloc(n + 1);
+
+        memcpy(copy, data, n);
+
+        ldb_slice_set(&result->data, copy, n);
+        result->heap_allocated = 1;
+        result->cachable = 1;
+      } else if (data != buf) {
         /* File implementation gave us pointer to some other data.
            Use it directly under the assumption that it will be live
            while the file is open. */
@@ -264,3 +250,180 @@ ldb_read_block(ldb_blockcontents_t *result,
 
   return LDB_OK;
 }
+
+int
+ldb_read_block(ldb_blockcontents_t *result,
+               ldb_rfile_t *file,
+               const ldb_readopt_t *options,
+               const ldb_blockhandle_t *handle) {
+  ldb_slice_t contents;
+  uint8_t *buf = NULL;
+  size_t n, len;
+  int rc;
+
+  ldb_blockcontents_init(result);
+
+  /* Read the block contents as well as the type/crc footer. */
+  /* See table_builder.c for the code that built this structure. */
+  n = handle->size;
+  len = n + LDB_BLOCK_TRAILER_SIZE;
+
+  if (!ldb_rfile_mapped(file))
+    buf = ldb_malloc(len);
+
+  rc = ldb_rfile_pread(file, &contents, buf, len, handle->offset);
+
+  if (rc != LDB_OK) {
+    ldb_safe_free(buf);
+    return rc;
+  }
+
+  if (contents.size != len) {
+    ldb_safe_free(buf);
+    return LDB_IOERR; /* "truncated block read" */
+  }
+
+  /* Pointer to where Read put the data. */
+  return decode_block(result, options, contents.data, n, buf, 0);
+}
+
+void
+ldb_read_blocks(ldb_blockcontents_t *results,
+                int *statuses,
+                ldb_rfile_t *file,
+                const ldb_readopt_t *options,
+                const ldb_blockhandle_t *handles,
+                size_t count) {
+  ldb_readreq_t *reqs;
+  size_t i;
+
+  if (count == 1 || ldb_rfile_mapped(file)) {
+    for (i = 0; i < count; i++)
+      statuses[i] = ldb_read_block(&results[i], file, options, &handles[i]);
+
+    return;
+  }
+
+  reqs = ldb_malloc(count * sizeof(ldb_readreq_t));
+
+  for (i = 0; i < count; i++) {
+    ldb_readreq_t *req = &reqs[i];
+
+    req->offset = handles[i].offset;
+    req->count = handles[i].size + LDB_BLOCK_TRAILER_SIZE;
+    req->buf = ldb_malloc(req->count);
+  }
+
+  ldb_rfile_multiread(file, reqs, count);
+
+  for (i = 0; i < count; i++) {
+    ldb_readreq_t *req = &reqs[i];
+
+    ldb_blockcontents_init(&results[i]);
+
+    if (req->status != LDB_OK) {
+      ldb_free(req->buf);
+      statuses[i] = req->status;
+    } else if (req->result.size != req->count) {
+      ldb_free(req->buf);
+      statuses[i] = LDB_IOERR; /* "truncated block read" */
+    } else {
+      statuses[i] = decode_block(&results[i],
+                                 options,
+                                 req->result.data,
+                                 handles[i].size,
+                                 req->buf,
+                                 0);
+    }
+  }
+
+  ldb_free(reqs);
+}
+
+/*
+ * Readahead
+ */
+
+void
+ldb_readahead_init(ldb_readahead_t *ra) {
+  ra->data = NULL;
+  ra->alloc = 0;
+  ra->offset = 0;
+  ra->size = 0;
+  ra->next = ~UINT64_C(0);
+  ra->window = 0;
+}
+
+void
+ldb_readahead_clear(ldb_readahead_t *ra) {
+  if (ra->data != NULL)
+    ldb_free(ra->data);
+
+  ldb_readahead_init(ra);
+}
+
+int
+ldb_read_block_ahead(ldb_blockcontents_t *result,
+                     ldb_rfile_t *file,
+                     const ldb_readopt_t *options,
+                     const ldb_blockhandle_t *handle,
+                     ldb_readahead_t *ra) {
+  uint64_t offset = handle->offset;
+  size_t n = handle->size;
+  size_t len = n + LDB_BLOCK_TRAILER_SIZE;
+  ldb_slice_t contents;
+  int sequential;
+  size_t want;
+  int rc;
+
+  if (ldb_rfile_mapped(file))
+    return ldb_read_block(result, file, options, handle);
+
+  /* Blocks a little past the last one read still count as sequential:
+     the ones in between may have been served by the block cache. */
+  sequential = (offset >= ra->next && offset - ra->next <= LDB_READAHEAD_MAX);
+
+  ra->next = offset + len;
+
+  if (!sequential) {
+    ra->window = 0;
+    return ldb_read_block(result, file, options, handle);
+  }
+
+  if (offset < ra->offset || offset + len > ra->offset + ra->size) {
+    /* Each read ahead is twice the size of the last. */
+    if (ra->window == 0)
+      ra->window = LDB_READAHEAD_MIN;
+    else if (ra->window < LDB_READAHEAD_MAX)
+      ra->window *= 2;
+
+    want = LDB_MAX(len, ra->window);
+
+    if (want > ra->alloc) {
+      if (ra->data != NULL)
+        ldb_free(ra->data);
+
+      ra->data = ldb_malloc(want);
+      ra->alloc = want;
+    }
+
+    ra->offset = offset;
+    ra->size = 0;
+
+    rc = ldb_rfile_pread(file, &contents, ra->data, want, offset);
+
+    if (rc != LDB_OK)
+      return rc;
+
+    /* Reads past the end of the file come up short. */
+    ra->size = contents.size;
+
+    if (contents.size < len)
+      return LDB_IOERR; /* "truncated block read" */
+  }
+
+  ldb_blockcontents_init(result);
+
+  return decode_block(result, options, ra->data + (offset - ra->offset),
+                      n, NULL, 1);
+}
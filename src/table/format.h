@@ -38,6 +38,10 @@
    and taking the leading 64 bits. */
 #define LDB_TABLE_MAGIC UINT64_C(0xdb4775248b80fb57) /* kTableMagicNumber */
 
+/* Bounds on the size of reads issued ahead of a sequential scan. */
+#define LDB_READAHEAD_MIN (8 << 10)
+#define LDB_READAHEAD_MAX (256 << 10)
+
 /*
  * Types
  */
@@ -65,6 +69,16 @@ typedef struct ldb_blockcontents_s {
   int heap_allocated;  /* True iff caller should free() data.data. */
 } ldb_blockcontents_t;
 
+/* Readahead state for a scan over the blocks of a single file. */
+typedef struct ldb_readahead_s {
+  uint8_t *data;
+  size_t alloc;
+  uint64_t offset;     /* File offset of data[0]. */
+  size_t size;         /* Bytes of file contents held in data. */
+  uint64_t next;       /* Offset just past the last block requested. */
+  size_t window;       /* Size of the next read; zero when not sequential. */
+} ldb_readahead_t;
+
 /*
  * Block Handle
  */
@@ -123,4 +137,36 @@ ldb_read_block(ldb_blockcontents_t *result,
                const struct ldb_readopt_s *options,
                const ldb_blockhandle_t *handle);
 
+/* Read "count" blocks at once. The outcome of each read is
+   stored in "results" and "statuses". Reads are issued as a
+   batch when the environment supports it. */
+void
+ldb_read_blocks(ldb_blockcontents_t *results,
+                int *statuses,
+                struct ldb_rfile_s *file,
+                const struct ldb_readopt_s *options,
+                const ldb_blockhandle_t *handles,
+                size_t count);
+
+/*
+ * Readahead
+ */
+
+void
+ldb_readahead_init(ldb_readahead_t *ra);
+
+void
+ldb_readahead_clear(ldb_readahead_t *ra);
+
+/* Same as ldb_read_block(), but once blocks are being requested in
+   ascending order, reads of growing size (up to LDB_READAHEAD_MAX)
+   are issued into "ra" and later blocks are served from there. Has
+   no effect on memory-mapped files. */
+int
+ldb_read_block_ahead(ldb_blockcontents_t *result,
+                     struct ldb_rfile_s *file,
+                     const struct ldb_readopt_s *options,
+                     const ldb_blockhandle_t *handle,
+                     ldb_readahead_t *ra);
+
 #endif /* LDB_TABLE_FORMAT_H */
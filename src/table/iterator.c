@@ -19,31 +19,90 @@
 #include "iterator.h"
 
 /*
- * Iterator
+ * Cleanup
  */
 
-static void
-ldb_iter_init(ldb_iter_t *iter, void *ptr, const ldb_itertbl_t *table) {
-  iter->ptr = ptr;
-  iter->cleanup_head.func = NULL;
-  iter->cleanup_head.next = NULL;
-  iter->table = table;
+void
+ldb_cleanup_init(ldb_cleanup_t *head) {
+  head->func = NULL;
+  head->arg1 = NULL;
+  head->arg2 = NULL;
+  head->next = NULL;
 }
 
-static void
-ldb_iter_clear(ldb_iter_t *iter) {
-  if (!ldb_cleanup_empty(&iter->cleanup_head)) {
+void
+ldb_cleanup_clear(ldb_cleanup_t *head) {
+  if (!ldb_cleanup_empty(head)) {
     ldb_cleanup_t *node, *next;
 
-    ldb_cleanup_run(&iter->cleanup_head);
+    ldb_cleanup_run(head);
 
-    for (node = iter->cleanup_head.next; node != NULL; node = next) {
+    for (node = head->next; node != NULL; node = next) {
       next = node->next;
       ldb_cleanup_run(node);
       ldb_free(node);
     }
   }
 
+  ldb_cleanup_init(head);
+}
+
+void
+ldb_cleanup_push(ldb_cleanup_t *head,
+                 ldb_cleanup_f func,
+                 void *arg1,
+                 void *arg2) {
+  ldb_cleanup_t *node;
+
+  if (ldb_cleanup_empty(head)) {
+    node = head;
+  } else {
+    node = ldb_malloc(sizeof(ldb_cleanup_t));
+    node->next = head->next;
+    head->next = node;
+  }
+
+  node->func = func;
+  node->arg1 = arg1;
+  node->arg2 = arg2;
+}
+
+void
+ldb_cleanup_move(ldb_cleanup_t *z, ldb_cleanup_t *x) {
+  ldb_cleanup_t *tail;
+
+  if (ldb_cleanup_empty(x))
+    return;
+
+  ldb_cleanup_push(z, x->func, x->arg1, x->arg2);
+
+  if (x->next != NULL) {
+    for (tail = x->next; tail->next != NULL; tail = tail->next)
+      ;
+
+    tail->next = z->next;
+    z->next = x->next;
+  }
+
+  ldb_cleanup_init(x);
+}
+
+/*
+ * Iterator
+ */
+
+static void
+ldb_iter_init(ldb_iter_t *iter, void *ptr, const ldb_itertbl_t *table) {
+  iter->ptr = ptr;
+  iter->table = table;
+
+  ldb_cleanup_init(&iter->cleanup_head);
+}
+
+static void
+ldb_iter_clear(ldb_iter_t *iter) {
+  ldb_cleanup_clear(&iter->cleanup_head);
+
   iter->table->clear(iter->ptr);
 
   ldb_free(iter->ptr);
@@ -67,19 +126,12 @@ ldb_iter_register_cleanup(ldb_iter_t *iter,
                           ldb_cleanup_f func,
                           void *arg1,
                           void *arg2) {
-  ldb_cleanup_t *node;
-
-  if (ldb_cleanup_empty(&iter->cleanup_head)) {
-    node = &iter->cleanup_head;
-  } else {
-    node = ldb_malloc(sizeof(ldb_cleanup_t));
-    node->next = iter->cleanup_head.next;
-    iter->cleanup_head.next = node;
-  }
+  ldb_cleanup_push(&iter->cleanup_head, func, arg1, arg2);
+}
 
-  node->func = func;
-  node->arg1 = arg1;
-  node->arg2 = arg2;
+void
+ldb_iter_move_cleanup(ldb_iter_t *iter, ldb_cleanup_t *head) {
+  ldb_cleanup_move(head, &iter->cleanup_head);
 }
 
 /*
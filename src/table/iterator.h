@@ -179,6 +179,23 @@ static const ldb_itertbl_t name ## _table = {                  \
 /* Invokes the cleanup function. */
 #define ldb_cleanup_run(x) (x)->func((x)->arg1, (x)->arg2)
 
+void
+ldb_cleanup_init(ldb_cleanup_t *head);
+
+/* Invokes and removes every cleanup function in the list. */
+void
+ldb_cleanup_clear(ldb_cleanup_t *head);
+
+void
+ldb_cleanup_push(ldb_cleanup_t *head,
+                 ldb_cleanup_f func,
+                 void *arg1,
+                 void *arg2);
+
+/* Moves every cleanup function from x to z. */
+void
+ldb_cleanup_move(ldb_cleanup_t *z, ldb_cleanup_t *x);
+
 /*
  * Iterator
  */
@@ -205,6 +222,11 @@ ldb_iter_register_cleanup(ldb_iter_t *iter,
                           void *arg1,
                           void *arg2);
 
+/* Hands the iterator's cleanup functions over to "head", keeping
+   whatever they release alive after the iterator is destroyed. */
+void
+ldb_iter_move_cleanup(ldb_iter_t *iter, ldb_cleanup_t *head);
+
 /*
  * Empty Iterator
  */
@@ -36,11 +36,14 @@ enum ldb_direction {
  */
 
 typedef struct ldb_mergeiter_s {
-  /* We might want to use a heap in case there are lots of children.
-     For now we use a simple array since we expect a very small number
-     of children in leveldb. */
+  /* The valid children are kept in a binary heap ordered by the
+     current direction (a min-heap when moving forward, a max-heap
+     when moving in reverse), so that advancing costs O(log n)
+     comparisons rather than a scan of every child. */
   const ldb_comparator_t *comparator;
   ldb_wrapiter_t *children;
+  ldb_wrapiter_t **heap;
+  int length;
   int n;
   ldb_wrapiter_t *current;
   enum ldb_direction direction;
@@ -55,6 +58,8 @@ ldb_mergeiter_init(ldb_mergeiter_t *mi,
 
   mi->comparator = comparator;
   mi->children = ldb_malloc(n * sizeof(ldb_wrapiter_t));
+  mi->heap = ldb_malloc(n * sizeof(ldb_wrapiter_t *));
+  mi->length = 0;
   mi->n = n;
   mi->current = NULL;
   mi->direction = LDB_FORWARD;
@@ -71,6 +76,7 @@ ldb_mergeiter_clear(ldb_mergeiter_t *mi) {
     ldb_wrapiter_clear(&mi->children[i]);
 
   ldb_free(mi->children);
+  ldb_free(mi->heap);
 }
 
 static int
@@ -103,52 +109,80 @@ ldb_mergeiter_status(const ldb_mergeiter_t *mi) {
   return rc;
 }
 
+/* Whether child "x" should be yielded before child "y" in the current
+   direction. Equal keys are yielded in child order when moving forward
+   and in reverse child order otherwise (matching a linear scan). */
+static int
+ldb_mergeiter_before(const ldb_mergeiter_t *mi,
+                     const ldb_wrapiter_t *x,
+                     const ldb_wrapiter_t *y) {
+  ldb_slice_t xk = ldb_wrapiter_key(x);
+  ldb_slice_t yk = ldb_wrapiter_key(y);
+  int cmp = ldb_compare(mi->comparator, &xk, &yk);
+
+  if (mi->direction == LDB_FORWARD)
+    return cmp < 0 || (cmp == 0 && x < y);
+
+  return cmp > 0 || (cmp == 0 && x > y);
+}
+
 static void
-ldb_mergeiter_find_smallest(ldb_mergeiter_t *mi) {
-  ldb_wrapiter_t *smallest = NULL;
-  int i;
+ldb_mergeiter_sift_down(ldb_mergeiter_t *mi, int i) {
+  ldb_wrapiter_t **heap = mi->heap;
+  ldb_wrapiter_t *item = heap[i];
+  int len = mi->length;
 
-  for (i = 0; i < mi->n; i++) {
-    ldb_wrapiter_t *child = &mi->children[i];
+  for (;;) {
+    int child = 2 * i + 1;
 
-    if (ldb_wrapiter_valid(child)) {
-      if (smallest == NULL) {
-        smallest = child;
-      } else {
-        ldb_slice_t child_key = ldb_wrapiter_key(child);
-        ldb_slice_t smallest_key = ldb_wrapiter_key(smallest);
+    if (child >= len)
+      break;
 
-        if (ldb_compare(mi->comparator, &child_key, &smallest_key) < 0)
-          smallest = child;
-      }
+    if (child + 1 < len && ldb_mergeiter_before(mi, heap[child + 1],
+                                                    heap[child])) {
+      child += 1;
     }
+
+    if (!ldb_mergeiter_before(mi, heap[child], item))
+      break;
+
+    heap[i] = heap[child];
+    i = child;
   }
 
-  mi->current = smallest;
+  heap[i] = item;
 }
 
+/* Rebuild the heap from all valid children. */
 static void
-ldb_mergeiter_find_largest(ldb_mergeiter_t *mi) {
-  ldb_wrapiter_t *largest = NULL;
+ldb_mergeiter_heapify(ldb_mergeiter_t *mi) {
   int i;
 
-  for (i = mi->n - 1; i >= 0; i--) {
-    ldb_wrapiter_t *child = &mi->children[i];
-
-    if (ldb_wrapiter_valid(child)) {
-      if (largest == NULL) {
-        largest = child;
-      } else {
-        ldb_slice_t child_key = ldb_wrapiter_key(child);
-        ldb_slice_t largest_key = ldb_wrapiter_key(largest);
+  mi->length = 0;
 
-        if (ldb_compare(mi->comparator, &child_key, &largest_key) > 0)
-          largest = child;
-      }
-    }
+  for (i = 0; i < mi->n; i++) {
+    if (ldb_wrapiter_valid(&mi->children[i]))
+      mi->heap[mi->length++] = &mi->children[i];
   }
 
-  mi->current = largest;
+  for (i = mi->length / 2 - 1; i >= 0; i--)
+    ldb_mergeiter_sift_down(mi, i);
+
+  mi->current = mi->length > 0 ? mi->heap[0] : NULL;
+}
+
+/* Restore the heap after the top child has moved. */
+static void
+ldb_mergeiter_update_top(ldb_mergeiter_t *mi) {
+  assert(mi->length > 0);
+
+  if (!ldb_wrapiter_valid(mi->heap[0]))
+    mi->heap[0] = mi->heap[--mi->length];
+
+  if (mi->length > 1)
+    ldb_mergeiter_sift_down(mi, 0);
+
+  mi->current = mi->length > 0 ? mi->heap[0] : NULL;
 }
 
 static void
@@ -158,9 +192,9 @@ ldb_mergeiter_seek_first(ldb_mergeiter_t *mi) {
   for (i = 0; i < mi->n; i++)
     ldb_wrapiter_seek_first(&mi->children[i]);
 
-  ldb_mergeiter_find_smallest(mi);
-
   mi->direction = LDB_FORWARD;
+
+  ldb_mergeiter_heapify(mi);
 }
 
 static void
@@ -170,9 +204,9 @@ ldb_mergeiter_seek_last(ldb_mergeiter_t *mi) {
   for (i = 0; i < mi->n; i++)
     ldb_wrapiter_seek_last(&mi->children[i]);
 
-  ldb_mergeiter_find_largest(mi);
-
   mi->direction = LDB_REVERSE;
+
+  ldb_mergeiter_heapify(mi);
 }
 
 static void
@@ -182,9 +216,9 @@ ldb_mergeiter_seek(ldb_mergeiter_t *mi, const ldb_slice_t *target) {
   for (i = 0; i < mi->n; i++)
     ldb_wrapiter_seek(&mi->children[i], target);
 
-  ldb_mergeiter_find_smallest(mi);
-
   mi->direction = LDB_FORWARD;
+
+  ldb_mergeiter_heapify(mi);
 }
 
 static void
@@ -197,14 +231,13 @@ ldb_mergeiter_next(ldb_mergeiter_t *mi) {
      the smallest child and key() == current->key(). Otherwise,
      we explicitly position the non-current children. */
   if (mi->direction != LDB_FORWARD) {
+    ldb_slice_t mi_key = ldb_mergeiter_key(mi);
     int i;
 
     for (i = 0; i < mi->n; i++) {
       ldb_wrapiter_t *child = &mi->children[i];
 
       if (child != mi->current) {
-        ldb_slice_t mi_key = ldb_mergeiter_key(mi);
-
         ldb_wrapiter_seek(child, &mi_key);
 
         if (ldb_wrapiter_valid(child)) {
@@ -216,11 +249,17 @@ ldb_mergeiter_next(ldb_mergeiter_t *mi) {
       }
     }
 
+    ldb_wrapiter_next(mi->current);
+
     mi->direction = LDB_FORWARD;
+
+    ldb_mergeiter_heapify(mi);
+
+    return;
   }
 
   ldb_wrapiter_next(mi->current);
-  ldb_mergeiter_find_smallest(mi);
+  ldb_mergeiter_update_top(mi);
 }
 
 static void
@@ -233,14 +272,13 @@ ldb_mergeiter_prev(ldb_mergeiter_t *mi) {
      the largest child and key() == current->key(). Otherwise,
      we explicitly position the non-current children. */
   if (mi->direction != LDB_REVERSE) {
+    ldb_slice_t mi_key = ldb_mergeiter_key(mi);
     int i;
 
     for (i = 0; i < mi->n; i++) {
       ldb_wrapiter_t *child = &mi->children[i];
 
       if (child != mi->current) {
-        ldb_slice_t mi_key = ldb_mergeiter_key(mi);
-
         ldb_wrapiter_seek(child, &mi_key);
 
         if (ldb_wrapiter_valid(child)) {
@@ -253,11 +291,17 @@ ldb_mergeiter_prev(ldb_mergeiter_t *mi) {
       }
     }
 
+    ldb_wrapiter_prev(mi->current);
+
     mi->direction = LDB_REVERSE;
+
+    ldb_mergeiter_heapify(mi);
+
+    return;
   }
 
   ldb_wrapiter_prev(mi->current);
-  ldb_mergeiter_find_largest(mi);
+  ldb_mergeiter_update_top(mi);
 }
 
 LDB_ITERATOR_FUNCTIONS(ldb_mergeiter);
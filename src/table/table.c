@@ -21,8 +21,11 @@
 #include "../util/env.h"
 #include "../util/internal.h"
 #include "../util/options.h"
+#include "../util/port.h"
+#include "../util/prefix.h"
 #include "../util/slice.h"
 #include "../util/status.h"
+#include "../util/thread_pool.h"
 
 #include "block.h"
 #include "filter_block.h"
@@ -42,6 +45,7 @@ struct ldb_table_s {
   uint64_t cache_id;
   ldb_filterreader_t *filter;
   const uint8_t *filter_data;
+  int prefix_filter; /* Whether the filter holds our extractor's prefixes. */
   ldb_blockhandle_t metaindex_handle; /* Handle to metaindex_block: saved from footer. */
   ldb_block_t *index_block;
 };
@@ -64,7 +68,8 @@ ldb_table_clear(ldb_table_t *table) {
 
 static void
 ldb_table_read_filter(ldb_table_t *table,
-                      const ldb_slice_t *filter_handle_value) {
+                      const ldb_slice_t *filter_handle_value,
+                      int full) {
   ldb_readopt_t opt = *ldb_readopt_default;
   ldb_blockhandle_t filter_handle;
   ldb_blockcontents_t block;
@@ -91,9 +96,34 @@ ldb_table_read_filter(ldb_table_t *table,
 
   table->filter = ldb_malloc(sizeof(ldb_filterreader_t));
 
-  ldb_filterreader_init(table->filter,
-                        table->options.filter_policy,
-                        &block.data);
+  if (full) {
+    ldb_filterreader_init_full(table->filter,
+                               table->options.filter_policy,
+                               &block.data);
+  } else {
+    ldb_filterreader_init(table->filter,
+                          table->options.filter_policy,
+                          &block.data);
+  }
+}
+
+static int
+ldb_table_find_meta(ldb_iter_t *iter, const char *name, ldb_slice_t *value) {
+  ldb_slice_t key;
+
+  ldb_slice_set_str(&key, name);
+  ldb_iter_seek(iter, &key);
+
+  if (ldb_iter_valid(iter)) {
+    ldb_slice_t iter_key = ldb_iter_key(iter);
+
+    if (ldb_slice_equal(&iter_key, &key)) {
+      *value = ldb_iter_value(iter);
+      return 1;
+    }
+  }
+
+  return 0;
 }
 
 static void
@@ -101,20 +131,27 @@ ldb_table_read_meta(ldb_table_t *table, const ldb_footer_t *footer) {
   ldb_readopt_t opt = *ldb_readopt_default;
   ldb_blockcontents_t contents;
   ldb_block_t *meta;
-  ldb_iter_t *iter;
-  ldb_slice_t key;
+  const ldb_bloom_t *policy = table->options.filter_policy;
+  ldb_slice_t iter_value;
+  char full_name[76];
   char name[72];
+  ldb_iter_t *iter;
+  int has_full;
   int rc;
 
-  if (table->options.filter_policy == NULL)
+  if (policy == NULL)
     return; /* Do not need any metadata. */
 
   if (table->options.paranoid_checks)
     opt.verify_checksums = 1;
 
-  if (!ldb_bloom_name(name, sizeof(name), table->options.filter_policy))
+  if (!ldb_bloom_name(name, sizeof(name), policy))
     return;
 
+  /* Tables written with a partitioned filter are still readable
+     even if the full filter's name cannot be formed. */
+  has_full = ldb_bloom_full_name(full_name, sizeof(full_name), policy);
+
   rc = ldb_read_block(&contents,
                       table->file,
                       &opt,
@@ -128,16 +165,20 @@ ldb_table_read_meta(ldb_table_t *table, const ldb_footer_t *footer) {
   meta = ldb_block_create(&contents);
   iter = ldb_blockiter_create(meta, ldb_bytewise_comparator);
 
-  ldb_slice_set_str(&key, name);
-  ldb_iter_seek(iter, &key);
+  /* A table carries either a full filter or a partitioned one,
+     depending on the options it was written with. */
+  if (has_full && ldb_table_find_meta(iter, full_name, &iter_value))
+    ldb_table_read_filter(table, &iter_value, 1);
+  else if (ldb_table_find_meta(iter, name, &iter_value))
+    ldb_table_read_filter(table, &iter_value, 0);
 
-  if (ldb_iter_valid(iter)) {
-    ldb_slice_t iter_key = ldb_iter_key(iter);
+  /* Prefixes are only usable if the table was
+     written with the extractor we are using. */
+  if (table->filter != NULL && table->options.prefix_extractor != NULL) {
+    const ldb_prefix_t *prefix = table->options.prefix_extractor;
 
-    if (ldb_slice_equal(&iter_key, &key)) {
-      ldb_slice_t iter_value = ldb_iter_value(iter);
-      ldb_table_read_filter(table, &iter_value);
-    }
+    if (ldb_prefix_name(name, sizeof(name), prefix))
+      table->prefix_filter = ldb_table_find_meta(iter, name, &iter_value);
   }
 
   ldb_iter_destroy(iter);
@@ -197,6 +238,7 @@ ldb_table_open(const ldb_dbopt_t *options,
     tbl->cache_id = 0;
     tbl->filter_data = NULL;
     tbl->filter = NULL;
+    tbl->prefix_filter = 0;
 
     if (options->block_cache != NULL)
       tbl->cache_id = ldb_lru_newid(options->block_cache);
@@ -237,13 +279,171 @@ release_block(void *arg, void *h) {
   ldb_lru_release(cache, handle);
 }
 
+/*
+ * Table Scan
+ */
+
+/* Maximum number of blocks a scan reads ahead in the background. */
+#define LDB_PREFETCH_MAX 16
+
+enum ldb_slot_state { LDB_SLOT_EMPTY, LDB_SLOT_PENDING, LDB_SLOT_READY };
+
+/* A block being read ahead of a forward scan. */
+typedef struct ldb_prefetch_s {
+  ldb_blockhandle_t handle;
+  ldb_blockcontents_t contents;
+  enum ldb_slot_state state;
+  int status;
+} ldb_prefetch_t;
+
+/* Per-iterator state: readahead for sequential scans,
+   and blocks read ahead of a forward scan on "pool". */
+typedef struct ldb_tablescan_s {
+  const ldb_table_t *table;
+  ldb_readopt_t options;
+  ldb_readahead_t ra;
+  ldb_pool_t *pool;
+  ldb_iter_t *index_iter; /* Used to find the blocks to read ahead. */
+  ldb_mutex_t mutex;
+  ldb_cond_t cond;
+  ldb_prefetch_t *slots;  /* Guarded by mutex. */
+  int length;
+  int pending;            /* Guarded by mutex. */
+} ldb_tablescan_t;
+
+/* A set of slots filled by a single background job. */
+typedef struct ldb_prefetchjob_s {
+  ldb_tablescan_t *scan;
+  ldb_prefetch_t *slots[LDB_PREFETCH_MAX];
+  int length;
+} ldb_prefetchjob_t;
+
+static void
+block_cache_key(uint8_t *buf, const ldb_table_t *table, uint64_t offset) {
+  ldb_fixed64_write(buf + 0, table->cache_id);
+  ldb_fixed64_write(buf + 8, offset);
+}
+
+static void
+contents_clear(ldb_blockcontents_t *contents) {
+  if (contents->heap_allocated)
+    ldb_free((void *)contents->data.data);
+
+  ldb_blockcontents_init(contents);
+}
+
+static void
+prefetch_work(void *arg) {
+  ldb_prefetchjob_t *job = (ldb_prefetchjob_t *)arg;
+  ldb_tablescan_t *scan = job->scan;
+  ldb_blockcontents_t contents[LDB_PREFETCH_MAX];
+  ldb_blockhandle_t handles[LDB_PREFETCH_MAX];
+  int statuses[LDB_PREFETCH_MAX];
+  int i;
+
+  /* Slot handles are not modified while a read is pending. */
+  for (i = 0; i < job->length; i++)
+    handles[i] = job->slots[i]->handle;
+
+  ldb_read_blocks(contents,
+                  statuses,
+                  scan->table->file,
+                  &scan->options,
+                  handles,
+                  job->length);
+
+  ldb_mutex_lock(&scan->mutex);
+
+  for (i = 0; i < job->length; i++) {
+    ldb_prefetch_t *slot = job->slots[i];
+
+    slot->contents = contents[i];
+    slot->status = statuses[i];
+    slot->state = LDB_SLOT_READY;
+  }
+
+  scan->pending -= job->length;
+
+  ldb_cond_broadcast(&scan->cond);
+
+  ldb_mutex_unlock(&scan->mutex);
+
+  ldb_free(job);
+}
+
+/* Take the block at "handle" if it was read ahead, waiting for
+   the read to complete if need be. */
+static int
+tablescan_take(ldb_tablescan_t *scan,
+               const ldb_blockhandle_t *handle,
+               ldb_blockcontents_t *contents,
+               int *status) {
+  int found = 0;
+  int i;
+
+  if (scan->length == 0)
+    return 0;
+
+  ldb_mutex_lock(&scan->mutex);
+
+  for (i = 0; i < scan->length; i++) {
+    ldb_prefetch_t *slot = &scan->slots[i];
+
+    if (slot->state == LDB_SLOT_EMPTY)
+      continue;
+
+    if (slot->handle.offset != handle->offset)
+      continue;
+
+    while (slot->state == LDB_SLOT_PENDING)
+      ldb_cond_wait(&scan->cond, &scan->mutex);
+
+    *contents = slot->contents;
+    *status = slot->status;
+
+    ldb_blockcontents_init(&slot->contents);
+
+    slot->state = LDB_SLOT_EMPTY;
+
+    found = 1;
+
+    break;
+  }
+
+  ldb_mutex_unlock(&scan->mutex);
+
+  return found;
+}
+
+static int
+table_read_block(const ldb_table_t *table,
+                 const ldb_readopt_t *options,
+                 const ldb_blockhandle_t *handle,
+                 ldb_tablescan_t *scan,
+                 ldb_blockcontents_t *contents) {
+  int rc;
+
+  if (scan == NULL)
+    return ldb_read_block(contents, table->file, options, handle);
+
+  if (tablescan_take(scan, handle, contents, &rc))
+    return rc;
+
+  return ldb_read_block_ahead(contents,
+                              table->file,
+                              options,
+                              handle,
+                              &scan->ra);
+}
+
 /* Convert an index iterator value (i.e., an encoded BlockHandle)
-   into an iterator over the contents of the corresponding block. */
+   into an iterator over the contents of the corresponding block.
+   Reads go through "scan" if it is non-NULL. */
 static ldb_iter_t *
-ldb_table_blockreader(void *arg,
-                      const ldb_readopt_t *options,
-                      const ldb_slice_t *index_value) {
-  ldb_table_t *table = (ldb_table_t *)arg;
+table_blockreader(const ldb_table_t *table,
+                  const ldb_readopt_t *options,
+                  const ldb_slice_t *index_value,
+                  ldb_tablescan_t *scan) {
   ldb_lru_t *block_cache = table->options.block_cache;
   ldb_block_t *block = NULL;
   ldb_lruhandle_t *cache_handle = NULL;
@@ -264,8 +464,7 @@ ldb_table_blockreader(void *arg,
       uint8_t cache_key_buffer[16];
       ldb_slice_t key;
 
-      ldb_fixed64_write(cache_key_buffer + 0, table->cache_id);
-      ldb_fixed64_write(cache_key_buffer + 8, handle.offset);
+      block_cache_key(cache_key_buffer, table, handle.offset);
 
       ldb_slice_set(&key, cache_key_buffer, sizeof(cache_key_buffer));
 
@@ -274,7 +473,7 @@ ldb_table_blockreader(void *arg,
       if (cache_handle != NULL) {
         block = (ldb_block_t *)ldb_lru_value(cache_handle);
       } else {
-        rc = ldb_read_block(&contents, table->file, options, &handle);
+        rc = table_read_block(table, options, &handle, scan, &contents);
 
         if (rc == LDB_OK) {
           block = ldb_block_create(&contents);
@@ -289,7 +488,7 @@ ldb_table_blockreader(void *arg,
         }
       }
     } else {
-      rc = ldb_read_block(&contents, table->file, options, &handle);
+      rc = table_read_block(table, options, &handle, scan, &contents);
 
       if (rc == LDB_OK)
         block = ldb_block_create(&contents);
@@ -310,28 +509,249 @@ ldb_table_blockreader(void *arg,
   return iter;
 }
 
+static ldb_iter_t *
+ldb_table_blockreader(void *arg,
+                      const ldb_readopt_t *options,
+                      const ldb_slice_t *index_value) {
+  return table_blockreader(arg, options, index_value, NULL);
+}
+
+static ldb_iter_t *
+ldb_tablescan_blockreader(void *arg,
+                          const ldb_readopt_t *options,
+                          const ldb_slice_t *index_value) {
+  ldb_tablescan_t *scan = (ldb_tablescan_t *)arg;
+  return table_blockreader(scan->table, options, index_value, scan);
+}
+
+static int
+is_cached(const ldb_table_t *table, const ldb_blockhandle_t *handle) {
+  ldb_lru_t *block_cache = table->options.block_cache;
+  ldb_lruhandle_t *cache_handle;
+  uint8_t buf[16];
+  ldb_slice_t key;
+
+  if (block_cache == NULL)
+    return 0;
+
+  block_cache_key(buf, table, handle->offset);
+
+  ldb_slice_set(&key, buf, sizeof(buf));
+
+  cache_handle = ldb_lru_lookup(block_cache, &key);
+
+  if (cache_handle == NULL)
+    return 0;
+
+  ldb_lru_release(block_cache, cache_handle);
+
+  return 1;
+}
+
+/* Read the blocks following the one at "index_key" in the background. */
+static void
+ldb_tablescan_prefetch(void *arg,
+                       const ldb_readopt_t *options,
+                       const ldb_slice_t *index_key) {
+  ldb_tablescan_t *scan = (ldb_tablescan_t *)arg;
+  const ldb_table_t *table = scan->table;
+  ldb_blockhandle_t ahead[LDB_PREFETCH_MAX];
+  ldb_prefetch_t *work[LDB_PREFETCH_MAX];
+  ldb_prefetchjob_t *job;
+  int n = 0, count = 0;
+  int i, j;
+
+  (void)options;
+
+  if (scan->index_iter == NULL) {
+    scan->index_iter = ldb_blockiter_create(table->index_block,
+                                            table->options.comparator);
+  }
+
+  ldb_iter_seek(scan->index_iter, index_key);
+
+  if (ldb_iter_valid(scan->index_iter))
+    ldb_iter_next(scan->index_iter);
+
+  while (n < scan->length && ldb_iter_valid(scan->index_iter)) {
+    ldb_slice_t value = ldb_iter_value(scan->index_iter);
+
+    if (!ldb_blockhandle_import(&ahead[n], &value))
+      break;
+
+    if (!is_cached(table, &ahead[n]))
+      n++;
+
+    ldb_iter_next(scan->index_iter);
+  }
+
+  ldb_mutex_lock(&scan->mutex);
+
+  /* Drop blocks the scan is no longer heading for. */
+  for (i = 0; i < scan->length; i++) {
+    ldb_prefetch_t *slot = &scan->slots[i];
+
+    if (slot->state != LDB_SLOT_READY)
+      continue;
+
+    for (j = 0; j < n; j++) {
+      if (ahead[j].offset == slot->handle.offset)
+        break;
+    }
+
+    if (j == n) {
+      contents_clear(&slot->contents);
+      slot->state = LDB_SLOT_EMPTY;
+    }
+  }
+
+  /* Claim a slot for each block not yet being read. */
+  for (j = 0; j < n; j++) {
+    ldb_prefetch_t *slot = NULL;
+
+    for (i = 0; i < scan->length; i++) {
+      if (scan->slots[i].state != LDB_SLOT_EMPTY
+          && scan->slots[i].handle.offset == ahead[j].offset) {
+        break;
+      }
+    }
+
+    if (i < scan->length)
+      continue;
+
+    for (i = 0; i < scan->length; i++) {
+      if (scan->slots[i].state == LDB_SLOT_EMPTY) {
+        slot = &scan->slots[i];
+        break;
+      }
+    }
+
+    if (slot == NULL)
+      break;
+
+    slot->handle = ahead[j];
+    slot->state = LDB_SLOT_PENDING;
+
+    scan->pending++;
+
+    work[count++] = slot;
+  }
+
+  ldb_mutex_unlock(&scan->mutex);
+
+  if (count == 0)
+    return;
+
+  job = ldb_malloc(sizeof(ldb_prefetchjob_t));
+  job->scan = scan;
+  job->length = count;
+
+  for (i = 0; i < count; i++)
+    job->slots[i] = work[i];
+
+  ldb_pool_schedule(scan->pool, &prefetch_work, job);
+}
+
+static void
+delete_tablescan(void *arg1, void *arg2) {
+  ldb_tablescan_t *scan = (ldb_tablescan_t *)arg1;
+  int i;
+
+  (void)arg2;
+
+  if (scan->length > 0) {
+    ldb_mutex_lock(&scan->mutex);
+
+    while (scan->pending > 0)
+      ldb_cond_wait(&scan->cond, &scan->mutex);
+
+    ldb_mutex_unlock(&scan->mutex);
+
+    for (i = 0; i < scan->length; i++)
+      contents_clear(&scan->slots[i].contents);
+
+    ldb_free(scan->slots);
+  }
+
+  if (scan->index_iter != NULL)
+    ldb_iter_destroy(scan->index_iter);
+
+  ldb_cond_destroy(&scan->cond);
+  ldb_mutex_destroy(&scan->mutex);
+  ldb_readahead_clear(&scan->ra);
+  ldb_free(scan);
+}
+
 ldb_iter_t *
-ldb_tableiter_create(const ldb_table_t *table, const ldb_readopt_t *options) {
+ldb_tableiter_create_prefetch(const ldb_table_t *table,
+                              const ldb_readopt_t *options,
+                              ldb_pool_t *pool) {
+  ldb_tablescan_t *scan = ldb_malloc(sizeof(ldb_tablescan_t));
   ldb_iter_t *iter = ldb_blockiter_create(table->index_block,
                                           table->options.comparator);
+  int i;
+
+  scan->table = table;
+  scan->options = *options;
+  scan->pool = pool;
+  scan->index_iter = NULL;
+  scan->slots = NULL;
+  scan->length = 0;
+  scan->pending = 0;
+
+  ldb_readahead_init(&scan->ra);
+  ldb_mutex_init(&scan->mutex);
+  ldb_cond_init(&scan->cond);
+
+  if (pool != NULL && options->prefetch_blocks > 0) {
+    scan->length = LDB_MIN(options->prefetch_blocks, LDB_PREFETCH_MAX);
+    scan->slots = ldb_malloc(scan->length * sizeof(ldb_prefetch_t));
+
+    for (i = 0; i < scan->length; i++) {
+      ldb_prefetch_t *slot = &scan->slots[i];
+
+      slot->state = LDB_SLOT_EMPTY;
+      slot->status = LDB_OK;
+
+      ldb_blockhandle_init(&slot->handle);
+      ldb_blockcontents_init(&slot->contents);
+    }
+  }
 
-  return ldb_twoiter_create(iter,
-                            &ldb_table_blockreader,
-                            (void *)table,
-                            options);
+  iter = ldb_twoiter_create(iter,
+                            &ldb_tablescan_blockreader,
+                            scan->length > 0 ? &ldb_tablescan_prefetch
+                                             : NULL,
+                            scan,
+                            options,
+                            table->options.comparator->user_comparator);
+
+  ldb_iter_register_cleanup(iter, &delete_tablescan, scan, NULL);
+
+  return iter;
 }
 
-int
-ldb_table_internal_get(ldb_table_t *table,
-                       const ldb_readopt_t *options,
-                       const ldb_slice_t *k,
-                       void *arg,
-                       void (*handle_result)(void *,
-                                             const ldb_slice_t *,
-                                             const ldb_slice_t *)) {
+ldb_iter_t *
+ldb_tableiter_create(const ldb_table_t *table, const ldb_readopt_t *options) {
+  return ldb_tableiter_create_prefetch(table, options, NULL);
+}
+
+static int
+table_get(ldb_table_t *table,
+          const ldb_readopt_t *options,
+          const ldb_slice_t *k,
+          void *arg,
+          void (*handle_result)(void *,
+                                const ldb_slice_t *,
+                                const ldb_slice_t *),
+          ldb_cleanup_t *pin) {
   ldb_iter_t *index_iter;
   int rc = LDB_OK;
 
+  /* A full filter can rule the key out without touching the index. */
+  if (table->filter != NULL && !ldb_filterreader_may_match(table->filter, k))
+    return LDB_OK;
+
   index_iter = ldb_blockiter_create(table->index_block,
                                     table->options.comparator);
 
@@ -342,7 +762,7 @@ ldb_table_internal_get(ldb_table_t *table,
     ldb_filterreader_t *filter = table->filter;
     ldb_blockhandle_t handle;
 
-    if (filter != NULL
+    if (filter != NULL && !filter->full
         && ldb_blockhandle_import(&handle, &iter_value)
         && !ldb_filterreader_matches(filter, handle.offset, k)) {
       /* Not found. */
@@ -358,6 +778,9 @@ ldb_table_internal_get(ldb_table_t *table,
         ldb_slice_t block_iter_value = ldb_iter_value(block_iter);
 
         (*handle_result)(arg, &block_iter_key, &block_iter_value);
+
+        if (pin != NULL)
+          ldb_iter_move_cleanup(block_iter, pin);
       }
 
       rc = ldb_iter_status(block_iter);
@@ -374,6 +797,113 @@ ldb_table_internal_get(ldb_table_t *table,
   return rc;
 }
 
+int
+ldb_table_internal_get(ldb_table_t *table,
+                       const ldb_readopt_t *options,
+                       const ldb_slice_t *k,
+                       void *arg,
+                       void (*handle_result)(void *,
+                                             const ldb_slice_t *,
+                                             const ldb_slice_t *)) {
+  return table_get(table, options, k, arg, handle_result, NULL);
+}
+
+int
+ldb_table_pinned_get(ldb_table_t *table,
+                     const ldb_readopt_t *options,
+                     const ldb_slice_t *k,
+                     void *arg,
+                     void (*handle_result)(void *,
+                                           const ldb_slice_t *,
+                                           const ldb_slice_t *),
+                     ldb_cleanup_t *pin) {
+  return table_get(table, options, k, arg, handle_result, pin);
+}
+
+int
+ldb_table_cursor_get(ldb_table_t *table,
+                     const ldb_readopt_t *options,
+                     ldb_tablecursor_t *cur,
+                     const ldb_slice_t *k,
+                     void *arg,
+                     void (*handle_result)(void *,
+                                           const ldb_slice_t *,
+                                           const ldb_slice_t *)) {
+  ldb_filterreader_t *filter = table->filter;
+  ldb_blockhandle_t handle;
+  ldb_slice_t iter_value;
+  int rc = LDB_OK;
+
+  if (filter != NULL && !ldb_filterreader_may_match(filter, k))
+    return LDB_OK; /* Not found. */
+
+  if (cur->index_iter == NULL) {
+    cur->index_iter = ldb_blockiter_create(table->index_block,
+                                           table->options.comparator);
+  }
+
+  ldb_iter_seek(cur->index_iter, k);
+
+  if (!ldb_iter_valid(cur->index_iter))
+    return ldb_iter_status(cur->index_iter);
+
+  iter_value = ldb_iter_value(cur->index_iter);
+
+  if (!ldb_blockhandle_import(&handle, &iter_value)) {
+    /* Let the uncached path report the bad handle. */
+    return ldb_table_internal_get(table, options, k, arg, handle_result);
+  }
+
+  if (filter != NULL && !filter->full
+      && !ldb_filterreader_matches(filter, handle.offset, k)) {
+    return LDB_OK; /* Not found. */
+  }
+
+  if (cur->block_iter == NULL || cur->block_offset != handle.offset) {
+    if (cur->block_iter != NULL)
+      ldb_iter_destroy(cur->block_iter);
+
+    cur->block_iter = ldb_table_blockreader(table, options, &iter_value);
+    cur->block_offset = handle.offset;
+  }
+
+  ldb_iter_seek(cur->block_iter, k);
+
+  if (ldb_iter_valid(cur->block_iter)) {
+    ldb_slice_t block_iter_key = ldb_iter_key(cur->block_iter);
+    ldb_slice_t block_iter_value = ldb_iter_value(cur->block_iter);
+
+    (*handle_result)(arg, &block_iter_key, &block_iter_value);
+  }
+
+  rc = ldb_iter_status(cur->block_iter);
+
+  if (rc != LDB_OK) {
+    ldb_iter_destroy(cur->block_iter);
+    cur->block_iter = NULL;
+  }
+
+  return rc;
+}
+
+void
+ldb_tablecursor_init(ldb_tablecursor_t *cur) {
+  cur->index_iter = NULL;
+  cur->block_iter = NULL;
+  cur->block_offset = 0;
+}
+
+void
+ldb_tablecursor_clear(ldb_tablecursor_t *cur) {
+  if (cur->block_iter != NULL)
+    ldb_iter_destroy(cur->block_iter);
+
+  if (cur->index_iter != NULL)
+    ldb_iter_destroy(cur->index_iter);
+
+  ldb_tablecursor_init(cur);
+}
+
 uint64_t
 ldb_table_approximate_offsetof(const ldb_table_t *table,
                                const ldb_slice_t *key) {
@@ -408,3 +938,12 @@ ldb_table_approximate_offsetof(const ldb_table_t *table,
 
   return result;
 }
+
+int
+ldb_table_prefix_may_match(const ldb_table_t *table,
+                           const ldb_slice_t *prefix) {
+  if (!table->prefix_filter)
+    return 1;
+
+  return ldb_filterreader_prefix_may_match(table->filter, prefix);
+}
@@ -21,8 +21,10 @@
  * Types
  */
 
+struct ldb_cleanup_s;
 struct ldb_dbopt_s;
 struct ldb_iter_s;
+struct ldb_pool_s;
 struct ldb_readopt_s;
 struct ldb_rfile_s;
 
@@ -31,6 +33,15 @@ struct ldb_rfile_s;
    multiple threads without external synchronization. */
 typedef struct ldb_table_s ldb_table_t;
 
+/* Lookup state carried across ldb_table_cursor_get() calls on
+   ascending keys. Keeps the index position and the last data block
+   open so that keys landing in the same block do not reread it. */
+typedef struct ldb_tablecursor_s {
+  struct ldb_iter_s *index_iter;
+  struct ldb_iter_s *block_iter;
+  uint64_t block_offset;
+} ldb_tablecursor_t;
+
 /*
  * Table
  */
@@ -66,6 +77,15 @@ struct ldb_iter_s *
 ldb_tableiter_create(const ldb_table_t *table,
                      const struct ldb_readopt_s *options);
 
+/* Same as ldb_tableiter_create(), but forward scans read up to
+ * options->prefetch_blocks data blocks ahead of their position
+ * on the threads of "pool".
+ */
+struct ldb_iter_s *
+ldb_tableiter_create_prefetch(const ldb_table_t *table,
+                              const struct ldb_readopt_s *options,
+                              struct ldb_pool_s *pool);
+
 /* Calls (*handle_result)(arg, ...) with the entry found after a call
  * to Seek(key). May not make such a call if filter policy says
  * that key is not present.
@@ -79,6 +99,40 @@ ldb_table_internal_get(ldb_table_t *table,
                                              const ldb_slice_t *,
                                              const ldb_slice_t *));
 
+/* Like ldb_table_internal_get(), but keeps the data block passed to
+ * (*handle_result) alive after returning: the functions releasing it
+ * are moved to "pin" and must eventually be run by the caller.
+ */
+int
+ldb_table_pinned_get(ldb_table_t *table,
+                     const struct ldb_readopt_s *options,
+                     const ldb_slice_t *k,
+                     void *arg,
+                     void (*handle_result)(void *,
+                                           const ldb_slice_t *,
+                                           const ldb_slice_t *),
+                     struct ldb_cleanup_s *pin);
+
+/* Like ldb_table_internal_get(), but reuses the index iterator and
+ * data block held by "cur". The cursor must only be used with one
+ * table and must be cleared before the table is released.
+ */
+int
+ldb_table_cursor_get(ldb_table_t *table,
+                     const struct ldb_readopt_s *options,
+                     ldb_tablecursor_t *cur,
+                     const ldb_slice_t *k,
+                     void *arg,
+                     void (*handle_result)(void *,
+                                           const ldb_slice_t *,
+                                           const ldb_slice_t *));
+
+void
+ldb_tablecursor_init(ldb_tablecursor_t *cur);
+
+void
+ldb_tablecursor_clear(ldb_tablecursor_t *cur);
+
 /* Given a key, return an approximate byte offset in the file where
  * the data for that key begins (or would begin if the key were
  * present in the file). The returned value is in terms of file
@@ -90,4 +144,12 @@ uint64_t
 ldb_table_approximate_offsetof(const ldb_table_t *table,
                                const ldb_slice_t *key);
 
+/* Return false if the table's filter rules out every key with the
+ * given prefix (as produced by the table's prefix extractor). Always
+ * true for tables written without prefix filters.
+ */
+int
+ldb_table_prefix_may_match(const ldb_table_t *table,
+                           const ldb_slice_t *prefix);
+
 #endif /* LDB_TABLE_H */
@@ -22,6 +22,7 @@
 #include "../util/env.h"
 #include "../util/internal.h"
 #include "../util/options.h"
+#include "../util/prefix.h"
 #include "../util/slice.h"
 #include "../util/snappy.h"
 #include "../util/status.h"
@@ -90,7 +91,15 @@ ldb_tablebuilder_init(ldb_tablebuilder_t *tb,
   if (options->filter_policy != NULL) {
     tb->filter_block = &tb->filter_block_;
 
-    ldb_filterbuilder_init(tb->filter_block, options->filter_policy);
+    if (options->full_filter)
+      ldb_filterbuilder_init_full(tb->filter_block, options->filter_policy);
+    else
+      ldb_filterbuilder_init(tb->filter_block, options->filter_policy);
+
+    if (options->prefix_extractor != NULL)
+      ldb_filterbuilder_set_prefix(tb->filter_block,
+                                   options->prefix_extractor);
+
     ldb_filterbuilder_start_block(tb->filter_block, 0);
   }
 }
@@ -337,13 +346,21 @@ ldb_tablebuilder_finish(ldb_tablebuilder_t *tb) {
     ldb_blockbuilder_init(&metaindex_block, &tb->options);
 
     if (tb->filter_block != NULL) {
-      /* Add mapping from "filter.Name" to location of filter data. */
+      /* Add mapping from "filter.Name" (or "fullfilter.Name")
+         to location of filter data. */
+      const ldb_bloom_t *policy = tb->options.filter_policy;
       uint8_t tmp[LDB_BLOCKHANDLE_MAX];
       ldb_buffer_t handle_encoding;
       ldb_slice_t key;
-      char name[72];
+      char name[76];
+      int ok;
+
+      if (tb->filter_block->full)
+        ok = ldb_bloom_full_name(name, sizeof(name), policy);
+      else
+        ok = ldb_bloom_name(name, sizeof(name), policy);
 
-      if (!ldb_bloom_name(name, sizeof(name), tb->options.filter_policy)) {
+      if (!ok) {
         ldb_blockbuilder_clear(&metaindex_block);
         return LDB_INVALID;
       }
@@ -352,6 +369,18 @@ ldb_tablebuilder_finish(ldb_tablebuilder_t *tb) {
       ldb_buffer_rwset(&handle_encoding, tmp, sizeof(tmp));
       ldb_blockhandle_export(&handle_encoding, &filter_handle);
       ldb_blockbuilder_add(&metaindex_block, &key, &handle_encoding);
+
+      /* Record that the filter also holds the prefixes produced by
+         "prefix.Name". Sorts after the filter entry. */
+      if (tb->filter_block->prefix != NULL) {
+        if (!ldb_prefix_name(name, sizeof(name), tb->filter_block->prefix)) {
+          ldb_blockbuilder_clear(&metaindex_block);
+          return LDB_INVALID;
+        }
+
+        ldb_slice_set_str(&key, name);
+        ldb_blockbuilder_add(&metaindex_block, &key, &handle_encoding);
+      }
     }
 
     ldb_tablebuilder_write_block(tb, &metaindex_block, &metaindex_handle);
@@ -38,6 +38,7 @@
 #include "block.h"
 #include "format.h"
 #include "iterator.h"
+#include "merger.h"
 #include "table_builder.h"
 #include "table.h"
 
@@ -1477,6 +1478,236 @@ test_approximate_offsetof_compressed(void) {
   ctor_destroy(c);
 }
 
+/*
+ * Readahead
+ */
+
+static void
+test_readahead(void) {
+  ctor_t *c = tablector_create(ldb_bytewise_comparator);
+  ldb_dbopt_t options = *ldb_dbopt_default;
+  ldb_blockcontents_t contents;
+  uint8_t buf[LDB_FOOTER_SIZE];
+  ldb_blockhandle_t *handles;
+  size_t window, nblocks, i;
+  ldb_readahead_t ra;
+  ldb_footer_t footer;
+  ldb_slice_t input;
+  ldb_vector_t keys;
+  ldb_block_t *index;
+  ldb_iter_t *iter;
+  tablector_t *tc;
+  char kbuf[32];
+  uint64_t fsize;
+  int reads;
+
+  ldb_vector_init(&keys);
+
+  for (i = 0; i < 3000; i++) {
+    sprintf(kbuf, "key%06d", (int)i);
+    ctor_add_str(c, kbuf, "0123456789012345678901234567890123456789"
+                          "0123456789012345678901234567890123456789");
+  }
+
+  options.block_size = 1024;
+  options.compression = LDB_NO_COMPRESSION;
+  options.comparator = ldb_bytewise_comparator;
+
+  ctor_finish(c, &options, &keys);
+
+  tc = c->ptr;
+
+  /* Collect the data block handles from the index. */
+  ASSERT(ldb_get_file_size(tc->path, &fsize) == LDB_OK);
+  ASSERT(ldb_rfile_pread(tc->source, &input, buf, sizeof(buf),
+                         fsize - LDB_FOOTER_SIZE) == LDB_OK);
+  ASSERT(ldb_footer_import(&footer, &input));
+  ASSERT(ldb_read_block(&contents, tc->source, ldb_readopt_default,
+                        &footer.index_handle) == LDB_OK);
+
+  index = ldb_block_create(&contents);
+  iter = ldb_blockiter_create(index, ldb_bytewise_comparator);
+  handles = ldb_malloc(3000 * sizeof(ldb_blockhandle_t));
+  nblocks = 0;
+
+  for (ldb_iter_seek_first(iter); ldb_iter_valid(iter); ldb_iter_next(iter)) {
+    ldb_slice_t value = ldb_iter_value(iter);
+
+    ASSERT(nblocks < 3000);
+    ASSERT(ldb_blockhandle_import(&handles[nblocks++], &value));
+  }
+
+  ldb_iter_destroy(iter);
+  ldb_block_destroy(index);
+
+  ASSERT(nblocks > 100);
+
+  /* A forward scan issues a few reads of growing size (the
+     first block, which starts the sequence, is read alone). */
+  ldb_readahead_init(&ra);
+
+  reads = 0;
+  window = 0;
+
+  for (i = 0; i < nblocks; i++) {
+    uint64_t offset = ra.offset;
+    size_t size = ra.size;
+
+    ASSERT(ldb_read_block_ahead(&contents, tc->source, ldb_readopt_default,
+                                &handles[i], &ra) == LDB_OK);
+
+    ldb_block_destroy(ldb_block_create(&contents));
+
+    if (i == 0) {
+      ASSERT(ra.window == 0 && ra.size == 0);
+      reads++;
+      continue;
+    }
+
+    if (ra.offset != offset || ra.size != size) {
+      if (window == 0)
+        ASSERT(ra.window == LDB_READAHEAD_MIN);
+      else
+        ASSERT(ra.window == LDB_MIN(2 * window, LDB_READAHEAD_MAX));
+
+      ASSERT(ra.offset == handles[i].offset);
+
+      window = ra.window;
+      reads++;
+    }
+  }
+
+  ASSERT(window > LDB_READAHEAD_MIN);
+  ASSERT(reads < 10);
+  ASSERT((size_t)reads < nblocks / 10);
+
+  /* Going backwards never reads ahead. */
+  for (i = nblocks - 1; i-- > 0;) {
+    ASSERT(ldb_read_block_ahead(&contents, tc->source, ldb_readopt_default,
+                                &handles[i], &ra) == LDB_OK);
+
+    ldb_block_destroy(ldb_block_create(&contents));
+
+    ASSERT(ra.window == 0);
+  }
+
+  ldb_readahead_clear(&ra);
+  ldb_free(handles);
+  ldb_vector_clear(&keys);
+  ctor_destroy(c);
+}
+
+/*
+ * Merger
+ */
+
+static void
+test_merger_many_children(void) {
+  enum { NUM_CHILDREN = 12, PER_CHILD = 200, TOTAL = 12 * 200 };
+  ldb_memtable_t *tables[NUM_CHILDREN];
+  ldb_iter_t *children[NUM_CHILDREN];
+  ldb_buffer_t *keys;
+  ldb_comparator_t icmp;
+  ldb_seqnum_t seq = 1;
+  ldb_slice_t key, val;
+  ldb_iter_t *iter;
+  ldb_rand_t rnd;
+  char kbuf[16];
+  int i, j, pos;
+
+  ldb_ikc_init(&icmp, ldb_bytewise_comparator);
+  ldb_rand_init(&rnd, 301);
+
+  val = ldb_string("v");
+
+  /* Overlapping children with plenty of equal user keys. */
+  for (i = 0; i < NUM_CHILDREN; i++) {
+    tables[i] = ldb_memtable_create(&icmp);
+
+    ldb_memtable_ref(tables[i]);
+
+    for (j = 0; j < PER_CHILD; j++) {
+      sprintf(kbuf, "%04d", (int)ldb_rand_uniform(&rnd, 500));
+
+      key = ldb_string(kbuf);
+
+      ldb_memtable_add(tables[i], seq++, LDB_TYPE_VALUE, &key, &val);
+    }
+
+    children[i] = ldb_memiter_create(tables[i]);
+  }
+
+  iter = ldb_mergeiter_create(&icmp, children, NUM_CHILDREN);
+  keys = ldb_malloc(TOTAL * sizeof(ldb_buffer_t));
+
+  /* Forward scan yields every entry in order. */
+  pos = 0;
+
+  for (ldb_iter_seek_first(iter); ldb_iter_valid(iter); ldb_iter_next(iter)) {
+    key = ldb_iter_key(iter);
+
+    ASSERT(pos < TOTAL);
+
+    if (pos > 0)
+      ASSERT(ldb_compare(&icmp, &keys[pos - 1], &key) < 0);
+
+    ldb_buffer_init(&keys[pos]);
+    ldb_buffer_set(&keys[pos], key.data, key.size);
+
+    pos++;
+  }
+
+  ASSERT(pos == TOTAL);
+
+  /* Backward scan is the exact reverse. */
+  for (ldb_iter_seek_last(iter); ldb_iter_valid(iter); ldb_iter_prev(iter)) {
+    key = ldb_iter_key(iter);
+
+    ASSERT(pos > 0);
+    ASSERT(ldb_compare(&icmp, &keys[--pos], &key) == 0);
+  }
+
+  ASSERT(pos == 0);
+
+  /* Random seeks with direction changes. */
+  for (i = 0; i < 2000; i++) {
+    if (i % 100 == 0) {
+      pos = ldb_rand_uniform(&rnd, TOTAL);
+      ldb_iter_seek(iter, &keys[pos]);
+    } else if (ldb_rand_one_in(&rnd, 2)) {
+      ldb_iter_next(iter);
+      pos++;
+    } else {
+      ldb_iter_prev(iter);
+      pos--;
+    }
+
+    if (pos < 0 || pos >= TOTAL) {
+      ASSERT(!ldb_iter_valid(iter));
+      pos = ldb_rand_uniform(&rnd, TOTAL);
+      ldb_iter_seek(iter, &keys[pos]);
+    }
+
+    ASSERT(ldb_iter_valid(iter));
+
+    key = ldb_iter_key(iter);
+
+    ASSERT(ldb_compare(&icmp, &keys[pos], &key) == 0);
+  }
+
+  ASSERT(ldb_iter_status(iter) == LDB_OK);
+
+  ldb_iter_destroy(iter);
+
+  for (i = 0; i < TOTAL; i++)
+    ldb_buffer_clear(&keys[i]);
+
+  ldb_free(keys);
+
+  for (i = 0; i < NUM_CHILDREN; i++)
+    ldb_memtable_unref(tables[i]);
+}
+
 /*
  * Execute
  */
@@ -1499,8 +1730,10 @@ ldb_test_table(void) {
   test_randomized(&h);
   test_randomized_long_db(&h);
   test_memtable_simple();
+  test_merger_many_children();
   test_approximate_offsetof_plain();
   test_approximate_offsetof_compressed();
+  test_readahead();
 
   harness_clear(&h);
 
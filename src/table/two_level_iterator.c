@@ -14,6 +14,7 @@
 #include <stddef.h>
 
 #include "../util/buffer.h"
+#include "../util/comparator.h"
 #include "../util/internal.h"
 #include "../util/options.h"
 #include "../util/slice.h"
@@ -29,8 +30,10 @@
 
 typedef struct ldb_twoiter_s {
   ldb_blockfunc_f block_function;
+  ldb_prefetchfunc_f prefetch_function; /* May be NULL. */
   void *arg;
   ldb_readopt_t options;
+  const ldb_comparator_t *ucmp; /* May be NULL. */
   int status;
   ldb_wrapiter_t index_iter;
   ldb_wrapiter_t data_iter; /* May be NULL. */
@@ -81,11 +84,15 @@ static void
 ldb_twoiter_init(ldb_twoiter_t *iter,
                ldb_iter_t *index_iter,
                ldb_blockfunc_f block_function,
+               ldb_prefetchfunc_f prefetch_function,
                void *arg,
-               const ldb_readopt_t *options) {
+               const ldb_readopt_t *options,
+               const ldb_comparator_t *ucmp) {
   iter->block_function = block_function;
+  iter->prefetch_function = prefetch_function;
   iter->arg = arg;
   iter->options = *options;
+  iter->ucmp = ucmp;
   iter->status = LDB_OK;
 
   ldb_wrapiter_init(&iter->index_iter, index_iter);
@@ -109,7 +116,7 @@ ldb_twoiter_set_data_iter(ldb_twoiter_t *iter, ldb_iter_t *data_iter) {
 }
 
 static void
-ldb_twoiter_init_data_block(ldb_twoiter_t *iter) {
+ldb_twoiter_init_data_block(ldb_twoiter_t *iter, int forward) {
   if (!ldb_wrapiter_valid(&iter->index_iter)) {
     ldb_twoiter_set_data_iter(iter, NULL);
   } else {
@@ -128,21 +135,67 @@ ldb_twoiter_init_data_block(ldb_twoiter_t *iter) {
       /* ldb_buffer_set(&iter->data_block_handle, handle.data, handle.size); */
 
       ldb_twoiter_set_data_iter(iter, data_iter);
+
+      /* Have the blocks after this one read while it is consumed. */
+      if (forward && iter->prefetch_function != NULL) {
+        ldb_slice_t key = ldb_wrapiter_key(&iter->index_iter);
+
+        iter->prefetch_function(iter->arg, &iter->options, &key);
+      }
     }
   }
 }
 
+/* Compare the user key of the current index entry to a bound. An
+   index key is >= every key in its block and < every key in the
+   block after it, so this tells us whether neighbouring blocks can
+   be skipped without being read. */
+static int
+ldb_twoiter_compare(const ldb_twoiter_t *iter, const ldb_slice_t *bound) {
+  ldb_slice_t key = ldb_wrapiter_key(&iter->index_iter);
+
+  if (key.size < 8)
+    return 0;
+
+  key.size -= 8;
+
+  return ldb_compare(iter->ucmp, &key, bound);
+}
+
+/* Whether every block after the current one is at or above the upper bound. */
+static int
+ldb_twoiter_past_upper(const ldb_twoiter_t *iter) {
+  const ldb_slice_t *upper = iter->options.iterate_upper_bound;
+
+  if (iter->ucmp == NULL || upper == NULL)
+    return 0;
+
+  return ldb_twoiter_compare(iter, upper) >= 0;
+}
+
+/* Whether the current block is entirely below the lower bound. */
+static int
+ldb_twoiter_below_lower(const ldb_twoiter_t *iter) {
+  const ldb_slice_t *lower = iter->options.iterate_lower_bound;
+
+  if (iter->ucmp == NULL || lower == NULL)
+    return 0;
+
+  return ldb_twoiter_compare(iter, lower) < 0;
+}
+
 static void
 ldb_twoiter_skip_forward(ldb_twoiter_t *iter) {
   while (iter->data_iter.iter == NULL || !ldb_wrapiter_valid(&iter->data_iter)) {
     /* Move to next block. */
-    if (!ldb_wrapiter_valid(&iter->index_iter)) {
+    if (!ldb_wrapiter_valid(&iter->index_iter)
+        || ldb_twoiter_past_upper(iter)) {
       ldb_twoiter_set_data_iter(iter, NULL);
       return;
     }
 
     ldb_wrapiter_next(&iter->index_iter);
-    ldb_twoiter_init_data_block(iter);
+    ldb_twoiter_init_data_block(iter, 1);
 
     if (iter->data_iter.iter != NULL)
       ldb_wrapiter_seek_first(&iter->data_iter);
@@ -159,7 +212,14 @@ ldb_twoiter_skip_backward(ldb_twoiter_t *iter) {
     }
 
     ldb_wrapiter_prev(&iter->index_iter);
-    ldb_twoiter_init_data_block(iter);
+
+    if (ldb_wrapiter_valid(&iter->index_iter)
+        && ldb_twoiter_below_lower(iter)) {
+      ldb_twoiter_set_data_iter(iter, NULL);
+      return;
+    }
+
+    ldb_twoiter_init_data_block(iter, 0);
 
     if (iter->data_iter.iter != NULL)
       ldb_wrapiter_seek_last(&iter->data_iter);
@@ -169,7 +229,7 @@ ldb_twoiter_skip_backward(ldb_twoiter_t *iter) {
 static void
 ldb_twoiter_seek(ldb_twoiter_t *iter, const ldb_slice_t *target) {
   ldb_wrapiter_seek(&iter->index_iter, target);
-  ldb_twoiter_init_data_block(iter);
+  ldb_twoiter_init_data_block(iter, 1);
 
   if (iter->data_iter.iter != NULL)
     ldb_wrapiter_seek(&iter->data_iter, target);
@@ -180,7 +240,7 @@ ldb_twoiter_seek(ldb_twoiter_t *iter, const ldb_slice_t *target) {
 static void
 ldb_twoiter_seek_first(ldb_twoiter_t *iter) {
   ldb_wrapiter_seek_first(&iter->index_iter);
-  ldb_twoiter_init_data_block(iter);
+  ldb_twoiter_init_data_block(iter, 1);
 
   if (iter->data_iter.iter != NULL)
     ldb_wrapiter_seek_first(&iter->data_iter);
@@ -191,7 +251,7 @@ ldb_twoiter_seek_first(ldb_twoiter_t *iter) {
 static void
 ldb_twoiter_seek_last(ldb_twoiter_t *iter) {
   ldb_wrapiter_seek_last(&iter->index_iter);
-  ldb_twoiter_init_data_block(iter);
+  ldb_twoiter_init_data_block(iter, 0);
 
   if (iter->data_iter.iter != NULL)
     ldb_wrapiter_seek_last(&iter->data_iter);
@@ -218,11 +278,14 @@ LDB_ITERATOR_FUNCTIONS(ldb_twoiter);
 ldb_iter_t *
 ldb_twoiter_create(ldb_iter_t *index_iter,
                    ldb_blockfunc_f block_function,
+                   ldb_prefetchfunc_f prefetch_function,
                    void *arg,
-                   const ldb_readopt_t *options) {
+                   const ldb_readopt_t *options,
+                   const ldb_comparator_t *ucmp) {
   ldb_twoiter_t *iter = ldb_malloc(sizeof(ldb_twoiter_t));
 
-  ldb_twoiter_init(iter, index_iter, block_function, arg, options);
+  ldb_twoiter_init(iter, index_iter, block_function,
+                   prefetch_function, arg, options, ucmp);
 
   return ldb_iter_create(iter, &ldb_twoiter_table);
 }
@@ -19,6 +19,7 @@
  * Types
  */
 
+struct ldb_comparator_s;
 struct ldb_iter_s;
 struct ldb_readopt_s;
 
@@ -26,6 +27,10 @@ typedef struct ldb_iter_s *(*ldb_blockfunc_f)(void *,
                                               const struct ldb_readopt_s *,
                                               const ldb_slice_t *);
 
+typedef void (*ldb_prefetchfunc_f)(void *,
+                                   const struct ldb_readopt_s *,
+                                   const ldb_slice_t *);
+
 /*
  * Two-Level Iterator
  */
@@ -39,11 +44,21 @@ typedef struct ldb_iter_s *(*ldb_blockfunc_f)(void *,
  *
  * Uses a supplied function to convert an index_iter value into
  * an iterator over the contents of the corresponding block.
+ *
+ * If "prefetch_function" is non-NULL, it is called with the index
+ * key of every block a forward scan moves into, so that the blocks
+ * after it can be read ahead of time.
+ *
+ * If "ucmp" is non-NULL, index keys are taken to be internal keys
+ * ordered by "ucmp", and blocks lying wholly outside the iterate
+ * bounds of "options" are skipped without being read.
  */
 struct ldb_iter_s *
 ldb_twoiter_create(struct ldb_iter_s *index_iter,
                    ldb_blockfunc_f block_function,
+                   ldb_prefetchfunc_f prefetch_function,
                    void *arg,
-                   const struct ldb_readopt_s *options);
+                   const struct ldb_readopt_s *options,
+                   const struct ldb_comparator_s *ucmp);
 
 #endif /* LDB_TWO_LEVEL_ITERATOR_H */
@@ -17,6 +17,7 @@
 #include "table/iterator.h"
 #include "table/table.h"
 
+#include "util/atomic.h"
 #include "util/cache.h"
 #include "util/coding.h"
 #include "util/env.h"
@@ -24,6 +25,7 @@
 #include "util/options.h"
 #include "util/slice.h"
 #include "util/status.h"
+#include "util/thread_pool.h"
 
 #include "filename.h"
 #include "table_cache.h"
@@ -36,6 +38,9 @@ struct ldb_tcache_s {
   const char *prefix;
   const ldb_dbopt_t *options;
   ldb_lru_t *lru;
+  /* Reads blocks ahead of iterators. Started by the first iterator
+     which asks for prefetching. */
+  ldb_atomic_ptr(ldb_pool_t) pool;
 };
 
 typedef struct ldb_entry_s {
@@ -77,16 +82,38 @@ ldb_tcache_create(const char *prefix, const ldb_dbopt_t *options, int entries) {
   cache->prefix = prefix;
   cache->options = options;
   cache->lru = ldb_lru_create(entries);
+  cache->pool = NULL;
 
   return cache;
 }
 
 void
 ldb_tcache_destroy(ldb_tcache_t *cache) {
+  if (cache->pool != NULL)
+    ldb_pool_destroy(cache->pool);
+
   ldb_lru_destroy(cache->lru);
   ldb_free(cache);
 }
 
+static ldb_pool_t *
+ldb_tcache_pool(ldb_tcache_t *cache) {
+  ldb_pool_t *pool = ldb_atomic_load_ptr(&cache->pool, ldb_order_acquire);
+
+  if (pool == NULL) {
+    pool = ldb_pool_create(2);
+
+    if (!ldb_atomic_compare_exchange_ptr(&cache->pool, NULL, pool,
+                                         ldb_order_acq_rel)) {
+      ldb_pool_destroy(pool);
+
+      pool = ldb_atomic_load_ptr(&cache->pool, ldb_order_acquire);
+    }
+  }
+
+  return pool;
+}
+
 static int
 find_table(ldb_tcache_t *cache,
            uint64_t file_number,
@@ -166,7 +193,12 @@ ldb_tcache_iterate(ldb_tcache_t *cache,
     return ldb_emptyiter_create(rc);
 
   table = ((ldb_entry_t *)ldb_lru_value(handle))->table;
-  result = ldb_tableiter_create(table, options);
+  if (options->prefetch_blocks > 0) {
+    result = ldb_tableiter_create_prefetch(table, options,
+                                           ldb_tcache_pool(cache));
+  } else {
+    result = ldb_tableiter_create(table, options);
+  }
 
   ldb_iter_register_cleanup(result, &unref_entry, cache->lru, handle);
 
@@ -202,6 +234,108 @@ ldb_tcache_get(ldb_tcache_t *cache,
   return rc;
 }
 
+int
+ldb_tcache_pinned_get(ldb_tcache_t *cache,
+                      const ldb_readopt_t *options,
+                      uint64_t file_number,
+                      uint64_t file_size,
+                      const ldb_slice_t *k,
+                      void *arg,
+                      void (*handle_result)(void *,
+                                            const ldb_slice_t *,
+                                            const ldb_slice_t *),
+                      ldb_cleanup_t *pin) {
+  ldb_lruhandle_t *handle = NULL;
+  int rc;
+
+  rc = find_table(cache, file_number, file_size, &handle);
+
+  if (rc == LDB_OK) {
+    ldb_table_t *table = ((ldb_entry_t *)ldb_lru_value(handle))->table;
+
+    rc = ldb_table_pinned_get(table, options, k, arg, handle_result, pin);
+
+    /* A block read through mmap points into the table's file. */
+    if (!ldb_cleanup_empty(pin))
+      ldb_cleanup_push(pin, &unref_entry, cache->lru, handle);
+    else
+      ldb_lru_release(cache->lru, handle);
+  }
+
+  return rc;
+}
+
+int
+ldb_tcache_cursor_get(ldb_tcache_t *cache,
+                      ldb_tcursor_t *cur,
+                      const ldb_readopt_t *options,
+                      uint64_t file_number,
+                      uint64_t file_size,
+                      const ldb_slice_t *k,
+                      void *arg,
+                      void (*handle_result)(void *,
+                                            const ldb_slice_t *,
+                                            const ldb_slice_t *)) {
+  ldb_table_t *table;
+  int rc;
+
+  if (cur->handle != NULL && cur->file_number != file_number)
+    ldb_tcursor_clear(cache, cur);
+
+  if (cur->handle == NULL) {
+    rc = find_table(cache, file_number, file_size, &cur->handle);
+
+    if (rc != LDB_OK) {
+      cur->handle = NULL;
+      return rc;
+    }
+
+    cur->file_number = file_number;
+  }
+
+  table = ((ldb_entry_t *)ldb_lru_value(cur->handle))->table;
+
+  return ldb_table_cursor_get(table, options, &cur->table,
+                              k, arg, handle_result);
+}
+
+void
+ldb_tcursor_init(ldb_tcursor_t *cur) {
+  cur->file_number = 0;
+  cur->handle = NULL;
+
+  ldb_tablecursor_init(&cur->table);
+}
+
+void
+ldb_tcursor_clear(ldb_tcache_t *cache, ldb_tcursor_t *cur) {
+  ldb_tablecursor_clear(&cur->table);
+
+  if (cur->handle != NULL)
+    ldb_lru_release(cache->lru, cur->handle);
+
+  ldb_tcursor_init(cur);
+}
+
+int
+ldb_tcache_prefix_may_match(ldb_tcache_t *cache,
+                            uint64_t file_number,
+                            uint64_t file_size,
+                            const ldb_slice_t *prefix) {
+  ldb_lruhandle_t *handle = NULL;
+  int result = 1;
+
+  if (find_table(cache, file_number, file_size, &handle) == LDB_OK) {
+    ldb_table_t *table = ((ldb_entry_t *)ldb_lru_value(handle))->table;
+
+    result = ldb_table_prefix_may_match(table, prefix);
+
+    ldb_lru_release(cache->lru, handle);
+  }
+
+  return result;
+}
+
 void
 ldb_tcache_evict(ldb_tcache_t *cache, uint64_t file_number) {
   ldb_slice_t key;
@@ -23,10 +23,19 @@
  * Types
  */
 
+struct ldb_cleanup_s;
 struct ldb_iter_s;
+struct ldb_lruhandle_s;
 
 typedef struct ldb_tcache_s ldb_tcache_t;
 
+/* A table cursor along with the cached table it was last used on. */
+typedef struct ldb_tcursor_s {
+  uint64_t file_number;
+  struct ldb_lruhandle_s *handle;
+  ldb_tablecursor_t table;
+} ldb_tcursor_t;
+
 /*
  * TableCache
  */
@@ -65,6 +74,50 @@ ldb_tcache_get(ldb_tcache_t *cache,
                                      const ldb_slice_t *,
                                      const ldb_slice_t *));
 
+/* Same as ldb_tcache_get(), but the data block and table the result
+   points into stay alive until the functions in "pin" are run. */
+int
+ldb_tcache_pinned_get(ldb_tcache_t *cache,
+                      const ldb_readopt_t *options,
+                      uint64_t file_number,
+                      uint64_t file_size,
+                      const ldb_slice_t *k,
+                      void *arg,
+                      void (*handle_result)(void *,
+                                            const ldb_slice_t *,
+                                            const ldb_slice_t *),
+                      struct ldb_cleanup_s *pin);
+
+/* Same as ldb_tcache_get(), but keeps the table and the last data
+   block read open in "cur" for the next (ascending) lookup. */
+int
+ldb_tcache_cursor_get(ldb_tcache_t *cache,
+                      ldb_tcursor_t *cur,
+                      const ldb_readopt_t *options,
+                      uint64_t file_number,
+                      uint64_t file_size,
+                      const ldb_slice_t *k,
+                      void *arg,
+                      void (*handle_result)(void *,
+                                            const ldb_slice_t *,
+                                            const ldb_slice_t *));
+
+void
+ldb_tcursor_init(ldb_tcursor_t *cur);
+
+/* Release the table and blocks held by "cur". */
+void
+ldb_tcursor_clear(ldb_tcache_t *cache, ldb_tcursor_t *cur);
+
+/* Return zero only if the prefix filter of the specified file proves
+   that it holds no key starting with "prefix". Errors and files without
+   a prefix filter answer one. */
+int
+ldb_tcache_prefix_may_match(ldb_tcache_t *cache,
+                            uint64_t file_number,
+                            uint64_t file_size,
+                            const ldb_slice_t *prefix);
+
 /* Evict any entry for the specified file number. */
 void
 ldb_tcache_evict(ldb_tcache_t *cache, uint64_t file_number);
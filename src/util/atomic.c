@@ -38,6 +38,14 @@ ldb_atomic__store(volatile long *object, long desired) {
   (void)InterlockedExchange(object, desired);
 }
 
+int
+ldb_atomic__compare_exchange(volatile long *object,
+                             long expected,
+                             long desired) {
+  /* Windows 98 or above. */
+  return InterlockedCompareExchange(object, desired, expected) == expected;
+}
+
 void *
 ldb_atomic__load_ptr(void *volatile *object) {
 #ifdef _WIN64
@@ -60,6 +68,23 @@ ldb_atomic__store_ptr(void *volatile *object, void *desired) {
 #endif
 }
 
+int
+ldb_atomic__compare_exchange_ptr(void *volatile *object,
+                                 void *expected,
+                                 void *desired) {
+#ifdef _WIN64
+  /* Windows XP or above. */
+  return InterlockedCompareExchangePointer(object,
+                                           desired,
+                                           expected) == expected;
+#else
+  /* Windows 98 or above. */
+  return InterlockedCompareExchange((volatile long *)object,
+                                    (long)desired,
+                                    (long)expected) == (long)expected;
+#endif
+}
+
 #else /* !LDB_MSVC_ATOMICS */
 
 #include "port.h"
@@ -92,6 +117,17 @@ ldb_atomic__store(long *object, long desired) {
   ldb_mutex_unlock(&ldb_atomic_lock);
 }
 
+int
+ldb_atomic__compare_exchange(long *object, long expected, long desired) {
+  int result;
+  ldb_mutex_lock(&ldb_atomic_lock);
+  result = (*object == expected);
+  if (result)
+    *object = desired;
+  ldb_mutex_unlock(&ldb_atomic_lock);
+  return result;
+}
+
 void *
 ldb_atomic__load_ptr(void **object) {
   void *result;
@@ -108,4 +144,15 @@ ldb_atomic__store_ptr(void **object, void *desired) {
   ldb_mutex_unlock(&ldb_atomic_lock);
 }
 
+int
+ldb_atomic__compare_exchange_ptr(void **object, void *expected, void *desired) {
+  int result;
+  ldb_mutex_lock(&ldb_atomic_lock);
+  result = (*object == expected);
+  if (result)
+    *object = desired;
+  ldb_mutex_unlock(&ldb_atomic_lock);
+  return result;
+}
+
 #endif /* !LDB_MSVC_ATOMICS */
@@ -134,8 +134,12 @@
 #define ldb_atomic_store(object, desired, order) \
   __atomic_store_n(object, desired, order)
 
+#define ldb_atomic_compare_exchange(object, expected, desired, order) \
+  __sync_bool_compare_and_swap(object, expected, desired)
+
 #define ldb_atomic_load_ptr ldb_atomic_load
 #define ldb_atomic_store_ptr ldb_atomic_store
+#define ldb_atomic_compare_exchange_ptr ldb_atomic_compare_exchange
 
 #elif defined(LDB_GNUC_ATOMICS)
 
@@ -154,10 +158,14 @@
   __sync_synchronize();                               \
 } while (0)
 
+#define ldb_atomic_compare_exchange(object, expected, desired, order) \
+  __sync_bool_compare_and_swap(object, expected, desired)
+
 #define ldb_atomic_load_ptr(object, order) \
   __sync_val_compare_and_swap(object, NULL, NULL)
 
 #define ldb_atomic_store_ptr ldb_atomic_store
+#define ldb_atomic_compare_exchange_ptr ldb_atomic_compare_exchange
 
 #elif defined(LDB_MSVC_ATOMICS)
 
@@ -170,12 +178,22 @@ ldb_atomic__load(volatile long *object);
 void
 ldb_atomic__store(volatile long *object, long desired);
 
+int
+ldb_atomic__compare_exchange(volatile long *object,
+                             long expected,
+                             long desired);
+
 void *
 ldb_atomic__load_ptr(void *volatile *object);
 
 void
 ldb_atomic__store_ptr(void *volatile *object, void *desired);
 
+int
+ldb_atomic__compare_exchange_ptr(void *volatile *object,
+                                 void *expected,
+                                 void *desired);
+
 #define ldb_atomic_fetch_add(object, operand, order) \
   ldb_atomic__fetch_add(object, operand)
 
@@ -188,12 +206,20 @@ ldb_atomic__store_ptr(void *volatile *object, void *desired);
 #define ldb_atomic_store(object, desired, order) \
   ldb_atomic__store(object, desired)
 
+#define ldb_atomic_compare_exchange(object, expected, desired, order) \
+  ldb_atomic__compare_exchange(object, expected, desired)
+
 #define ldb_atomic_load_ptr(object, order) \
   ldb_atomic__load_ptr((void *volatile *)(object))
 
 #define ldb_atomic_store_ptr(object, desired, order) \
   ldb_atomic__store_ptr((void *volatile *)(object), (void *)(desired))
 
+#define ldb_atomic_compare_exchange_ptr(object, expected, desired, order) \
+  ldb_atomic__compare_exchange_ptr((void *volatile *)(object),           \
+                                   (void *)(expected),                   \
+                                   (void *)(desired))
+
 #else /* !LDB_MSVC_ATOMICS */
 
 long
@@ -205,12 +231,18 @@ ldb_atomic__load(long *object);
 void
 ldb_atomic__store(long *object, long desired);
 
+int
+ldb_atomic__compare_exchange(long *object, long expected, long desired);
+
 void *
 ldb_atomic__load_ptr(void **object);
 
 void
 ldb_atomic__store_ptr(void **object, void *desired);
 
+int
+ldb_atomic__compare_exchange_ptr(void **object, void *expected, void *desired);
+
 #define ldb_atomic_fetch_add(object, operand, order) \
   ldb_atomic__fetch_add(object, operand)
 
@@ -223,12 +255,20 @@ ldb_atomic__store_ptr(void **object, void *desired);
 #define ldb_atomic_store(object, desired, order) \
   ldb_atomic__store(object, desired)
 
+#define ldb_atomic_compare_exchange(object, expected, desired, order) \
+  ldb_atomic__compare_exchange(object, expected, desired)
+
 #define ldb_atomic_load_ptr(object, order) \
   ldb_atomic__load_ptr((void **)(object))
 
 #define ldb_atomic_store_ptr(object, desired, order) \
   ldb_atomic__store_ptr((void **)(object), (void *)(desired))
 
+#define ldb_atomic_compare_exchange_ptr(object, expected, desired, order) \
+  ldb_atomic__compare_exchange_ptr((void **)(object),                    \
+                                   (void *)(expected),                   \
+                                   (void *)(desired))
+
 #endif /* !LDB_MSVC_ATOMICS */
 
 #endif /* LDB_ATOMICS_H */
@@ -14,8 +14,10 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "atomic.h"
 #include "bloom.h"
 #include "buffer.h"
+#include "coding.h"
 #include "hash.h"
 #include "internal.h"
 #include "slice.h"
@@ -35,6 +37,34 @@ bloom_match(const ldb_bloom_t *bloom,
             const ldb_slice_t *filter,
             const ldb_slice_t *key);
 
+static void
+blocked_build(const ldb_bloom_t *bloom,
+              ldb_buffer_t *dst,
+              const ldb_slice_t *keys,
+              size_t length);
+
+static int
+blocked_match(const ldb_bloom_t *bloom,
+              const ldb_slice_t *filter,
+              const ldb_slice_t *key);
+
+static void
+ribbon_build(const ldb_bloom_t *bloom,
+             ldb_buffer_t *dst,
+             const ldb_slice_t *keys,
+             size_t length);
+
+static int
+ribbon_match(const ldb_bloom_t *bloom,
+             const ldb_slice_t *filter,
+             const ldb_slice_t *key);
+
+typedef struct ribbon_policy_s {
+  ldb_bloom_t ribbon; /* Must be first. */
+  ldb_bloom_t bloom;  /* Policy for levels below bloom_before_level. */
+  int bloom_before_level;
+} ribbon_policy_t;
+
 static const ldb_bloom_t bloom_default = {
   /* .name = */ "leveldb.BuiltinBloomFilter2",
   /* .build = */ bloom_build,
@@ -67,6 +97,38 @@ ldb_bloom_destroy(ldb_bloom_t *bloom) {
   ldb_free(bloom);
 }
 
+ldb_bloom_t *
+ldb_bloom_create_blocked(int bits_per_key) {
+  ldb_bloom_t *bloom = ldb_malloc(sizeof(ldb_bloom_t));
+  ldb_bloom_init_blocked(bloom, bits_per_key);
+  return bloom;
+}
+
+ldb_bloom_t *
+ldb_bloom_create_ribbon(int bits_per_key, int bloom_before_level) {
+  ribbon_policy_t *policy = ldb_malloc(sizeof(ribbon_policy_t));
+  ldb_bloom_t *ribbon = &policy->ribbon;
+  int r = bits_per_key * 0.69 + 0.5; /* FPR of 2^-r. */
+
+  ldb_bloom_init(ribbon, bits_per_key);
+
+  ribbon->name = "lcdb.RibbonFilter";
+  ribbon->build = ribbon_build;
+  ribbon->match = ribbon_match;
+  ribbon->k = r < 1 ? 1 : (r > 8 ? 8 : r); /* Result bits per slot. */
+  ribbon->state = policy;
+
+  /* Blooms are written under the ribbon policy's name; its match
+     function tells the two formats apart. */
+  ldb_bloom_init_blocked(&policy->bloom, bits_per_key);
+
+  policy->bloom.name = ribbon->name;
+  policy->bloom.match = ribbon_match;
+  policy->bloom_before_level = bloom_before_level;
+
+  return ribbon;
+}
+
 void
 ldb_bloom_init(ldb_bloom_t *bloom, int bits_per_key) {
   /* We intentionally round down to reduce probing cost a little bit. */
@@ -85,20 +147,54 @@ ldb_bloom_init(ldb_bloom_t *bloom, int bits_per_key) {
     bloom->k = 30;
 }
 
-int
-ldb_bloom_name(char *buf, size_t size, const ldb_bloom_t *bloom) {
-  const char *name = bloom->name;
-  size_t len = strlen(name);
-
-  if (7 + len + 1 > size)
+static int
+bloom_prefixed_name(char *buf,
+                    size_t size,
+                    const char *prefix,
+                    const ldb_bloom_t *bloom) {
+  size_t plen = strlen(prefix);
+  size_t len = strlen(bloom->name);
+
+  if (plen + len + 1 > size)
     return 0;
 
-  memcpy(buf + 0, "filter.", 7);
-  memcpy(buf + 7, name, len + 1);
+  memcpy(buf + 0, prefix, plen);
+  memcpy(buf + plen, bloom->name, len + 1);
 
   return 1;
 }
 
+void
+ldb_bloom_init_blocked(ldb_bloom_t *bloom, int bits_per_key) {
+  ldb_bloom_init(bloom, bits_per_key);
+
+  bloom->name = "lcdb.CacheLocalBloomFilter";
+  bloom->build = blocked_build;
+  bloom->match = blocked_match;
+}
+
+const ldb_bloom_t *
+ldb_bloom_for_level(const ldb_bloom_t *bloom, int level) {
+  if (bloom->build == ribbon_build) {
+    const ribbon_policy_t *policy = bloom->state;
+
+    if (level < policy->bloom_before_level)
+      return &policy->bloom;
+  }
+
+  return bloom;
+}
+
+int
+ldb_bloom_name(char *buf, size_t size, const ldb_bloom_t *bloom) {
+  return bloom_prefixed_name(buf, size, "filter.", bloom);
+}
+
+int
+ldb_bloom_full_name(char *buf, size_t size, const ldb_bloom_t *bloom) {
+  return bloom_prefixed_name(buf, size, "fullfilter.", bloom);
+}
+
 static uint32_t
 bloom_hash(const ldb_slice_t *key) {
   return ldb_hash(key->data, key->size, 0xbc9f1d34);
@@ -195,3 +291,530 @@ bloom_match(const ldb_bloom_t *bloom,
 
   return 1;
 }
+
+/*
+ * Blocked Bloom
+ */
+
+/* A blocked bloom filter is an array of 64-byte lines followed by
+ * a single byte holding the number of probes. A key hashes to one
+ * line (by multiply-shift rather than modulo) and every probe for
+ * it sets or tests a bit within that line, so a lookup touches a
+ * single cache line.
+ *
+ * Probe i uses the top 9 bits of hash * C^(i + 1). Since each probe
+ * only depends on i, the probes may be computed and tested in
+ * parallel; SIMD variants are provided for AVX2 and NEON. SSE alone
+ * lacks both gathers and per-lane shifts, so it uses the scalar path.
+ */
+
+#define BLOCKED_LINE 64
+#define BLOCKED_MULT 0x9e3779b9
+
+#if defined(__GNUC__) && !defined(LDB_BLOOM_PORTABLE)
+#  if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#    if defined(__clang__) || __GNUC__ > 4 \
+     || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#      define LDB_BLOOM_AVX2
+#    endif
+#  elif defined(__aarch64__) && defined(__ARM_NEON)
+#    define LDB_BLOOM_NEON
+#  endif
+#endif
+
+#if defined(LDB_BLOOM_AVX2)
+#  include <cpuid.h>
+#  include <immintrin.h>
+#elif defined(LDB_BLOOM_NEON)
+#  include <arm_neon.h>
+#endif
+
+static uint32_t
+blocked_hash(const ldb_slice_t *key) {
+  return ldb_hash(key->data, key->size, 0xbc9f1d34);
+}
+
+static size_t
+blocked_lines(const ldb_bloom_t *bloom, size_t n) {
+  size_t bits = n * bloom->bits_per_key;
+  size_t lines = (bits + BLOCKED_LINE * 8 - 1) / (BLOCKED_LINE * 8);
+
+  /* Odd line counts spread keys better across the lines. */
+  return lines | 1;
+}
+
+static LDB_INLINE const uint8_t *
+blocked_line(const uint8_t *data, size_t lines, uint32_t hash) {
+  size_t i = ((uint64_t)hash * lines) >> 32;
+  return data + i * BLOCKED_LINE;
+}
+
+static void
+blocked_build(const ldb_bloom_t *bloom,
+              ldb_buffer_t *dst,
+              const ldb_slice_t *keys,
+              size_t length) {
+  size_t lines = blocked_lines(bloom, length);
+  size_t bytes = lines * BLOCKED_LINE;
+  uint8_t *data;
+  size_t i, j;
+
+  data = ldb_buffer_pad(dst, bytes + 1);
+
+  for (i = 0; i < length; i++) {
+    uint32_t hash = blocked_hash(&keys[i]);
+    uint8_t *line = (uint8_t *)blocked_line(data, lines, hash);
+
+    for (j = 0; j < bloom->k; j++) {
+      uint32_t pos;
+
+      hash *= BLOCKED_MULT;
+      pos = hash >> 23;
+
+      line[pos >> 3] |= (1 << (pos & 7));
+    }
+  }
+
+  data[bytes] = bloom->k; /* Remember # of probes in filter. */
+}
+
+static int
+blocked_probe(const uint8_t *line, uint32_t hash, int k) {
+  int i;
+
+  for (i = 0; i < k; i++) {
+    uint32_t pos;
+
+    hash *= BLOCKED_MULT;
+    pos = hash >> 23;
+
+    if ((line[pos >> 3] & (1 << (pos & 7))) == 0)
+      return 0;
+  }
+
+  return 1;
+}
+
+#if defined(LDB_BLOOM_AVX2)
+
+/* C^1 through C^8, and C^8 to step to the next eight probes. */
+#define BLOCKED_POWERS                                 \
+  (int)0x9e3779b9, (int)0xe35e67b1, (int)0x734297e9, \
+  (int)0x35fbe861, (int)0xdeb7c719, (int)0x448b211, \
+  (int)0x3459b749, (int)0xab25f4c1
+#define BLOCKED_STEP8 ((int)0xab25f4c1)
+
+__attribute__((target("avx2"))) static int
+blocked_probe_avx2(const uint8_t *line, uint32_t hash, int k) {
+  const int *words = (const int *)(const void *)line;
+  __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i hv = _mm256_mullo_epi32(_mm256_set1_epi32((int)hash),
+                                  _mm256_setr_epi32(BLOCKED_POWERS));
+  __m256i step = _mm256_set1_epi32(BLOCKED_STEP8);
+  __m256i ones = _mm256_set1_epi32(1);
+  __m256i low5 = _mm256_set1_epi32(31);
+  int i;
+
+  /* Line words are read little-endian, matching the byte
+     order the bits were set in by blocked_build(). */
+  for (i = 0; i < k; i += 8) {
+    __m256i idx = _mm256_srli_epi32(hv, 28);
+    __m256i pos = _mm256_and_si256(_mm256_srli_epi32(hv, 23), low5);
+    __m256i mask = _mm256_sllv_epi32(ones, pos);
+    __m256i word = _mm256_i32gather_epi32(words, idx, 4);
+
+    if (k - i < 8) {
+      __m256i live = _mm256_cmpgt_epi32(_mm256_set1_epi32(k - i), lanes);
+      mask = _mm256_and_si256(mask, live);
+    }
+
+    if (!_mm256_testc_si256(word, mask))
+      return 0;
+
+    hv = _mm256_mullo_epi32(hv, step);
+  }
+
+  return 1;
+}
+
+static int
+blocked_has_avx2(void) {
+  unsigned int a, b, c, d, lo, hi;
+
+  if (!__get_cpuid(1, &a, &b, &c, &d))
+    return 0;
+
+  if (((c >> 27) & 1) == 0 || ((c >> 28) & 1) == 0)
+    return 0; /* OSXSAVE, AVX */
+
+  __asm__ __volatile__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+
+  (void)hi;
+
+  if ((lo & 6) != 6)
+    return 0; /* XMM and YMM state enabled by the OS. */
+
+  if (__get_cpuid_max(0, NULL) < 7)
+    return 0;
+
+  __cpuid_count(7, 0, a, b, c, d);
+
+  return (b >> 5) & 1; /* AVX2 */
+}
+
+/* 0 = undetected, 1 = scalar, 2 = avx2. */
+static ldb_atomic(int) blocked_backend = 0;
+
+static int
+blocked_detect(void) {
+  int backend = blocked_has_avx2() ? 2 : 1;
+
+  ldb_atomic_store(&blocked_backend, backend, ldb_order_release);
+
+  return backend;
+}
+
+#elif defined(LDB_BLOOM_NEON)
+
+static int
+blocked_probe_neon(const uint8_t *line, uint32_t hash, int k) {
+  static const uint32_t powers[8] = {
+    0x9e3779b9, 0xe35e67b1, 0x734297e9, 0x35fbe861,
+    0xdeb7c719, 0x0448b211, 0x3459b749, 0xab25f4c1
+  };
+  static const uint8_t lane_index[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+  uint32x4_t h = vdupq_n_u32(hash);
+  uint32x4_t lo = vmulq_u32(h, vld1q_u32(powers + 0));
+  uint32x4_t hi = vmulq_u32(h, vld1q_u32(powers + 4));
+  uint32x4_t step = vdupq_n_u32(powers[7]);
+  uint8x8_t lanes = vld1_u8(lane_index);
+  uint8x8_t one = vdup_n_u8(1);
+  uint8x16x4_t table;
+  int i;
+
+  /* The whole line fits in four registers; probes are resolved
+     to byte indices and looked up with a single TBL. */
+  table.val[0] = vld1q_u8(line + 0);
+  table.val[1] = vld1q_u8(line + 16);
+  table.val[2] = vld1q_u8(line + 32);
+  table.val[3] = vld1q_u8(line + 48);
+
+  for (i = 0; i < k; i += 8) {
+    uint8x8_t idx = vmovn_u16(vcombine_u16(vmovn_u32(vshrq_n_u32(lo, 26)),
+                                           vmovn_u32(vshrq_n_u32(hi, 26))));
+    uint8x8_t pos = vmovn_u16(vcombine_u16(vmovn_u32(vshrq_n_u32(lo, 23)),
+                                           vmovn_u32(vshrq_n_u32(hi, 23))));
+    uint8x8_t mask = vshl_u8(one, vreinterpret_s8_u8(vand_u8(pos,
+                                                       vdup_n_u8(7))));
+    uint8x8_t bits = vqtbl4_u8(table, idx);
+    uint8x8_t ok = vceq_u8(vand_u8(bits, mask), mask);
+
+    if (k - i < 8)
+      ok = vorr_u8(ok, vcge_u8(lanes, vdup_n_u8(k - i)));
+
+    if (vget_lane_u64(vreinterpret_u64_u8(ok), 0) != UINT64_MAX)
+      return 0;
+
+    lo = vmulq_u32(lo, step);
+    hi = vmulq_u32(hi, step);
+  }
+
+  return 1;
+}
+
+#endif /* LDB_BLOOM_NEON */
+
+static int
+blocked_match(const ldb_bloom_t *bloom,
+              const ldb_slice_t *filter,
+              const ldb_slice_t *key) {
+  const uint8_t *data = filter->data;
+  size_t len = filter->size;
+  const uint8_t *line;
+  size_t lines;
+  uint32_t hash;
+  int k;
+
+  (void)bloom;
+
+  if (len < BLOCKED_LINE + 1 || (len - 1) % BLOCKED_LINE != 0)
+    return 1; /* Not a filter we know how to read. */
+
+  lines = (len - 1) / BLOCKED_LINE;
+
+  /* Use the encoded k so that we can read filters generated by
+     bloom filters created using different parameters. */
+  k = data[len - 1];
+
+  if (k > 30) {
+    /* Reserved for potentially new encodings. Consider it a match. */
+    return 1;
+  }
+
+  hash = blocked_hash(key);
+  line = blocked_line(data, lines, hash);
+
+#if defined(LDB_BLOOM_AVX2)
+  {
+    int backend = ldb_atomic_load(&blocked_backend, ldb_order_acquire);
+
+    if (UNLIKELY(backend == 0))
+      backend = blocked_detect();
+
+    if (backend == 2)
+      return blocked_probe_avx2(line, hash, k);
+  }
+#elif defined(LDB_BLOOM_NEON)
+  return blocked_probe_neon(line, hash, k);
+#endif
+
+  return blocked_probe(line, hash, k);
+}
+
+/*
+ * Ribbon
+ */
+
+/* A Ribbon filter (Dillinger & Walzer, 2021) stores r bits for each
+ * of m slots. Every key maps to a start slot s, a 64-bit coefficient
+ * row c (with bit 0 set) and an r-bit result; the stored bits z are
+ * chosen so that for every key, the XOR of z[s + i] over all bits i
+ * set in c equals its result. A key not in the set matches with
+ * probability 2^-r.
+ *
+ * The system is solved by Gaussian elimination restricted to the
+ * 64-wide band ("banding"), then back substitution. Banding fails
+ * with small probability, in which case another hash seed is tried
+ * and the table is eventually grown.
+ *
+ * The solution is stored interleaved: for each run of 64 slots, r
+ * little-endian words hold bit j of every slot in the run, so that
+ * a query is r parity computations over two adjacent words. The
+ * filter ends with the slot count (fixed32), the seed, r, and a
+ * marker byte distinguishing it from a blocked bloom filter.
+ */
+
+#define RIBBON_MARKER 0xfe
+#define RIBBON_TRAILER 7
+
+#if LDB_GNUC_PREREQ(3, 4) || LDB_HAS_BUILTIN(__builtin_parityll)
+#  define ribbon_parity(x) __builtin_parityll(x)
+#  define ribbon_ctz(x) __builtin_ctzll(x)
+#else
+static int
+ribbon_parity(uint64_t x) {
+  x ^= x >> 32;
+  x ^= x >> 16;
+  x ^= x >> 8;
+  x ^= x >> 4;
+  x ^= x >> 2;
+  x ^= x >> 1;
+  return x & 1;
+}
+
+static int
+ribbon_ctz(uint64_t x) {
+  int n = 0;
+
+  while ((x & 1) == 0) {
+    x >>= 1;
+    n++;
+  }
+
+  return n;
+}
+#endif
+
+static uint64_t
+ribbon_mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= UINT64_C(0xff51afd7ed558ccd);
+  h ^= h >> 33;
+  h *= UINT64_C(0xc4ceb9fe1a85ec53);
+  h ^= h >> 33;
+  return h;
+}
+
+typedef struct ribbon_row_s {
+  uint32_t start;
+  uint64_t coeff;
+  uint32_t result;
+} ribbon_row_t;
+
+static void
+ribbon_row(ribbon_row_t *row,
+           const ldb_slice_t *key,
+           uint32_t seed,
+           uint32_t slots,
+           int r) {
+  uint64_t h = ldb_hash(key->data, key->size, 0xbc9f1d34);
+
+  h = ribbon_mix(h + (seed + 1) * UINT64_C(0x9e3779b97f4a7c15));
+
+  row->start = ((h >> 32) * (slots - 63)) >> 32;
+  row->coeff = ribbon_mix(h) | 1;
+  row->result = h & ((1 << r) - 1);
+}
+
+static size_t
+ribbon_slots(size_t n) {
+  /* About 6% overhead; the minimum is one full band. */
+  size_t slots = n + n / 16 + 1;
+  return slots < 64 ? 64 : slots;
+}
+
+static int
+ribbon_add(uint64_t *coeffs,
+           uint8_t *results,
+           const ribbon_row_t *row) {
+  uint64_t c = row->coeff;
+  uint32_t res = row->result;
+  size_t i = row->start;
+
+  for (;;) {
+    int tz;
+
+    if (coeffs[i] == 0) {
+      coeffs[i] = c;
+      results[i] = res;
+      return 1;
+    }
+
+    c ^= coeffs[i];
+    res ^= results[i];
+
+    if (c == 0)
+      return res == 0; /* Redundant (e.g. duplicate key) or inconsistent. */
+
+    tz = ribbon_ctz(c);
+    i += tz;
+    c >>= tz;
+  }
+}
+
+static void
+ribbon_build(const ldb_bloom_t *bloom,
+             ldb_buffer_t *dst,
+             const ldb_slice_t *keys,
+             size_t length) {
+  int r = bloom->k;
+  size_t slots = ribbon_slots(length);
+  uint64_t *coeffs = NULL;
+  uint8_t *results = NULL;
+  uint64_t state[8];
+  uint32_t seed = 0;
+  size_t i, words;
+  uint8_t *data;
+  int j;
+
+  for (;;) {
+    coeffs = ldb_realloc(coeffs, slots * sizeof(uint64_t));
+    results = ldb_realloc(results, slots);
+
+    memset(coeffs, 0, slots * sizeof(uint64_t));
+    memset(results, 0, slots);
+
+    for (i = 0; i < length; i++) {
+      ribbon_row_t row;
+
+      ribbon_row(&row, &keys[i], seed, slots, r);
+
+      if (!ribbon_add(coeffs, results, &row))
+        break;
+    }
+
+    if (i == length)
+      break;
+
+    /* Try a few seeds before giving up some space. */
+    seed = (seed + 1) & 0xff;
+
+    if ((seed & 3) == 0)
+      slots += slots / 32 + 1;
+  }
+
+  words = ((slots + 63) / 64) * r;
+  data = ldb_buffer_pad(dst, words * 8 + RIBBON_TRAILER);
+
+  memset(data, 0, words * 8);
+  memset(state, 0, sizeof(state));
+
+  /* Back substitution. state[j] holds bit j of the solution for
+     the 64 slots starting at i (bit 0 is slot i). */
+  for (i = slots; i-- > 0;) {
+    uint8_t *word = data + ((i / 64) * r) * 8;
+    uint64_t c = coeffs[i];
+
+    for (j = 0; j < r; j++) {
+      uint64_t bit = 0;
+
+      state[j] <<= 1;
+
+      if (c != 0)
+        bit = ribbon_parity(c & state[j]) ^ ((results[i] >> j) & 1);
+
+      state[j] |= bit;
+
+      if (bit)
+        word[j * 8 + (i & 63) / 8] |= 1 << (i & 7);
+    }
+  }
+
+  data += words * 8;
+  data = ldb_fixed32_write(data, slots);
+
+  *data++ = seed;
+  *data++ = r;
+  *data++ = RIBBON_MARKER;
+
+  ldb_free(results);
+  ldb_free(coeffs);
+}
+
+static int
+ribbon_match(const ldb_bloom_t *bloom,
+             const ldb_slice_t *filter,
+             const ldb_slice_t *key) {
+  const uint8_t *data = filter->data;
+  size_t len = filter->size;
+  uint32_t slots, seed, off;
+  const uint8_t *block;
+  ribbon_row_t row;
+  int j, r;
+
+  if (len == 0)
+    return 0;
+
+  if (data[len - 1] != RIBBON_MARKER)
+    return blocked_match(bloom, filter, key);
+
+  if (len < RIBBON_TRAILER)
+    return 1;
+
+  slots = ldb_fixed32_decode(data + len - RIBBON_TRAILER);
+  seed = data[len - 3];
+  r = data[len - 2];
+
+  if (r < 1 || r > 8 || slots < 64)
+    return 1;
+
+  if (len - RIBBON_TRAILER != ((slots + 63) / 64) * r * 8)
+    return 1;
+
+  ribbon_row(&row, key, seed, slots, r);
+
+  block = data + (row.start / 64) * r * 8;
+  off = row.start & 63;
+
+  for (j = 0; j < r; j++) {
+    uint64_t window = ldb_fixed64_decode(block + j * 8) >> off;
+
+    if (off != 0)
+      window |= ldb_fixed64_decode(block + (r + j) * 8) << (64 - off);
+
+    if ((uint32_t)ribbon_parity(window & row.coeff) != ((row.result >> j) & 1))
+      return 0;
+  }
+
+  return 1;
+}
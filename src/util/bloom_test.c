@@ -82,9 +82,8 @@ next_length(int length) {
 }
 
 static void
-test_varying_lengths(int verbose) {
+test_varying_lengths(const ldb_bloom_t *bloom, size_t slack, int verbose) {
   ldb_slice_t *keys = ldb_malloc(10000 * sizeof(ldb_slice_t));
-  const ldb_bloom_t *bloom = ldb_bloom_default;
   uint8_t *bufs = ldb_malloc(10000 * 4);
   int mediocre_filters = 0;
   int good_filters = 0;
@@ -106,7 +105,7 @@ test_varying_lengths(int verbose) {
     ldb_buffer_reset(&filter);
     ldb_bloom_build(bloom, &filter, keys, length);
 
-    ASSERT(filter.size <= ((size_t)length * 10 / 8) + 40);
+    ASSERT(filter.size <= ((size_t)length * 10 / 8) + slack);
 
     /* All added keys must match. */
     for (i = 0; i < length; i++) {
@@ -154,13 +153,128 @@ test_varying_lengths(int verbose) {
   ldb_free(bufs);
 }
 
+static void
+test_blocked_probes(void) {
+  uint8_t *bufs = ldb_malloc(1000 * 4);
+  ldb_slice_t keys[1000];
+  ldb_buffer_t filter;
+  ldb_bloom_t bloom;
+  int bits, i;
+
+  ldb_buffer_init(&filter);
+
+  /* Cover probe counts on either side of the SIMD width. */
+  for (bits = 1; bits <= 44; bits++) {
+    int fp = 0;
+
+    ldb_bloom_init_blocked(&bloom, bits);
+
+    for (i = 0; i < 1000; i++)
+      keys[i] = bloom_key(i, &bufs[i * 4]);
+
+    ldb_buffer_reset(&filter);
+    ldb_bloom_build(&bloom, &filter, keys, 1000);
+
+    ASSERT(filter.data[filter.size - 1] == bloom.k);
+
+    for (i = 0; i < 1000; i++)
+      ASSERT(ldb_bloom_match(&bloom, &filter, &keys[i]));
+
+    for (i = 0; i < 1000; i++) {
+      ldb_slice_t key = bloom_key(i + 1000000000, &bufs[i * 4]);
+
+      fp += ldb_bloom_match(&bloom, &filter, &key);
+    }
+
+    ASSERT(bits < 8 || fp < 100);
+  }
+
+  /* Filters from the default policy are not blocked filters. */
+  ldb_bloom_init(&bloom, 10);
+  ldb_buffer_reset(&filter);
+  ldb_bloom_build(&bloom, &filter, keys, 3);
+
+  ldb_bloom_init_blocked(&bloom, 10);
+  ASSERT(ldb_bloom_match(&bloom, &filter, &keys[0]));
+  ASSERT(strcmp(bloom.name, ldb_bloom_default->name) != 0);
+
+  ldb_buffer_clear(&filter);
+  ldb_free(bufs);
+}
+
+static void
+test_ribbon(void) {
+  ldb_bloom_t *ribbon = ldb_bloom_create_ribbon(10, 3);
+  const ldb_bloom_t *bloom = ldb_bloom_for_level(ribbon, 2);
+  ldb_slice_t *keys = ldb_malloc(10100 * sizeof(ldb_slice_t));
+  uint8_t *bufs = ldb_malloc(10100 * 4);
+  ldb_buffer_t filter, blocked;
+  uint8_t buffer[4];
+  int i, fp;
+
+  ASSERT(ldb_bloom_for_level(ribbon, 3) == ribbon);
+  ASSERT(ldb_bloom_for_level(ribbon, 6) == ribbon);
+  ASSERT(bloom != ribbon);
+  ASSERT(strcmp(bloom->name, ribbon->name) == 0);
+  ASSERT(ldb_bloom_for_level(ldb_bloom_default, 0) == ldb_bloom_default);
+
+  /* Include some keys twice; duplicates must not break banding. */
+  for (i = 0; i < 10100; i++)
+    keys[i] = bloom_key(i % 10000, &bufs[i * 4]);
+
+  ldb_buffer_init(&filter);
+  ldb_buffer_init(&blocked);
+
+  ldb_bloom_build(ribbon, &filter, keys, 10100);
+  ldb_bloom_build(bloom, &blocked, keys, 10000);
+
+  fprintf(stderr, "Ribbon: %d bytes, blocked bloom: %d bytes\n",
+                  (int)filter.size, (int)blocked.size);
+
+  /* About 7.5 bits per key for a bloom-equivalent of 10. */
+  ASSERT(filter.size * 8 < 10000 * 8);
+
+  for (i = 0; i < 10000; i++) {
+    ASSERT(ldb_bloom_match(ribbon, &filter, &keys[i]));
+    ASSERT(ldb_bloom_match(ribbon, &blocked, &keys[i]));
+  }
+
+  fp = 0;
+
+  for (i = 0; i < 100000; i++) {
+    ldb_slice_t key = bloom_key(i + 1000000000, buffer);
+    fp += ldb_bloom_match(ribbon, &filter, &key);
+  }
+
+  fprintf(stderr, "Ribbon false positives: %5.2f%%\n", fp / 1000.0);
+
+  ASSERT(fp <= 1200); /* 2^-7 = 0.78% */
+
+  ldb_buffer_clear(&blocked);
+  ldb_buffer_clear(&filter);
+  ldb_bloom_destroy(ribbon);
+  ldb_free(bufs);
+  ldb_free(keys);
+}
+
 LDB_EXTERN int
 ldb_test_bloom(void);
 
 int
 ldb_test_bloom(void) {
+  ldb_bloom_t *blocked = ldb_bloom_create_blocked(10);
+  ldb_bloom_t *ribbon = ldb_bloom_create_ribbon(10, 0);
+
   test_empty_filter();
   test_small_filter();
-  test_varying_lengths(1);
+  test_varying_lengths(ldb_bloom_default, 40, 1);
+  test_varying_lengths(blocked, 2 * 64 + 1, 1);
+  test_blocked_probes();
+  test_varying_lengths(ribbon, 64, 1);
+  test_ribbon();
+
+  ldb_bloom_destroy(ribbon);
+  ldb_bloom_destroy(blocked);
+
   return 0;
 }
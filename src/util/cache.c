@@ -14,11 +14,13 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include "atomic.h"
 #include "cache.h"
 #include "hash.h"
 #include "internal.h"
 #include "port.h"
 #include "slice.h"
+#include "vector.h"
 
 /* LRU cache implementation
  *
@@ -43,6 +45,36 @@
  * external reference.
  */
 
+/* CLOCK cache implementation
+ *
+ * Every entry lives in a "slot" which is never freed until the cache itself
+ * is destroyed. A slot holds a single atomic word containing the number of
+ * external references along with two flags:
+ *
+ * - LOCKED: the slot is not visible to lookups. Free slots, slots being
+ *   evicted, and erased slots which are still referenced are locked.
+ *
+ * - ERASED: the slot was erased while still referenced. Whoever drops the
+ *   last reference hands the slot back to the shard (under its mutex).
+ *
+ * A lookup walks the hash chain without a lock, pins a candidate slot by
+ * incrementing its reference count, and only then checks that the slot is
+ * unlocked and holds the wanted key. A slot can only be locked by a writer
+ * if its reference count is zero at the moment the flag is added, so a
+ * pinned, unlocked slot cannot change underneath the reader. The word is
+ * only ever modified by adding and subtracting deltas, meaning readers
+ * which pin a locked slot can simply back off again.
+ *
+ * Inserts, erases and evictions take the shard mutex. Eviction follows the
+ * (generalized) CLOCK algorithm: a hit bumps the slot's small saturating
+ * "usage" counter and the hand, sweeping over all slots, decrements the
+ * counter or evicts unreferenced slots whose counter has reached zero.
+ *
+ * Hash chains are only rewired under the mutex. A reader racing with a
+ * writer may end up following a slot onto another chain and miss an entry
+ * which is present; this merely costs a spurious cache miss.
+ */
+
 /*
  * Constants
  */
@@ -50,6 +82,15 @@
 #define LDB_SHARD_BITS 4
 #define LDB_SHARDS (1 << LDB_SHARD_BITS)
 
+#define LDB_CLOCK_MAX_BITS 6
+#define LDB_CLOCK_MIN_CAPACITY 64
+#define LDB_CLOCK_MAX_CHAIN 1024
+#define LDB_CLOCK_MAX_USAGE 3
+
+#define LDB_CLOCK_LOCKED (UINT32_C(1) << 30)
+#define LDB_CLOCK_ERASED (UINT32_C(1) << 29)
+#define LDB_CLOCK_REFS (LDB_CLOCK_ERASED - 1)
+
 /*
  * LRU Handle
  */
@@ -147,7 +188,7 @@ ldb_lrutable_resize(ldb_lrutable_t *tbl) {
   assert(tbl->elems == count);
 
   if (tbl->list != NULL)
-    ldb_free(tbl->list);
+    ldb_free((void *)tbl->list);
 
   tbl->list = new_list;
   tbl->length = new_length;
@@ -165,7 +206,7 @@ ldb_lrutable_init(ldb_lrutable_t *tbl) {
 static void
 ldb_lrutable_clear(ldb_lrutable_t *tbl) {
   if (tbl->list != NULL)
-    ldb_free(tbl->list);
+    ldb_free((void *)tbl->list);
 }
 
 static ldb_lruhandle_t *
@@ -449,12 +490,535 @@ ldb_shard_insert(ldb_shard_t *lru,
   return e;
 }
 
+
+/*
+ * Clock Slot
+ */
+
+struct ldb_clockshard_s;
+
+typedef struct ldb_clockslot_s {
+  void *value; /* Must be first; see ldb_lru_value(). */
+  void (*deleter)(const ldb_slice_t *key, void *value);
+  ldb_atomic(uint32_t) meta;  /* References and LOCKED/ERASED flags. */
+  ldb_atomic(uint32_t) hash;  /* Hash of key; read racily by lookups. */
+  ldb_atomic(int) usage;      /* Recent hits (saturating). */
+  ldb_atomic_ptr(struct ldb_clockslot_s) next_hash;
+  struct ldb_clockshard_s *shard;
+  /* The following are protected by the shard mutex,
+     or are stable while the slot is pinned. */
+  struct ldb_clockslot_s *next_free;
+  size_t charge;
+  uint8_t *key_data;
+  size_t key_length;
+  size_t key_alloc;
+  int pending; /* Erased, but not yet handed back to the shard. */
+} ldb_clockslot_t;
+
+static ldb_slice_t
+ldb_clockslot_key(const ldb_clockslot_t *e) {
+  ldb_slice_t key;
+  ldb_slice_set(&key, e->key_data, e->key_length);
+  return key;
+}
+
+static int
+clockslot_equal(const ldb_clockslot_t *x, const ldb_slice_t *y) {
+  if (x->key_length != y->size)
+    return 0;
+
+  if (x->key_length == 0)
+    return 1;
+
+  return memcmp(x->key_data, y->data, y->size) == 0;
+}
+
+/*
+ * Clock Table
+ */
+
+typedef struct ldb_clocktable_s {
+  uint32_t length;
+  ldb_atomic_ptr(ldb_clockslot_t) *list;
+} ldb_clocktable_t;
+
+static ldb_clocktable_t *
+ldb_clocktable_create(uint32_t length) {
+  ldb_clocktable_t *tbl = ldb_malloc(sizeof(ldb_clocktable_t));
+  uint32_t i;
+
+  tbl->length = length;
+  tbl->list = ldb_malloc(length * sizeof(tbl->list[0]));
+
+  for (i = 0; i < length; i++)
+    ldb_atomic_store_ptr(&tbl->list[i], NULL, ldb_order_relaxed);
+
+  return tbl;
+}
+
+static void
+ldb_clocktable_destroy(ldb_clocktable_t *tbl) {
+  ldb_free((void *)tbl->list);
+  ldb_free(tbl);
+}
+
+/*
+ * Clock Shard
+ */
+
+typedef struct ldb_clockshard_s {
+  /* Initialized before use. */
+  size_t capacity;
+
+  /* mutex protects the following state. */
+  ldb_mutex_t mutex;
+  size_t usage;
+  uint32_t elems;
+
+  /* Current hash table. Superseded tables are kept
+     around (in tables) as readers may still hold them. */
+  ldb_atomic_ptr(ldb_clocktable_t) table;
+  ldb_vector_t tables;
+
+  /* Every slot ever allocated, in clock order. */
+  ldb_vector_t slots;
+  size_t hand;
+
+  /* Unused slots. */
+  ldb_clockslot_t *free;
+} ldb_clockshard_t;
+
+static ldb_clocktable_t *
+ldb_clockshard_table(ldb_clockshard_t *lru) {
+  return ldb_atomic_load_ptr(&lru->table, ldb_order_acquire);
+}
+
+static void
+ldb_clockshard_init(ldb_clockshard_t *lru, size_t capacity) {
+  ldb_clocktable_t *tbl = ldb_clocktable_create(16);
+
+  ldb_mutex_init(&lru->mutex);
+
+  lru->capacity = capacity;
+  lru->usage = 0;
+  lru->elems = 0;
+
+  ldb_atomic_store_ptr(&lru->table, tbl, ldb_order_relaxed);
+
+  ldb_vector_init(&lru->tables);
+  ldb_vector_init(&lru->slots);
+  ldb_vector_push(&lru->tables, tbl);
+
+  lru->hand = 0;
+  lru->free = NULL;
+}
+
+static void
+ldb_clockshard_clear(ldb_clockshard_t *lru) {
+  size_t i;
+
+  for (i = 0; i < lru->slots.length; i++) {
+    ldb_clockslot_t *e = lru->slots.items[i];
+    uint32_t meta = ldb_atomic_load(&e->meta, ldb_order_acquire);
+
+    /* Error if caller has an unreleased handle. */
+    assert((meta & LDB_CLOCK_REFS) == 0);
+    assert(!e->pending);
+
+    if (!(meta & LDB_CLOCK_LOCKED)) {
+      ldb_slice_t key = ldb_clockslot_key(e);
+
+      e->deleter(&key, e->value);
+    }
+
+    if (e->key_data != NULL)
+      ldb_free(e->key_data);
+
+    ldb_free(e);
+  }
+
+  for (i = 0; i < lru->tables.length; i++)
+    ldb_clocktable_destroy(lru->tables.items[i]);
+
+  ldb_vector_clear(&lru->slots);
+  ldb_vector_clear(&lru->tables);
+
+  ldb_mutex_destroy(&lru->mutex);
+}
+
+static size_t
+ldb_clockshard_total_charge(ldb_clockshard_t *lru) {
+  size_t usage;
+  ldb_mutex_lock(&lru->mutex);
+  usage = lru->usage;
+  ldb_mutex_unlock(&lru->mutex);
+  return usage;
+}
+
+/* Hand a locked, unreferenced slot back to the free list. */
+static void
+ldb_clockshard_recycle(ldb_clockshard_t *lru, ldb_clockslot_t *e) {
+  ldb_slice_t key = ldb_clockslot_key(e);
+
+  e->deleter(&key, e->value);
+
+  e->value = NULL;
+  e->deleter = NULL;
+  e->next_free = lru->free;
+
+  lru->free = e;
+}
+
+/* Reclaim an erased slot if its last reference is gone. REQUIRES: mutex. */
+static void
+ldb_clockshard_reclaim(ldb_clockshard_t *lru, ldb_clockslot_t *e) {
+  uint32_t meta;
+
+  if (!e->pending)
+    return;
+
+  meta = ldb_atomic_load(&e->meta, ldb_order_acquire);
+
+  if (meta & LDB_CLOCK_REFS)
+    return;
+
+  e->pending = 0;
+
+  ldb_atomic_fetch_sub(&e->meta, LDB_CLOCK_ERASED, ldb_order_relaxed);
+
+  ldb_clockshard_recycle(lru, e);
+}
+
+static void
+ldb_clockshard_unref(ldb_clockshard_t *lru, ldb_clockslot_t *e) {
+  uint32_t old = ldb_atomic_fetch_sub(&e->meta, 1, ldb_order_acq_rel);
+
+  assert((old & LDB_CLOCK_REFS) > 0);
+
+  if (UNLIKELY((old & LDB_CLOCK_ERASED) && (old & LDB_CLOCK_REFS) == 1)) {
+    ldb_mutex_lock(&lru->mutex);
+    ldb_clockshard_reclaim(lru, e);
+    ldb_mutex_unlock(&lru->mutex);
+  }
+}
+
+/* Pin a slot. Returns 0 (and leaves it unpinned) if the slot is locked. */
+static int
+ldb_clockshard_ref(ldb_clockshard_t *lru, ldb_clockslot_t *e) {
+  uint32_t old = ldb_atomic_fetch_add(&e->meta, 1, ldb_order_acquire);
+
+  if (old & LDB_CLOCK_LOCKED) {
+    ldb_clockshard_unref(lru, e);
+    return 0;
+  }
+
+  return 1;
+}
+
+static ldb_clockslot_t *
+ldb_clockshard_lookup(ldb_clockshard_t *lru,
+                      const ldb_slice_t *key,
+                      uint32_t hash) {
+  ldb_clocktable_t *tbl = ldb_clockshard_table(lru);
+  ldb_atomic_ptr(ldb_clockslot_t) *ptr = &tbl->list[hash & (tbl->length - 1)];
+  ldb_clockslot_t *e = ldb_atomic_load_ptr(ptr, ldb_order_acquire);
+  int steps = 0;
+
+  while (e != NULL && steps++ < LDB_CLOCK_MAX_CHAIN) {
+    if ((uint32_t)ldb_atomic_load(&e->hash, ldb_order_relaxed) == hash) {
+      if (ldb_clockshard_ref(lru, e)) {
+        /* Pinned and visible: the key can no longer change. */
+        if ((uint32_t)ldb_atomic_load(&e->hash, ldb_order_relaxed) == hash
+            && clockslot_equal(e, key)) {
+          int usage = ldb_atomic_load(&e->usage, ldb_order_relaxed);
+
+          /* Racy increments may be lost; that is fine. */
+          if (usage < LDB_CLOCK_MAX_USAGE)
+            ldb_atomic_store(&e->usage, usage + 1, ldb_order_relaxed);
+
+          return e;
+        }
+
+        ldb_clockshard_unref(lru, e);
+      }
+    }
+
+    e = ldb_atomic_load_ptr(&e->next_hash, ldb_order_acquire);
+  }
+
+  return NULL;
+}
+
+/* Find the link pointing at a visible entry. REQUIRES: mutex. */
+static ldb_atomic_ptr(ldb_clockslot_t) *
+ldb_clockshard_find(ldb_clockshard_t *lru,
+                    const ldb_slice_t *key,
+                    uint32_t hash) {
+  ldb_clocktable_t *tbl = ldb_clockshard_table(lru);
+  ldb_atomic_ptr(ldb_clockslot_t) *ptr = &tbl->list[hash & (tbl->length - 1)];
+  ldb_clockslot_t *e;
+
+  for (;;) {
+    e = ldb_atomic_load_ptr(ptr, ldb_order_relaxed);
+
+    if (e == NULL)
+      break;
+
+    if ((uint32_t)ldb_atomic_load(&e->hash, ldb_order_relaxed) == hash
+        && clockslot_equal(e, key)) {
+      break;
+    }
+
+    ptr = &e->next_hash;
+  }
+
+  return ptr;
+}
+
+/* Unlink a visible entry from its hash chain. REQUIRES: mutex. */
+static void
+ldb_clockshard_unlink(ldb_clockshard_t *lru, ldb_clockslot_t *e) {
+  ldb_slice_t key = ldb_clockslot_key(e);
+  uint32_t hash = ldb_atomic_load(&e->hash, ldb_order_relaxed);
+  ldb_atomic_ptr(ldb_clockslot_t) *ptr = ldb_clockshard_find(lru, &key, hash);
+  void *next = ldb_atomic_load_ptr(&e->next_hash, ldb_order_relaxed);
+
+  assert(ldb_atomic_load_ptr(ptr, ldb_order_relaxed) == (void *)e);
+
+  ldb_atomic_store_ptr(ptr, next, ldb_order_release);
+
+  lru->usage -= e->charge;
+  lru->elems--;
+}
+
+/* Remove a visible entry from the cache. Readers which
+   still hold it keep it alive. REQUIRES: mutex. */
+static void
+ldb_clockshard_finish_erase(ldb_clockshard_t *lru, ldb_clockslot_t *e) {
+  ldb_clockshard_unlink(lru, e);
+
+  ldb_atomic_fetch_add(&e->meta,
+                       LDB_CLOCK_LOCKED | LDB_CLOCK_ERASED,
+                       ldb_order_acq_rel);
+
+  e->pending = 1;
+
+  ldb_clockshard_reclaim(lru, e);
+}
+
+/* Evict an entry if it is not referenced. REQUIRES: mutex. */
+static int
+ldb_clockshard_evict(ldb_clockshard_t *lru, ldb_clockslot_t *e) {
+  uint32_t old = ldb_atomic_load(&e->meta, ldb_order_relaxed);
+
+  if (old & (LDB_CLOCK_LOCKED | LDB_CLOCK_REFS))
+    return 0;
+
+  old = ldb_atomic_fetch_add(&e->meta, LDB_CLOCK_LOCKED, ldb_order_acq_rel);
+
+  if (old & LDB_CLOCK_REFS) {
+    /* Lost a race with a reader. */
+    ldb_atomic_fetch_sub(&e->meta, LDB_CLOCK_LOCKED, ldb_order_release);
+    return 0;
+  }
+
+  ldb_clockshard_unlink(lru, e);
+  ldb_clockshard_recycle(lru, e);
+
+  return 1;
+}
+
+static void
+ldb_clockshard_sweep(ldb_clockshard_t *lru) {
+  size_t steps = (LDB_CLOCK_MAX_USAGE + 1) * lru->slots.length;
+  int usage;
+
+  while (lru->usage > lru->capacity && steps-- > 0) {
+    ldb_clockslot_t *e = lru->slots.items[lru->hand];
+
+    if (++lru->hand == lru->slots.length)
+      lru->hand = 0;
+
+    usage = ldb_atomic_load(&e->usage, ldb_order_relaxed);
+
+    if (usage > 0) {
+      ldb_atomic_store(&e->usage, usage - 1, ldb_order_relaxed);
+      continue;
+    }
+
+    ldb_clockshard_evict(lru, e);
+  }
+}
+
+/* Double the hash table. REQUIRES: mutex. */
+static void
+ldb_clockshard_resize(ldb_clockshard_t *lru) {
+  ldb_clocktable_t *old = ldb_clockshard_table(lru);
+  ldb_clocktable_t *tbl = ldb_clocktable_create(old->length * 2);
+  uint32_t i;
+
+  for (i = 0; i < old->length; i++) {
+    ldb_clockslot_t *e = ldb_atomic_load_ptr(&old->list[i],
+                                             ldb_order_relaxed);
+
+    while (e != NULL) {
+      ldb_clockslot_t *next = ldb_atomic_load_ptr(&e->next_hash,
+                                                  ldb_order_relaxed);
+      uint32_t hash = ldb_atomic_load(&e->hash, ldb_order_relaxed);
+      ldb_atomic_ptr(ldb_clockslot_t) *ptr = &tbl->list[hash & (tbl->length - 1)];
+      void *head = ldb_atomic_load_ptr(ptr, ldb_order_relaxed);
+
+      ldb_atomic_store_ptr(&e->next_hash, head, ldb_order_release);
+      ldb_atomic_store_ptr(ptr, e, ldb_order_relaxed);
+
+      e = next;
+    }
+  }
+
+  ldb_vector_push(&lru->tables, tbl);
+
+  ldb_atomic_store_ptr(&lru->table, tbl, ldb_order_release);
+}
+
+static ldb_clockslot_t *
+ldb_clockshard_alloc(ldb_clockshard_t *lru) {
+  ldb_clockslot_t *e = lru->free;
+
+  if (e != NULL) {
+    lru->free = e->next_free;
+    return e;
+  }
+
+  e = ldb_malloc(sizeof(ldb_clockslot_t));
+
+  e->value = NULL;
+  e->deleter = NULL;
+  e->shard = lru;
+  e->next_free = NULL;
+  e->charge = 0;
+  e->key_data = NULL;
+  e->key_length = 0;
+  e->key_alloc = 0;
+  e->pending = 0;
+
+  ldb_atomic_store(&e->meta, LDB_CLOCK_LOCKED, ldb_order_relaxed);
+  ldb_atomic_store(&e->hash, 0, ldb_order_relaxed);
+  ldb_atomic_store(&e->usage, 0, ldb_order_relaxed);
+  ldb_atomic_store_ptr(&e->next_hash, NULL, ldb_order_relaxed);
+
+  ldb_vector_push(&lru->slots, e);
+
+  return e;
+}
+
+static ldb_clockslot_t *
+ldb_clockshard_insert(ldb_clockshard_t *lru,
+                      const ldb_slice_t *key,
+                      uint32_t hash,
+                      void *value,
+                      size_t charge,
+                      void (*deleter)(const ldb_slice_t *key, void *value)) {
+  ldb_atomic_ptr(ldb_clockslot_t) *ptr;
+  ldb_clockslot_t *e, *old;
+  ldb_clocktable_t *tbl;
+
+  ldb_mutex_lock(&lru->mutex);
+
+  e = ldb_clockshard_alloc(lru);
+
+  if (key->size > e->key_alloc) {
+    e->key_data = ldb_realloc(e->key_data, key->size);
+    e->key_alloc = key->size;
+  }
+
+  if (key->size > 0)
+    memcpy(e->key_data, key->data, key->size);
+
+  e->key_length = key->size;
+  e->value = value;
+  e->deleter = deleter;
+  e->charge = charge;
+
+  ldb_atomic_store(&e->hash, hash, ldb_order_relaxed);
+  ldb_atomic_store(&e->usage, 0, ldb_order_relaxed);
+
+  if (lru->capacity == 0) {
+    /* Don't cache (capacity==0 is supported and turns off caching). */
+    /* The slot is handed back once the returned handle is released. */
+    ldb_atomic_fetch_add(&e->meta, LDB_CLOCK_ERASED + 1, ldb_order_release);
+    e->pending = 1;
+    ldb_mutex_unlock(&lru->mutex);
+    return e;
+  }
+
+  ptr = ldb_clockshard_find(lru, key, hash);
+  old = ldb_atomic_load_ptr(ptr, ldb_order_relaxed);
+
+  if (old != NULL)
+    ldb_clockshard_finish_erase(lru, old);
+
+  tbl = ldb_clockshard_table(lru);
+  ptr = &tbl->list[hash & (tbl->length - 1)];
+
+  ldb_atomic_store_ptr(&e->next_hash,
+                       ldb_atomic_load_ptr(ptr, ldb_order_relaxed),
+                       ldb_order_relaxed);
+
+  /* Unlock with a single reference for the returned handle. */
+  ldb_atomic_fetch_sub(&e->meta, LDB_CLOCK_LOCKED - 1, ldb_order_release);
+  ldb_atomic_store_ptr(ptr, e, ldb_order_release);
+
+  lru->usage += charge;
+  lru->elems++;
+
+  if (lru->elems > tbl->length)
+    ldb_clockshard_resize(lru);
+
+  ldb_clockshard_sweep(lru);
+
+  ldb_mutex_unlock(&lru->mutex);
+
+  return e;
+}
+
+static void
+ldb_clockshard_erase(ldb_clockshard_t *lru,
+                     const ldb_slice_t *key,
+                     uint32_t hash) {
+  ldb_atomic_ptr(ldb_clockslot_t) *ptr;
+  ldb_clockslot_t *e;
+
+  ldb_mutex_lock(&lru->mutex);
+
+  ptr = ldb_clockshard_find(lru, key, hash);
+  e = ldb_atomic_load_ptr(ptr, ldb_order_relaxed);
+
+  if (e != NULL)
+    ldb_clockshard_finish_erase(lru, e);
+
+  ldb_mutex_unlock(&lru->mutex);
+}
+
+static void
+ldb_clockshard_prune(ldb_clockshard_t *lru) {
+  size_t i;
+
+  ldb_mutex_lock(&lru->mutex);
+
+  for (i = 0; i < lru->slots.length; i++)
+    ldb_clockshard_evict(lru, lru->slots.items[i]);
+
+  ldb_mutex_unlock(&lru->mutex);
+}
+
 /*
  * LRU Cache
  */
 
 struct ldb_lru_s {
-  ldb_shard_t shard[LDB_SHARDS];
+  ldb_shard_t *shard;      /* LRU shards (NULL for a CLOCK cache). */
+  ldb_clockshard_t *clock; /* CLOCK shards (NULL for an LRU cache). */
+  int shard_bits;
   ldb_mutex_t id_mutex;
   uint64_t last_id;
 };
@@ -465,8 +1029,16 @@ ldb_lru_hash(const ldb_slice_t *s) {
 }
 
 static uint32_t
-ldb_lru_shard(uint32_t hash) {
-  return hash >> (32 - LDB_SHARD_BITS);
+ldb_lru_shard(const ldb_lru_t *lru, uint32_t hash) {
+  if (lru->shard_bits == 0)
+    return 0;
+
+  return hash >> (32 - lru->shard_bits);
+}
+
+static int
+ldb_lru_shards(const ldb_lru_t *lru) {
+  return 1 << lru->shard_bits;
 }
 
 static void
@@ -476,6 +1048,9 @@ ldb_lru_init(ldb_lru_t *lru, size_t capacity) {
 
   ldb_mutex_init(&lru->id_mutex);
 
+  lru->shard = ldb_malloc(LDB_SHARDS * sizeof(ldb_shard_t));
+  lru->clock = NULL;
+  lru->shard_bits = LDB_SHARD_BITS;
   lru->last_id = 0;
 
   for (i = 0; i < LDB_SHARDS; i++) {
@@ -485,12 +1060,54 @@ ldb_lru_init(ldb_lru_t *lru, size_t capacity) {
   }
 }
 
+static int
+ldb_clock_shard_bits(size_t capacity) {
+  int cpus = ldb_cpu_count();
+  int bits = 0;
+
+  /* Aim for two shards per core... */
+  while (bits < LDB_CLOCK_MAX_BITS && (1 << bits) < 2 * cpus)
+    bits++;
+
+  /* ...without making the shards uselessly small. */
+  while (bits > 0 && (capacity >> bits) < LDB_CLOCK_MIN_CAPACITY)
+    bits--;
+
+  return bits;
+}
+
+static void
+ldb_lru_init_clock(ldb_lru_t *lru, size_t capacity) {
+  int bits = ldb_clock_shard_bits(capacity);
+  size_t per_shard = (capacity + (1 << bits) - 1) >> bits;
+  int i;
+
+  ldb_mutex_init(&lru->id_mutex);
+
+  lru->shard = NULL;
+  lru->clock = ldb_malloc(((size_t)1 << bits) * sizeof(ldb_clockshard_t));
+  lru->shard_bits = bits;
+  lru->last_id = 0;
+
+  for (i = 0; i < ldb_lru_shards(lru); i++)
+    ldb_clockshard_init(&lru->clock[i], per_shard);
+}
+
 static void
 ldb_lru_clear(ldb_lru_t *lru) {
   int i;
 
-  for (i = 0; i < LDB_SHARDS; i++)
-    ldb_shard_clear(&lru->shard[i]);
+  for (i = 0; i < ldb_lru_shards(lru); i++) {
+    if (lru->clock != NULL)
+      ldb_clockshard_clear(&lru->clock[i]);
+    else
+      ldb_shard_clear(&lru->shard[i]);
+  }
+
+  if (lru->clock != NULL)
+    ldb_free(lru->clock);
+  else
+    ldb_free(lru->shard);
 
   ldb_mutex_destroy(&lru->id_mutex);
 }
@@ -502,6 +1119,13 @@ ldb_lru_create(size_t capacity) {
   return lru;
 }
 
+ldb_lru_t *
+ldb_lru_create_clock(size_t capacity) {
+  ldb_lru_t *lru = ldb_malloc(sizeof(ldb_lru_t));
+  ldb_lru_init_clock(lru, capacity);
+  return lru;
+}
+
 void
 ldb_lru_destroy(ldb_lru_t *lru) {
   ldb_lru_clear(lru);
@@ -515,33 +1139,58 @@ ldb_lru_insert(ldb_lru_t *lru,
                size_t charge,
                void (*deleter)(const ldb_slice_t *key, void *value)) {
   uint32_t hash = ldb_lru_hash(key);
-  ldb_shard_t *shard = &lru->shard[ldb_lru_shard(hash)];
-  return ldb_shard_insert(shard, key, hash, value, charge, deleter);
+  uint32_t index = ldb_lru_shard(lru, hash);
+
+  if (lru->clock != NULL) {
+    ldb_clockshard_t *shard = &lru->clock[index];
+    ldb_clockslot_t *e = ldb_clockshard_insert(shard, key, hash, value,
+                                               charge, deleter);
+    return (ldb_lruhandle_t *)e;
+  }
+
+  return ldb_shard_insert(&lru->shard[index], key, hash,
+                          value, charge, deleter);
 }
 
 ldb_lruhandle_t *
 ldb_lru_lookup(ldb_lru_t *lru, const ldb_slice_t *key) {
   uint32_t hash = ldb_lru_hash(key);
-  ldb_shard_t *shard = &lru->shard[ldb_lru_shard(hash)];
-  return ldb_shard_lookup(shard, key, hash);
+  uint32_t index = ldb_lru_shard(lru, hash);
+
+  if (lru->clock != NULL) {
+    ldb_clockshard_t *shard = &lru->clock[index];
+    return (ldb_lruhandle_t *)ldb_clockshard_lookup(shard, key, hash);
+  }
+
+  return ldb_shard_lookup(&lru->shard[index], key, hash);
 }
 
 void
 ldb_lru_release(ldb_lru_t *lru, ldb_lruhandle_t *handle) {
-  ldb_shard_t *shard = &lru->shard[ldb_lru_shard(handle->hash)];
-  ldb_shard_release(shard, handle);
+  if (lru->clock != NULL) {
+    ldb_clockslot_t *e = (ldb_clockslot_t *)handle;
+    ldb_clockshard_unref(e->shard, e);
+  } else {
+    ldb_shard_t *shard = &lru->shard[ldb_lru_shard(lru, handle->hash)];
+    ldb_shard_release(shard, handle);
+  }
 }
 
 void
 ldb_lru_erase(ldb_lru_t *lru, const ldb_slice_t *key) {
   uint32_t hash = ldb_lru_hash(key);
-  ldb_shard_t *shard = &lru->shard[ldb_lru_shard(hash)];
-  ldb_shard_erase(shard, key, hash);
+  uint32_t index = ldb_lru_shard(lru, hash);
+
+  if (lru->clock != NULL)
+    ldb_clockshard_erase(&lru->clock[index], key, hash);
+  else
+    ldb_shard_erase(&lru->shard[index], key, hash);
 }
 
 void *
 ldb_lru_value(ldb_lruhandle_t *handle) {
-  return handle->value;
+  /* Both handle types begin with the value pointer. */
+  return *((void **)handle);
 }
 
 uint32_t
@@ -557,8 +1206,12 @@ void
 ldb_lru_prune(ldb_lru_t *lru) {
   int i;
 
-  for (i = 0; i < LDB_SHARDS; i++)
-    ldb_shard_prune(&lru->shard[i]);
+  for (i = 0; i < ldb_lru_shards(lru); i++) {
+    if (lru->clock != NULL)
+      ldb_clockshard_prune(&lru->clock[i]);
+    else
+      ldb_shard_prune(&lru->shard[i]);
+  }
 }
 
 size_t
@@ -566,8 +1219,12 @@ ldb_lru_total_charge(ldb_lru_t *lru) {
   size_t total = 0;
   int i;
 
-  for (i = 0; i < LDB_SHARDS; i++)
-    total += ldb_shard_total_charge(&lru->shard[i]);
+  for (i = 0; i < ldb_lru_shards(lru); i++) {
+    if (lru->clock != NULL)
+      total += ldb_clockshard_total_charge(&lru->clock[i]);
+    else
+      total += ldb_shard_total_charge(&lru->shard[i]);
+  }
 
   return total;
 }
@@ -36,6 +36,13 @@ typedef struct ldb_lruhandle_s ldb_lruhandle_t;
 LDB_EXTERN ldb_lru_t *
 ldb_lru_create(size_t capacity);
 
+/* Create a new cache with a fixed size capacity. This implementation
+   uses the CLOCK eviction policy: lookups pin entries with atomic
+   reference counts and never take a lock. The number of shards is
+   scaled with the number of cores. */
+LDB_EXTERN ldb_lru_t *
+ldb_lru_create_clock(size_t capacity);
+
 /* Destroys all existing entries by calling the "deleter"
    function that was passed to the constructor. */
 LDB_EXTERN void
@@ -18,6 +18,7 @@
 #include "cache.h"
 #include "coding.h"
 #include "extern.h"
+#include "port.h"
 #include "slice.h"
 #include "testutil.h"
 #include "vector.h"
@@ -39,6 +40,7 @@ typedef struct test_s {
 } test_t;
 
 static test_t *current;
+static int use_clock = 0;
 
 /*
  * Helpers
@@ -71,12 +73,20 @@ decode_value(void *v) {
  * CacheTest
  */
 
+static ldb_lru_t *
+test_create(size_t capacity) {
+  if (use_clock)
+    return ldb_lru_create_clock(capacity);
+
+  return ldb_lru_create(capacity);
+}
+
 static void
 test_init(test_t *t) {
   ldb_array_init(&t->deleted_keys);
   ldb_array_init(&t->deleted_values);
 
-  t->cache = ldb_lru_create(CACHE_SIZE);
+  t->cache = test_create(CACHE_SIZE);
 
   current = t;
 }
@@ -410,7 +420,7 @@ test_cache_zero_size_cache(void) {
 
   ldb_lru_destroy(t.cache);
 
-  t.cache = ldb_lru_create(0);
+  t.cache = test_create(0);
 
   test_insert(&t, 1, 100, 1);
 
@@ -419,15 +429,97 @@ test_cache_zero_size_cache(void) {
   test_clear(&t);
 }
 
+#if defined(_WIN32) || defined(LDB_PTHREAD)
+
+#define THREAD_COUNT 4
+#define THREAD_ITERS 20000
+#define THREAD_KEYS 2000
+
+typedef struct thread_state_s {
+  ldb_lru_t *cache;
+  uint32_t seed;
+  int hits;
+} thread_state_t;
+
+static void
+thread_deleter(const ldb_slice_t *key, void *value) {
+  ASSERT(decode_key(key) == decode_value(value));
+}
+
+static void
+thread_body(void *arg) {
+  thread_state_t *state = arg;
+  ldb_lruhandle_t *h;
+  uint8_t buf[4];
+  ldb_slice_t k;
+  int i, key;
+
+  for (i = 0; i < THREAD_ITERS; i++) {
+    state->seed = state->seed * 1103515245 + 12345;
+
+    key = (state->seed >> 8) % THREAD_KEYS;
+    k = encode_key(key, buf);
+
+    switch ((state->seed >> 4) & 15) {
+      case 0:
+        ldb_lru_erase(state->cache, &k);
+        break;
+      case 1:
+      case 2:
+        h = ldb_lru_insert(state->cache, &k, encode_value(key),
+                           1, &thread_deleter);
+        ldb_lru_release(state->cache, h);
+        break;
+      default:
+        h = ldb_lru_lookup(state->cache, &k);
+
+        if (h != NULL) {
+          ASSERT(decode_value(ldb_lru_value(h)) == key);
+          ldb_lru_release(state->cache, h);
+          state->hits++;
+        }
+
+        break;
+    }
+  }
+}
+
+static void
+test_cache_concurrent(void) {
+  thread_state_t states[THREAD_COUNT];
+  ldb_thread_t threads[THREAD_COUNT];
+  ldb_lru_t *cache = test_create(THREAD_KEYS / 2);
+  int i;
+
+  for (i = 0; i < THREAD_COUNT; i++) {
+    states[i].cache = cache;
+    states[i].seed = i + 1;
+    states[i].hits = 0;
+
+    ldb_thread_create(&threads[i], thread_body, &states[i]);
+  }
+
+  for (i = 0; i < THREAD_COUNT; i++) {
+    ldb_thread_join(&threads[i]);
+    ASSERT(states[i].hits > 0);
+  }
+
+  /* No references may have leaked. */
+  ldb_lru_prune(cache);
+
+  ASSERT(ldb_lru_total_charge(cache) == 0);
+
+  ldb_lru_destroy(cache);
+}
+
+#endif /* _WIN32 || LDB_PTHREAD */
+
 /*
  * Execute
  */
 
-LDB_EXTERN int
-ldb_test_cache(void);
-
-int
-ldb_test_cache(void) {
+static void
+test_cache(void) {
   test_cache_hit_and_miss();
   test_cache_erase();
   test_cache_entries_are_pinned();
@@ -437,5 +529,21 @@ ldb_test_cache(void) {
   test_cache_newid();
   test_cache_prune();
   test_cache_zero_size_cache();
+#if defined(_WIN32) || defined(LDB_PTHREAD)
+  test_cache_concurrent();
+#endif
+}
+
+LDB_EXTERN int
+ldb_test_cache(void);
+
+int
+ldb_test_cache(void) {
+  use_clock = 0;
+  test_cache();
+
+  use_clock = 1;
+  test_cache();
+
   return 0;
 }
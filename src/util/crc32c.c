@@ -12,6 +12,8 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+#include "atomic.h"
 #include "coding.h"
 #include "crc32c.h"
 #include "internal.h"
@@ -273,8 +275,8 @@ round_up(const void *ptr) {
  * CRC32C
  */
 
-uint32_t
-ldb_crc32c_extend(uint32_t z, const uint8_t *xp, size_t xn) {
+static uint32_t
+crc32c_extend_portable(uint32_t z, const uint8_t *xp, size_t xn) {
   const uint8_t *p = xp;
   const uint8_t *e = p + xn;
   uint32_t l = z ^ crc32c_xor;
@@ -455,8 +457,8 @@ static const uint32_t crc32c_mask_delta = 0xa282ead8;
  * CRC32C
  */
 
-uint32_t
-ldb_crc32c_extend(uint32_t z, const uint8_t *xp, size_t xn) {
+static uint32_t
+crc32c_extend_portable(uint32_t z, const uint8_t *xp, size_t xn) {
   z ^= 0xffffffff;
 
   while (xn--)
@@ -467,6 +469,313 @@ ldb_crc32c_extend(uint32_t z, const uint8_t *xp, size_t xn) {
 
 #endif /* LDB_CRC32C_SIMPLE */
 
+/*
+ * Hardware Backends
+ */
+
+/* The SSE4.2 and ARMv8 instruction sets both provide a CRC32C
+ * instruction. These backends are written with inline assembly
+ * so that they build without any special compiler flags; they
+ * are only used if the CPU reports support at runtime.
+ */
+
+#if defined(__GNUC__) && !defined(LDB_CRC32C_PORTABLE)
+#  if defined(__x86_64__) || defined(__amd64__)
+#    define LDB_CRC32C_SSE42
+#    define LDB_CRC32C_WORD 8
+#  elif defined(__i386__)
+#    define LDB_CRC32C_SSE42
+#    define LDB_CRC32C_WORD 4
+#  elif defined(__aarch64__)
+#    if defined(__ARM_FEATURE_CRC32) || defined(__APPLE__)
+#      define LDB_CRC32C_ARMV8
+#      define LDB_CRC32C_WORD 8
+#    elif defined(__linux__)
+#      define LDB_CRC32C_ARMV8
+#      define LDB_CRC32C_WORD 8
+#      define LDB_CRC32C_AUXV
+#    endif
+#  endif
+#endif
+
+#if defined(LDB_CRC32C_SSE42)
+#  include <cpuid.h>
+#elif defined(LDB_CRC32C_AUXV)
+#  include <sys/auxv.h>
+#endif
+
+#if defined(LDB_CRC32C_WORD)
+
+/* Block sizes for the 3-way interleaved loops. Must be powers of two. */
+#define CRC32C_LONG 8192
+#define CRC32C_SHORT 256
+
+/* Tables which shift a CRC by CRC32C_LONG and CRC32C_SHORT zero bytes. */
+static uint32_t crc32c_long[4][256];
+static uint32_t crc32c_short[4][256];
+
+static LDB_INLINE uint32_t
+crc32c_hw_byte(uint32_t crc, uint8_t x) {
+#if defined(LDB_CRC32C_SSE42)
+  __asm__ ("crc32b %1, %0" : "+r" (crc) : "rm" (x));
+#else
+  __asm__ (".arch_extension crc\n\t"
+           "crc32cb %w0, %w0, %w1" : "+r" (crc) : "r" (x));
+#endif
+  return crc;
+}
+
+#if LDB_CRC32C_WORD == 8
+static LDB_INLINE uint32_t
+crc32c_hw_word(uint32_t crc, const uint8_t *xp) {
+  uint64_t w, z = crc;
+
+  memcpy(&w, xp, 8);
+
+#if defined(LDB_CRC32C_SSE42)
+  __asm__ ("crc32q %1, %0" : "+r" (z) : "rm" (w));
+#else
+  __asm__ (".arch_extension crc\n\t"
+           "crc32cx %w0, %w0, %x1" : "+r" (z) : "r" (w));
+#endif
+
+  return (uint32_t)z;
+}
+#else /* LDB_CRC32C_WORD != 8 */
+static LDB_INLINE uint32_t
+crc32c_hw_word(uint32_t crc, const uint8_t *xp) {
+  uint32_t w;
+
+  memcpy(&w, xp, 4);
+
+  __asm__ ("crc32l %1, %0" : "+r" (crc) : "rm" (w));
+
+  return crc;
+}
+#endif /* LDB_CRC32C_WORD != 8 */
+
+/* Multiply a GF(2) 32x32 matrix by a vector. */
+static uint32_t
+gf2_matrix_times(const uint32_t *mat, uint32_t vec) {
+  uint32_t sum = 0;
+
+  while (vec) {
+    if (vec & 1)
+      sum ^= *mat;
+
+    vec >>= 1;
+    mat++;
+  }
+
+  return sum;
+}
+
+static void
+gf2_matrix_square(uint32_t *square, const uint32_t *mat) {
+  int n;
+
+  for (n = 0; n < 32; n++)
+    square[n] = gf2_matrix_times(mat, mat[n]);
+}
+
+/* Construct the operator which appends "len" zero bytes to a CRC.
+   "len" must be a power of two. */
+static void
+crc32c_zeros_op(uint32_t *even, size_t len) {
+  uint32_t odd[32];
+  uint32_t row = 1;
+  int n;
+
+  /* Operator for one zero bit. */
+  odd[0] = 0x82f63b78;
+
+  for (n = 1; n < 32; n++) {
+    odd[n] = row;
+    row <<= 1;
+  }
+
+  /* Two zero bits, then four. */
+  gf2_matrix_square(even, odd);
+  gf2_matrix_square(odd, even);
+
+  /* Each pass doubles the number of zero bytes (starting at one). */
+  do {
+    gf2_matrix_square(even, odd);
+
+    len >>= 1;
+
+    if (len == 0)
+      return;
+
+    gf2_matrix_square(odd, even);
+
+    len >>= 1;
+  } while (len);
+
+  for (n = 0; n < 32; n++)
+    even[n] = odd[n];
+}
+
+static void
+crc32c_zeros(uint32_t zeros[][256], size_t len) {
+  uint32_t op[32];
+  uint32_t n;
+
+  crc32c_zeros_op(op, len);
+
+  for (n = 0; n < 256; n++) {
+    zeros[0][n] = gf2_matrix_times(op, n);
+    zeros[1][n] = gf2_matrix_times(op, n << 8);
+    zeros[2][n] = gf2_matrix_times(op, n << 16);
+    zeros[3][n] = gf2_matrix_times(op, n << 24);
+  }
+}
+
+static LDB_INLINE uint32_t
+crc32c_shift(uint32_t zeros[][256], uint32_t crc) {
+  return zeros[0][crc & 0xff]
+       ^ zeros[1][(crc >> 8) & 0xff]
+       ^ zeros[2][(crc >> 16) & 0xff]
+       ^ zeros[3][crc >> 24];
+}
+
+static uint32_t
+crc32c_extend_hw(uint32_t z, const uint8_t *xp, size_t xn) {
+  uint32_t crc0 = z ^ 0xffffffff;
+  uint32_t crc1, crc2;
+  const uint8_t *end;
+
+  /* Align to a word boundary. */
+  while (xn > 0 && ((uintptr_t)xp & (LDB_CRC32C_WORD - 1)) != 0) {
+    crc0 = crc32c_hw_byte(crc0, *xp++);
+    xn--;
+  }
+
+  /* The CRC instruction has a latency of three cycles but a throughput
+     of one per cycle. Computing three independent CRCs over adjacent
+     blocks and combining them afterwards keeps the pipeline full. */
+  while (xn >= CRC32C_LONG * 3) {
+    crc1 = 0;
+    crc2 = 0;
+    end = xp + CRC32C_LONG;
+
+    do {
+      crc0 = crc32c_hw_word(crc0, xp);
+      crc1 = crc32c_hw_word(crc1, xp + CRC32C_LONG);
+      crc2 = crc32c_hw_word(crc2, xp + CRC32C_LONG * 2);
+      xp += LDB_CRC32C_WORD;
+    } while (xp < end);
+
+    crc0 = crc32c_shift(crc32c_long, crc0) ^ crc1;
+    crc0 = crc32c_shift(crc32c_long, crc0) ^ crc2;
+
+    xp += CRC32C_LONG * 2;
+    xn -= CRC32C_LONG * 3;
+  }
+
+  while (xn >= CRC32C_SHORT * 3) {
+    crc1 = 0;
+    crc2 = 0;
+    end = xp + CRC32C_SHORT;
+
+    do {
+      crc0 = crc32c_hw_word(crc0, xp);
+      crc1 = crc32c_hw_word(crc1, xp + CRC32C_SHORT);
+      crc2 = crc32c_hw_word(crc2, xp + CRC32C_SHORT * 2);
+      xp += LDB_CRC32C_WORD;
+    } while (xp < end);
+
+    crc0 = crc32c_shift(crc32c_short, crc0) ^ crc1;
+    crc0 = crc32c_shift(crc32c_short, crc0) ^ crc2;
+
+    xp += CRC32C_SHORT * 2;
+    xn -= CRC32C_SHORT * 3;
+  }
+
+  while (xn >= LDB_CRC32C_WORD) {
+    crc0 = crc32c_hw_word(crc0, xp);
+    xp += LDB_CRC32C_WORD;
+    xn -= LDB_CRC32C_WORD;
+  }
+
+  while (xn > 0) {
+    crc0 = crc32c_hw_byte(crc0, *xp++);
+    xn--;
+  }
+
+  return crc0 ^ 0xffffffff;
+}
+
+static int
+crc32c_has_hw(void) {
+#if defined(LDB_CRC32C_SSE42)
+  unsigned int a, b, c, d;
+
+  if (!__get_cpuid(1, &a, &b, &c, &d))
+    return 0;
+
+  return (c >> 20) & 1; /* SSE4.2 */
+#elif defined(LDB_CRC32C_AUXV)
+  return (getauxval(AT_HWCAP) >> 7) & 1; /* HWCAP_CRC32 */
+#else
+  return 1;
+#endif
+}
+
+#endif /* LDB_CRC32C_WORD */
+
+/*
+ * CRC32C
+ */
+
+#if defined(LDB_CRC32C_WORD)
+
+/* 0 = undetected, 1 = portable, 2 = hardware, 3 = detecting. */
+static ldb_atomic(int) crc32c_backend = 0;
+
+static int
+crc32c_detect(void) {
+  int backend = 1;
+
+  /* Only one thread builds the tables, and it does so before the
+     hardware backend is published. Anyone arriving in the meantime
+     uses the portable code for that call. */
+  if (!ldb_atomic_compare_exchange(&crc32c_backend, 0, 3, ldb_order_acq_rel))
+    return 1;
+
+  if (crc32c_has_hw()) {
+    crc32c_zeros(crc32c_long, CRC32C_LONG);
+    crc32c_zeros(crc32c_short, CRC32C_SHORT);
+    backend = 2;
+  }
+
+  ldb_atomic_store(&crc32c_backend, backend, ldb_order_release);
+
+  return backend;
+}
+
+uint32_t
+ldb_crc32c_extend(uint32_t z, const uint8_t *xp, size_t xn) {
+  int backend = ldb_atomic_load(&crc32c_backend, ldb_order_acquire);
+
+  if (UNLIKELY(backend == 0))
+    backend = crc32c_detect();
+
+  if (backend == 2)
+    return crc32c_extend_hw(z, xp, xn);
+
+  return crc32c_extend_portable(z, xp, xn);
+}
+
+#else /* !LDB_CRC32C_WORD */
+
+uint32_t
+ldb_crc32c_extend(uint32_t z, const uint8_t *xp, size_t xn) {
+  return crc32c_extend_portable(z, xp, xn);
+}
+
+#endif /* !LDB_CRC32C_WORD */
+
 uint32_t
 ldb_crc32c_value(const uint8_t *xp, size_t xn) {
   return ldb_crc32c_extend(0, xp, xn);
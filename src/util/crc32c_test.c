@@ -66,6 +66,57 @@ test_extend(void) {
   ASSERT(ldb_crc32c_str("hello world", 11) == ldb_crc32c_extstr(v, "world", 5));
 }
 
+static uint32_t
+crc32c_bitwise(uint32_t crc, const uint8_t *xp, size_t xn) {
+  int i;
+
+  crc ^= 0xffffffff;
+
+  while (xn--) {
+    crc ^= *xp++;
+
+    for (i = 0; i < 8; i++)
+      crc = (crc >> 1) ^ (0x82f63b78 & -(crc & 1));
+  }
+
+  return crc ^ 0xffffffff;
+}
+
+static void
+test_lengths(void) {
+  /* Cover every alignment and the interleaved (long) code paths. */
+  static const size_t lengths[] = {
+    0, 1, 3, 7, 8, 15, 16, 31, 255, 767, 768, 769, 1000,
+    24575, 24576, 24577, 50000, 100003
+  };
+
+  size_t size = 100003 + 16;
+  uint8_t *buf = malloc(size);
+  uint32_t seed = 1;
+  size_t i, j;
+
+  ASSERT(buf != NULL);
+
+  for (i = 0; i < size; i++) {
+    seed = seed * 1103515245 + 12345;
+    buf[i] = seed >> 24;
+  }
+
+  for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    for (j = 0; j < 16; j++) {
+      const uint8_t *xp = buf + j;
+      size_t xn = lengths[i];
+      uint32_t expect = crc32c_bitwise(0, xp, xn);
+
+      ASSERT(ldb_crc32c_value(xp, xn) == expect);
+      ASSERT(ldb_crc32c_extend(ldb_crc32c_value(xp, xn / 3),
+                               xp + xn / 3, xn - xn / 3) == expect);
+    }
+  }
+
+  free(buf);
+}
+
 static void
 test_mask(void) {
   uint32_t crc = ldb_crc32c_str("foo", 3);
@@ -85,6 +136,7 @@ ldb_test_crc32c(void) {
   test_standard_results();
   test_values();
   test_extend();
+  test_lengths();
   test_mask();
   return 0;
 }
@@ -34,6 +34,14 @@ typedef struct ldb_logger_s ldb_logger_t;
 typedef struct ldb_rfile_s ldb_rfile_t;
 typedef struct ldb_wfile_s ldb_wfile_t;
 
+typedef struct ldb_readreq_s {
+  uint64_t offset;
+  size_t count;
+  void *buf;
+  ldb_slice_t result;
+  int status;
+} ldb_readreq_t;
+
 /*
  * Filesystem
  */
@@ -109,6 +117,12 @@ ldb_rfile_pread(ldb_rfile_t *file,
                 size_t count,
                 uint64_t offset);
 
+/* Perform several positional reads at once. Each request
+   is treated as a call to ldb_rfile_pread. Returns the
+   first failing status, if any. */
+int
+ldb_rfile_multiread(ldb_rfile_t *file, ldb_readreq_t *reqs, size_t count);
+
 /*
  * Writable File
  */
@@ -134,6 +148,12 @@ ldb_wfile_flush(ldb_wfile_t *file);
 int
 ldb_wfile_sync(ldb_wfile_t *file);
 
+/* Sync data already flushed to the file, leaving the write buffer
+   alone. Unlike ldb_wfile_sync, this may be called while another
+   thread is appending. */
+int
+ldb_wfile_sync_data(ldb_wfile_t *file);
+
 /*
  * Logging
  */
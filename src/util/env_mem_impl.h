@@ -562,6 +562,24 @@ ldb_rfile_pread(ldb_rfile_t *file,
   return ldb_fstate_pread(file->state, result, buf, count, offset);
 }
 
+int
+ldb_rfile_multiread(ldb_rfile_t *file, ldb_readreq_t *reqs, size_t count) {
+  int rc = LDB_OK;
+  size_t i;
+
+  for (i = 0; i < count; i++) {
+    ldb_readreq_t *req = &reqs[i];
+
+    req->status = ldb_rfile_pread(file, &req->result, req->buf,
+                                  req->count, req->offset);
+
+    if (rc == LDB_OK)
+      rc = req->status;
+  }
+
+  return rc;
+}
+
 /*
  * Readable File Instantiation
  */
@@ -633,6 +651,12 @@ ldb_wfile_sync(ldb_wfile_t *file) {
   return LDB_OK;
 }
 
+int
+ldb_wfile_sync_data(ldb_wfile_t *file) {
+  (void)file;
+  return LDB_OK;
+}
+
 /*
  * Writable File Instantiation
  */
@@ -222,6 +222,47 @@ test_open_on_read(void) {
   ASSERT(ldb_remove_file(path) == LDB_OK);
 }
 
+static void
+test_multiread(void) {
+  static const char file_data[] = "abcdefghijklmnopqrstuvwxyz";
+  ldb_readreq_t reqs[50];
+  uint8_t scratch[50][4];
+  char path[LDB_PATH_MAX];
+  ldb_rfile_t *file;
+  int i, use_mmap;
+
+  ASSERT(ldb_test_filename(path, sizeof(path), "multiread.txt"));
+
+  {
+    ldb_slice_t data = ldb_string(file_data);
+
+    ASSERT(ldb_write_file(path, &data, 0) == LDB_OK);
+  }
+
+  for (use_mmap = 0; use_mmap <= 1; use_mmap++) {
+    ASSERT(ldb_randfile_create(path, &file, use_mmap) == LDB_OK);
+
+    for (i = 0; i < 50; i++) {
+      reqs[i].offset = i % 26;
+      reqs[i].count = LDB_MIN(4, 26 - (i % 26));
+      reqs[i].buf = scratch[i];
+    }
+
+    ASSERT(ldb_rfile_multiread(file, reqs, 50) == LDB_OK);
+
+    for (i = 0; i < 50; i++) {
+      ASSERT(reqs[i].status == LDB_OK);
+      ASSERT(reqs[i].result.size == reqs[i].count);
+      ASSERT(memcmp(reqs[i].result.data, file_data + (i % 26),
+                    reqs[i].count) == 0);
+    }
+
+    ldb_rfile_destroy(file);
+  }
+
+  ASSERT(ldb_remove_file(path) == LDB_OK);
+}
+
 /*
  * Threads
  */
@@ -395,6 +436,7 @@ ldb_test_env(void) {
   test_reopen_writable_file();
   test_reopen_appendable_file();
   test_open_on_read();
+  test_multiread();
 
 #if defined(_WIN32) || defined(LDB_PTHREAD)
   {
@@ -55,6 +55,7 @@
 #undef HAVE_FLOCK
 #undef HAVE_FDATASYNC
 #undef HAVE_PREAD
+#undef HAVE_URING
 
 #if !defined(__wasi__) && !defined(__EMSCRIPTEN__)
 #  define HAVE_FCNTL
@@ -86,6 +87,16 @@
 #  define HAVE_PREAD
 #endif
 
+#if defined(LDB_HAVE_URING) && defined(LDB_HAVE_ATOMICS) \
+                           && defined(__linux__)       \
+                           && defined(HAVE_MMAP)
+#  include <linux/io_uring.h>
+#  include <sys/syscall.h>
+#  if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#    define HAVE_URING
+#  endif
+#endif
+
 /*
  * Fixes
  */
@@ -302,6 +313,327 @@ ldb_max_open_files(void) {
 #endif
 }
 
+/*
+ * io_uring
+ */
+
+#ifdef HAVE_URING
+
+/* Submission queue depth of each ring. */
+#define LDB_URING_ENTRIES 32
+
+/* Maximum number of idle rings kept around for reuse. */
+#define LDB_URING_CACHE 64
+
+/* A ring is used by one thread at a time. Idle rings are cached. */
+typedef struct ldb_uring_s {
+  int fd;
+  unsigned int *sq_head;
+  unsigned int *sq_tail;
+  unsigned int *sq_mask;
+  unsigned int *sq_array;
+  unsigned int *cq_head;
+  unsigned int *cq_tail;
+  unsigned int *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  unsigned char *sq_ring;
+  unsigned char *cq_ring;
+  size_t sq_size;
+  size_t cq_size;
+  size_t sqes_size;
+  struct ldb_uring_s *next;
+} ldb_uring_t;
+
+static ldb_mutex_t uring_mutex = LDB_MUTEX_INITIALIZER;
+static ldb_uring_t *uring_cache = NULL; /* Guarded by uring_mutex. */
+static int uring_cached = 0; /* Guarded by uring_mutex. */
+static ldb_atomic(int) uring_disabled = 0;
+static ldb_atomic(int) uring_features = 0;
+
+static void
+ldb_uring_destroy(ldb_uring_t *ring) {
+  munmap(ring->sqes, ring->sqes_size);
+
+  if (ring->cq_ring != ring->sq_ring)
+    munmap(ring->cq_ring, ring->cq_size);
+
+  munmap(ring->sq_ring, ring->sq_size);
+
+  close(ring->fd);
+
+  ldb_free(ring);
+}
+
+static ldb_uring_t *
+ldb_uring_create(void) {
+  int flags = MAP_SHARED | MAP_POPULATE;
+  int prot = PROT_READ | PROT_WRITE;
+  struct io_uring_params p;
+  unsigned char *sq, *cq;
+  ldb_uring_t *ring;
+  void *ptr;
+  long fd;
+
+  memset(&p, 0, sizeof(p));
+
+  fd = syscall(__NR_io_uring_setup, LDB_URING_ENTRIES, &p);
+
+  if (fd < 0)
+    return NULL;
+
+  ring = ldb_malloc(sizeof(ldb_uring_t));
+
+  ring->fd = fd;
+  ring->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+  ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->sq_size = LDB_MAX(ring->sq_size, ring->cq_size);
+    ring->cq_size = ring->sq_size;
+  }
+
+  ptr = mmap(NULL, ring->sq_size, prot, flags, fd, IORING_OFF_SQ_RING);
+
+  if (ptr == MAP_FAILED)
+    goto fail;
+
+  ring->sq_ring = ptr;
+
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->cq_ring = ring->sq_ring;
+  } else {
+    ptr = mmap(NULL, ring->cq_size, prot, flags, fd, IORING_OFF_CQ_RING);
+
+    if (ptr == MAP_FAILED) {
+      munmap(ring->sq_ring, ring->sq_size);
+      goto fail;
+    }
+
+    ring->cq_ring = ptr;
+  }
+
+  ptr = mmap(NULL, ring->sqes_size, prot, flags, fd, IORING_OFF_SQES);
+
+  if (ptr == MAP_FAILED) {
+    if (ring->cq_ring != ring->sq_ring)
+      munmap(ring->cq_ring, ring->cq_size);
+
+    munmap(ring->sq_ring, ring->sq_size);
+
+    goto fail;
+  }
+
+  ring->sqes = ptr;
+
+  sq = ring->sq_ring;
+  cq = ring->cq_ring;
+
+  ring->sq_head = (unsigned int *)(void *)(sq + p.sq_off.head);
+  ring->sq_tail = (unsigned int *)(void *)(sq + p.sq_off.tail);
+  ring->sq_mask = (unsigned int *)(void *)(sq + p.sq_off.ring_mask);
+  ring->sq_array = (unsigned int *)(void *)(sq + p.sq_off.array);
+  ring->cq_head = (unsigned int *)(void *)(cq + p.cq_off.head);
+  ring->cq_tail = (unsigned int *)(void *)(cq + p.cq_off.tail);
+  ring->cq_mask = (unsigned int *)(void *)(cq + p.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(void *)(cq + p.cq_off.cqes);
+  ring->next = NULL;
+
+  ldb_atomic_store(&uring_features, p.features, ldb_order_relaxed);
+
+  return ring;
+fail:
+  close(fd);
+  ldb_free(ring);
+  return NULL;
+}
+
+static ldb_uring_t *
+ldb_uring_acquire(void) {
+  ldb_uring_t *ring = NULL;
+
+  if (ldb_atomic_load(&uring_disabled, ldb_order_relaxed))
+    return NULL;
+
+  ldb_mutex_lock(&uring_mutex);
+
+  if (uring_cache != NULL) {
+    ring = uring_cache;
+    uring_cache = ring->next;
+    uring_cached--;
+  }
+
+  ldb_mutex_unlock(&uring_mutex);
+
+  if (ring == NULL) {
+    ring = ldb_uring_create();
+
+    /* The kernel lacks io_uring, or it is forbidden to us.
+       Stick to plain system calls from now on. */
+    if (ring == NULL)
+      ldb_atomic_store(&uring_disabled, 1, ldb_order_relaxed);
+  }
+
+  return ring;
+}
+
+static void
+ldb_uring_release(ldb_uring_t *ring) {
+  ldb_mutex_lock(&uring_mutex);
+
+  if (uring_cached < LDB_URING_CACHE) {
+    ring->next = uring_cache;
+    uring_cache = ring;
+    uring_cached++;
+    ring = NULL;
+  }
+
+  ldb_mutex_unlock(&uring_mutex);
+
+  if (ring != NULL)
+    ldb_uring_destroy(ring);
+}
+
+static unsigned int
+ldb_uring_reap(ldb_uring_t *ring, int *results) {
+  unsigned int head = *ring->cq_head;
+  unsigned int tail = ldb_atomic_load(ring->cq_tail, ldb_order_acquire);
+  unsigned int count = 0;
+
+  while (head != tail) {
+    struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+
+    results[cqe->user_data] = cqe->res;
+
+    head++;
+    count++;
+  }
+
+  ldb_atomic_store(ring->cq_head, head, ldb_order_release);
+
+  return count;
+}
+
+/* Run the "count" operations described by "ops" (at most
+   LDB_URING_ENTRIES) and wait for all of them to complete. Each
+   result is stored in "results" as the operation's return value
+   or negated errno. Returns zero if io_uring is unavailable, in
+   which case none of the operations were started. */
+static int
+ldb_uring_run(const struct io_uring_sqe *ops,
+              unsigned int count,
+              int *results) {
+  unsigned int submitted = 0;
+  unsigned int completed = 0;
+  ldb_uring_t *ring;
+  unsigned int tail;
+  unsigned int i;
+
+  assert(count <= LDB_URING_ENTRIES);
+
+  if (count == 0)
+    return 1;
+
+  if ((ring = ldb_uring_acquire()) == NULL)
+    return 0;
+
+  tail = *ring->sq_tail;
+
+  for (i = 0; i < count; i++) {
+    unsigned int index = tail & *ring->sq_mask;
+
+    ring->sqes[index] = ops[i];
+    ring->sqes[index].user_data = i;
+    ring->sq_array[index] = index;
+
+    tail++;
+  }
+
+  ldb_atomic_store(ring->sq_tail, tail, ldb_order_release);
+
+  while (completed < count) {
+    long ret = syscall(__NR_io_uring_enter, ring->fd,
+                       count - submitted, 1,
+                       IORING_ENTER_GETEVENTS, NULL, 0);
+
+    if (ret < 0) {
+      int err = errno;
+
+      if (err == EINTR || err == EAGAIN || err == EBUSY) {
+        completed += ldb_uring_reap(ring, results);
+        continue;
+      }
+
+      if (submitted == count) {
+        /* We can no longer wait in the kernel, but the operations
+           in flight still own their buffers. Poll for them. */
+        ldb_sleep_usec(100);
+        completed += ldb_uring_reap(ring, results);
+        continue;
+      }
+
+      /* The kernel took none of the remaining entries. Withdraw
+         them so that the ring stays usable, and fail them. */
+      ldb_atomic_store(ring->sq_tail,
+                       ldb_atomic_load(ring->sq_head, ldb_order_acquire),
+                       ldb_order_release);
+
+      if (submitted == 0) {
+        ldb_uring_release(ring);
+        return 0;
+      }
+
+      for (i = submitted; i < count; i++)
+        results[i] = -err;
+
+      /* Keep reaping the ones which were started. */
+      count = submitted;
+
+      continue;
+    }
+
+    submitted += ret;
+    completed += ldb_uring_reap(ring, results);
+  }
+
+  ldb_uring_release(ring);
+
+  return 1;
+}
+
+static int
+ldb_uring_supports(int feature) {
+  ldb_uring_t *ring;
+
+  if (ldb_atomic_load(&uring_features, ldb_order_relaxed) == 0) {
+    if ((ring = ldb_uring_acquire()) == NULL)
+      return 0;
+
+    ldb_uring_release(ring);
+  }
+
+  return (ldb_atomic_load(&uring_features, ldb_order_relaxed) & feature) != 0;
+}
+
+static void
+ldb_uring_prep(struct io_uring_sqe *sqe,
+               int op,
+               int fd,
+               const void *buf,
+               size_t count,
+               uint64_t offset) {
+  memset(sqe, 0, sizeof(*sqe));
+
+  sqe->opcode = op;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)buf;
+  sqe->len = count;
+  sqe->off = offset;
+}
+
+#endif /* HAVE_URING */
+
 /*
  * Environment
  */
@@ -731,7 +1063,7 @@ ldb_rfile_pread(ldb_rfile_t *file,
       return LDB_POSIX_ERROR(errno);
   }
 
-#ifdef HAVE_PREAD
+#if defined(HAVE_PREAD)
   do {
     nread = pread(fd, buf, count, offset);
   } while (nread < 0 && errno == EINTR);
@@ -758,6 +1090,88 @@ ldb_rfile_pread(ldb_rfile_t *file,
   return nread < 0 ? LDB_IOERR : LDB_OK;
 }
 
+int
+ldb_rfile_multiread(ldb_rfile_t *file, ldb_readreq_t *reqs, size_t count) {
+  int rc = LDB_OK;
+  size_t i = 0;
+
+#ifdef HAVE_URING
+  if (!file->mapped && file->fd != -1) {
+    struct io_uring_sqe ops[LDB_URING_ENTRIES];
+    int res[LDB_URING_ENTRIES];
+    unsigned int j, n;
+
+    while (i < count) {
+      n = 0;
+
+      while (i + n < count && n < LDB_URING_ENTRIES) {
+        ldb_readreq_t *req = &reqs[i + n];
+
+        if (req->buf == NULL || req->count > INT_MAX)
+          break;
+
+        ldb_uring_prep(&ops[n], IORING_OP_READ, file->fd,
+                       req->buf, req->count, req->offset);
+
+        n++;
+      }
+
+      if (n == 0 || !ldb_uring_run(ops, n, res))
+        break;
+
+      for (j = 0; j < n; j++) {
+        ldb_readreq_t *req = &reqs[i + j];
+
+        if (res[j] == -EINTR || res[j] == -EAGAIN) {
+          req->status = ldb_rfile_pread(file, &req->result, req->buf,
+                                        req->count, req->offset);
+        } else if (res[j] < 0) {
+          req->status = LDB_IOERR;
+        } else {
+          unsigned char *buf = req->buf;
+          size_t nread = res[j];
+          ldb_slice_t rest;
+
+          req->status = LDB_OK;
+
+          /* A ring may return less than was asked for. Read the
+             rest directly; only the end of the file stops us. */
+          while (nread < req->count) {
+            req->status = ldb_rfile_pread(file, &rest, buf + nread,
+                                          req->count - nread,
+                                          req->offset + nread);
+
+            if (req->status != LDB_OK || rest.size == 0)
+              break;
+
+            nread += rest.size;
+          }
+
+          ldb_slice_set(&req->result, buf, nread);
+        }
+
+        if (rc == LDB_OK)
+          rc = req->status;
+      }
+
+      i += n;
+    }
+  }
+#endif
+
+  for (; i < count; i++) {
+    ldb_readreq_t *req = &reqs[i];
+
+    req->status = ldb_rfile_pread(file, &req->result, req->buf,
+                                  req->count, req->offset);
+
+    if (rc == LDB_OK)
+      rc = req->status;
+  }
+
+  return rc;
+}
+
 static int
 ldb_rfile_close(ldb_rfile_t *file) {
   int rc = LDB_OK;
@@ -922,7 +1336,9 @@ ldb_wfile_close(ldb_wfile_t *file) {
 static int
 ldb_wfile_write(ldb_wfile_t *file, const unsigned char *data, size_t size) {
   while (size > 0) {
-    ssize_t nwrite = write(file->fd, data, size);
+    ssize_t nwrite;
+
+    nwrite = write(file->fd, data, size);
 
     if (nwrite < 0) {
       if (errno == EINTR)
@@ -957,6 +1373,44 @@ ldb_wfile_sync_dir(ldb_wfile_t *file) {
   return rc;
 }
 
+#ifdef HAVE_URING
+/* Flush and sync with a single system call by linking
+   the write to the fsync. Returns zero if the caller
+   must finish the job itself. */
+static int
+ldb_wfile_uring_sync(ldb_wfile_t *file, int *rc) {
+  struct io_uring_sqe ops[2];
+  int res[2];
+
+  if (!ldb_uring_supports(IORING_FEAT_RW_CUR_POS))
+    return 0;
+
+  ldb_uring_prep(&ops[0], IORING_OP_WRITE, file->fd,
+                 file->buf, file->pos, ~UINT64_C(0));
+  ldb_uring_prep(&ops[1], IORING_OP_FSYNC, file->fd, NULL, 0, 0);
+
+  ops[0].flags = IOSQE_IO_LINK;
+  ops[1].fsync_flags = IORING_FSYNC_DATASYNC;
+
+  if (!ldb_uring_run(ops, 2, res))
+    return 0;
+
+  if (res[0] > 0) {
+    memmove(file->buf, file->buf + res[0], file->pos - res[0]);
+    file->pos -= res[0];
+  }
+
+  /* A short write cancels the fsync. Anything
+     else is a real failure which we must not retry. */
+  if (res[1] == -ECANCELED)
+    return 0;
+
+  *rc = (res[0] < 0 || res[1] < 0) ? LDB_IOERR : LDB_OK;
+
+  return 1;
+}
+#endif
+
 int
 ldb_wfile_append(ldb_wfile_t *file, const ldb_slice_t *data) {
   const unsigned char *write_data = data->data;
@@ -1001,12 +1455,22 @@ ldb_wfile_sync(ldb_wfile_t *file) {
   if ((rc = ldb_wfile_sync_dir(file)))
     return rc;
 
+#ifdef HAVE_URING
+  if (ldb_wfile_uring_sync(file, &rc))
+    return rc;
+#endif
+
   if ((rc = ldb_wfile_flush(file)))
     return rc;
 
   return ldb_sync_fd(file->fd);
 }
 
+int
+ldb_wfile_sync_data(ldb_wfile_t *file) {
+  return ldb_sync_fd(file->fd);
+}
+
 /*
  * Writable File Instantiation
  */
@@ -233,7 +233,7 @@ histogram_merge(histogram_t *z, const histogram_t *x) {
     z->buckets[b] += x->buckets[b];
 }
 
-static double
+double
 histogram_percentile(const histogram_t *h, double p) {
   double threshold = h->num * (p / 100.0);
   double sum = 0;
@@ -46,6 +46,9 @@ histogram_add(histogram_t *h, double value);
 void
 histogram_merge(histogram_t *z, const histogram_t *x);
 
+double
+histogram_percentile(const histogram_t *h, double p);
+
 char *
 histogram_string(const histogram_t *h, char *buf);
 
@@ -33,7 +33,16 @@ static const ldb_dbopt_t db_options = {
   /* .compression = */ LDB_NO_COMPRESSION,
   /* .reuse_logs = */ 0,
   /* .filter_policy = */ NULL,
-  /* .use_mmap = */ 1
+  /* .use_mmap = */ 1,
+  /* .max_background_compactions = */ 1,
+  /* .max_subcompactions = */ 1,
+  /* .full_filter = */ 0,
+  /* .row_cache = */ NULL,
+  /* .prefix_extractor = */ NULL,
+  /* .concurrent_memtable_writes = */ 0,
+  /* .pipelined_write = */ 0,
+  /* .group_commit = */ 0,
+  /* .group_commit_delay = */ 0
 };
 
 /*
@@ -43,7 +52,11 @@ static const ldb_dbopt_t db_options = {
 static const ldb_readopt_t read_options = {
   /* .verify_checksums = */ 0,
   /* .fill_cache = */ 1,
-  /* .snapshot = */ NULL
+  /* .snapshot = */ NULL,
+  /* .iterate_lower_bound = */ NULL,
+  /* .iterate_upper_bound = */ NULL,
+  /* .prefix_same_as_start = */ 0,
+  /* .prefetch_blocks = */ 0
 };
 
 /*
@@ -61,7 +74,11 @@ static const ldb_writeopt_t write_options = {
 static const ldb_readopt_t iter_options = {
   /* .verify_checksums = */ 0,
   /* .fill_cache = */ 0,
-  /* .snapshot = */ NULL
+  /* .snapshot = */ NULL,
+  /* .iterate_lower_bound = */ NULL,
+  /* .iterate_upper_bound = */ NULL,
+  /* .prefix_same_as_start = */ 0,
+  /* .prefetch_blocks = */ 0
 };
 
 /*
@@ -21,9 +21,11 @@
  */
 
 struct ldb_bloom_s;
+struct ldb_buffer_s;
 struct ldb_comparator_s;
 struct ldb_logger_s;
 struct ldb_lru_s;
+struct ldb_prefix_s;
 struct ldb_snapshot_s;
 
 /*
@@ -160,6 +162,72 @@ typedef struct ldb_dbopt_s {
 
   /* Whether to utilize mmap() for random access files. */
   int use_mmap; /* 1 */
+
+  /* Maximum number of background compactions which may run at once.
+   * Compactions are only ever run concurrently when their input files
+   * (and the key ranges they write to) do not overlap.  Values greater
+   * than one have no effect when built without thread support.
+   */
+  int max_background_compactions; /* 1 */
+
+  /* Maximum number of threads a single compaction may be split
+   * across.  Shards are cut at the boundaries of the compaction's
+   * input files; each one merges and writes its own slice of the
+   * key range.  Values greater than one have no effect when built
+   * without thread support.
+   */
+  int max_subcompactions; /* 1 */
+
+  /* If true, tables are written with a single filter covering all
+   * of their keys rather than one filter per 2KB of data. A full
+   * filter is checked before the index block is searched and wastes
+   * fewer bits on small filters. Tables written either way remain
+   * readable regardless of this setting.
+   */
+  int full_filter; /* 0 */
+
+  /* If non-null, use the specified cache for rows. A row cache maps
+   * (table, user key) to the newest version of the key in that table,
+   * letting repeated point reads skip the table and block caches. Reads
+   * from snapshots older than a cached row fall back to the table.
+   */
+  struct ldb_lru_s *row_cache; /* NULL */
+
+  /* If non-null, table filters also summarize the prefixes this
+   * extractor produces for their keys, and iterators in prefix mode
+   * (see ldb_readopt_t) use them to skip tables holding no keys with
+   * the sought prefix. Has no effect unless filter_policy is set.
+   */
+  const struct ldb_prefix_s *prefix_extractor; /* NULL */
+
+  /* If true, each writer in a write group inserts its own batch into
+   * the memtable in parallel with the others once the group leader
+   * has logged the group, rather than the leader inserting every
+   * batch by itself. Has no effect when built without thread support.
+   */
+  int concurrent_memtable_writes; /* 0 */
+
+  /* If true, a write group hands the log over to the next group as
+   * soon as its record is written, and then applies its batches to
+   * the memtable while the next group logs. Sequence numbers still
+   * become visible in order. Has no effect when built without thread
+   * support.
+   */
+  int pipelined_write; /* 0 */
+
+  /* If true, sync writes do not fsync the log themselves. A write
+   * group logs its record, hands the log over to the next group, and
+   * waits for a dedicated thread to sync the log. Groups logged while
+   * a sync is in progress share the next one. Implies pipelined_write.
+   * Has no effect when built without thread support.
+   */
+  int group_commit; /* 0 */
+
+  /* With group_commit, the number of microseconds a sync write
+   * leader waits for more writers to join its group, if others are
+   * already queued. It stops waiting early once the group is full.
+   */
+  int group_commit_delay; /* 0 */
 } ldb_dbopt_t;
 
 /*
@@ -184,6 +252,40 @@ typedef struct ldb_readopt_s {
    * snapshot of the state at the beginning of this read operation.
    */
   const struct ldb_snapshot_s *snapshot; /* NULL */
+
+  /* If non-null, iterators created with these options will not
+   * yield user keys less than "iterate_lower_bound" (inclusive).
+   * Seeks before the bound are moved up to it, and files and data
+   * blocks entirely below it are never read.
+   *
+   * The referenced slice must outlive any iterator that uses it.
+   */
+  const struct ldb_buffer_s *iterate_lower_bound; /* NULL */
+
+  /* If non-null, iterators created with these options stop once
+   * they reach a user key greater than or equal to
+   * "iterate_upper_bound" (exclusive). Files and data blocks that
+   * lie entirely at or beyond the bound are never read.
+   *
+   * The referenced slice must outlive any iterator that uses it.
+   */
+  const struct ldb_buffer_s *iterate_upper_bound; /* NULL */
+
+  /* If true and the database has a prefix extractor, a seek only
+   * yields keys sharing the prefix of its target, and the iterator
+   * becomes invalid once it runs past them. Tables whose filters
+   * rule the prefix out are skipped without reading any blocks.
+   * Seeks to targets outside the extractor's domain, seek_first()
+   * and seek_last() are unaffected.
+   */
+  int prefix_same_as_start; /* 0 */
+
+  /* If positive, forward iterators read up to this many data blocks
+   * (at most 16) ahead of their position on a background thread, so
+   * that disk reads and decompression overlap with the scan. Blocks
+   * read ahead are kept by the iterator until it reaches them.
+   */
+  int prefetch_blocks; /* 0 */
 } ldb_readopt_t;
 
 /*
@@ -144,4 +144,11 @@ ldb_thread_detach(ldb_thread_t *thread);
 void
 ldb_thread_join(ldb_thread_t *thread);
 
+/*
+ * System
+ */
+
+int
+ldb_cpu_count(void);
+
 #endif /* LDB_PORT_H */
@@ -83,3 +83,12 @@ void
 ldb_thread_join(ldb_thread_t *thread) {
   (void)thread;
 }
+
+/*
+ * System
+ */
+
+int
+ldb_cpu_count(void) {
+  return 1;
+}
@@ -173,3 +173,19 @@ ldb_thread_join(ldb_thread_t *thread) {
   if (pthread_join(thread->handle, NULL) != 0)
     abort(); /* LCOV_EXCL_LINE */
 }
+
+/*
+ * System
+ */
+
+int
+ldb_cpu_count(void) {
+#if defined(_SC_NPROCESSORS_ONLN)
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (count >= 1 && count <= 1024)
+    return count;
+#endif
+
+  return 1;
+}
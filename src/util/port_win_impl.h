@@ -194,3 +194,19 @@ ldb_thread_join(ldb_thread_t *thread) {
   if (!CloseHandle(thread->handle))
     abort(); /* LCOV_EXCL_LINE */
 }
+
+/*
+ * System
+ */
+
+int
+ldb_cpu_count(void) {
+  SYSTEM_INFO info;
+
+  GetSystemInfo(&info);
+
+  if (info.dwNumberOfProcessors < 1 || info.dwNumberOfProcessors > 1024)
+    return 1;
+
+  return (int)info.dwNumberOfProcessors;
+}
@@ -0,0 +1,67 @@
+/*!
+ * prefix.c - prefix extractor for lcdb
+ * Copyright (c) 2022, Christopher Jeffrey (MIT License).
+ * https://github.com/chjj/lcdb
+ *
+ * See LICENSE for more information.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "internal.h"
+#include "prefix.h"
+#include "slice.h"
+
+/*
+ * Fixed Prefix
+ */
+
+static ldb_slice_t
+fixed_transform(const ldb_prefix_t *prefix, const ldb_slice_t *key) {
+  return ldb_slice(key->data, prefix->length);
+}
+
+static int
+fixed_in_domain(const ldb_prefix_t *prefix, const ldb_slice_t *key) {
+  return key->size >= prefix->length;
+}
+
+ldb_prefix_t *
+ldb_prefix_create_fixed(size_t length) {
+  ldb_prefix_t *prefix = ldb_malloc(sizeof(ldb_prefix_t) + 32);
+  char *name = (char *)(prefix + 1);
+
+  sprintf(name, "lcdb.FixedPrefix.%lu", (unsigned long)length);
+
+  prefix->name = name;
+  prefix->transform = fixed_transform;
+  prefix->in_domain = fixed_in_domain;
+  prefix->length = length;
+  prefix->state = NULL;
+
+  return prefix;
+}
+
+void
+ldb_prefix_destroy(ldb_prefix_t *prefix) {
+  ldb_free(prefix);
+}
+
+/*
+ * Helpers
+ */
+
+int
+ldb_prefix_name(char *buf, size_t size, const ldb_prefix_t *prefix) {
+  size_t len = strlen(prefix->name);
+
+  if (7 + len + 1 > size)
+    return 0;
+
+  memcpy(buf + 0, "prefix.", 7);
+  memcpy(buf + 7, prefix->name, len + 1);
+
+  return 1;
+}
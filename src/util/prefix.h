@@ -0,0 +1,80 @@
+/*!
+ * prefix.h - prefix extractor for lcdb
+ * Copyright (c) 2022, Christopher Jeffrey (MIT License).
+ * https://github.com/chjj/lcdb
+ *
+ * See LICENSE for more information.
+ */
+
+#ifndef LDB_PREFIX_H
+#define LDB_PREFIX_H
+
+#include <stddef.h>
+#include "extern.h"
+#include "types.h"
+
+/*
+ * Types
+ */
+
+/* A prefix extractor maps a user key to a prefix of that key. When one
+ * is supplied, table filters also record the prefixes of their keys so
+ * that prefix seeks can skip tables holding no keys with the sought
+ * prefix.
+ *
+ * All keys sharing a prefix must sort contiguously according to the
+ * comparator in use. A fixed-length extractor over the default
+ * bytewise comparator satisfies this.
+ */
+typedef struct ldb_prefix_s {
+  /* The name of the extractor. This is recorded in each table that
+   * holds prefix filters, and tables written with a differently named
+   * extractor will not have their prefix filters consulted. The name
+   * must change whenever the prefix produced for some key changes,
+   * and may be at most 64 bytes long.
+   */
+  const char *name;
+
+  /* Return the prefix of "key". The result must point into "key".
+   * Only called for keys which are in the domain of the extractor.
+   */
+  ldb_slice_t (*transform)(const struct ldb_prefix_s *prefix,
+                           const ldb_slice_t *key);
+
+  /* Whether "key" has a prefix. Keys outside of the domain are not
+   * added to prefix filters and never restrict a prefix seek.
+   */
+  int (*in_domain)(const struct ldb_prefix_s *prefix,
+                   const ldb_slice_t *key);
+
+  /* Members specific to the fixed-length extractor. */
+  size_t length;
+
+  /* Extra state. */
+  void *state;
+} ldb_prefix_t;
+
+/*
+ * Prefix
+ */
+
+/* Return a new prefix extractor which takes the first "length" bytes
+ * of a key as its prefix. Keys shorter than "length" have no prefix.
+ *
+ * Callers must delete the result after any database that is using the
+ * result has been closed.
+ */
+LDB_EXTERN ldb_prefix_t *
+ldb_prefix_create_fixed(size_t length);
+
+LDB_EXTERN void
+ldb_prefix_destroy(ldb_prefix_t *prefix);
+
+int
+ldb_prefix_name(char *buf, size_t size, const ldb_prefix_t *prefix);
+
+#define ldb_prefix_transform(prefix, key) (prefix)->transform(prefix, key)
+
+#define ldb_prefix_in_domain(prefix, key) (prefix)->in_domain(prefix, key)
+
+#endif /* LDB_PREFIX_H */
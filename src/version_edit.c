@@ -179,6 +179,7 @@ ldb_filemeta_init(ldb_filemeta_t *meta) {
   meta->allowed_seeks = (1 << 30);
   meta->number = 0;
   meta->file_size = 0;
+  meta->being_compacted = 0;
 
   ldb_ikey_init(&meta->smallest);
   ldb_ikey_init(&meta->largest);
@@ -196,6 +197,7 @@ ldb_filemeta_copy(ldb_filemeta_t *z, const ldb_filemeta_t *x) {
   z->allowed_seeks = x->allowed_seeks;
   z->number = x->number;
   z->file_size = x->file_size;
+  z->being_compacted = x->being_compacted;
 
   ldb_ikey_copy(&z->smallest, &x->smallest);
   ldb_ikey_copy(&z->largest, &x->largest);
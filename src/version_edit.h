@@ -16,6 +16,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "util/atomic.h"
 #include "util/rbt.h"
 #include "util/types.h"
 
@@ -27,11 +28,12 @@
 
 typedef struct ldb_filemeta_s {
   int refs;
-  int allowed_seeks;   /* Seeks allowed until compaction. */
+  ldb_atomic(int) allowed_seeks; /* Seeks allowed until compaction. */
   uint64_t number;
   uint64_t file_size;  /* File size in bytes. */
   ldb_ikey_t smallest; /* Smallest internal key served by table. */
   ldb_ikey_t largest;  /* Largest internal key served by table. */
+  int being_compacted; /* Input to a running compaction (guarded by mutex). */
 } ldb_filemeta_t;
 
 typedef struct ldb_vedit_s {
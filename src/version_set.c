@@ -14,13 +14,16 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "table/iterator.h"
 #include "table/merger.h"
 #include "table/table.h"
 #include "table/two_level_iterator.h"
 
+#include "util/atomic.h"
 #include "util/buffer.h"
+#include "util/cache.h"
 #include "util/coding.h"
 #include "util/comparator.h"
 #include "util/env.h"
@@ -211,6 +214,73 @@ some_file_overlaps_range(const ldb_comparator_t *icmp,
   return !before_file(ucmp, largest_user_key, files->items[index]);
 }
 
+/* Whether a file may hold keys within the iterate bounds of "options". */
+static int
+file_in_bounds(const ldb_comparator_t *ucmp,
+               const ldb_readopt_t *options,
+               const ldb_filemeta_t *f) {
+  const ldb_slice_t *upper = options->iterate_upper_bound;
+
+  if (after_file(ucmp, options->iterate_lower_bound, f))
+    return 0;
+
+  if (upper != NULL) {
+    ldb_slice_t smallest = ldb_ikey_user_key(&f->smallest);
+
+    if (ldb_compare(ucmp, &smallest, upper) >= 0)
+      return 0;
+  }
+
+  return 1;
+}
+
+/* Computes the range [*first, *last) of files in a sorted, disjoint
+   level which may hold keys within the iterate bounds of "options". */
+static void
+file_bounds(const ldb_comparator_t *icmp,
+            const ldb_vector_t *files,
+            const ldb_readopt_t *options,
+            uint32_t *first,
+            uint32_t *last) {
+  const ldb_comparator_t *ucmp = icmp->user_comparator;
+  const ldb_slice_t *lower = options->iterate_lower_bound;
+  const ldb_slice_t *upper = options->iterate_upper_bound;
+  uint32_t left, right;
+
+  *first = 0;
+  *last = files->length;
+
+  if (lower != NULL) {
+    ldb_ikey_t key;
+
+    ldb_ikey_init(&key);
+    ldb_ikey_set(&key, lower, LDB_MAX_SEQUENCE, LDB_VALTYPE_SEEK);
+
+    *first = find_file(icmp, files, &key);
+
+    ldb_ikey_clear(&key);
+  }
+
+  if (upper != NULL) {
+    /* Find the first file starting at or after the upper bound. */
+    left = *first;
+    right = files->length;
+
+    while (left < right) {
+      uint32_t mid = (left + right) / 2;
+      const ldb_filemeta_t *f = files->items[mid];
+      ldb_slice_t smallest = ldb_ikey_user_key(&f->smallest);
+
+      if (ldb_compare(ucmp, &smallest, upper) < 0)
+        left = mid + 1;
+      else
+        right = mid;
+    }
+
+    *last = right;
+  }
+}
+
 /*
  * Version::LevelFileNumIterator
  */
@@ -219,10 +289,13 @@ some_file_overlaps_range(const ldb_comparator_t *icmp,
    information about the files in the level. For a given entry, key()
    is the largest key that occurs in the file, and value() is an
    16-byte value containing the file number and file size, both
-   encoded using ldb_fixed64_write. */
+   encoded using ldb_fixed64_write. Files lying entirely outside
+   the iterate bounds are never yielded. */
 typedef struct ldb_numiter_s {
   ldb_comparator_t icmp;
   const ldb_vector_t *flist; /* ldb_filemeta_t */
+  uint32_t first;
+  uint32_t last;
   uint32_t index;
   uint8_t value[16];
 } ldb_numiter_t;
@@ -230,10 +303,14 @@ typedef struct ldb_numiter_s {
 static void
 ldb_numiter_init(ldb_numiter_t *iter,
                  const ldb_comparator_t *icmp,
-                 const ldb_vector_t *flist) {
+                 const ldb_vector_t *flist,
+                 const ldb_readopt_t *options) {
   iter->icmp = *icmp;
   iter->flist = flist;
-  iter->index = flist->length; /* Mark as invalid. */
+
+  file_bounds(icmp, flist, options, &iter->first, &iter->last);
+
+  iter->index = iter->last; /* Mark as invalid. */
 }
 
 static void
@@ -243,22 +320,28 @@ ldb_numiter_clear(ldb_numiter_t *iter) {
 
 static int
 ldb_numiter_valid(const ldb_numiter_t *iter) {
-  return iter->index < iter->flist->length;
+  return iter->index >= iter->first && iter->index < iter->last;
 }
 
 static void
 ldb_numiter_seek(ldb_numiter_t *iter, const ldb_slice_t *target) {
   iter->index = find_file(&iter->icmp, iter->flist, target);
+
+  if (iter->index < iter->first)
+    iter->index = iter->first;
 }
 
 static void
 ldb_numiter_seek_first(ldb_numiter_t *iter) {
-  iter->index = 0;
+  iter->index = iter->first;
 }
 
 static void
 ldb_numiter_seek_last(ldb_numiter_t *iter) {
-  iter->index = iter->flist->length == 0 ? 0 : iter->flist->length - 1;
+  if (iter->last == iter->first)
+    iter->index = iter->last; /* Marks as invalid. */
+  else
+    iter->index = iter->last - 1;
 }
 
 static void
@@ -271,8 +354,8 @@ static void
 ldb_numiter_prev(ldb_numiter_t *iter) {
   assert(ldb_numiter_valid(iter));
 
-  if (iter->index == 0)
-    iter->index = iter->flist->length; /* Marks as invalid. */
+  if (iter->index == iter->first)
+    iter->index = iter->last; /* Marks as invalid. */
   else
     iter->index--;
 }
@@ -305,10 +388,12 @@ ldb_numiter_status(const ldb_numiter_t *iter) {
 LDB_ITERATOR_FUNCTIONS(ldb_numiter);
 
 static ldb_iter_t *
-ldb_numiter_create(const ldb_comparator_t *icmp, const ldb_vector_t *flist) {
+ldb_numiter_create(const ldb_comparator_t *icmp,
+                   const ldb_vector_t *flist,
+                   const ldb_readopt_t *options) {
   ldb_numiter_t *iter = ldb_malloc(sizeof(ldb_numiter_t));
 
-  ldb_numiter_init(iter, icmp, flist);
+  ldb_numiter_init(iter, icmp, flist, options);
 
   return ldb_iter_create(iter, &ldb_numiter_table);
 }
@@ -334,12 +419,15 @@ static ldb_iter_t *
 ldb_concatiter_create(const ldb_version_t *ver,
                       const ldb_readopt_t *options,
                       int level) {
-  ldb_iter_t *iter = ldb_numiter_create(&ver->vset->icmp, &ver->files[level]);
+  const ldb_comparator_t *icmp = &ver->vset->icmp;
+  ldb_iter_t *iter = ldb_numiter_create(icmp, &ver->files[level], options);
 
   return ldb_twoiter_create(iter,
                             &get_file_iterator,
+                            NULL,
                             ver->vset->table_cache,
-                            options);
+                            options,
+                            icmp->user_comparator);
 }
 
 /*
@@ -356,6 +444,8 @@ typedef struct saver_s {
   const ldb_comparator_t *ucmp;
   ldb_slice_t user_key;
   ldb_buffer_t *value;
+  ldb_slice_t *pinned; /* Set instead of value for pinned reads. */
+  ldb_seqnum_t sequence;
 } saver_t;
 
 static void
@@ -370,9 +460,14 @@ save_value(void *arg, const ldb_slice_t *ikey, const ldb_slice_t *v) {
 
   if (ldb_compare(s->ucmp, &pkey.user_key, &s->user_key) == 0) {
     s->state = (pkey.type == LDB_TYPE_VALUE) ? S_FOUND : S_DELETED;
+    s->sequence = pkey.sequence;
 
-    if (s->state == S_FOUND && s->value != NULL)
-      ldb_buffer_set(s->value, v->data, v->size);
+    if (s->state == S_FOUND) {
+      if (s->value != NULL)
+        ldb_buffer_set(s->value, v->data, v->size);
+      else if (s->pinned != NULL)
+        ldb_slice_set(s->pinned, v->data, v->size);
+    }
   }
 }
 
@@ -388,32 +483,235 @@ typedef struct getstate_s {
   ldb_filemeta_t *last_file_read;
   int last_file_read_level;
   ldb_vset_t *vset;
+  ldb_vbatch_t *batch;
   int status;
   int found;
+  ldb_cleanup_t *pin; /* Keeps a pinned result alive. */
+  /* Row cache state (unused if there is no row cache). */
+  ldb_lru_t *row_cache;
+  ldb_seqnum_t sequence;
+  ldb_ikey_t newest;
+  ldb_buffer_t row_key;
 } getstate_t;
 
+static ldb_tcursor_t *
+ldb_vbatch_cursor(ldb_vbatch_t *batch, int level, ldb_filemeta_t *f) {
+  const ldb_vector_t *files = &batch->version->files[0];
+  size_t i;
+
+  if (level > 0)
+    return &batch->cursors[files->length + level - 1];
+
+  for (i = 0; i < files->length; i++) {
+    if (files->items[i] == f)
+      break;
+  }
+
+  assert(i < files->length);
+
+  return &batch->cursors[i];
+}
+
+static void
+getstate_read(getstate_t *state,
+              int level,
+              ldb_filemeta_t *f,
+              const ldb_slice_t *ikey) {
+  ldb_tcache_t *cache = state->vset->table_cache;
+
+  if (state->pin != NULL) {
+    ldb_cleanup_t pin;
+
+    ldb_cleanup_init(&pin);
+
+    state->status = ldb_tcache_pinned_get(cache,
+                                          state->options,
+                                          f->number,
+                                          f->file_size,
+                                          ikey,
+                                          &state->saver,
+                                          save_value,
+                                          &pin);
+
+    if (state->status == LDB_OK && state->saver.state == S_FOUND)
+      ldb_cleanup_move(state->pin, &pin);
+    else
+      ldb_cleanup_clear(&pin);
+  } else if (state->batch != NULL) {
+    state->status = ldb_tcache_cursor_get(cache,
+                                          ldb_vbatch_cursor(state->batch,
+                                                            level, f),
+                                          state->options,
+                                          f->number,
+                                          f->file_size,
+                                          ikey,
+                                          &state->saver,
+                                          save_value);
+  } else {
+    state->status = ldb_tcache_get(cache,
+                                   state->options,
+                                   f->number,
+                                   f->file_size,
+                                   ikey,
+                                   &state->saver,
+                                   save_value);
+  }
+}
+
+/*
+ * Row Cache (for Version::Get)
+ *
+ * The row cache maps (file number, user key) to the newest version
+ * of that key stored in the file. Tables are immutable, so an entry
+ * never goes stale. It does however only answer reads whose snapshot
+ * can see the cached version: older snapshots read the table.
+ */
+
+typedef struct ldb_row_s {
+  ldb_seqnum_t sequence;
+  int deleted;
+  size_t size;
+  uint8_t data[1];
+} ldb_row_t;
+
+static void
+row_deleter(const ldb_slice_t *key, void *value) {
+  (void)key;
+  ldb_free(value);
+}
+
+static void
+row_release(void *arg1, void *arg2) {
+  ldb_lru_release((ldb_lru_t *)arg1, (ldb_lruhandle_t *)arg2);
+}
+
+static ldb_slice_t
+getstate_row_key(getstate_t *state, ldb_filemeta_t *f) {
+  ldb_buffer_reset(&state->row_key);
+  ldb_buffer_fixed64(&state->row_key, state->vset->row_cache_id);
+  ldb_buffer_fixed64(&state->row_key, f->number);
+  ldb_buffer_concat(&state->row_key, &state->saver.user_key);
+
+  return ldb_slice(state->row_key.data, state->row_key.size);
+}
+
+/* Returns 1 if the row cache answered the read, 0 on a
+   miss, and -1 if the cached row is too new to be used. */
+static int
+getstate_row_get(getstate_t *state, ldb_filemeta_t *f) {
+  ldb_slice_t key = getstate_row_key(state, f);
+  ldb_lruhandle_t *h = ldb_lru_lookup(state->row_cache, &key);
+  saver_t *s = &state->saver;
+  ldb_row_t *row;
+
+  if (h == NULL)
+    return 0;
+
+  row = ldb_lru_value(h);
+
+  if (row->sequence > state->sequence) {
+    ldb_lru_release(state->row_cache, h);
+    return -1;
+  }
+
+  s->state = row->deleted ? S_DELETED : S_FOUND;
+  s->sequence = row->sequence;
+
+  if (s->state == S_FOUND && s->pinned != NULL) {
+    ldb_slice_set(s->pinned, row->data, row->size);
+    ldb_cleanup_push(state->pin, row_release, state->row_cache, h);
+    h = NULL;
+  } else if (s->state == S_FOUND && s->value != NULL) {
+    ldb_buffer_set(s->value, row->data, row->size);
+  }
+
+  if (h != NULL)
+    ldb_lru_release(state->row_cache, h);
+
+  state->status = LDB_OK;
+
+  return 1;
+}
+
+static void
+getstate_row_put(getstate_t *state, ldb_filemeta_t *f) {
+  ldb_slice_t key = getstate_row_key(state, f);
+  saver_t *s = &state->saver;
+  const ldb_slice_t *value = NULL;
+  size_t size = 0;
+  ldb_row_t *row;
+
+  if (s->state == S_FOUND) {
+    value = s->value != NULL ? s->value : s->pinned;
+    size = value->size;
+  }
+
+  row = ldb_malloc(sizeof(ldb_row_t) + size);
+  row->sequence = s->sequence;
+  row->deleted = (s->state == S_DELETED);
+  row->size = size;
+
+  if (size > 0)
+    memcpy(row->data, value->data, size);
+
+  ldb_lru_release(state->row_cache,
+                  ldb_lru_insert(state->row_cache,
+                                 &key,
+                                 row,
+                                 sizeof(ldb_row_t) + size + key.size,
+                                 row_deleter));
+}
+
+/* Read the newest version of the key in the file and cache it,
+   then fall back to a regular read if the snapshot is older. */
+static void
+getstate_row_fill(getstate_t *state, int level, ldb_filemeta_t *f) {
+  saver_t *s = &state->saver;
+
+  getstate_read(state, level, f, &state->newest);
+
+  if (state->status != LDB_OK || s->state == S_NOTFOUND)
+    return;
+
+  if (s->state == S_DELETED || (s->state == S_FOUND && (s->value != NULL ||
+                                                         s->pinned != NULL))) {
+    getstate_row_put(state, f);
+  }
+
+  if (s->state != S_CORRUPT && s->sequence > state->sequence) {
+    if (state->pin != NULL)
+      ldb_cleanup_clear(state->pin);
+
+    s->state = S_NOTFOUND;
+
+    getstate_read(state, level, f, &state->ikey);
+  }
+}
+
 static int
 getstate_match(void *arg, int level, ldb_filemeta_t *f) {
   getstate_t *state = (getstate_t *)arg;
-  ldb_tcache_t *cache = state->vset->table_cache;
+  int rc = -1;
 
-  if (state->stats->seek_file == NULL &&
-      state->last_file_read != NULL) {
-    /* We have had more than one seek for this read. Charge the 1st file. */
-    state->stats->seek_file = state->last_file_read;
-    state->stats->seek_file_level = state->last_file_read_level;
-  }
+  if (state->row_cache != NULL)
+    rc = getstate_row_get(state, f);
 
-  state->last_file_read = f;
-  state->last_file_read_level = level;
+  if (rc <= 0) {
+    if (state->stats->seek_file == NULL &&
+        state->last_file_read != NULL) {
+      /* We have had more than one seek for this read. Charge the 1st file. */
+      state->stats->seek_file = state->last_file_read;
+      state->stats->seek_file_level = state->last_file_read_level;
+    }
 
-  state->status = ldb_tcache_get(cache,
-                                 state->options,
-                                 f->number,
-                                 f->file_size,
-                                 &state->ikey,
-                                 &state->saver,
-                                 save_value);
+    state->last_file_read = f;
+    state->last_file_read_level = level;
+
+    if (rc == 0)
+      getstate_row_fill(state, level, f);
+    else
+      getstate_read(state, level, f, &state->ikey);
+  }
 
   if (state->status != LDB_OK) {
     state->found = 1;
@@ -525,35 +823,86 @@ ldb_version_num_files(const ldb_version_t *ver, int level) {
   return ver->files[level].length;
 }
 
+static int
+level_may_match(ldb_version_t *ver, int level, const ldb_slice_t *prefix) {
+  const ldb_comparator_t *icmp = &ver->vset->icmp;
+  const ldb_vector_t *files = &ver->files[level];
+  ldb_filemeta_t *f;
+  uint32_t index;
+  ldb_ikey_t key;
+
+  ldb_ikey_init(&key);
+  ldb_ikey_set(&key, prefix, LDB_MAX_SEQUENCE, LDB_VALTYPE_SEEK);
+
+  index = find_file(icmp, files, &key);
+
+  ldb_ikey_clear(&key);
+
+  if (index >= files->length)
+    return 0;
+
+  /* Keys sharing a prefix are contiguous and sort at or after the
+     prefix itself. The first file ending at or after the prefix holds
+     such a key if any file in the level does. */
+  f = files->items[index];
+
+  return ldb_tcache_prefix_may_match(ver->vset->table_cache,
+                                     f->number,
+                                     f->file_size,
+                                     prefix);
+}
+
 void
 ldb_version_add_iterators(ldb_version_t *ver,
                           const ldb_readopt_t *options,
+                          const ldb_slice_t *prefix,
                           ldb_vector_t *iters) {
+  const ldb_comparator_t *icmp = &ver->vset->icmp;
   ldb_tcache_t *table_cache = ver->vset->table_cache;
+  uint32_t first, last;
   int level;
   size_t i;
 
-  /* Merge all level zero files together since they may overlap. */
+  /* Merge all level zero files together since they may overlap.
+     Files outside of the iterate bounds, or whose prefix filter
+     rules out "prefix", need not be opened at all. */
   for (i = 0; i < ver->files[0].length; i++) {
     ldb_filemeta_t *item = ver->files[0].items[i];
-    ldb_iter_t *iter = ldb_tcache_iterate(table_cache,
-                                          options,
-                                          item->number,
-                                          item->file_size,
-                                          NULL);
+    ldb_iter_t *iter;
+
+    if (!file_in_bounds(icmp->user_comparator, options, item))
+      continue;
+
+    if (prefix != NULL && !ldb_tcache_prefix_may_match(table_cache,
+                                                       item->number,
+                                                       item->file_size,
+                                                       prefix)) {
+      continue;
+    }
+
+    iter = ldb_tcache_iterate(table_cache,
+                              options,
+                              item->number,
+                              item->file_size,
+                              NULL);
 
     ldb_vector_push(iters, iter);
   }
 
   /* For levels > 0, we can use a concatenating iterator that sequentially
      walks through the non-overlapping files in the level, opening them
-     lazily. */
+     lazily. Levels with no files inside the iterate bounds, or with no
+     file that may hold "prefix", are skipped. */
   for (level = 1; level < LDB_NUM_LEVELS; level++) {
-    if (ver->files[level].length > 0) {
-      ldb_iter_t *iter = ldb_concatiter_create(ver, options, level);
+    file_bounds(icmp, &ver->files[level], options, &first, &last);
 
-      ldb_vector_push(iters, iter);
-    }
+    if (first >= last)
+      continue;
+
+    if (prefix != NULL && !level_may_match(ver, level, prefix))
+      continue;
+
+    ldb_vector_push(iters, ldb_concatiter_create(ver, options, level));
   }
 }
 
@@ -632,12 +981,15 @@ ldb_version_for_each_overlapping(ldb_version_t *ver,
   }
 }
 
-int
-ldb_version_get(ldb_version_t *ver,
-                const ldb_readopt_t *options,
-                const ldb_lkey_t *k,
-                ldb_buffer_t *value,
-                ldb_getstats_t *stats) {
+static int
+version_get(ldb_version_t *ver,
+            ldb_vbatch_t *batch,
+            const ldb_readopt_t *options,
+            const ldb_lkey_t *k,
+            ldb_buffer_t *value,
+            ldb_slice_t *pinned,
+            ldb_cleanup_t *pin,
+            ldb_getstats_t *stats) {
   getstate_t state;
 
   stats->seek_file = NULL;
@@ -652,11 +1004,28 @@ ldb_version_get(ldb_version_t *ver,
   state.options = options;
   state.ikey = ldb_lkey_internal_key(k);
   state.vset = ver->vset;
+  state.batch = batch;
+  state.pin = pin;
 
   state.saver.state = S_NOTFOUND;
   state.saver.ucmp = ver->vset->icmp.user_comparator;
   state.saver.user_key = ldb_lkey_user_key(k);
   state.saver.value = value;
+  state.saver.pinned = pinned;
+  state.saver.sequence = 0;
+
+  state.row_cache = ver->vset->options->row_cache;
+
+  if (state.row_cache != NULL) {
+    state.sequence = ldb_fixed64_decode(state.ikey.data
+                                      + state.ikey.size - 8) >> 8;
+
+    ldb_ikey_init(&state.newest);
+    ldb_ikey_set(&state.newest, &state.saver.user_key,
+                 LDB_MAX_SEQUENCE, LDB_VALTYPE_SEEK);
+
+    ldb_buffer_init(&state.row_key);
+  }
 
   ldb_version_for_each_overlapping(ver,
                                    &state.saver.user_key,
@@ -664,24 +1033,102 @@ ldb_version_get(ldb_version_t *ver,
                                    &state,
                                    &getstate_match);
 
+  if (state.row_cache != NULL) {
+    ldb_ikey_clear(&state.newest);
+    ldb_buffer_clear(&state.row_key);
+  }
+
   return state.found ? state.status : LDB_NOTFOUND;
 }
 
+int
+ldb_version_get(ldb_version_t *ver,
+                const ldb_readopt_t *options,
+                const ldb_lkey_t *k,
+                ldb_buffer_t *value,
+                ldb_getstats_t *stats) {
+  return version_get(ver, NULL, options, k, value, NULL, NULL, stats);
+}
+
+int
+ldb_version_get_pinned(ldb_version_t *ver,
+                       const ldb_readopt_t *options,
+                       const ldb_lkey_t *k,
+                       ldb_slice_t *value,
+                       ldb_cleanup_t *pin,
+                       ldb_getstats_t *stats) {
+  return version_get(ver, NULL, options, k, NULL, value, pin, stats);
+}
+
+/*
+ * Version Batch
+ */
+
+void
+ldb_vbatch_init(ldb_vbatch_t *batch, ldb_version_t *ver) {
+  size_t i;
+
+  batch->version = ver;
+  batch->length = ver->files[0].length + LDB_NUM_LEVELS - 1;
+  batch->cursors = ldb_malloc(batch->length * sizeof(ldb_tcursor_t));
+
+  for (i = 0; i < batch->length; i++)
+    ldb_tcursor_init(&batch->cursors[i]);
+}
+
+void
+ldb_vbatch_clear(ldb_vbatch_t *batch) {
+  ldb_tcache_t *cache = batch->version->vset->table_cache;
+  size_t i;
+
+  for (i = 0; i < batch->length; i++)
+    ldb_tcursor_clear(cache, &batch->cursors[i]);
+
+  ldb_free(batch->cursors);
+}
+
+int
+ldb_vbatch_get(ldb_vbatch_t *batch,
+               const ldb_readopt_t *options,
+               const ldb_lkey_t *k,
+               ldb_buffer_t *value,
+               ldb_getstats_t *stats) {
+  return version_get(batch->version, batch, options, k,
+                     value, NULL, NULL, stats);
+}
+
 int
 ldb_version_update_stats(ldb_version_t *ver, const ldb_getstats_t *stats) {
+  if (ldb_version_charge_seek(ver, stats))
+    return ldb_version_mark_seek_file(ver, stats);
+
+  return 0;
+}
+
+int
+ldb_version_charge_seek(ldb_version_t *ver, const ldb_getstats_t *stats) {
   ldb_filemeta_t *f = stats->seek_file;
 
-  if (f != NULL) {
-    f->allowed_seeks--;
+  if (f == NULL)
+    return 0;
 
-    if (f->allowed_seeks <= 0 && ver->file_to_compact == NULL) {
-      ver->file_to_compact = f;
-      ver->file_to_compact_level = stats->seek_file_level;
-      return 1;
-    }
-  }
+  if (ldb_atomic_fetch_sub(&f->allowed_seeks, 1, ldb_order_relaxed) > 1)
+    return 0;
 
-  return 0;
+  return ldb_atomic_load_ptr(&ver->file_to_compact, ldb_order_acquire) == NULL;
+}
+
+int
+ldb_version_mark_seek_file(ldb_version_t *ver, const ldb_getstats_t *stats) {
+  if (ver->file_to_compact != NULL)
+    return 0;
+
+  ver->file_to_compact_level = stats->seek_file_level;
+
+  ldb_atomic_store_ptr(&ver->file_to_compact, stats->seek_file,
+                       ldb_order_release);
+
+  return 1;
 }
 
 int
@@ -1121,12 +1568,20 @@ ldb_vset_init(ldb_vset_t *vset,
   vset->descriptor_file = NULL;
   vset->descriptor_log = NULL;
   vset->current = NULL;
+  vset->row_cache_id = 0;
+
+  if (options->row_cache != NULL)
+    vset->row_cache_id = ldb_lru_newid(options->row_cache);
 
   ldb_version_init(&vset->dummy_versions, vset);
 
   for (level = 0; level < LDB_NUM_LEVELS; level++)
     ldb_buffer_init(&vset->compact_pointer[level]);
 
+  vset->writing_manifest = 0;
+
+  ldb_cond_init(&vset->manifest_written);
+
   ldb_vset_append_version(vset, ldb_version_create(vset));
 }
 
@@ -1146,6 +1601,8 @@ ldb_vset_clear(ldb_vset_t *vset) {
 
   for (level = 0; level < LDB_NUM_LEVELS; level++)
     ldb_buffer_clear(&vset->compact_pointer[level]);
+
+  ldb_cond_destroy(&vset->manifest_written);
 }
 
 ldb_vset_t *
@@ -1246,6 +1703,13 @@ ldb_vset_log_and_apply(ldb_vset_t *vset, ldb_vedit_t *edit, ldb_mutex_t *mu) {
 
   fname[0] = '\0';
 
+  /* Another compaction may be in the middle of writing its edit
+     (with *mu released). Wait for it so edits are applied in order. */
+  while (vset->writing_manifest)
+    ldb_cond_wait(&vset->manifest_written, mu);
+
+  vset->writing_manifest = 1;
+
   if (edit->has_log_number) {
     assert(edit->log_number >= vset->log_number);
     assert(edit->log_number < vset->next_file_number);
@@ -1345,6 +1809,10 @@ ldb_vset_log_and_apply(ldb_vset_t *vset, ldb_vedit_t *edit, ldb_mutex_t *mu) {
     }
   }
 
+  vset->writing_manifest = 0;
+
+  ldb_cond_broadcast(&vset->manifest_written);
+
   return rc;
 }
 
@@ -1588,6 +2056,31 @@ ldb_vset_mark_file_number_used(ldb_vset_t *vset, uint64_t number) {
     vset->next_file_number = number + 1;
 }
 
+static double
+ldb_vset_level_score(const ldb_vset_t *vset,
+                     const ldb_version_t *v,
+                     int level) {
+  if (level == 0) {
+    /* We treat level-0 specially by bounding the number of files
+     * instead of number of bytes for two reasons:
+     *
+     * (1) With larger write-buffer sizes, it is nice not to do too
+     * many level-0 compactions.
+     *
+     * (2) The files in level-0 are merged on every read and
+     * therefore we wish to avoid too many files when the individual
+     * file size is small (perhaps because of a small write-buffer
+     * setting, or very high compression ratios, or lots of
+     * overwrites/deletions).
+     */
+    return v->files[level].length / (double)(LDB_L0_COMPACTION_TRIGGER);
+  }
+
+  /* Compute the ratio of current size to size limit. */
+  return (double)total_file_size(&v->files[level])
+       / max_bytes_for_level(vset->options, level);
+}
+
 static void
 ldb_vset_finalize(ldb_vset_t *vset, ldb_version_t *v) {
   /* Precomputed best level for next compaction. */
@@ -1596,28 +2089,7 @@ ldb_vset_finalize(ldb_vset_t *vset, ldb_version_t *v) {
   int level;
 
   for (level = 0; level < LDB_NUM_LEVELS - 1; level++) {
-    double score;
-
-    if (level == 0) {
-      /* We treat level-0 specially by bounding the number of files
-       * instead of number of bytes for two reasons:
-       *
-       * (1) With larger write-buffer sizes, it is nice not to do too
-       * many level-0 compactions.
-       *
-       * (2) The files in level-0 are merged on every read and
-       * therefore we wish to avoid too many files when the individual
-       * file size is small (perhaps because of a small write-buffer
-       * setting, or very high compression ratios, or lots of
-       * overwrites/deletions).
-       */
-      score = v->files[level].length / (double)(LDB_L0_COMPACTION_TRIGGER);
-    } else {
-      /* Compute the ratio of current size to size limit. */
-      uint64_t level_bytes = total_file_size(&v->files[level]);
-
-      score = (double)level_bytes / max_bytes_for_level(vset->options, level);
-    }
+    double score = ldb_vset_level_score(vset, v, level);
 
     if (score > best_score) {
       best_level = level;
@@ -1899,10 +2371,13 @@ ldb_inputiter_create(ldb_vset_t *vset, ldb_compaction_t *c) {
       } else {
         /* Create concatenating iterator for the files from this level. */
         list[num++] = ldb_twoiter_create(ldb_numiter_create(&vset->icmp,
-                                                            &c->inputs[which]),
+                                                            &c->inputs[which],
+                                                            &options),
                                          &get_file_iterator,
+                                         NULL,
                                          vset->table_cache,
-                                         &options);
+                                         &options,
+                                         NULL);
       }
     }
   }
@@ -1916,59 +2391,38 @@ ldb_inputiter_create(ldb_vset_t *vset, ldb_compaction_t *c) {
   return result;
 }
 
-static void
+static int
 ldb_vset_setup_other_inputs(ldb_vset_t *vset, ldb_compaction_t *c);
 
-ldb_compaction_t *
-ldb_vset_pick_compaction(ldb_vset_t *vset) {
-  ldb_compaction_t *c;
-  int level;
-  size_t i;
-
-  /* We prefer compactions triggered by too much data in a level over
-     the compactions triggered by seeks. */
-  int size_compaction = (vset->current->compaction_score >= 1);
-  int seek_compaction = (vset->current->file_to_compact != NULL);
-
-  if (size_compaction) {
-    level = vset->current->compaction_level;
-
-    assert(level >= 0);
-    assert(level + 1 < LDB_NUM_LEVELS);
-
-    c = ldb_compaction_create(vset->options, level);
+static void
+ldb_compaction_mark_inputs(ldb_compaction_t *c, int value);
 
-    /* Pick the first file that comes after compact_pointer[level]. */
-    for (i = 0; i < vset->current->files[level].length; i++) {
-      ldb_filemeta_t *f = vset->current->files[level].items[i];
+static int
+any_being_compacted(const ldb_vector_t *files) {
+  size_t i;
 
-      if (vset->compact_pointer[level].size == 0 ||
-          ldb_compare(&vset->icmp, &f->largest,
-                      &vset->compact_pointer[level]) > 0) {
-        ldb_vector_push(&c->inputs[0], f);
-        break;
-      }
-    }
+  for (i = 0; i < files->length; i++) {
+    const ldb_filemeta_t *f = files->items[i];
 
-    if (c->inputs[0].length == 0) {
-      /* Wrap-around to the beginning of the key space. */
-      ldb_vector_push(&c->inputs[0], vset->current->files[level].items[0]);
-    }
-  } else if (seek_compaction) {
-    level = vset->current->file_to_compact_level;
-    c = ldb_compaction_create(vset->options, level);
-    ldb_vector_push(&c->inputs[0], vset->current->file_to_compact);
-  } else {
-    return NULL;
+    if (f->being_compacted)
+      return 1;
   }
 
+  return 0;
+}
+
+/* Finish setting up a compaction whose initial input has been placed
+   in c->inputs[0]. Returns NULL (and deletes "c") if the compaction
+   would conflict with one which is already in progress. */
+static ldb_compaction_t *
+ldb_vset_setup_compaction(ldb_vset_t *vset, ldb_compaction_t *c) {
   c->input_version = vset->current;
 
   ldb_version_ref(c->input_version);
 
   /* Files in level 0 may overlap each other,
      so pick up all overlapping ones. */
-  if (level == 0) {
+  if (c->level == 0) {
     ldb_slice_t smallest, largest;
 
     ldb_vset_get_range(vset, &c->inputs[0], &smallest, &largest);
@@ -1983,7 +2437,104 @@ ldb_vset_pick_compaction(ldb_vset_t *vset) {
     assert(c->inputs[0].length > 0);
   }
 
-  ldb_vset_setup_other_inputs(vset, c);
+  if (!ldb_vset_setup_other_inputs(vset, c)) {
+    ldb_compaction_destroy(c);
+    return NULL;
+  }
+
+  return c;
+}
+
+/* Try to pick a size compaction for "level", starting with the first
+   file that comes after compact_pointer[level] and skipping any files
+   which are already being compacted. */
+static ldb_compaction_t *
+ldb_vset_pick_level(ldb_vset_t *vset, int level) {
+  const ldb_vector_t *files = &vset->current->files[level];
+  ldb_compaction_t *c;
+  size_t start, i;
+
+  assert(level >= 0);
+  assert(level + 1 < LDB_NUM_LEVELS);
+
+  if (files->length == 0)
+    return NULL;
+
+  /* Level-0 files may overlap, so only one level-0
+     compaction can be running at any given time. */
+  if (level == 0 && any_being_compacted(files))
+    return NULL;
+
+  /* Pick the first file that comes after compact_pointer[level]. */
+  for (start = 0; start < files->length; start++) {
+    ldb_filemeta_t *f = files->items[start];
+
+    if (vset->compact_pointer[level].size == 0 ||
+        ldb_compare(&vset->icmp, &f->largest,
+                    &vset->compact_pointer[level]) > 0) {
+      break;
+    }
+  }
+
+  /* Wrap-around to the beginning of the key space. */
+  if (start == files->length)
+    start = 0;
+
+  for (i = 0; i < files->length; i++) {
+    ldb_filemeta_t *f = files->items[(start + i) % files->length];
+
+    if (f->being_compacted)
+      continue;
+
+    c = ldb_compaction_create(vset->options, level);
+
+    ldb_vector_push(&c->inputs[0], f);
+
+    c = ldb_vset_setup_compaction(vset, c);
+
+    if (c != NULL)
+      return c;
+
+    /* Every level-0 candidate ends up with the same inputs. */
+    if (level == 0)
+      break;
+  }
+
+  return NULL;
+}
+
+ldb_compaction_t *
+ldb_vset_pick_compaction(ldb_vset_t *vset) {
+  ldb_version_t *current = vset->current;
+  ldb_compaction_t *c = NULL;
+  int level;
+
+  /* We prefer compactions triggered by too much data in a level over
+     the compactions triggered by seeks. The level with the highest
+     score is tried first. Other levels are only considered when every
+     candidate in that level conflicts with a running compaction. */
+  if (current->compaction_score >= 1) {
+    c = ldb_vset_pick_level(vset, current->compaction_level);
+
+    for (level = 0; c == NULL && level < LDB_NUM_LEVELS - 1; level++) {
+      if (level == current->compaction_level)
+        continue;
+
+      if (ldb_vset_level_score(vset, current, level) >= 1)
+        c = ldb_vset_pick_level(vset, level);
+    }
+  }
+
+  if (c == NULL && current->file_to_compact != NULL &&
+                  !current->file_to_compact->being_compacted) {
+    level = current->file_to_compact_level;
+    c = ldb_compaction_create(vset->options, level);
+    ldb_vector_push(&c->inputs[0], current->file_to_compact);
+    c = ldb_vset_setup_compaction(vset, c);
+  }
+
+  if (c != NULL)
+    ldb_compaction_mark_inputs(c, 1);
 
   return c;
 }
@@ -2087,7 +2638,7 @@ add_boundary_inputs(const ldb_comparator_t *icmp,
   }
 }
 
-static void
+static int
 ldb_vset_setup_other_inputs(ldb_vset_t *vset, ldb_compaction_t *c) {
   int level = ldb_compaction_level(c);
   ldb_slice_t smallest, largest;
@@ -2133,7 +2684,8 @@ ldb_vset_setup_other_inputs(ldb_vset_t *vset, ldb_compaction_t *c) {
 
     if (expanded0.length > c->inputs[0].length &&
         inputs1_size + expanded0_size <
-            expanded_compaction_byte_size_limit(vset->options)) {
+            expanded_compaction_byte_size_limit(vset->options) &&
+        !any_being_compacted(&expanded0)) {
       ldb_slice_t new_start, new_limit;
       ldb_vector_t expanded1;
 
@@ -2180,6 +2732,13 @@ ldb_vset_setup_other_inputs(ldb_vset_t *vset, ldb_compaction_t *c) {
     ldb_vector_clear(&expanded0);
   }
 
+  /* Back off if another compaction is already working on some of the
+     inputs (or would be writing into the range of our outputs). */
+  if (any_being_compacted(&c->inputs[0]) ||
+      any_being_compacted(&c->inputs[1])) {
+    return 0;
+  }
+
   /* Compute the set of grandparent files that overlap this compaction
      (parent == level+1; grandparent == level+2). */
   if (level + 2 < LDB_NUM_LEVELS) {
@@ -2195,6 +2754,8 @@ ldb_vset_setup_other_inputs(ldb_vset_t *vset, ldb_compaction_t *c) {
   ldb_buffer_copy(&vset->compact_pointer[level], &largest);
 
   ldb_vedit_set_compact_pointer(&c->edit, level, &largest);
+
+  return 1;
 }
 
 ldb_compaction_t *
@@ -2241,10 +2802,17 @@ ldb_vset_compact_range(ldb_vset_t *vset,
 
   ldb_vector_swap(&c->inputs[0], &inputs);
 
-  ldb_vset_setup_other_inputs(vset, c);
-
   ldb_vector_clear(&inputs);
 
+  /* Manual compactions are only run while no other compaction is in
+     progress, so the inputs should never conflict with anything. */
+  if (!ldb_vset_setup_other_inputs(vset, c)) {
+    ldb_compaction_destroy(c);
+    return NULL;
+  }
+
+  ldb_compaction_mark_inputs(c, 1);
+
   return c;
 }
 
@@ -2261,6 +2829,7 @@ ldb_compaction_init(ldb_compaction_t *c,
   c->level = level;
   c->max_output_file_size = max_file_size_for_level(options, level);
   c->input_version = NULL;
+  c->marked = 0;
   c->grandparent_index = 0;
   c->seen_key = 0;
   c->overlapped_bytes = 0;
@@ -2274,10 +2843,30 @@ ldb_compaction_init(ldb_compaction_t *c,
   ldb_vector_init(&c->grandparents);
 }
 
+static void
+ldb_compaction_mark_inputs(ldb_compaction_t *c, int value) {
+  int which;
+  size_t i;
+
+  for (which = 0; which < 2; which++) {
+    for (i = 0; i < c->inputs[which].length; i++) {
+      ldb_filemeta_t *f = c->inputs[which].items[i];
+
+      f->being_compacted = value;
+    }
+  }
+
+  c->marked = value;
+}
+
 static void
 ldb_compaction_clear(ldb_compaction_t *c) {
-  if (c->input_version != NULL)
+  if (c->input_version != NULL) {
+    if (c->marked)
+      ldb_compaction_mark_inputs(c, 0);
+
     ldb_version_unref(c->input_version);
+  }
 
   ldb_vedit_clear(&c->edit);
   ldb_vector_clear(&c->inputs[0]);
@@ -2298,6 +2887,24 @@ ldb_compaction_destroy(ldb_compaction_t *c) {
   ldb_free(c);
 }
 
+ldb_compaction_t *
+ldb_compaction_fork(const ldb_compaction_t *c) {
+  ldb_compaction_t *r = ldb_malloc(sizeof(ldb_compaction_t));
+
+  ldb_compaction_init(r, c->input_version->vset->options, c->level);
+
+  r->max_output_file_size = c->max_output_file_size;
+  r->input_version = c->input_version;
+
+  ldb_version_ref(r->input_version);
+
+  ldb_vector_copy(&r->inputs[0], &c->inputs[0]);
+  ldb_vector_copy(&r->inputs[1], &c->inputs[1]);
+  ldb_vector_copy(&r->grandparents, &c->grandparents);
+
+  return r;
+}
+
 int
 ldb_compaction_level(const ldb_compaction_t *c) {
   return c->level;
@@ -2417,6 +3024,9 @@ ldb_compaction_should_stop_before(ldb_compaction_t *c,
 void
 ldb_compaction_release_inputs(ldb_compaction_t *c) {
   if (c->input_version != NULL) {
+    if (c->marked)
+      ldb_compaction_mark_inputs(c, 0);
+
     ldb_version_unref(c->input_version);
     c->input_version = NULL;
   }
@@ -44,6 +44,14 @@ typedef struct ldb_version_s ldb_version_t;
 typedef struct ldb_vset_s ldb_vset_t;
 typedef struct ldb_compaction_s ldb_compaction_t;
 
+/* State for a batch of lookups against a single version. Holds one
+   table cursor for every level-0 file and one for each other level. */
+typedef struct ldb_vbatch_s {
+  ldb_version_t *version;
+  ldb_tcursor_t *cursors;
+  size_t length;
+} ldb_vbatch_t;
+
 struct ldb_version_s {
   ldb_vset_t *vset;    /* VersionSet to which this Version belongs. */
   ldb_version_t *next; /* Next version in linked list. */
@@ -53,7 +61,8 @@ struct ldb_version_s {
   /* List of files per level. */
   ldb_vector_t files[LDB_NUM_LEVELS]; /* ldb_filemeta_t[] */
 
-  /* Next file to compact based on seek stats. */
+  /* Next file to compact based on seek stats (set at most once,
+     may be read atomically without the mutex). */
   ldb_filemeta_t *file_to_compact;
   int file_to_compact_level;
 
@@ -68,6 +77,7 @@ struct ldb_vset_s {
   const char *dbname;
   const ldb_dbopt_t *options;
   ldb_tcache_t *table_cache;
+  uint64_t row_cache_id;
   ldb_comparator_t icmp;
   uint64_t next_file_number;
   uint64_t manifest_file_number;
@@ -84,6 +94,10 @@ struct ldb_vset_s {
   /* Per-level key at which the next compaction at that level should start.
      Either an empty string, or a valid ldb_ikey_t. */
   ldb_buffer_t compact_pointer[LDB_NUM_LEVELS];
+
+  /* Serializes MANIFEST writes between concurrent log_and_apply() calls. */
+  int writing_manifest;
+  ldb_cond_t manifest_written;
 };
 
 struct ldb_compaction_s {
@@ -91,6 +105,7 @@ struct ldb_compaction_s {
   uint64_t max_output_file_size;
   ldb_version_t *input_version;
   ldb_vedit_t edit;
+  int marked; /* Inputs are flagged as being_compacted. */
 
   /* Each compaction reads inputs from "level" and "level+1". */
   ldb_vector_t inputs[2]; /* The two sets of inputs. */
@@ -154,11 +169,14 @@ int
 ldb_version_num_files(const ldb_version_t *ver, int level);
 
 /* Append to *iters a sequence of iterators that will
-   yield the contents of this Version when merged together. */
+   yield the contents of this Version when merged together.
+   If "prefix" is non-NULL, tables whose prefix filter proves
+   they hold no key starting with it are left out. */
 /* REQUIRES: This version has been saved (see VersionSet::SaveTo) */
 void
 ldb_version_add_iterators(ldb_version_t *ver,
                           const ldb_readopt_t *options,
+                          const ldb_slice_t *prefix,
                           ldb_vector_t *iters);
 
 /* Lookup the value for key. If found, store it in *val and
@@ -171,12 +189,59 @@ ldb_version_get(ldb_version_t *ver,
                 ldb_buffer_t *value,
                 ldb_getstats_t *stats);
 
+/* Same as ldb_version_get(), but points *value into the block (or
+   cached row) holding it. The functions releasing that memory are
+   added to "pin" on success. */
+/* REQUIRES: lock is not held */
+int
+ldb_version_get_pinned(ldb_version_t *ver,
+                       const ldb_readopt_t *options,
+                       const ldb_lkey_t *k,
+                       ldb_slice_t *value,
+                       ldb_cleanup_t *pin,
+                       ldb_getstats_t *stats);
+
+/*
+ * Version Batch
+ */
+
+/* Prepare a batch of lookups against "ver". The caller must keep
+   a reference to "ver" until ldb_vbatch_clear() is called. */
+void
+ldb_vbatch_init(ldb_vbatch_t *batch, ldb_version_t *ver);
+
+void
+ldb_vbatch_clear(ldb_vbatch_t *batch);
+
+/* Same as ldb_version_get(), but keeps tables and data blocks open
+   between calls. Keys should be passed in ascending order. */
+/* REQUIRES: lock is not held */
+int
+ldb_vbatch_get(ldb_vbatch_t *batch,
+               const ldb_readopt_t *options,
+               const ldb_lkey_t *k,
+               ldb_buffer_t *value,
+               ldb_getstats_t *stats);
+
 /* Adds "stats" into the current state. Returns true if a new
    compaction may need to be triggered, false otherwise. */
 /* REQUIRES: lock is held */
 int
 ldb_version_update_stats(ldb_version_t *ver, const ldb_getstats_t *stats);
 
+/* Charge the seek recorded in "stats" without holding the lock.
+   Returns true if the file has run out of allowed seeks and should
+   be passed to ldb_version_mark_seek_file() (with the lock held). */
+int
+ldb_version_charge_seek(ldb_version_t *ver, const ldb_getstats_t *stats);
+
+/* Schedule the file recorded in "stats" (which has been charged
+   already) for compaction. Returns true if a new compaction may
+   need to be triggered. */
+/* REQUIRES: lock is held */
+int
+ldb_version_mark_seek_file(ldb_version_t *ver, const ldb_getstats_t *stats);
+
 /* Record a sample of bytes read at the specified internal key.
    Samples are taken approximately once every LDB_READ_BYTES_PERIOD
    bytes. Returns true if a new compaction may need to be triggered. */
@@ -275,7 +340,7 @@ ldb_vset_needs_compaction(const ldb_vset_t *vset);
    is both saved to persistent state and installed as the new
    current version. Will release *mu while actually writing to the file. */
 /* REQUIRES: *mu is held on entry. */
-/* REQUIRES: no other thread concurrently calls log_and_apply() */
+/* Concurrent callers (e.g. parallel compactions) are serialized. */
 int
 ldb_vset_log_and_apply(ldb_vset_t *vset, ldb_vedit_t *edit, ldb_mutex_t *mu);
 
@@ -325,7 +390,10 @@ ldb_inputiter_create(ldb_vset_t *vset, ldb_compaction_t *c);
 /* Pick level and inputs for a new compaction.
    Returns NULL if there is no compaction to be done.
    Otherwise returns a pointer to a heap-allocated object that
-   describes the compaction. Caller should delete the result. */
+   describes the compaction. Caller should delete the result.
+   Files which are inputs to a compaction still in progress are
+   never picked, and the inputs of the result are marked as being
+   compacted until the compaction is released or deleted. */
 ldb_compaction_t *
 ldb_vset_pick_compaction(ldb_vset_t *vset);
 
@@ -356,6 +424,13 @@ ldb_compaction_create(const ldb_dbopt_t *options, int level);
 void
 ldb_compaction_destroy(ldb_compaction_t *c);
 
+/* Create a compaction over the same inputs as "c" with fresh
+   iteration state (used to process a subrange of "c" on another
+   thread). The result never marks or unmarks the inputs; "c" must
+   outlive it. REQUIRES: mutex is held. */
+ldb_compaction_t *
+ldb_compaction_fork(const ldb_compaction_t *c);
+
 /* Return the level that is being compacted. Inputs from "level"
    and "level+1" will be merged to produce a set of "level+1" files. */
 int
@@ -401,7 +476,7 @@ ldb_compaction_should_stop_before(ldb_compaction_t *c,
                                   const ldb_slice_t *ikey);
 
 /* Release the input version for the compaction, once the compaction
-   is successful. */
+   is successful. Also clears the being_compacted flag on its inputs. */
 void
 ldb_compaction_release_inputs(ldb_compaction_t *c);
 
@@ -37,13 +37,6 @@
  *    data: uint8[len]
  */
 
-/*
- * Constants
- */
-
-/* Header has an 8-byte sequence number followed by a 4-byte count. */
-#define LDB_HEADER 12
-
 /*
  * Batch
  */
@@ -74,9 +67,9 @@ ldb_batch_clear(ldb_batch_t *batch) {
 
 void
 ldb_batch_reset(ldb_batch_t *batch) {
-  ldb_buffer_resize(&batch->rep, LDB_HEADER);
+  ldb_buffer_resize(&batch->rep, LDB_BATCH_HEADER);
 
-  memset(batch->rep.data, 0, LDB_HEADER);
+  memset(batch->rep.data, 0, LDB_BATCH_HEADER);
 }
 
 size_t
@@ -90,10 +83,10 @@ ldb_batch_iterate(const ldb_batch_t *batch, ldb_handler_t *handler) {
   ldb_slice_t key, value;
   int found = 0;
 
-  if (input.size < LDB_HEADER)
+  if (input.size < LDB_BATCH_HEADER)
     return LDB_CORRUPTION; /* "malformed WriteBatch (too small)" */
 
-  ldb_slice_eat(&input, LDB_HEADER);
+  ldb_slice_eat(&input, LDB_BATCH_HEADER);
 
   while (input.size > 0) {
     int tag = input.data[0];
@@ -175,12 +168,12 @@ ldb_batch_del(ldb_batch_t *batch, const ldb_slice_t *key) {
 
 void
 ldb_batch_append(ldb_batch_t *dst, const ldb_batch_t *src) {
-  assert(src->rep.size >= LDB_HEADER);
+  assert(src->rep.size >= LDB_BATCH_HEADER);
 
   ldb_batch_set_count(dst, ldb_batch_count(dst) + ldb_batch_count(src));
 
-  ldb_buffer_append(&dst->rep, src->rep.data + LDB_HEADER,
-                               src->rep.size - LDB_HEADER);
+  ldb_buffer_append(&dst->rep, src->rep.data + LDB_BATCH_HEADER,
+                               src->rep.size - LDB_BATCH_HEADER);
 }
 
 static void
@@ -218,9 +211,45 @@ ldb_batch_insert_into(const ldb_batch_t *batch, ldb_memtable_t *table) {
   return ldb_batch_iterate(batch, &handler);
 }
 
+static void
+memtable_put_concurrently(ldb_handler_t *handler,
+                          const ldb_slice_t *key,
+                          const ldb_slice_t *value) {
+  ldb_memtable_t *table = handler->state;
+  ldb_seqnum_t seq = handler->number;
+
+  ldb_memtable_add_concurrently(table, seq, LDB_TYPE_VALUE, key, value);
+
+  handler->number++;
+}
+
+static void
+memtable_del_concurrently(ldb_handler_t *handler, const ldb_slice_t *key) {
+  static const ldb_slice_t value = {NULL, 0, 0};
+  ldb_memtable_t *table = handler->state;
+  ldb_seqnum_t seq = handler->number;
+
+  ldb_memtable_add_concurrently(table, seq, LDB_TYPE_DELETION, key, &value);
+
+  handler->number++;
+}
+
+int
+ldb_batch_insert_concurrently(const ldb_batch_t *batch,
+                              ldb_memtable_t *table) {
+  ldb_handler_t handler;
+
+  handler.state = table;
+  handler.number = ldb_batch_sequence(batch);
+  handler.put = memtable_put_concurrently;
+  handler.del = memtable_del_concurrently;
+
+  return ldb_batch_iterate(batch, &handler);
+}
+
 void
 ldb_batch_set_contents(ldb_batch_t *batch, const ldb_slice_t *contents) {
-  assert(contents->size >= LDB_HEADER);
+  assert(contents->size >= LDB_BATCH_HEADER);
 
   ldb_buffer_copy(&batch->rep, contents);
 }
@@ -234,3 +263,21 @@ size_t
 ldb_batch_size(const ldb_batch_t *batch) {
   return batch->rep.size;
 }
+
+ldb_slice_t
+ldb_batch_body(const ldb_batch_t *batch) {
+  ldb_slice_t body;
+
+  assert(batch->rep.size >= LDB_BATCH_HEADER);
+
+  ldb_slice_set(&body, batch->rep.data + LDB_BATCH_HEADER,
+                       batch->rep.size - LDB_BATCH_HEADER);
+
+  return body;
+}
+
+void
+ldb_batch_header(uint8_t *zp, ldb_seqnum_t seq, int count) {
+  ldb_fixed64_write(zp + 0, seq);
+  ldb_fixed32_write(zp + 8, count);
+}
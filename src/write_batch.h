@@ -36,6 +36,13 @@
  * external synchronization.
  */
 
+/*
+ * Constants
+ */
+
+/* Header has an 8-byte sequence number followed by a 4-byte count. */
+#define LDB_BATCH_HEADER 12
+
 /*
  * Types
  */
@@ -131,6 +138,12 @@ ldb_batch_append(ldb_batch_t *dst, const ldb_batch_t *src);
 int
 ldb_batch_insert_into(const ldb_batch_t *batch, struct ldb_memtable_s *table);
 
+/* Same as ldb_batch_insert_into(), but may run in parallel with
+   other batches being inserted into the same memtable. */
+int
+ldb_batch_insert_concurrently(const ldb_batch_t *batch,
+                              struct ldb_memtable_s *table);
+
 void
 ldb_batch_set_contents(ldb_batch_t *batch, const ldb_slice_t *contents);
 
@@ -140,4 +153,14 @@ ldb_batch_contents(const ldb_batch_t *batch);
 size_t
 ldb_batch_size(const ldb_batch_t *batch);
 
+/* Return the records of the batch, without the header. */
+ldb_slice_t
+ldb_batch_body(const ldb_batch_t *batch);
+
+/* Encode a header for a batch of `count` entries starting at `seq`.
+   Followed by the bodies of one or more batches holding `count`
+   entries in total, this forms a valid batch representation. */
+void
+ldb_batch_header(uint8_t *zp, ldb__seqnum_t seq, int count);
+
 #endif /* LDB_WRITE_BATCH_H */